@@ -0,0 +1,723 @@
+/**
+ * Purpose: Closed loop autoplay. See autoplay.h
+ */
+
+#include<stddef.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#ifndef _WIN32
+#include<signal.h>
+#include<sys/types.h>
+#endif
+#include"autoplay.h"
+#include"board.h"
+#include"bitboard.h"
+#include"timing.h"
+
+#define BOARD_NOT_READY 2   // The game is mid click or hasn't got to our clicks yet
+
+// Everything the stages share. Only touched under lock once the stages start
+struct pipeline_s {
+    AutoplayTarget* target;
+    const AutoplayConfig* config;
+    AutoplayStats* stats;
+    PoolLock lock;
+    PoolCondition changed;            // Anything below changed
+    Snapshot board;                   // The newest board read
+    DWORD boardClicks;                // Tiles the game had clicked when it was read
+    DWORD boardNumber;                // Boards read so far
+    unsigned short queue[AUTOPLAY_MAX_TILES];  // Tiles waiting to be sent
+    DWORD queued;
+    uint32_t sentTiles[BITBOARD_ROWS];  // Tiles ever queued, so a board that's behind can't send one twice
+    int clicking;                     // The clicker has taken tiles it hasn't finished sending
+    int stuck;                        // The last board proved nothing new but was behind, so no guess
+    int finished;                     // Set by Finish when the game is over or a stage fails. Only read under lock
+    unsigned char lastField[MINEFIELD_SIZE];  // The last board that showed every click sent. Solver only
+    DWORD lastClicks;                 // Tiles the game had clicked when it was read
+    int haveLast;
+    unsigned int state;               // Random state for guesses
+
+    // Each stage's own. Too big for the stack
+    Snapshot reading;
+    Snapshot solving;
+    unsigned char kinds[KIND_GRID_SIZE];
+    IncrementalSolver solver;         // Kept from board to board, so each only costs what changed
+    ProbabilityResult chances;
+};
+
+void InitAutoplayConfig(AutoplayConfig* config) {
+/**
+ * Purpose: Fills in the defaults: pipelined, with the usual timeout
+ * @param config : AutoplayConfig* - the config
+ * @return : void
+ */
+
+    config->mode      = AUTOPLAY_PIPELINED;
+    config->seed      = 1;
+    config->timeoutMs = AUTOPLAY_TIMEOUT_MS;
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK MatchWindow(HWND window, LPARAM argument) {
+/**
+ * Purpose: EnumWindows callback. Stops at winmine's main window in the
+ *          process we're after
+ * @param window : HWND - a top level window
+ * @param argument : LPARAM - AutoplayTarget* whose context holds the PID and gets the window
+ * @return : BOOL - FALSE once it's found
+ */
+
+    AutoplayTarget* target = (AutoplayTarget*)argument;
+    char className[32];
+    DWORD PID = 0;
+
+    GetWindowThreadProcessId(window, &PID);
+    if (PID != (DWORD)(uintptr_t)target->context) return TRUE;
+    if (!GetClassNameA(window, className, sizeof(className)) || strcmp(className, "Minesweeper")) return TRUE;
+    target->context = window;
+    return FALSE;
+}
+
+static int WindowClick(AutoplayTarget* target, const unsigned short* tiles, DWORD numTiles) {
+/**
+ * Purpose: Clicks tiles by sending winmine's window the same button down and
+ *          up a real click does. SendMessage waits for the window to handle
+ *          each one, so the field is finished changing when it returns
+ * @param target : AutoplayTarget* - the game. context is its window
+ * @param tiles : const unsigned short* - minefield offsets to click
+ * @param numTiles : DWORD - number of tiles
+ * @return : int - 0 on success
+ */
+
+    HWND window = (HWND)target->context;
+
+    for (DWORD i = 0; i < numTiles; i++) {
+        int x = WINMINE_BOARD_LEFT + (tiles[i] % ROW_STRIDE - 1)*WINMINE_TILE_PIXELS + WINMINE_TILE_PIXELS/2;
+        int y = WINMINE_BOARD_TOP + (tiles[i] / ROW_STRIDE - 1)*WINMINE_TILE_PIXELS + WINMINE_TILE_PIXELS/2;
+
+        AtomicAdd(&target->sequence, 1);
+        SendMessageA(window, WM_LBUTTONDOWN, MK_LBUTTON, MAKELPARAM(x, y));
+        SendMessageA(window, WM_LBUTTONUP, 0, MAKELPARAM(x, y));
+        AtomicAdd(&target->clicked, 1);
+        AtomicAdd(&target->sequence, 1);
+    }
+    return 0;
+}
+
+static int LocalProgress(AutoplayTarget* target, DWORD* sequence, DWORD* clicked) {
+/**
+ * Purpose: Progress of a target that clicks from this process. The clicker
+ *          keeps the sequence itself
+ * @param target : AutoplayTarget* - the game
+ * @param sequence : DWORD* - receives the sequence. Odd while a click is being sent
+ * @param clicked : DWORD* - receives the number of tiles clicked
+ * @return : int - 0
+ */
+
+    *sequence = (DWORD)AtomicAdd(&target->sequence, 0);
+    *clicked  = (DWORD)AtomicAdd(&target->clicked, 0);
+    return 0;
+}
+#else
+static int StandInClick(AutoplayTarget* target, const unsigned short* tiles, DWORD numTiles) {
+/**
+ * Purpose: Puts tiles in a stand-in's click ring and wakes it up. The tiles
+ *          and the new posted count go in one process_vm_writev, posted
+ *          last. The stand-in clicks them on its own time
+ * @param target : AutoplayTarget* - the stand-in. context is its PID
+ * @param tiles : const unsigned short* - minefield offsets to click
+ * @param numTiles : DWORD - number of tiles. No more than the ring holds
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    WriteRange ranges[3];
+    DWORD first = target->sent % CLICK_MAILBOX_TILES;
+    DWORD before = CLICK_MAILBOX_TILES - first;  // Tiles that fit before the ring wraps
+    DWORD posted = target->sent + numTiles;
+    int numRanges = 0;
+
+    if (numTiles > before) {
+        ranges[numRanges].offset = CLICK_MAILBOX_OFFSET + offsetof(ClickMailbox, tiles);
+        ranges[numRanges].buff   = tiles + before;
+        ranges[numRanges].length = (numTiles - before)*sizeof(unsigned short);
+        numRanges++;
+        numTiles = before;
+    }
+    ranges[numRanges].offset = CLICK_MAILBOX_OFFSET + offsetof(ClickMailbox, tiles) + first*sizeof(unsigned short);
+    ranges[numRanges].buff   = tiles;
+    ranges[numRanges].length = numTiles*sizeof(unsigned short);
+    numRanges++;
+    ranges[numRanges].offset = CLICK_MAILBOX_OFFSET + offsetof(ClickMailbox, posted);
+    ranges[numRanges].buff   = &posted;
+    ranges[numRanges].length = sizeof(DWORD);
+    numRanges++;
+
+    if (WriteSourceRanges(target->source, ranges, numRanges)) return 1;
+    if (kill((pid_t)(intptr_t)target->context, SIGUSR1)) {
+        perror("Error waking the stand-in");
+        return 1;
+    }
+    return 0;
+}
+
+static int StandInProgress(AutoplayTarget* target, DWORD* sequence, DWORD* clicked) {
+/**
+ * Purpose: Reads a stand-in's click sequence and click count
+ * @param target : AutoplayTarget* - the stand-in
+ * @param sequence : DWORD* - receives the sequence. Odd while it's clicking
+ * @param clicked : DWORD* - receives the number of tiles it has clicked
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    DWORD header[2];  // sequence and done, next to each other
+
+    if (ReadSource(target->source, CLICK_MAILBOX_OFFSET + offsetof(ClickMailbox, sequence), header, sizeof(header))) {
+        return 1;
+    }
+    *sequence = header[0];
+    *clicked  = header[1];
+    return 0;
+}
+
+static int StandInNewGame(AutoplayTarget* target, unsigned int seed) {
+/**
+ * Purpose: Has a stand-in deal a new board
+ * @param target : AutoplayTarget* - the stand-in
+ * @param seed : unsigned int - seed for the board. Not 0
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned short newGame = CLICK_NEW_GAME;
+    DWORD value = seed ? seed : 1;
+
+    if (WriteSource(target->source, CLICK_MAILBOX_OFFSET + offsetof(ClickMailbox, newGame), &value, sizeof(DWORD)) || \
+        StandInClick(target, &newGame, 1)) return 1;
+    target->sent++;
+    return 0;
+}
+#endif
+
+int OpenAutoplayTarget(AutoplayTarget* target, Session* session) {
+/**
+ * Purpose: Gets an attached game ready to take clicks. On Windows that's
+ *          winmine's window. On Linux it's the stand-in's click mailbox,
+ *          picked up wherever the last player left it
+ * @param target : AutoplayTarget* - the target to set up
+ * @param session : Session* - an attached game
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    memset(target, 0, sizeof(AutoplayTarget));
+    target->source   = &session->source;
+    target->capacity = AUTOPLAY_MAX_TILES;
+
+#ifdef _WIN32
+    target->name     = "window messages";
+    target->click    = WindowClick;
+    target->progress = LocalProgress;
+    target->context  = (void*)(uintptr_t)session->PID;
+    EnumWindows(MatchWindow, (LPARAM)target);
+    if (target->context == (void*)(uintptr_t)session->PID) {
+        printf("Couldn't find a Minesweeper window in process %u\n", session->PID);
+        return 1;
+    }
+#else
+    {
+        DWORD header[3];  // sequence, done and posted
+
+        target->name     = "stand-in click mailbox";
+        target->click    = StandInClick;
+        target->progress = StandInProgress;
+        target->newGame  = StandInNewGame;
+        target->context  = (void*)(intptr_t)session->PID;
+        target->capacity = CLICK_MAILBOX_TILES;
+        if (ReadSource(target->source, CLICK_MAILBOX_OFFSET, header, sizeof(header))) return 1;
+        target->sent = header[2];
+    }
+#endif
+    return 0;
+}
+
+static void Finish(struct pipeline_s* pipe, int result) {
+/**
+ * Purpose: Ends the game for every stage. The first result sticks
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @param result : int - GAME_WON, GAME_LOST, AUTOPLAY_GAVE_UP or GAME_IN_PROGRESS on failure
+ * @return : void
+ */
+
+    AcquireLock(&pipe->lock);
+    if (!pipe->finished) pipe->stats->result = result;
+    pipe->finished = 1;
+    WakeAll(&pipe->changed);
+    ReleaseLock(&pipe->lock);
+}
+
+static int TryReadBoard(struct pipeline_s* pipe, DWORD atLeast, DWORD* clicks) {
+/**
+ * Purpose: Reads a board the game could really have shown: the click
+ *          sequence is read before and after the snapshot and has to be the
+ *          same even number both times. Only once the game has clicked at
+ *          least atLeast tiles
+ * @param pipe : struct pipeline_s* - the pipeline. The board goes in pipe->reading
+ * @param atLeast : DWORD - clicks the board has to show
+ * @param clicks : DWORD* - receives the number of tiles clicked, board or not
+ * @return : int - 0 with a board, BOARD_NOT_READY to try again later, 1 on failure
+ */
+
+    AutoplayTarget* target = pipe->target;
+    DWORD sequence, sequenceAfter, clickedAfter;
+    unsigned long long start;
+
+    if (target->progress(target, &sequence, clicks)) return 1;
+    if ((sequence & 1) || (int)(*clicks - atLeast) < 0) return BOARD_NOT_READY;
+
+    start = NowNs();
+    if (TakeSnapshot(target->source, &pipe->reading) || target->progress(target, &sequenceAfter, &clickedAfter)) return 1;
+    pipe->stats->readNs += NowNs() - start;
+    if (sequenceAfter != sequence) {
+        pipe->stats->retries++;
+        return BOARD_NOT_READY;
+    }
+    return 0;
+}
+
+static int TimedOut(struct pipeline_s* pipe, unsigned long long waitStart, DWORD clicks, DWORD atLeast) {
+/**
+ * Purpose: Whether the game has kept us waiting too long. Says so if it has
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @param waitStart : unsigned long long - when the wait started
+ * @param clicks : DWORD - tiles the game has clicked
+ * @param atLeast : DWORD - tiles we're waiting for it to click
+ * @return : int - non-zero if it's time to give up
+ */
+
+    if (NowNs() - waitStart <= (unsigned long long)pipe->config->timeoutMs*1000000ull) return 0;
+    printf("The game stopped taking clicks (%u of %u done)\n", clicks, atLeast);
+    return 1;
+}
+
+static int Clickable(unsigned char kind) {
+/**
+ * Purpose: Whether clicking a tile would do anything. winmine ignores flags
+ * @param kind : unsigned char - the tile's visible kind
+ * @return : int - non-zero if it's covered and not flagged
+ */
+
+    return kind == TILE_UNCLICKED || kind == TILE_QUESTION;
+}
+
+static int Unsent(struct pipeline_s* pipe, DWORD x, DWORD y) {
+/**
+ * Purpose: Whether a tile can still be clicked and hasn't been queued before.
+ *          Only the solver sets sentTiles, so it can read them without the lock
+ * @param pipe : struct pipeline_s* - the pipeline, with kinds up to date
+ * @param x : DWORD - the tile's column
+ * @param y : DWORD - the tile's row
+ * @return : int - non-zero if it's worth sending
+ */
+
+    return Clickable(pipe->kinds[x + y*ROW_STRIDE]) && !(pipe->sentTiles[y] & (1u << x));
+}
+
+static DWORD Guess(struct pipeline_s* pipe, DWORD width, DWORD height, DWORD numMines) {
+/**
+ * Purpose: Picks the covered tile least likely to be a mine, or a random
+ *          one if the odds can't be worked out. Tiles sent before are
+ *          skipped: the game has already had its chance to open them
+ * @param pipe : struct pipeline_s* - the pipeline, with kinds and solver up to date
+ * @param width : DWORD - the width of the board
+ * @param height : DWORD - the height of the board
+ * @param numMines : DWORD - mines in the game
+ * @return : DWORD - the tile's offset, or 0 if nothing can be clicked
+ */
+
+    DWORD covered = 0;
+    DWORD pick;
+
+    if (!ListConstraints(pipe->kinds, height, width, &pipe->solver.result) && \
+        !ComputeProbabilities(NULL, NULL, pipe->kinds, height, width, numMines, &pipe->solver.result, &pipe->chances) && \
+        pipe->chances.bestX && Unsent(pipe, pipe->chances.bestX, pipe->chances.bestY)) {
+        return pipe->chances.bestX + pipe->chances.bestY*ROW_STRIDE;
+    }
+
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) covered += Unsent(pipe, x, y);
+    }
+    if (!covered) return 0;
+    pick = NextRandom(&pipe->state) % covered;
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            if (Unsent(pipe, x, y) && !pick--) return x + y*ROW_STRIDE;
+        }
+    }
+    return 0;
+}
+
+static int UpToDate(struct pipeline_s* pipe, DWORD clicks) {
+/**
+ * Purpose: Whether a board shows everything there is: every tile sent has
+ *          been clicked and nothing is waiting to be. Call under the lock
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @param clicks : DWORD - tiles the game had clicked when the board was read
+ * @return : int - non-zero if nothing can change the game but a new click
+ */
+
+    return clicks == pipe->target->sent && !pipe->queued && !pipe->clicking;
+}
+
+static int SolveBoard(struct pipeline_s* pipe, DWORD clicks, DWORD limit) {
+/**
+ * Purpose: Queues every tile pipe->solving proves safe that hasn't been
+ *          queued before. If there are none and the board is up to date
+ *          (nothing sent that it doesn't show, nothing waiting to be sent)
+ *          it queues a guess instead. A board that's behind waits for the
+ *          next one, or to catch up (see SolveStage). Gives up if clicks
+ *          were sent since the last up to date board and this one shows
+ *          nothing new
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @param clicks : DWORD - tiles the game had clicked when the board was read
+ * @param limit : DWORD - most tiles to queue
+ * @return : int - GAME_IN_PROGRESS, GAME_WON, GAME_LOST or AUTOPLAY_GAVE_UP
+ */
+
+    const Snapshot* board = &pipe->solving;
+    const unsigned char* field = SNAPSHOT_FIELD(board);
+    Bitboard bitboard;
+    DWORD added = 0;
+    DWORD tile;
+    int upToDate;
+    int state;
+
+    if (board->width < 1 || board->width > MAX_WIDTH || board->height < 1 || board->height > MAX_HEIGHT) {
+        printf("The board isn't a game (%ux%u)\n", board->width, board->height);
+        return AUTOPLAY_GAVE_UP;
+    }
+
+    // winmine knows how the game ended. Anything else only sees what a player would
+    PackBitboard(field, board->height, board->width, &bitboard);
+    state = GameState(&bitboard);
+    if (state != GAME_IN_PROGRESS) return state;
+    DecodeField(field, board->height, pipe->kinds);
+    for (DWORD i = 0; i < KIND_GRID_SIZE; i++) pipe->kinds[i] &= TILE_VISIBLE_MASK;
+    if (UpdateIncremental(&pipe->solver, pipe->kinds, board->height, board->width)) return AUTOPLAY_GAVE_UP;
+
+    AcquireLock(&pipe->lock);
+    for (DWORD y = 1; y <= board->height && pipe->queued < limit; y++) {
+        for (uint32_t safe = pipe->solver.result.safe[y] & ~pipe->sentTiles[y]; safe && pipe->queued < limit; safe &= safe - 1) {
+            DWORD x = (DWORD)CTZ32(safe);
+
+            if (!Clickable(pipe->kinds[x + y*ROW_STRIDE])) continue;
+            pipe->queue[pipe->queued++] = (unsigned short)(x + y*ROW_STRIDE);
+            pipe->sentTiles[y] |= 1u << x;
+            added++;
+        }
+    }
+    upToDate = UpToDate(pipe, clicks);
+    pipe->stuck = !added && !upToDate;
+    if (added) WakeAll(&pipe->changed);
+    ReleaseLock(&pipe->lock);
+    if (added || !upToDate) return GAME_IN_PROGRESS;
+
+    // The game ignored everything sent since the last board like this one
+    if (pipe->haveLast && pipe->lastClicks != clicks && !memcmp(pipe->lastField, field, MINEFIELD_SIZE)) {
+        printf("The game didn't change after %u more click(s)\n", clicks - pipe->lastClicks);
+        return AUTOPLAY_GAVE_UP;
+    }
+    memcpy(pipe->lastField, field, MINEFIELD_SIZE);
+    pipe->lastClicks = clicks;
+    pipe->haveLast   = 1;
+
+    // Stuck on a board that shows everything. Nothing else can queue until we do
+    tile = Guess(pipe, board->width, board->height, board->numMines);
+    if (!tile) return AUTOPLAY_GAVE_UP;
+    AcquireLock(&pipe->lock);
+    pipe->queue[pipe->queued++] = (unsigned short)tile;
+    pipe->sentTiles[tile / ROW_STRIDE] |= 1u << (tile % ROW_STRIDE);
+    pipe->stats->guesses++;
+    WakeAll(&pipe->changed);
+    ReleaseLock(&pipe->lock);
+
+    return GAME_IN_PROGRESS;
+}
+
+static DWORD Room(struct pipeline_s* pipe) {
+/**
+ * Purpose: How many more tiles the game can be sent. Tiles the last board
+ *          doesn't show yet are still taking up space. Call under the lock
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @return : DWORD - tiles that fit
+ */
+
+    DWORD waiting = pipe->target->sent - pipe->boardClicks;
+    return waiting < pipe->target->capacity ? pipe->target->capacity - waiting : 0;
+}
+
+static int SendQueued(struct pipeline_s* pipe) {
+/**
+ * Purpose: Sends everything that's queued as one batch, or as much of it as
+ *          the game has room for
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned short tiles[AUTOPLAY_MAX_TILES];
+    DWORD numTiles;
+    unsigned long long start;
+    int status;
+
+    AcquireLock(&pipe->lock);
+    numTiles = pipe->queued < Room(pipe) ? pipe->queued : Room(pipe);
+    memcpy(tiles, pipe->queue, numTiles*sizeof(unsigned short));
+    memmove(pipe->queue, pipe->queue + numTiles, (pipe->queued - numTiles)*sizeof(unsigned short));
+    pipe->queued  -= numTiles;
+    pipe->clicking = 1;
+    ReleaseLock(&pipe->lock);
+
+    start  = NowNs();
+    status = numTiles ? pipe->target->click(pipe->target, tiles, numTiles) : 0;
+
+    AcquireLock(&pipe->lock);
+    if (!status && numTiles) {
+        pipe->target->sent += numTiles;
+        pipe->stats->batches++;
+        pipe->stats->moves += numTiles;
+    }
+    pipe->stats->clickNs += NowNs() - start;
+    pipe->clicking = 0;
+    WakeAll(&pipe->changed);
+    ReleaseLock(&pipe->lock);
+
+    return status;
+}
+
+static int PlaySequential(struct pipeline_s* pipe, DWORD limit) {
+/**
+ * Purpose: Read, solve, click, one after another: every board is read once
+ *          the game has clicked everything sent so far
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @param limit : DWORD - most tiles to click per board
+ * @return : int - 0 once the game is over, 1 on failure
+ */
+
+    for (;;) {
+        DWORD clicks;
+        unsigned long long waitStart = NowNs();
+        unsigned long long start;
+        int status;
+        int state;
+
+        while ((status = TryReadBoard(pipe, pipe->target->sent, &clicks)) == BOARD_NOT_READY) {
+            if (TimedOut(pipe, waitStart, clicks, pipe->target->sent)) return 1;
+            YieldThread();
+        }
+        if (status) return 1;
+        memcpy(&pipe->solving, &pipe->reading, sizeof(Snapshot));
+        pipe->boardClicks = clicks;
+        pipe->stats->boards++;
+
+        start = NowNs();
+        state = SolveBoard(pipe, clicks, limit);
+        pipe->stats->solveNs += NowNs() - start;
+        pipe->stats->solved++;
+        if (state != GAME_IN_PROGRESS) {
+            pipe->stats->result = state;
+            return 0;
+        }
+        if (SendQueued(pipe)) return 1;
+    }
+}
+
+static void ReadStage(void* argument) {
+/**
+ * Purpose: Pipeline stage. Whenever the game has clicked something since the
+ *          last board, reads a new one and hands it to the solver
+ * @param argument : struct pipeline_s* - the pipeline
+ * @return : void
+ */
+
+    struct pipeline_s* pipe = (struct pipeline_s*)argument;
+    unsigned long long waitStart = NowNs();
+    DWORD atLeast;   // Clicks the next board has to show
+    int first = 1;
+
+    // The first board has to show everything already sent (a new game, say)
+    AcquireLock(&pipe->lock);
+    atLeast = pipe->target->sent;
+    ReleaseLock(&pipe->lock);
+
+    for (;;) {
+        DWORD clicks;
+        int status;
+        int finished;
+
+        // Nothing can change while everything sent is on the last board and nothing's being sent
+        AcquireLock(&pipe->lock);
+        if (!pipe->finished && !first && pipe->boardClicks == pipe->target->sent && !pipe->clicking) {
+            while (!pipe->finished && pipe->boardClicks == pipe->target->sent && !pipe->clicking) {
+                WaitCondition(&pipe->changed, &pipe->lock);
+            }
+            waitStart = NowNs();
+        }
+        finished = pipe->finished;
+        ReleaseLock(&pipe->lock);
+        if (finished) break;
+
+        status = TryReadBoard(pipe, atLeast, &clicks);
+        if (status == BOARD_NOT_READY) {
+            if (!TimedOut(pipe, waitStart, clicks, atLeast)) {
+                YieldThread();
+                continue;
+            }
+        }
+        if (status) {
+            Finish(pipe, GAME_IN_PROGRESS);
+            break;
+        }
+
+        AcquireLock(&pipe->lock);
+        memcpy(&pipe->board, &pipe->reading, sizeof(Snapshot));
+        pipe->boardClicks = clicks;
+        pipe->boardNumber++;
+        pipe->stats->boards++;
+        WakeAll(&pipe->changed);
+        ReleaseLock(&pipe->lock);
+        atLeast   = clicks + 1;
+        waitStart = NowNs();
+        first = 0;
+    }
+}
+
+static void ClickStage(void* argument) {
+/**
+ * Purpose: Pipeline stage. Sends whatever the solver has queued as soon as
+ *          the game has room for it
+ * @param argument : struct pipeline_s* - the pipeline
+ * @return : void
+ */
+
+    struct pipeline_s* pipe = (struct pipeline_s*)argument;
+    int finished;
+
+    for (;;) {
+        AcquireLock(&pipe->lock);
+        while (!pipe->finished && (!pipe->queued || !Room(pipe))) WaitCondition(&pipe->changed, &pipe->lock);
+        finished = pipe->finished;
+        ReleaseLock(&pipe->lock);
+        if (finished) break;
+
+        if (SendQueued(pipe)) {
+            Finish(pipe, GAME_IN_PROGRESS);
+            break;
+        }
+    }
+}
+
+static void SolveStage(struct pipeline_s* pipe) {
+/**
+ * Purpose: Pipeline stage. Solves the newest board, skipping any that came
+ *          in while the last one was being solved, until the game is over.
+ *          A board that was behind when it was solved gets solved again if
+ *          the game catches up to it without anything new to read
+ * @param pipe : struct pipeline_s* - the pipeline
+ * @return : void
+ */
+
+    DWORD solvedNumber = 0;
+
+    for (;;) {
+        DWORD clicks;
+        unsigned long long start;
+        int state;
+
+        AcquireLock(&pipe->lock);
+        while (!pipe->finished && pipe->boardNumber == solvedNumber && \
+               !(pipe->stuck && UpToDate(pipe, pipe->boardClicks))) WaitCondition(&pipe->changed, &pipe->lock);
+        if (pipe->finished) {
+            ReleaseLock(&pipe->lock);
+            break;
+        }
+        memcpy(&pipe->solving, &pipe->board, sizeof(Snapshot));
+        clicks = pipe->boardClicks;
+        solvedNumber = pipe->boardNumber;
+        ReleaseLock(&pipe->lock);
+
+        start = NowNs();
+        state = SolveBoard(pipe, clicks, AUTOPLAY_MAX_TILES);
+        pipe->stats->solveNs += NowNs() - start;
+        pipe->stats->solved++;
+        if (state != GAME_IN_PROGRESS) {
+            Finish(pipe, state);
+            break;
+        }
+    }
+}
+
+int AutoplayGame(ThreadPool* pool, AutoplayTarget* target, const AutoplayConfig* config, AutoplayStats* stats) {
+/**
+ * Purpose: Plays the target's game until it's won or lost. Pipelined, the
+ *          reader and clicker run as pool tasks and this thread solves
+ * @param pool : ThreadPool* - at least 2 threads for AUTOPLAY_PIPELINED. Otherwise it runs batched
+ * @param target : AutoplayTarget* - the game
+ * @param config : const AutoplayConfig* - how to play
+ * @param stats : AutoplayStats* - receives how it went
+ * @return : int - 0 if the game ended (won or lost), 1 if it couldn't be finished
+ */
+
+    struct pipeline_s* pipe;
+    unsigned long long readsBefore = target->source->numReads, writesBefore = target->source->numWrites;
+    unsigned long long start;
+    int status = 0;
+
+    memset(stats, 0, sizeof(AutoplayStats));
+    stats->result = GAME_IN_PROGRESS;
+    pipe = (struct pipeline_s*)calloc(1, sizeof(struct pipeline_s));
+    if (!pipe) return 1;
+    pipe->target = target;
+    pipe->config = config;
+    pipe->stats  = stats;
+    pipe->state  = config->seed ? config->seed : 1;
+    InitIncrementalSolver(&pipe->solver, 0);
+    InitLock(&pipe->lock);
+    InitCondition(&pipe->changed);
+    ClearProbabilityCache();
+
+    start = NowNs();
+    if (config->mode == AUTOPLAY_PIPELINED && pool && pool->numThreads >= 2) {
+        TaskGroup group = { 0 };
+
+        SubmitTask(pool, &group, ReadStage, pipe);
+        SubmitTask(pool, &group, ClickStage, pipe);
+        SolveStage(pipe);
+        WaitForGroup(pool, &group);
+    }
+    else status = PlaySequential(pipe, config->mode == AUTOPLAY_SINGLE ? 1 : AUTOPLAY_MAX_TILES);
+    stats->wallNs = NowNs() - start;
+    stats->reads  = target->source->numReads - readsBefore;
+    stats->writes = target->source->numWrites - writesBefore;
+
+    DestroyCondition(&pipe->changed);
+    DestroyLock(&pipe->lock);
+    free(pipe);
+    return status || (stats->result != GAME_WON && stats->result != GAME_LOST);
+}
+
+void PrintAutoplayStats(const AutoplayStats* stats) {
+/**
+ * Purpose: Prints how a game went
+ * @param stats : const AutoplayStats* - from AutoplayGame
+ * @return : void
+ */
+
+    const char* result = stats->result == GAME_WON ? "Won" : stats->result == GAME_LOST ? "Lost" : \
+                         stats->result == AUTOPLAY_GAVE_UP ? "Gave up" : "Stopped";
+    double seconds = (double)stats->wallNs / 1e9;
+
+    printf("%s after %u moves (%u guesses) in %u batches\n", result, stats->moves, stats->guesses, stats->batches);
+    printf("%.2f ms, %.0f moves/s. %u boards read (%u read again), %u solved. %llu reads, %llu writes\n", \
+           seconds*1000.0, seconds > 0.0 ? stats->moves / seconds : 0.0, stats->boards, stats->retries, \
+           stats->solved, stats->reads, stats->writes);
+    printf("Busy reading %.2f ms, solving %.2f ms, clicking %.2f ms\n\n", stats->readNs / 1e6, \
+           stats->solveNs / 1e6, stats->clickNs / 1e6);
+}
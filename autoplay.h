@@ -0,0 +1,88 @@
+/**
+ * Purpose: Plays a running game to the end. Each cycle reads the board,
+ *          finds every tile the honest helper can prove safe (or the least
+ *          likely mine when there aren't any) and sends them all as one
+ *          batch. Pipelined, reading, solving and clicking are stages on
+ *          their own threads: boards are read while the game is still
+ *          working through the last batch, and whatever those boards prove
+ *          safe is queued up behind it instead of waiting for the batch to
+ *          finish. The game is attached to once and read one snapshot at a
+ *          time, and the solver only looks again at what each board changed
+ */
+
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include"winmine.h"
+#include"memorySource.h"
+#include"session.h"
+#include"snapshot.h"
+#include"tileDecode.h"
+#include"solver.h"
+#include"incrementalSolver.h"
+#include"probability.h"
+#include"threadPool.h"
+
+// How the cycles run
+#define AUTOPLAY_SINGLE     0   // One click per read, the way the menu's actions work
+#define AUTOPLAY_BATCHED    1   // Read, solve, click every safe tile, one stage after another
+#define AUTOPLAY_PIPELINED  2   // Read, solve and click overlapped on their own threads
+
+#define AUTOPLAY_TIMEOUT_MS   2000   // Give up if the game stops taking clicks for this long
+#define AUTOPLAY_GAVE_UP      (-1)   // Nothing left to click that would change anything
+#define AUTOPLAY_MAX_TILES    (MAX_WIDTH*MAX_HEIGHT)
+
+// Where winmine draws the board in its window, for clicking it with messages
+#define WINMINE_BOARD_LEFT    12
+#define WINMINE_BOARD_TOP     55
+#define WINMINE_TILE_PIXELS   16
+
+// Somewhere clicks can be sent. Tiles are minefield offsets (x + y*ROW_STRIDE)
+typedef struct autoplayTarget_s {
+    // Sends tiles to be clicked in order. They're tiles sent + 1 onwards.
+    // The caller adds numTiles to sent afterwards
+    int (*click)(struct autoplayTarget_s* target, const unsigned short* tiles, DWORD numTiles);
+    // The game's click sequence (odd while a click is changing the field)
+    // and the number of tiles it has clicked so far. A board read between
+    // two calls that gave the same even sequence holds exactly that many
+    int (*progress)(struct autoplayTarget_s* target, DWORD* sequence, DWORD* clicked);
+    // Optional. Deals a new board. Counts as a tile, and adds itself to sent
+    int (*newGame)(struct autoplayTarget_s* target, unsigned int seed);
+
+    const char* name;          // Human readable name of the target
+    MemorySource* source;      // Reads the game
+    void* context;             // Target specific data (window handle, PID)
+    DWORD sent;                // Tiles sent so far
+    DWORD capacity;            // Most tiles that can be waiting in the game at once
+    volatile long sequence;    // The click sequence of targets that click from this process
+    volatile long clicked;
+} AutoplayTarget;
+
+typedef struct autoplayConfig_s {
+    int mode;                  // AUTOPLAY_SINGLE, AUTOPLAY_BATCHED or AUTOPLAY_PIPELINED
+    unsigned int seed;         // For random guesses when there's no better one
+    unsigned int timeoutMs;    // Give up if a click takes longer than this to show up
+} AutoplayConfig;
+
+typedef struct autoplayStats_s {
+    int result;                      // GAME_WON, GAME_LOST, AUTOPLAY_GAVE_UP, or GAME_IN_PROGRESS on failure
+    DWORD batches;                   // Batches of clicks sent
+    DWORD moves;                     // Tiles sent to be clicked
+    DWORD guesses;                   // Of those, how many weren't proven safe
+    DWORD boards;                    // Boards read
+    DWORD solved;                    // Boards solved. Fewer than boards when the solver skipped ahead
+    DWORD retries;                   // Boards read again because the game was mid click
+    unsigned long long reads;        // Read calls made against the game
+    unsigned long long writes;       // Write calls made against the game
+    unsigned long long wallNs;       // From the first read to the game being over
+    unsigned long long readNs;       // Time each stage was busy
+    unsigned long long solveNs;
+    unsigned long long clickNs;
+} AutoplayStats;
+
+void InitAutoplayConfig(AutoplayConfig* config);
+int OpenAutoplayTarget(AutoplayTarget* target, Session* session);
+int AutoplayGame(ThreadPool* pool, AutoplayTarget* target, const AutoplayConfig* config, AutoplayStats* stats);
+void PrintAutoplayStats(const AutoplayStats* stats);
+
+#endif
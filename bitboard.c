@@ -0,0 +1,238 @@
+/**
+ * Purpose: The bitboard layer. See bitboard.h
+ */
+
+#include<string.h>
+#include"bitboard.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+int Popcount32(uint32_t value) {
+/**
+ * Purpose: Counts the set bits in value without needing a POPCNT instruction
+ * @param value : uint32_t - the bits to count
+ * @return : int - number of bits set
+ */
+
+    value = value - ((value >> 1) & 0x55555555);
+    value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+    value = (value + (value >> 4)) & 0x0F0F0F0F;
+    return (int)((value * 0x01010101) >> 24);
+}
+
+int Ctz32(uint32_t value) {
+/**
+ * Purpose: Index of the lowest set bit. value must not be 0
+ * @param value : uint32_t - the bits to search
+ * @return : int - index of the lowest set bit
+ */
+
+    return Popcount32((value & (0u - value)) - 1);
+}
+
+#ifdef HAVE_SSE2
+static uint32_t RowMask(const unsigned char* row, __m128i (*select)(__m128i)) {
+/**
+ * Purpose: Turns one 32 byte row into 32 bits, one per byte whose top bit
+ *          is set after select has been applied
+ * @param row : const unsigned char* - the start of the row
+ * @param select : __m128i (*)(__m128i) - moves the interesting bit into bit 7
+ * @return : uint32_t - the packed row
+ */
+
+    uint32_t low  = (uint32_t)_mm_movemask_epi8(select(_mm_loadu_si128((const __m128i*)row)));
+    uint32_t high = (uint32_t)_mm_movemask_epi8(select(_mm_loadu_si128((const __m128i*)(row + 16))));
+    return low | (high << 16);
+}
+
+static __m128i SelectMine(__m128i raw) { return raw; }
+static __m128i SelectRevealed(__m128i raw) { return _mm_slli_epi16(raw, 1); }
+static __m128i SelectFlag(__m128i raw) {
+    return _mm_cmpeq_epi8(_mm_and_si128(raw, _mm_set1_epi8(0x0F)), _mm_set1_epi8(FLAG));
+}
+static __m128i SelectQuestion(__m128i raw) {
+    return _mm_cmpeq_epi8(_mm_and_si128(raw, _mm_set1_epi8(0x0F)), _mm_set1_epi8(QUESTION_MARK));
+}
+static __m128i SelectUnclicked(__m128i raw) {
+    return _mm_cmpeq_epi8(_mm_and_si128(raw, _mm_set1_epi8(0x0F)), _mm_set1_epi8(UNCLICKED_SPACE));
+}
+#endif
+
+void PackBitboard(const unsigned char* field, DWORD height, DWORD width, Bitboard* board) {
+/**
+ * Purpose: Packs the raw minefield (MINEFIELD_OFFSET layout) into bitplanes
+ * @param field : const unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param board : Bitboard* - receives the bitplanes
+ * @return : void
+ */
+
+    uint32_t playable = ((width >= 31 ? 0xFFFFFFFFu : (1u << (width + 1))) - 1) & ~1u;  // Bits 1..width
+
+    memset(board, 0, sizeof(Bitboard));
+    board->height = height;
+    board->width  = width;
+
+    for (DWORD y = 1; y <= height; y++) {
+        const unsigned char* row = field + y*ROW_STRIDE;
+        board->playable[y] = playable;
+
+#ifdef HAVE_SSE2
+        board->mine[y]      = RowMask(row, SelectMine) & playable;
+        board->revealed[y]  = RowMask(row, SelectRevealed) & playable;
+        board->flagged[y]   = RowMask(row, SelectFlag) & playable;
+        board->question[y]  = RowMask(row, SelectQuestion) & playable;
+        board->unclicked[y] = RowMask(row, SelectUnclicked) & playable;
+#else
+        for (DWORD x = 1; x <= width; x++) {
+            uint32_t bit = 1u << x;
+            if (row[x] & MINE) board->mine[y] |= bit;
+            if (row[x] & REVEALED_TILE) board->revealed[y] |= bit;
+            if ((row[x] & 0x0F) == FLAG) board->flagged[y] |= bit;
+            if ((row[x] & 0x0F) == QUESTION_MARK) board->question[y] |= bit;
+            if ((row[x] & 0x0F) == UNCLICKED_SPACE) board->unclicked[y] |= bit;
+        }
+#endif
+    }
+
+    return;
+}
+
+void UnpackBitboard(const Bitboard* board, unsigned char* field) {
+/**
+ * Purpose: Writes the bitplanes back out in winmine's layout, border and
+ *          all. Revealed tiles get their neighbor counts filled in
+ * @param board : const Bitboard* - the bitplanes
+ * @param field : unsigned char* - receives the raw minefield (MINEFIELD_SIZE bytes)
+ * @return : void
+ */
+
+    unsigned char counts[ROW_STRIDE*BITBOARD_ROWS];
+
+    CountAllNeighbors(board, counts);
+    memset(field, UNCLICKED_SPACE, MINEFIELD_SIZE);
+
+    for (DWORD y = 0; y <= board->height + 1; y++) {
+        for (DWORD x = 0; x <= board->width + 1; x++) {
+            unsigned char* tile = field + x + y*ROW_STRIDE;
+            uint32_t bit = 1u << x;
+
+            if (!(board->playable[y] & bit)) *tile = BORDER_TILE;
+            else if ((board->revealed[y] & board->mine[y]) & bit) *tile = EXPLODED_MINE;
+            else if (board->revealed[y] & bit) *tile = (unsigned char)(REVEALED_TILE | counts[x + y*ROW_STRIDE]);
+            else {
+                if (board->flagged[y] & bit) *tile = FLAG;
+                else if (board->question[y] & bit) *tile = QUESTION_MARK;
+                else *tile = UNCLICKED_SPACE;
+                if (board->mine[y] & bit) *tile |= MINE;
+            }
+        }
+    }
+
+    return;
+}
+
+int NeighborMines(const Bitboard* board, DWORD x, DWORD y) {
+/**
+ * Purpose: Number of mines in the 8 tiles around x, y
+ * @param board : const Bitboard* - the bitplanes
+ * @param x : DWORD - column, 1 through width
+ * @param y : DWORD - row, 1 through height
+ * @return : int - 0 through 8
+ */
+
+    uint32_t around = 7u << (x - 1);
+
+    return POPCOUNT32(board->mine[y - 1] & around) + POPCOUNT32(board->mine[y] & around & ~(1u << x)) + \
+           POPCOUNT32(board->mine[y + 1] & around);
+}
+
+void CountAllNeighbors(const Bitboard* board, unsigned char* counts) {
+/**
+ * Purpose: Neighbor mine counts for every tile at once. The 8 shifted
+ *          neighbor rows are added bit-sliced, so a whole row of 32 counts
+ *          costs a few dozen word operations
+ * @param board : const Bitboard* - the bitplanes
+ * @param counts : unsigned char* - receives counts with the 32 byte row stride
+ * @return : void
+ */
+
+    memset(counts, 0, ROW_STRIDE*BITBOARD_ROWS);
+
+    for (DWORD y = 1; y <= board->height; y++) {
+        uint32_t neighbors[8] = {
+            board->mine[y - 1] << 1, board->mine[y - 1], board->mine[y - 1] >> 1,
+            board->mine[y] << 1,                         board->mine[y] >> 1,
+            board->mine[y + 1] << 1, board->mine[y + 1], board->mine[y + 1] >> 1
+        };
+        uint32_t sum[4] = { 0, 0, 0, 0 };  // Bit x of sum[i] is bit i of the count for column x
+
+        for (int i = 0; i < 8; i++) {
+            uint32_t carry = neighbors[i];
+            for (int bit = 0; bit < 4 && carry; bit++) {
+                uint32_t nextCarry = sum[bit] & carry;
+                sum[bit] ^= carry;
+                carry = nextCarry;
+            }
+        }
+
+        for (DWORD x = 1; x <= board->width; x++) {
+            counts[x + y*ROW_STRIDE] = (unsigned char)(((sum[0] >> x) & 1) | (((sum[1] >> x) & 1) << 1) | \
+                                                       (((sum[2] >> x) & 1) << 2) | (((sum[3] >> x) & 1) << 3));
+        }
+    }
+
+    return;
+}
+
+DWORD ListMines(const Bitboard* board, int skipFlagged, struct parameters_s* locations, DWORD maxLocations) {
+/**
+ * Purpose: Finds every mine by walking the set bits of each row
+ * @param board : const Bitboard* - the bitplanes
+ * @param skipFlagged : int - non-zero to leave out mines that already have a flag
+ * @param locations : struct parameters_s* - receives the x, y of each mine
+ * @param maxLocations : DWORD - size of locations
+ * @return : DWORD - number of mines written to locations
+ */
+
+    DWORD found = 0;
+
+    for (DWORD y = 1; y <= board->height; y++) {
+        uint32_t mines = board->mine[y];
+        if (skipFlagged) mines &= ~board->flagged[y];
+
+        while (mines && found < maxLocations) {
+            locations[found].x = CTZ32(mines);
+            locations[found].y = (int)y;
+            found++;
+            mines &= mines - 1;
+        }
+    }
+
+    return found;
+}
+
+int GameState(const Bitboard* board) {
+/**
+ * Purpose: Works out whether the game has been won or lost
+ * @param board : const Bitboard* - the bitplanes
+ * @return : int - GAME_LOST if a mine was revealed, GAME_WON if every safe
+ *         tile is revealed, otherwise GAME_IN_PROGRESS
+ */
+
+    uint32_t exploded = 0;
+    uint32_t hidden   = 0;  // Safe tiles that still need to be clicked
+
+    for (DWORD y = 1; y <= board->height; y++) {
+        exploded |= board->mine[y] & board->revealed[y];
+        hidden   |= board->playable[y] & ~board->mine[y] & ~board->revealed[y];
+    }
+
+    if (exploded) return GAME_LOST;
+    if (!hidden) return GAME_WON;
+    return GAME_IN_PROGRESS;
+}
@@ -0,0 +1,50 @@
+/**
+ * Purpose: Packs the minefield into bitplanes. A winmine row, border included,
+ *          is 32 bytes so it fits exactly in a uint32_t with bit x being
+ *          column x. Neighbor counts, finding every mine and checking for a
+ *          win or a loss become shifts, ANDs and popcounts over at most 26 rows
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include<stdint.h>
+#include"winmine.h"
+#include"flagStub.h"
+
+#define BITBOARD_ROWS (MAX_HEIGHT + 2)  // Rows 0 and height + 1 are the border
+
+#define GAME_IN_PROGRESS 0
+#define GAME_WON         1
+#define GAME_LOST        2
+
+#if defined(__GNUC__)
+#define POPCOUNT32(v) __builtin_popcount(v)
+#define CTZ32(v)      __builtin_ctz(v)
+#else
+#define POPCOUNT32(v) Popcount32(v)
+#define CTZ32(v)      Ctz32(v)
+#endif
+
+typedef struct bitboard_s {
+    DWORD height;                       // Height of the field
+    DWORD width;                        // Width of the field
+    uint32_t playable[BITBOARD_ROWS];   // Tiles inside the border
+    uint32_t mine[BITBOARD_ROWS];       // MINE bit set
+    uint32_t revealed[BITBOARD_ROWS];   // REVEALED_TILE bit set
+    uint32_t flagged[BITBOARD_ROWS];    // Flag showing
+    uint32_t question[BITBOARD_ROWS];   // Question mark showing
+    uint32_t unclicked[BITBOARD_ROWS];  // Blank and unclicked
+} Bitboard;
+
+int Popcount32(uint32_t value);
+int Ctz32(uint32_t value);
+
+void PackBitboard(const unsigned char* field, DWORD height, DWORD width, Bitboard* board);
+void UnpackBitboard(const Bitboard* board, unsigned char* field);
+int NeighborMines(const Bitboard* board, DWORD x, DWORD y);
+void CountAllNeighbors(const Bitboard* board, unsigned char* counts);
+DWORD ListMines(const Bitboard* board, int skipFlagged, struct parameters_s* locations, DWORD maxLocations);
+int GameState(const Bitboard* board);
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * Purpose: Synthetic winmine boards. See board.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"board.h"
+
+unsigned int NextRandom(unsigned int* state) {
+/**
+ * Purpose: xorshift32. Fast, tiny and good enough for placing mines
+ * @param state : unsigned int* - the generator state. Must not be 0
+ * @return : unsigned int - the next random number
+ */
+
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+int BuildBoard(unsigned char* image, DWORD width, DWORD height, DWORD numMines, unsigned int seed) {
+/**
+ * Purpose: Lays out a fresh (nothing clicked) game in image the same way
+ *          winmine does: mine count, dimensions, and a field of unclicked
+ *          tiles surrounded by a border
+ * @param image : unsigned char* - at least MODULE_IMAGE_SIZE bytes
+ * @param width : DWORD - width of the field
+ * @param height : DWORD - height of the field
+ * @param numMines : DWORD - number of mines to place
+ * @param seed : unsigned int - seed for mine placement
+ * @return : int - 0 on success, 1 if the dimensions are invalid
+ */
+
+    unsigned char* field = image + MINEFIELD_OFFSET;
+    DWORD numTiles = width * height;
+    unsigned int state = seed ? seed : 0x2545F491;  // xorshift can't start at 0
+
+    if (width < 1 || width > MAX_WIDTH || height < 1 || height > MAX_HEIGHT || numMines > numTiles) {
+        printf("Invalid board: width %u, height %u, mines %u\n", width, height, numMines);
+        return 1;
+    }
+
+    memset(image, 0, MODULE_IMAGE_SIZE);
+    memcpy(image + NUM_MINES_OFFSET, &numMines, sizeof(DWORD));
+    memcpy(image + WIDTH_OFFSET, &width, sizeof(DWORD));
+    memcpy(image + HEIGHT_OFFSET, &height, sizeof(DWORD));
+    memcpy(image + MINES_REMAINING_OFFSET, &numMines, sizeof(DWORD));
+
+    // Unclicked tiles everywhere, then the border around the playable area
+    memset(field, UNCLICKED_SPACE, MINEFIELD_SIZE);
+    for (DWORD x = 0; x <= width + 1; x++) {
+        field[x] = BORDER_TILE;
+        field[x + (height + 1)*ROW_STRIDE] = BORDER_TILE;
+    }
+    for (DWORD y = 1; y <= height; y++) {
+        field[y*ROW_STRIDE] = BORDER_TILE;
+        field[width + 1 + y*ROW_STRIDE] = BORDER_TILE;
+    }
+
+    // Floyd's sampling picks numMines distinct tiles with exactly numMines
+    // random numbers. The field itself doubles as the "already picked" set
+    for (DWORD j = numTiles - numMines; j < numTiles; j++) {
+        DWORD pick = NextRandom(&state) % (j + 1);
+        unsigned char* tile = field + (pick % width + 1) + (pick / width + 1)*ROW_STRIDE;
+        if (*tile & MINE) tile = field + (j % width + 1) + (j / width + 1)*ROW_STRIDE;
+        *tile |= MINE;
+    }
+
+    return 0;
+}
+
+int RevealTile(unsigned char* field, DWORD width, DWORD height, DWORD x, DWORD y) {
+/**
+ * Purpose: Left clicks a tile the way winmine does. Question marks open
+ *          like any covered tile. A tile with no mines around it opens up
+ *          its neighbors too. The cascade uses an explicit stack rather
+ *          than recursion
+ * @param field : unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param width : DWORD - width of the field
+ * @param height : DWORD - height of the field
+ * @param x : DWORD - column to click
+ * @param y : DWORD - row to click
+ * @return : int - number of tiles revealed, or -1 if the tile was a mine
+ */
+
+    unsigned short stack[MAX_WIDTH*MAX_HEIGHT];  // Tiles waiting to be opened
+    int stackSize = 0;
+    int revealed = 0;
+
+    if (x < 1 || x > width || y < 1 || y > height) return 0;
+    if (field[x + y*ROW_STRIDE] & MINE) {
+        field[x + y*ROW_STRIDE] = EXPLODED_MINE;
+        return -1;
+    }
+    if (field[x + y*ROW_STRIDE] & REVEALED_TILE) return 0;
+    if ((field[x + y*ROW_STRIDE] & 0x0F) != UNCLICKED_SPACE && (field[x + y*ROW_STRIDE] & 0x0F) != QUESTION_MARK) return 0;
+
+    stack[stackSize++] = (unsigned short)(x + y*ROW_STRIDE);
+    field[x + y*ROW_STRIDE] = REVEALED_TILE;  // Marked now so it's never pushed twice
+
+    while (stackSize) {
+        unsigned short offset = stack[--stackSize];
+        unsigned char count = 0;
+
+        // The border has no mines so the neighbors never need bounds checks
+        for (int dy = -ROW_STRIDE; dy <= ROW_STRIDE; dy += ROW_STRIDE) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (field[offset + dy + dx] & MINE) count++;
+            }
+        }
+        field[offset] = (unsigned char)(REVEALED_TILE | count);
+        revealed++;
+        if (count) continue;
+
+        for (int dy = -ROW_STRIDE; dy <= ROW_STRIDE; dy += ROW_STRIDE) {
+            for (int dx = -1; dx <= 1; dx++) {
+                unsigned char* neighbor = field + offset + dy + dx;
+                if (*neighbor != UNCLICKED_SPACE && *neighbor != QUESTION_MARK) continue;  // Border, flagged or opened
+                *neighbor = REVEALED_TILE;
+                stack[stackSize++] = (unsigned short)(offset + dy + dx);
+            }
+        }
+    }
+
+    return revealed;
+}
+
+int MoveFirstClickMine(unsigned char* field, DWORD width, DWORD height, DWORD x, DWORD y) {
+/**
+ * Purpose: winmine never lets the first click lose. If there's a mine under
+ *          it, the mine moves to the first tile without one, scanning row
+ *          by row from the top left. Call this before the first RevealTile
+ * @param field : unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param width : DWORD - width of the field
+ * @param height : DWORD - height of the field
+ * @param x : DWORD - column of the first click
+ * @param y : DWORD - row of the first click
+ * @return : int - 1 if a mine was moved, 0 if not
+ */
+
+    if (!(field[x + y*ROW_STRIDE] & MINE)) return 0;
+
+    for (DWORD row = 1; row <= height; row++) {
+        for (DWORD column = 1; column <= width; column++) {
+            if (field[column + row*ROW_STRIDE] & MINE) continue;
+            field[column + row*ROW_STRIDE] |= MINE;
+            field[x + y*ROW_STRIDE] &= (unsigned char)~MINE;
+            return 1;
+        }
+    }
+
+    return 0;  // Every tile is a mine
+}
+
+int ClickTiles(unsigned char* field, DWORD width, DWORD height, const unsigned short* tiles, DWORD numTiles) {
+/**
+ * Purpose: Left clicks a batch of tiles in order, the way winmine handles
+ *          them: the first click of a game never loses, flags and tiles
+ *          that are already open do nothing, and nothing is clicked once a
+ *          mine has gone off
+ * @param field : unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param width : DWORD - width of the field
+ * @param height : DWORD - height of the field
+ * @param tiles : const unsigned short* - minefield offsets (x + y*ROW_STRIDE)
+ * @param numTiles : DWORD - number of tiles
+ * @return : int - number of tiles revealed, or -1 if the game is lost
+ */
+
+    int firstClick = 1;
+    int revealed = 0;
+
+    // winmine keeps count of its clicks. Nothing opened yet is the same thing here
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            if (field[x + y*ROW_STRIDE] == EXPLODED_MINE) return -1;
+            if (field[x + y*ROW_STRIDE] & REVEALED_TILE) firstClick = 0;
+        }
+    }
+
+    for (DWORD i = 0; i < numTiles; i++) {
+        DWORD x = tiles[i] % ROW_STRIDE, y = tiles[i] / ROW_STRIDE;
+        int opened;
+
+        if (x < 1 || x > width || y < 1 || y > height) continue;
+        if ((field[tiles[i]] & 0x0F) == FLAG) continue;  // winmine won't open a flag
+        if (firstClick) {
+            MoveFirstClickMine(field, width, height, x, y);
+            firstClick = 0;
+        }
+        opened = RevealTile(field, width, height, x, y);
+        if (opened < 0) return -1;
+        revealed += opened;
+    }
+
+    return revealed;
+}
@@ -0,0 +1,35 @@
+/**
+ * Purpose: Builds synthetic winmine module images so the helper can be run
+ *          and measured without the real game
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include"winmine.h"
+
+// The stand-in takes clicks through a mailbox in its module image, past
+// everything winmine keeps there. The helper adds tiles to the ring, moves
+// posted past them and sends SIGUSR1. The stand-in clicks them one at a time
+// the way winmine would. sequence is odd while a click is being opened, so a
+// board read between two even reads of the same sequence is one winmine
+// could have shown, with exactly done clicks in it
+#define CLICK_MAILBOX_OFFSET  0x5700
+#define CLICK_MAILBOX_TILES   1024   // Ring size. Must be a power of 2
+#define CLICK_NEW_GAME        0      // A "tile" that deals a new board from newGame's seed
+
+typedef struct clickMailbox_s {
+    DWORD sequence;    // Odd while the field is changing
+    DWORD done;        // Tiles clicked so far
+    DWORD posted;      // Tiles put in the ring so far
+    DWORD newGame;     // Seed for the next CLICK_NEW_GAME
+    unsigned short tiles[CLICK_MAILBOX_TILES];  // Minefield offsets (x + y*ROW_STRIDE). Tile i is at i % CLICK_MAILBOX_TILES
+} ClickMailbox;
+
+unsigned int NextRandom(unsigned int* state);
+int BuildBoard(unsigned char* image, DWORD width, DWORD height, DWORD numMines, unsigned int seed);
+int RevealTile(unsigned char* field, DWORD width, DWORD height, DWORD x, DWORD y);
+int MoveFirstClickMine(unsigned char* field, DWORD width, DWORD height, DWORD x, DWORD y);
+int ClickTiles(unsigned char* field, DWORD width, DWORD height, const unsigned short* tiles, DWORD numTiles);
+
+#endif
@@ -0,0 +1,160 @@
+/**
+ * Purpose: Client side of the shared board feed. See boardFeed.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#ifndef _WIN32
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<unistd.h>
+#endif
+#include"boardFeed.h"
+
+#if defined(__GNUC__)
+#define LOAD_RELAXED(p)   __atomic_load_n((p), __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(p)   __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define FENCE_ACQUIRE()   __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#else
+// MSVC's volatile accesses already acquire. Sequences can tear on 32 bit
+// builds, which only ever makes a good read look torn
+#define LOAD_RELAXED(p)   (*(p))
+#define LOAD_ACQUIRE(p)   (*(p))
+#define FENCE_ACQUIRE()   MemoryBarrier()
+#endif
+
+int OpenBoardFeed(BoardFeed* feed, const char* name) {
+/**
+ * Purpose: Maps a publisher's feed read only
+ * @param feed : BoardFeed* - receives the mapping
+ * @param name : const char* - the feed's name. NULL for BOARD_FEED_NAME
+ * @return : int - 0 on success, 1 if there's no publisher or it's another version
+ */
+
+    memset(feed, 0, sizeof(BoardFeed));
+    if (!name) name = BOARD_FEED_NAME;
+
+#ifdef _WIN32
+    feed->hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    if (!feed->hMapping) {
+        printf("Error opening the board feed %s: %d. Is anything publishing?\n", name, GetLastError());
+        return 1;
+    }
+    feed->shared = (const SharedBoard*)MapViewOfFile(feed->hMapping, FILE_MAP_READ, 0, 0, sizeof(SharedBoard));
+    if (!feed->shared) {
+        printf("Error mapping the board feed: %d\n", GetLastError());
+        CloseHandle(feed->hMapping);
+        return 1;
+    }
+#else
+    void* shared;
+
+    feed->fd = shm_open(name, O_RDONLY, 0);
+    if (feed->fd < 0) {
+        perror("Error opening the board feed. Is anything publishing?");
+        return 1;
+    }
+    shared = mmap(NULL, sizeof(SharedBoard), PROT_READ, MAP_SHARED, feed->fd, 0);
+    if (shared == MAP_FAILED) {
+        perror("Error mapping the board feed");
+        close(feed->fd);
+        return 1;
+    }
+    feed->shared = (const SharedBoard*)shared;
+#endif
+
+    if (feed->shared->magic != BOARD_FEED_MAGIC || feed->shared->version != BOARD_FEED_VERSION || \
+        feed->shared->numSlots != BOARD_FEED_SLOTS || feed->shared->slotSize != sizeof(BoardFeedSlot)) {
+        printf("The board feed %s isn't one this build can read\n", name);
+        CloseBoardFeed(feed);
+        return 1;
+    }
+
+    return 0;
+}
+
+void CloseBoardFeed(BoardFeed* feed) {
+/**
+ * Purpose: Unmaps a feed opened by OpenBoardFeed
+ * @param feed : BoardFeed* - the feed
+ * @return : void
+ */
+
+#ifdef _WIN32
+    if (feed->shared) UnmapViewOfFile(feed->shared);
+    if (feed->hMapping) CloseHandle(feed->hMapping);
+#else
+    if (feed->shared) munmap((void*)feed->shared, sizeof(SharedBoard));
+    if (feed->fd > 0) close(feed->fd);
+#endif
+
+    memset(feed, 0, sizeof(BoardFeed));
+}
+
+int BeginBoardView(BoardFeed* feed, BoardView* view) {
+/**
+ * Purpose: Points a view at the newest board, in place. Anything read
+ *          through view->slot only counts if BoardViewValid agrees afterward
+ * @param feed : BoardFeed* - the feed
+ * @param view : BoardView* - receives the view
+ * @return : int - 0 on success, 1 if nothing has been published yet
+ */
+
+    for (;;) {
+        uint64_t latest = LOAD_ACQUIRE(&feed->shared->latest);
+
+        if (!latest) return 1;
+        view->slot     = &feed->shared->slots[latest % BOARD_FEED_SLOTS];
+        view->sequence = LOAD_ACQUIRE(&view->slot->sequence);
+        feed->reads++;
+        if (view->sequence == latest) return 0;
+
+        // The publisher has lapped the ring since. There's a newer board
+        feed->torn++;
+    }
+}
+
+int BoardViewValid(BoardFeed* feed, const BoardView* view) {
+/**
+ * Purpose: Whether everything read through a view since BeginBoardView was
+ *          the board it started on, with none of the one that replaced it
+ * @param feed : BoardFeed* - the feed
+ * @param view : const BoardView* - from BeginBoardView
+ * @return : int - non-zero if the reads can be used. 0 means begin again
+ */
+
+    FENCE_ACQUIRE();
+    if (LOAD_RELAXED(&view->slot->sequence) == view->sequence) return 1;
+    feed->torn++;
+    return 0;
+}
+
+int CopyLatestBoard(BoardFeed* feed, Snapshot* snapshot, uint64_t* number) {
+/**
+ * Purpose: Copies the newest board out into a Snapshot, for readers that
+ *          want to keep it past the next few publishes or hand it to
+ *          DecodeField and friends
+ * @param feed : BoardFeed* - the feed
+ * @param snapshot : Snapshot* - receives the board
+ * @param number : uint64_t* - receives the board's number. Optional
+ * @return : int - 0 on success, 1 if nothing has been published or every
+ *         try was torn
+ */
+
+    BoardView view;
+
+    for (int tries = 0; tries < BOARD_FEED_RETRIES; tries++) {
+        if (BeginBoardView(feed, &view)) return 1;
+
+        snapshot->numMines = view.slot->numMines;
+        snapshot->height   = view.slot->height;
+        snapshot->width    = view.slot->width;
+        memcpy(snapshot->window, view.slot->window, SNAPSHOT_SIZE);
+        if (!BoardViewValid(feed, &view)) continue;
+
+        if (number) *number = view.sequence;
+        return 0;
+    }
+
+    return 1;
+}
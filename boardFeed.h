@@ -0,0 +1,85 @@
+/**
+ * Purpose: Board state shared with other local tools (overlays, loggers,
+ *          analytics) so they don't each attach to the game. One publisher
+ *          (minefinder's option d) takes the snapshots and puts them in a
+ *          ring in named shared memory. Any number of readers map it read
+ *          only and read boards in place, with no copies and no locks.
+ *
+ *          Each slot is a seqlock: its sequence is 0 while the publisher is
+ *          writing it and the board's number once it's done. A reader notes
+ *          the sequence, reads what it wants, and then checks the sequence
+ *          hasn't changed. If it has, the board was overwritten under it
+ *          (torn) and the read is thrown away. The ring gives a reader
+ *          BOARD_FEED_SLOTS boards' worth of time before that can happen.
+ *
+ *          This file and boardFeed.c are the client library. They only
+ *          need winmine.h and snapshot.h. boardPublisher.h is the other side
+ */
+
+#ifndef BOARD_FEED_H
+#define BOARD_FEED_H
+
+#include<stdint.h>
+#include"winmine.h"
+#include"snapshot.h"
+
+#ifdef _WIN32
+#define BOARD_FEED_NAME     "Local\\MinesweeperHelperBoard"   // Name of the file mapping
+#else
+#define BOARD_FEED_NAME     "/minesweeperHelperBoard"         // Name for shm_open
+#endif
+#define BOARD_FEED_MAGIC    0x44524F42   // "BORD"
+#define BOARD_FEED_VERSION  1
+#define BOARD_FEED_SLOTS    8            // Boards in the ring. A power of two
+#define BOARD_FEED_WINDOW   880          // SNAPSHOT_SIZE rounded up to 16
+#define BOARD_FEED_RETRIES  64           // Torn reads CopyLatestBoard puts up with before giving up
+
+// One published board, a multiple of 64 bytes so slots don't share cache lines
+typedef struct boardFeedSlot_s {
+    volatile uint64_t sequence;                // The board's number once written, 0 while being written
+    uint64_t publishedNs;                      // When the publisher took the snapshot (its clock)
+    DWORD numMines;                            // Decoded from the window, the way SetMineMetadata does
+    DWORD height;
+    DWORD width;
+    DWORD reserved;
+    unsigned char window[BOARD_FEED_WINDOW];   // The snapshot window (SNAPSHOT_SIZE bytes from SNAPSHOT_OFFSET)
+    unsigned char padding[48];
+} BoardFeedSlot;
+
+// The whole shared region
+typedef struct sharedBoard_s {
+    DWORD magic;                       // BOARD_FEED_MAGIC once the publisher has set it up
+    DWORD version;                     // BOARD_FEED_VERSION
+    DWORD numSlots;                    // BOARD_FEED_SLOTS
+    DWORD slotSize;                    // sizeof(BoardFeedSlot)
+    volatile uint64_t latest;          // Number of the newest complete board. 0 before the first
+    volatile uint64_t polls;           // Snapshots the publisher has taken. Goes up while it's alive
+    DWORD publisherPid;
+    unsigned char padding[28];
+    BoardFeedSlot slots[BOARD_FEED_SLOTS];   // Board n is in slots[n % BOARD_FEED_SLOTS]
+} SharedBoard;
+
+typedef struct boardFeed_s {
+    const SharedBoard* shared;         // The mapping
+#ifdef _WIN32
+    HANDLE hMapping;
+#else
+    int fd;
+#endif
+    unsigned long long reads;          // Views begun or boards copied
+    unsigned long long torn;           // Of those, how many were overwritten while being read
+} BoardFeed;
+
+// A board read in place. Only good once BoardViewValid says so
+typedef struct boardView_s {
+    const BoardFeedSlot* slot;
+    uint64_t sequence;                 // The board's number
+} BoardView;
+
+int OpenBoardFeed(BoardFeed* feed, const char* name);
+void CloseBoardFeed(BoardFeed* feed);
+int BeginBoardView(BoardFeed* feed, BoardView* view);
+int BoardViewValid(BoardFeed* feed, const BoardView* view);
+int CopyLatestBoard(BoardFeed* feed, Snapshot* snapshot, uint64_t* number);
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * Purpose: Publishing boards to the shared feed. See boardPublisher.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#ifndef _WIN32
+#include<errno.h>
+#include<fcntl.h>
+#include<signal.h>
+#include<sys/mman.h>
+#include<unistd.h>
+#endif
+#include"boardPublisher.h"
+#include"timing.h"
+
+#if defined(__GNUC__)
+#define STORE_RELAXED(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define FENCE_RELEASE()       __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+// MSVC's volatile accesses already release
+#define STORE_RELAXED(p, v)   (*(p) = (v))
+#define STORE_RELEASE(p, v)   (*(p) = (v))
+#define FENCE_RELEASE()       MemoryBarrier()
+#endif
+
+static int PublisherAlive(const SharedBoard* shared) {
+/**
+ * Purpose: Whether a feed that was already there still has its publisher
+ * @param shared : const SharedBoard* - the feed
+ * @return : int - non-zero if the process that set it up is still running
+ */
+
+    DWORD PID = shared->publisherPid;
+
+    if (shared->magic != BOARD_FEED_MAGIC || !PID) return 0;  // Never finished setting up
+#ifdef _WIN32
+    {
+        HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, PID);
+        DWORD exitCode = 0;
+        int alive;
+
+        if (!hProcess) return GetLastError() == ERROR_ACCESS_DENIED;  // Someone else's, so not ours to take
+        alive = GetExitCodeProcess(hProcess, &exitCode) && exitCode == STILL_ACTIVE;
+        CloseHandle(hProcess);
+        return alive;
+    }
+#else
+    return !kill((pid_t)PID, 0) || errno != ESRCH;
+#endif
+}
+
+int OpenBoardPublisher(BoardPublisher* publisher, const char* name) {
+/**
+ * Purpose: Creates the feed's shared memory (or takes over one a publisher
+ *          that crashed left behind) and sets it up empty. A feed whose
+ *          publisher is still running is left alone
+ * @param publisher : BoardPublisher* - receives the publisher
+ * @param name : const char* - the feed's name. NULL for BOARD_FEED_NAME
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    int existing;
+
+    memset(publisher, 0, sizeof(BoardPublisher));
+    if (!name) name = BOARD_FEED_NAME;
+    snprintf(publisher->name, sizeof(publisher->name), "%s", name);
+
+#ifdef _WIN32
+    publisher->hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedBoard), name);
+    if (!publisher->hMapping) {
+        printf("Error creating the board feed %s: %d\n", name, GetLastError());
+        return 1;
+    }
+    existing = GetLastError() == ERROR_ALREADY_EXISTS;
+    publisher->shared = (SharedBoard*)MapViewOfFile(publisher->hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedBoard));
+    if (!publisher->shared) {
+        printf("Error mapping the board feed: %d\n", GetLastError());
+        CloseHandle(publisher->hMapping);
+        return 1;
+    }
+#else
+    void* shared;
+
+    publisher->fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    existing = publisher->fd < 0 && errno == EEXIST;
+    if (existing) publisher->fd = shm_open(name, O_RDWR, 0644);
+    if (publisher->fd < 0) {
+        perror("Error creating the board feed");
+        return 1;
+    }
+    if (ftruncate(publisher->fd, sizeof(SharedBoard))) {
+        perror("Error sizing the board feed");
+        close(publisher->fd);
+        if (!existing) shm_unlink(name);
+        return 1;
+    }
+    shared = mmap(NULL, sizeof(SharedBoard), PROT_READ | PROT_WRITE, MAP_SHARED, publisher->fd, 0);
+    if (shared == MAP_FAILED) {
+        perror("Error mapping the board feed");
+        close(publisher->fd);
+        if (!existing) shm_unlink(name);
+        return 1;
+    }
+    publisher->shared = (SharedBoard*)shared;
+#endif
+
+    // Two publishers would write over each other's ring
+    if (existing && PublisherAlive(publisher->shared)) {
+        printf("Process %u is already publishing %s\n", publisher->shared->publisherPid, name);
+#ifdef _WIN32
+        UnmapViewOfFile(publisher->shared);
+        CloseHandle(publisher->hMapping);
+#else
+        munmap(publisher->shared, sizeof(SharedBoard));
+        close(publisher->fd);
+#endif
+        publisher->shared = NULL;
+        return 1;
+    }
+
+    // Readers check the magic last, so it goes in after everything else
+    publisher->shared->magic = 0;
+    FENCE_RELEASE();
+    memset(publisher->shared, 0, sizeof(SharedBoard));
+    publisher->shared->version  = BOARD_FEED_VERSION;
+    publisher->shared->numSlots = BOARD_FEED_SLOTS;
+    publisher->shared->slotSize = sizeof(BoardFeedSlot);
+#ifdef _WIN32
+    publisher->shared->publisherPid = GetCurrentProcessId();
+#else
+    publisher->shared->publisherPid = (DWORD)getpid();
+#endif
+    FENCE_RELEASE();
+    publisher->shared->magic = BOARD_FEED_MAGIC;
+
+    return 0;
+}
+
+void CloseBoardPublisher(BoardPublisher* publisher) {
+/**
+ * Purpose: Stops publishing. Readers that have the feed mapped keep what's
+ *          there, but nobody new can open it
+ * @param publisher : BoardPublisher* - the publisher
+ * @return : void
+ */
+
+#ifdef _WIN32
+    if (publisher->shared) UnmapViewOfFile(publisher->shared);
+    if (publisher->hMapping) CloseHandle(publisher->hMapping);
+#else
+    if (publisher->shared) munmap(publisher->shared, sizeof(SharedBoard));
+    if (publisher->fd > 0) {
+        close(publisher->fd);
+        shm_unlink(publisher->name);
+    }
+#endif
+
+    publisher->shared = NULL;
+}
+
+void PublishSnapshot(BoardPublisher* publisher, const Snapshot* snapshot, unsigned long long takenNs) {
+/**
+ * Purpose: Writes a board into the next slot of the ring and makes it the
+ *          newest. The slot's sequence is 0 for as long as it's being
+ *          written, so a reader that was on the board it held sees the
+ *          change and throws its read away
+ * @param publisher : BoardPublisher* - the publisher
+ * @param snapshot : const Snapshot* - the board
+ * @param takenNs : unsigned long long - when the snapshot was taken
+ * @return : void
+ */
+
+    uint64_t number = ++publisher->published;
+    BoardFeedSlot* slot = &publisher->shared->slots[number % BOARD_FEED_SLOTS];
+
+    STORE_RELAXED(&slot->sequence, (uint64_t)0);
+    FENCE_RELEASE();
+    slot->publishedNs = takenNs;
+    slot->numMines    = snapshot->numMines;
+    slot->height      = snapshot->height;
+    slot->width       = snapshot->width;
+    memcpy(slot->window, snapshot->window, SNAPSHOT_SIZE);
+    STORE_RELEASE(&slot->sequence, number);
+    STORE_RELEASE(&publisher->shared->latest, number);
+}
+
+int PublishIfChanged(BoardPublisher* publisher, MemorySource* source, Snapshot* snapshot, int* changed) {
+/**
+ * Purpose: Takes a snapshot and publishes it if it's not the board that was
+ *          published last. Every poll counts toward the feed's heartbeat
+ * @param publisher : BoardPublisher* - the publisher
+ * @param source : MemorySource* - the game
+ * @param snapshot : Snapshot* - scratch space for the snapshot
+ * @param changed : int* - receives whether a board was published
+ * @return : int - 0 on success, 1 if the game couldn't be read
+ */
+
+    unsigned long long takenNs = NowNs();
+
+    *changed = 0;
+    if (TakeSnapshot(source, snapshot)) return 1;
+    STORE_RELEASE(&publisher->shared->polls, (uint64_t)++publisher->polls);
+    if (publisher->published && !memcmp(publisher->last, snapshot->window, SNAPSHOT_SIZE)) return 0;
+
+    memcpy(publisher->last, snapshot->window, SNAPSHOT_SIZE);
+    PublishSnapshot(publisher, snapshot, takenNs);
+    *changed = 1;
+    return 0;
+}
@@ -0,0 +1,33 @@
+/**
+ * Purpose: The publishing side of the shared board feed (see boardFeed.h).
+ *          Creates the named shared memory, takes snapshots and writes each
+ *          board that changed into the next slot of the ring
+ */
+
+#ifndef BOARD_PUBLISHER_H
+#define BOARD_PUBLISHER_H
+
+#include"winmine.h"
+#include"memorySource.h"
+#include"snapshot.h"
+#include"boardFeed.h"
+
+typedef struct boardPublisher_s {
+    SharedBoard* shared;                   // The mapping, writable
+    char name[64];                         // What readers open it by
+#ifdef _WIN32
+    HANDLE hMapping;
+#else
+    int fd;
+#endif
+    unsigned long long published;          // Boards written to the ring
+    unsigned long long polls;              // Snapshots taken
+    unsigned char last[SNAPSHOT_SIZE];     // The newest board published, to skip ones that didn't change
+} BoardPublisher;
+
+int OpenBoardPublisher(BoardPublisher* publisher, const char* name);
+void CloseBoardPublisher(BoardPublisher* publisher);
+void PublishSnapshot(BoardPublisher* publisher, const Snapshot* snapshot, unsigned long long takenNs);
+int PublishIfChanged(BoardPublisher* publisher, MemorySource* source, Snapshot* snapshot, int* changed);
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * Purpose: Direct-write flagging. See directFlag.h
+ */
+
+#include<stdint.h>
+#include<stdio.h>
+#include<string.h>
+#include"directFlag.h"
+#include"bitboard.h"
+#include"geometry.h"
+
+static void AddFieldRange(DirectFlagPlan* plan, const WinmineOffsets* offsets, int start, int end) {
+/**
+ * Purpose: Adds a range of the planned minefield to the plan's writes
+ * @param plan : DirectFlagPlan* - the plan
+ * @param offsets : const WinmineOffsets* - where the minefield is
+ * @param start : int - first byte of the range in the minefield
+ * @param end : int - one past its last byte
+ * @return : void
+ */
+
+    WriteRange* range = &plan->ranges[plan->numRanges++];
+
+    range->offset = offsets->minefield + (DWORD)start;
+    range->buff   = plan->field + start;
+    range->length = (size_t)(end - start);
+    plan->bytesToWrite += (DWORD)range->length;
+}
+
+int PlanDirectFlag(const Snapshot* snapshot, const WinmineOffsets* offsets, DWORD maxGap, DirectFlagPlan* plan) {
+/**
+ * Purpose: Works out every write a direct flag needs. Runs of changed bytes
+ *          separated by at most maxGap unchanged ones become one range, with
+ *          the unchanged bytes written back as the snapshot had them. The
+ *          mines remaining count is the mine count less every flag on the
+ *          board afterward (wrong ones too, the way winmine counts) and is
+ *          always the last range
+ * @param snapshot : const Snapshot* - the game as it was just read, from offsets->numMines (TakeSnapshotAt)
+ * @param offsets : const WinmineOffsets* - where the minefield and counter are
+ * @param maxGap : DWORD - most unchanged bytes to rewrite to join two ranges. 0 writes only changed bytes,
+ *                 which is the only safe choice when the game can change between the read and the write
+ * @param plan : DirectFlagPlan* - receives the plan. No ranges if there's nothing to flag
+ * @return : int - 0 on success, 1 if the snapshot isn't a game that can be flagged
+ */
+
+    const unsigned char* before = SNAPSHOT_FIELD(snapshot);
+    Geometry geometry;
+    Bitboard board;
+    DWORD flags = 0;   // Flags on the board before
+    int start = -1;    // Start of the range being built
+    int end = -1;      // One past its last changed byte
+
+    plan->numRanges    = 0;
+    plan->minesFlagged = 0;
+    plan->bytesChanged = 0;
+    plan->bytesToWrite = 0;
+
+    if (InitGeometry(&geometry, snapshot->width, snapshot->height, GEOMETRY_AUTO) || geometry.tiled) return 1;
+    PackBitboard(before, snapshot->height, snapshot->width, &board);
+    if (GameState(&board) == GAME_LOST) {
+        printf("Found an exploded mine. The game is already over. Start a new game first\n");
+        return 1;
+    }
+
+    // The field as it should end up, and the counter to match it
+    memcpy(plan->field, before, MINEFIELD_SIZE);
+    plan->minesFlagged = geometry.flag(&geometry, plan->field, NULL, 0);
+    if (!plan->minesFlagged) return 0;
+    for (DWORD y = 1; y <= snapshot->height; y++) flags += POPCOUNT32(board.flagged[y]);
+    plan->minesRemaining = snapshot->numMines - flags - plan->minesFlagged;
+
+    // Changed bytes, merged across small gaps. Most of the field didn't
+    // change, so it's compared 8 bytes at a time until something did
+    for (int i = 0; i < MINEFIELD_SIZE; i++) {
+        uint64_t was, now;
+
+        if (i + 8 <= MINEFIELD_SIZE) {
+            memcpy(&was, before + i, sizeof(uint64_t));
+            memcpy(&now, plan->field + i, sizeof(uint64_t));
+            if (was == now) {
+                i += 7;
+                continue;
+            }
+        }
+        if (plan->field[i] == before[i]) continue;
+
+        plan->bytesChanged++;
+        if (start >= 0 && (DWORD)(i - end) <= maxGap) {
+            end = i + 1;
+            continue;
+        }
+        if (start >= 0) AddFieldRange(plan, offsets, start, end);
+        start = i;
+        end   = i + 1;
+    }
+    if (start >= 0) AddFieldRange(plan, offsets, start, end);
+
+    plan->ranges[plan->numRanges].offset = offsets->minesRemaining;
+    plan->ranges[plan->numRanges].buff   = &plan->minesRemaining;
+    plan->ranges[plan->numRanges].length = sizeof(DWORD);
+    plan->numRanges++;
+    plan->bytesToWrite += sizeof(DWORD);
+
+    return 0;
+}
+
+int ApplyDirectFlag(MemorySource* source, const DirectFlagPlan* plan) {
+/**
+ * Purpose: Writes a plan's ranges, counter included, as one batch
+ * @param source : MemorySource* - the game
+ * @param plan : const DirectFlagPlan* - from PlanDirectFlag
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    if (!plan->numRanges) return 0;
+    return WriteSourceRanges(source, plan->ranges, plan->numRanges);
+}
+
+int DirectFlagAllMines(MemorySource* source, const WinmineOffsets* offsets, Snapshot* snapshot, DirectFlagPlan* plan) {
+/**
+ * Purpose: Puts a flag over every mine by writing the minefield. Nothing
+ *          runs inside winmine, so this works on anything the helper can
+ *          write to, but the game only redraws the tiles when it next paints.
+ *          The board is read from the same offsets the writes go to, and on
+ *          a live game no unchanged bytes are written back
+ * @param source : MemorySource* - the game
+ * @param offsets : const WinmineOffsets* - where the minefield and counter are
+ * @param snapshot : Snapshot* - receives the game as it was before flagging
+ * @param plan : DirectFlagPlan* - receives what was written
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    // Only a buffer (imageSize set) can't change between the read and the write
+    DWORD maxGap = source->imageSize ? DIRECT_FLAG_GAP : 0;
+
+    if (TakeSnapshotAt(source, offsets->numMines, snapshot)) return 1;
+    if (PlanDirectFlag(snapshot, offsets, maxGap, plan)) return 1;
+    return ApplyDirectFlag(source, plan);
+}
@@ -0,0 +1,38 @@
+/**
+ * Purpose: Flagging every mine by writing the minefield directly instead of
+ *          calling winmine's flag function from a remote thread. The field
+ *          as it should end up (MINE | FLAG on every covered or question
+ *          marked mine) is worked out locally and diffed against a snapshot
+ *          read from the build's own offsets. The changed bytes are written
+ *          in one batch together with the new mines remaining count. On a
+ *          buffer they're merged into as few ranges as possible. On a live
+ *          game only the mines are written, so nothing the player does
+ *          between the read and the write gets undone
+ */
+
+#ifndef DIRECT_FLAG_H
+#define DIRECT_FLAG_H
+
+#include"winmine.h"
+#include"memorySource.h"
+#include"snapshot.h"
+#include"signature.h"
+
+#define DIRECT_FLAG_GAP         ROW_STRIDE  // Unchanged bytes worth rewriting to save a write
+#define DIRECT_FLAG_MAX_RANGES  (MINEFIELD_SIZE/2 + 2)  // Every other byte changed, plus the counter
+
+typedef struct directFlagPlan_s {
+    unsigned char field[MINEFIELD_SIZE];   // The minefield as it should end up
+    DWORD minesRemaining;                  // The counter as it should end up
+    DWORD minesFlagged;                    // Mines that get a flag
+    DWORD bytesChanged;                    // Bytes of the field that differ from the snapshot
+    DWORD bytesToWrite;                    // Bytes the ranges cover, counter included
+    int numRanges;
+    WriteRange ranges[DIRECT_FLAG_MAX_RANGES];
+} DirectFlagPlan;
+
+int PlanDirectFlag(const Snapshot* snapshot, const WinmineOffsets* offsets, DWORD maxGap, DirectFlagPlan* plan);
+int ApplyDirectFlag(MemorySource* source, const DirectFlagPlan* plan);
+int DirectFlagAllMines(MemorySource* source, const WinmineOffsets* offsets, Snapshot* snapshot, DirectFlagPlan* plan);
+
+#endif
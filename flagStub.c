@@ -0,0 +1,70 @@
+/**
+ * Purpose: The batched flagging stub. See flagStub.h
+ */
+
+#include<string.h>
+#include"flagStub.h"
+
+// The compiled form of flagBatch in winmineShellcode.c, by hand so the CALL
+// can be pointed anywhere. It's a stdcall thread routine taking a pointer
+// to a flagBatch_s
+static const unsigned char flagStub[FLAG_STUB_LENGTH] = {
+    0x55,                    // PUSH EBP
+    0x8B, 0xEC,              // MOV EBP,ESP
+    0x56,                    // PUSH ESI
+    0x57,                    // PUSH EDI
+    0x8B, 0x75, 0x08,        // MOV ESI,[EBP+8]      ; the batch
+    0x8B, 0x3E,              // MOV EDI,[ESI]        ; count
+    0x83, 0xC6, 0x04,        // ADD ESI,4            ; first location
+    0x85, 0xFF,              // TEST EDI,EDI
+    0x74, 0x10,              // JZ done
+    0xFF, 0x76, 0x04,        // loop: PUSH [ESI+4]   ; y
+    0xFF, 0x36,              // PUSH [ESI]           ; x
+    0xE8, 0x00, 0x00, 0x00, 0x00,  // CALL <flag function>. Callee cleans up (stdcall)
+    0x83, 0xC6, 0x08,        // ADD ESI,8            ; next location
+    0x4F,                    // DEC EDI
+    0x75, 0xF0,              // JNZ loop
+    0x5F,                    // done: POP EDI
+    0x5E,                    // POP ESI
+    0x5D,                    // POP EBP
+    0xC2, 0x04, 0x00         // RET 4
+};
+
+size_t FlagBatchSize(DWORD numLocations) {
+/**
+ * Purpose: How many bytes BuildFlagBatch needs for a batch
+ * @param numLocations : DWORD - number of tiles in the batch
+ * @return : size_t - size of the stub plus the batch
+ */
+
+    return FLAG_BATCH_OFFSET + sizeof(struct flagBatch_s) + numLocations*sizeof(struct parameters_s);
+}
+
+void BuildFlagBatch(unsigned char* out, uint32_t remoteAddr, uint32_t flagFunction, \
+                    const struct parameters_s* locations, DWORD numLocations) {
+/**
+ * Purpose: Lays out the stub followed by the batch, ready to be written to
+ *          remoteAddr in one go. The thread should be started at remoteAddr
+ *          with remoteAddr + FLAG_BATCH_OFFSET as its parameter
+ * @param out : unsigned char* - at least FlagBatchSize(numLocations) bytes
+ * @param remoteAddr : uint32_t - where out will live in the target process
+ * @param flagFunction : uint32_t - address of the function that flags a tile
+ * @param locations : const struct parameters_s* - the tiles to flag
+ * @param numLocations : DWORD - number of tiles to flag
+ * @return : void
+ */
+
+    // The CALL operand is relative to the instruction after the CALL. Unsigned
+    // math wraps the same way the CPU does
+    uint32_t callOperand = flagFunction - (remoteAddr + FLAG_STUB_AFTER_CALL_OFFSET);
+
+    memset(out, 0xCC, FLAG_BATCH_OFFSET);  // INT3 padding after the stub
+    memcpy(out, flagStub, FLAG_STUB_LENGTH);
+    memcpy(out + FLAG_STUB_CALL_OFFSET, &callOperand, sizeof(uint32_t));
+
+    memcpy(out + FLAG_BATCH_OFFSET, &numLocations, sizeof(DWORD));
+    memcpy(out + FLAG_BATCH_OFFSET + sizeof(struct flagBatch_s), locations, \
+           numLocations*sizeof(struct parameters_s));
+
+    return;
+}
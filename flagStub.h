@@ -0,0 +1,37 @@
+/**
+ * Purpose: Builds the code we inject into winmine to flag tiles. One remote
+ *          thread runs a small loop that calls winmine's flag function for
+ *          every location in a batch, so a whole board costs one allocation,
+ *          one write and one thread
+ */
+
+#ifndef FLAG_STUB_H
+#define FLAG_STUB_H
+
+#include<stddef.h>
+#include<stdint.h>
+#include"winmine.h"
+
+#define FLAG_STUB_LENGTH            0x27  // Size of the loop stub
+#define FLAG_STUB_CALL_OFFSET       0x17  // Offset to the call operand in the stub
+#define FLAG_STUB_AFTER_CALL_OFFSET 0x1B  // Offset to the instruction after the CALL instruction
+#define FLAG_BATCH_OFFSET           0x28  // Offset to the batch (count + locations) after the stub
+
+// To pass two or more arguments to winmine's flag function, we'll use a struct
+// to put two ints on the stack
+struct parameters_s {
+    int x;
+    int y;
+};
+
+// What the stub's single argument points to
+struct flagBatch_s {
+    DWORD count;                     // Number of locations that follow
+    struct parameters_s locations[]; // The tiles to flag
+};
+
+size_t FlagBatchSize(DWORD numLocations);
+void BuildFlagBatch(unsigned char* out, uint32_t remoteAddr, uint32_t flagFunction, \
+                    const struct parameters_s* locations, DWORD numLocations);
+
+#endif
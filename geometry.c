@@ -0,0 +1,397 @@
+/**
+ * Purpose: Fixed, runtime and tiled board geometry. See geometry.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"geometry.h"
+#include"board.h"
+#include"tileDecode.h"
+
+// Fully unrolls a loop whose trip count the compiler knows
+#if defined(__clang__)
+#define UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define UNROLL _Pragma("GCC unroll 64")
+#else
+#define UNROLL
+#endif
+
+// The first playable tile of a winmine layout field
+#define FIRST_TILE(cells) ((cells) + ROW_STRIDE + 1)
+
+// Where tile (tx, ty) starts, and how much of it is on the board
+#define TILE_START(geometry, cells, tx, ty) ((cells) + ((size_t)(ty)*(geometry)->tilesAcross + (tx))*GEOMETRY_TILE_SIZE)
+#define TILE_SPAN(side, t) ((side) - (t)*GEOMETRY_TILE < GEOMETRY_TILE ? (side) - (t)*GEOMETRY_TILE : GEOMETRY_TILE)
+
+// Every path below is built from these three row kernels. They're inlined
+// into each caller, so wherever the bounds are constants so are the loops
+
+static inline void ScanRows(const unsigned char* row, DWORD width, DWORD height, DWORD stride, BoardCounts* counts) {
+/**
+ * Purpose: Adds up the mines, flags, question marks, revealed tiles and
+ *          exploded mines in a rectangle of tiles
+ * @param row : const unsigned char* - the rectangle's top left tile
+ * @param width : DWORD - tiles per row
+ * @param height : DWORD - rows
+ * @param stride : DWORD - bytes from one row to the next
+ * @param counts : BoardCounts* - added to
+ * @return : void
+ */
+
+    DWORD mines = 0, unflagged = 0, flagged = 0, questions = 0, revealed = 0, exploded = 0;
+
+    for (DWORD y = 0; y < height; y++, row += stride) {
+        UNROLL
+        for (DWORD x = 0; x < width; x++) {
+            DWORD mine = row[x] >> 7;
+            DWORD flag = (row[x] & 0x0F) == FLAG;
+
+            mines     += mine;
+            unflagged += mine & (flag ^ 1);
+            flagged   += flag;
+            questions += (row[x] & 0x0F) == QUESTION_MARK;
+            revealed  += (row[x] >> 6) & 1;
+            exploded  += mine & (row[x] >> 6);
+        }
+    }
+
+    counts->mines          += mines;
+    counts->unflaggedMines += unflagged;
+    counts->flagged        += flagged;
+    counts->questions      += questions;
+    counts->revealed       += revealed;
+    counts->exploded       += exploded;
+}
+
+static inline char* RenderSegment(const unsigned char* row, DWORD width, char* out) {
+/**
+ * Purpose: Draws a run of tiles from one row
+ * @param row : const unsigned char* - the first tile
+ * @param width : DWORD - tiles in the run
+ * @param out : char* - where the glyphs go
+ * @return : char* - just past the last glyph
+ */
+
+    UNROLL
+    for (DWORD x = 0; x < width; x++) {
+        memcpy(out, tileGlyphs[tileKindTable[row[x]]], 3);
+        out += 3;
+    }
+    return out;
+}
+
+static inline DWORD FlagRows(unsigned char* row, DWORD width, DWORD height, DWORD stride, int x0, int y0, \
+                             struct parameters_s* flagged, DWORD numFlagged, DWORD maxFlagged) {
+/**
+ * Purpose: Flags every covered or question marked mine in a rectangle
+ * @param row : unsigned char* - the rectangle's top left tile
+ * @param width : DWORD - tiles per row
+ * @param height : DWORD - rows
+ * @param stride : DWORD - bytes from one row to the next
+ * @param x0 : int - board x of the rectangle's left column
+ * @param y0 : int - board y of the rectangle's top row
+ * @param flagged : struct parameters_s* - where the flagged tiles are listed
+ * @param numFlagged : DWORD - how many were flagged before this rectangle
+ * @param maxFlagged : DWORD - room in the list
+ * @return : DWORD - how many have been flagged, this rectangle included
+ */
+
+    for (DWORD y = 0; y < height; y++, row += stride) {
+        UNROLL
+        for (DWORD x = 0; x < width; x++) {
+            if (row[x] != (MINE | UNCLICKED_SPACE) && row[x] != (MINE | QUESTION_MARK)) continue;
+            row[x] = MINE | FLAG;
+            if (numFlagged < maxFlagged) {
+                flagged[numFlagged].x = x0 + (int)x;
+                flagged[numFlagged].y = y0 + (int)y;
+            }
+            numFlagged++;
+        }
+    }
+    return numFlagged;
+}
+
+// The standard difficulties. Every bound is a constant
+#define FIXED_GEOMETRY(name, W, H) \
+static void Scan##name(const Geometry* geometry, const unsigned char* cells, BoardCounts* counts) { \
+    (void)geometry; \
+    memset(counts, 0, sizeof(BoardCounts)); \
+    ScanRows(FIRST_TILE(cells), W, H, ROW_STRIDE, counts); \
+} \
+static size_t Render##name(const Geometry* geometry, const unsigned char* cells, char* out) { \
+    (void)geometry; \
+    for (DWORD y = 0; y < H; y++) { \
+        out = RenderSegment(FIRST_TILE(cells) + y*ROW_STRIDE, W, out); \
+        *out++ = '\n'; \
+    } \
+    return (W*3 + 1)*H; \
+} \
+static DWORD Flag##name(const Geometry* geometry, unsigned char* cells, struct parameters_s* flagged, DWORD maxFlagged) { \
+    (void)geometry; \
+    return FlagRows(FIRST_TILE(cells), W, H, ROW_STRIDE, 1, 1, flagged, 0, maxFlagged); \
+}
+
+FIXED_GEOMETRY(Beginner, 9, 9)
+FIXED_GEOMETRY(Intermediate, 16, 16)
+FIXED_GEOMETRY(Expert, 30, 16)
+
+static void ScanRuntime(const Geometry* geometry, const unsigned char* cells, BoardCounts* counts) {
+/**
+ * Purpose: GeometryScan for any board in winmine's layout
+ * @param geometry : const Geometry* - the board's geometry
+ * @param cells : const unsigned char* - the board
+ * @param counts : BoardCounts* - receives the totals
+ * @return : void
+ */
+
+    memset(counts, 0, sizeof(BoardCounts));
+    ScanRows(FIRST_TILE(cells), geometry->width, geometry->height, ROW_STRIDE, counts);
+}
+
+static size_t RenderRuntime(const Geometry* geometry, const unsigned char* cells, char* out) {
+/**
+ * Purpose: GeometryRender for any board in winmine's layout
+ * @param geometry : const Geometry* - the board's geometry
+ * @param cells : const unsigned char* - the board
+ * @param out : char* - geometry->renderSize bytes
+ * @return : size_t - bytes written
+ */
+
+    for (DWORD y = 0; y < geometry->height; y++) {
+        out = RenderSegment(FIRST_TILE(cells) + y*ROW_STRIDE, geometry->width, out);
+        *out++ = '\n';
+    }
+    return geometry->renderSize;
+}
+
+static DWORD FlagRuntime(const Geometry* geometry, unsigned char* cells, struct parameters_s* flagged, DWORD maxFlagged) {
+/**
+ * Purpose: GeometryFlag for any board in winmine's layout
+ * @param geometry : const Geometry* - the board's geometry
+ * @param cells : unsigned char* - the board
+ * @param flagged : struct parameters_s* - where the flagged tiles are listed
+ * @param maxFlagged : DWORD - room in the list
+ * @return : DWORD - number of mines flagged
+ */
+
+    return FlagRows(FIRST_TILE(cells), geometry->width, geometry->height, ROW_STRIDE, 1, 1, flagged, 0, maxFlagged);
+}
+
+static void ScanTiled(const Geometry* geometry, const unsigned char* cells, BoardCounts* counts) {
+/**
+ * Purpose: GeometryScan for tiled boards. Whole tiles take the constant
+ *          bound copy of the kernel, the ragged right and bottom edges the
+ *          runtime one
+ * @param geometry : const Geometry* - the board's geometry
+ * @param cells : const unsigned char* - the board
+ * @param counts : BoardCounts* - receives the totals
+ * @return : void
+ */
+
+    memset(counts, 0, sizeof(BoardCounts));
+    for (DWORD ty = 0; ty < geometry->tilesDown; ty++) {
+        DWORD height = TILE_SPAN(geometry->height, ty);
+
+        for (DWORD tx = 0; tx < geometry->tilesAcross; tx++) {
+            const unsigned char* tile = TILE_START(geometry, cells, tx, ty);
+            DWORD width = TILE_SPAN(geometry->width, tx);
+
+            if (width == GEOMETRY_TILE && height == GEOMETRY_TILE) {
+                ScanRows(tile, GEOMETRY_TILE, GEOMETRY_TILE, GEOMETRY_TILE, counts);
+            }
+            else ScanRows(tile, width, height, GEOMETRY_TILE, counts);
+        }
+    }
+}
+
+static size_t RenderTiled(const Geometry* geometry, const unsigned char* cells, char* out) {
+/**
+ * Purpose: GeometryRender for tiled boards. A board row crosses a band of
+ *          tiles, one 64 tile run from each
+ * @param geometry : const Geometry* - the board's geometry
+ * @param cells : const unsigned char* - the board
+ * @param out : char* - geometry->renderSize bytes
+ * @return : size_t - bytes written
+ */
+
+    for (DWORD ty = 0; ty < geometry->tilesDown; ty++) {
+        DWORD height = TILE_SPAN(geometry->height, ty);
+
+        for (DWORD y = 0; y < height; y++) {
+            for (DWORD tx = 0; tx < geometry->tilesAcross; tx++) {
+                const unsigned char* row = TILE_START(geometry, cells, tx, ty) + y*GEOMETRY_TILE;
+                DWORD width = TILE_SPAN(geometry->width, tx);
+
+                if (width == GEOMETRY_TILE) out = RenderSegment(row, GEOMETRY_TILE, out);
+                else out = RenderSegment(row, width, out);
+            }
+            *out++ = '\n';
+        }
+    }
+    return geometry->renderSize;
+}
+
+static DWORD FlagTiled(const Geometry* geometry, unsigned char* cells, struct parameters_s* flagged, DWORD maxFlagged) {
+/**
+ * Purpose: GeometryFlag for tiled boards. Mines are listed a tile at a time,
+ *          so the list isn't in row order
+ * @param geometry : const Geometry* - the board's geometry
+ * @param cells : unsigned char* - the board
+ * @param flagged : struct parameters_s* - where the flagged tiles are listed
+ * @param maxFlagged : DWORD - room in the list
+ * @return : DWORD - number of mines flagged
+ */
+
+    DWORD numFlagged = 0;
+
+    for (DWORD ty = 0; ty < geometry->tilesDown; ty++) {
+        DWORD height = TILE_SPAN(geometry->height, ty);
+
+        for (DWORD tx = 0; tx < geometry->tilesAcross; tx++) {
+            unsigned char* tile = TILE_START(geometry, cells, tx, ty);
+            DWORD width = TILE_SPAN(geometry->width, tx);
+            int x0 = (int)(tx*GEOMETRY_TILE) + 1, y0 = (int)(ty*GEOMETRY_TILE) + 1;
+
+            if (width == GEOMETRY_TILE && height == GEOMETRY_TILE) {
+                numFlagged = FlagRows(tile, GEOMETRY_TILE, GEOMETRY_TILE, GEOMETRY_TILE, x0, y0, flagged, numFlagged, maxFlagged);
+            }
+            else numFlagged = FlagRows(tile, width, height, GEOMETRY_TILE, x0, y0, flagged, numFlagged, maxFlagged);
+        }
+    }
+    return numFlagged;
+}
+
+int InitGeometry(Geometry* geometry, DWORD width, DWORD height, int layout) {
+/**
+ * Purpose: Works out how a board of this size is laid out and which code
+ *          runs on it
+ * @param geometry : Geometry* - receives the geometry
+ * @param width : DWORD - the width of the board
+ * @param height : DWORD - the height of the board
+ * @param layout : int - GEOMETRY_AUTO, GEOMETRY_RUNTIME or GEOMETRY_TILED
+ * @return : int - 0 on success, 1 if the board can't be laid out that way
+ */
+
+    int fitsWinmine = width >= 1 && width <= MAX_WIDTH && height >= 1 && height <= MAX_HEIGHT;
+
+    memset(geometry, 0, sizeof(Geometry));
+    geometry->width      = width;
+    geometry->height     = height;
+    geometry->renderSize = ((size_t)width*3 + 1)*height;
+
+    if (fitsWinmine && layout != GEOMETRY_TILED) {
+        geometry->name      = "custom";
+        geometry->cellsSize = MINEFIELD_SIZE;
+        geometry->scan      = ScanRuntime;
+        geometry->render    = RenderRuntime;
+        geometry->flag      = FlagRuntime;
+        if (layout == GEOMETRY_RUNTIME) return 0;
+
+        if (width == 9 && height == 9) {
+            geometry->name   = "beginner";
+            geometry->scan   = ScanBeginner;
+            geometry->render = RenderBeginner;
+            geometry->flag   = FlagBeginner;
+        }
+        else if (width == 16 && height == 16) {
+            geometry->name   = "intermediate";
+            geometry->scan   = ScanIntermediate;
+            geometry->render = RenderIntermediate;
+            geometry->flag   = FlagIntermediate;
+        }
+        else if (width == 30 && height == 16) {
+            geometry->name   = "expert";
+            geometry->scan   = ScanExpert;
+            geometry->render = RenderExpert;
+            geometry->flag   = FlagExpert;
+        }
+        return 0;
+    }
+
+    if (layout == GEOMETRY_RUNTIME || width < 1 || width > GEOMETRY_MAX_SIDE || height < 1 || height > GEOMETRY_MAX_SIDE) {
+        printf("Can't lay out a %ux%u board that way\n", width, height);
+        return 1;
+    }
+
+    geometry->name        = "tiled";
+    geometry->tiled       = 1;
+    geometry->tilesAcross = (width + GEOMETRY_TILE - 1) / GEOMETRY_TILE;
+    geometry->tilesDown   = (height + GEOMETRY_TILE - 1) / GEOMETRY_TILE;
+    geometry->cellsSize   = (size_t)geometry->tilesAcross*geometry->tilesDown*GEOMETRY_TILE_SIZE;
+    geometry->scan        = ScanTiled;
+    geometry->render      = RenderTiled;
+    geometry->flag        = FlagTiled;
+
+    return 0;
+}
+
+size_t GeometryOffset(const Geometry* geometry, DWORD x, DWORD y) {
+/**
+ * Purpose: Where a tile lives in the board's cells
+ * @param geometry : const Geometry* - the board's geometry
+ * @param x : DWORD - column, from 1
+ * @param y : DWORD - row, from 1
+ * @return : size_t - the tile's offset
+ */
+
+    if (!geometry->tiled) return x + y*ROW_STRIDE;
+
+    x--;
+    y--;
+    return ((size_t)(y / GEOMETRY_TILE)*geometry->tilesAcross + x / GEOMETRY_TILE)*GEOMETRY_TILE_SIZE + \
+           (y % GEOMETRY_TILE)*GEOMETRY_TILE + x % GEOMETRY_TILE;
+}
+
+int BuildTiledBoard(const Geometry* geometry, unsigned char* cells, DWORD numMines, unsigned int seed) {
+/**
+ * Purpose: Lays out a fresh (nothing clicked) tiled board with numMines
+ *          mines, picked the same way BuildBoard picks them
+ * @param geometry : const Geometry* - a tiled geometry
+ * @param cells : unsigned char* - geometry->cellsSize bytes
+ * @param numMines : DWORD - number of mines to place
+ * @param seed : unsigned int - seed for mine placement
+ * @return : int - 0 on success, 1 if there are more mines than tiles
+ */
+
+    DWORD numTiles = geometry->width*geometry->height;
+    unsigned int state = seed ? seed : 0x2545F491;  // xorshift can't start at 0
+
+    if (!geometry->tiled || numMines > numTiles) {
+        printf("Invalid tiled board: %ux%u, mines %u\n", geometry->width, geometry->height, numMines);
+        return 1;
+    }
+
+    // Tiles past the right and bottom edges are never looked at
+    memset(cells, UNCLICKED_SPACE, geometry->cellsSize);
+
+    // Floyd's sampling, with the board as the "already picked" set
+    for (DWORD j = numTiles - numMines; j < numTiles; j++) {
+        DWORD pick = NextRandom(&state) % (j + 1);
+        unsigned char* tile = cells + GeometryOffset(geometry, pick % geometry->width + 1, pick / geometry->width + 1);
+        if (*tile & MINE) tile = cells + GeometryOffset(geometry, j % geometry->width + 1, j / geometry->width + 1);
+        *tile |= MINE;
+    }
+
+    return 0;
+}
+
+void CopyBoard(const Geometry* from, const unsigned char* fromCells, const Geometry* to, unsigned char* toCells) {
+/**
+ * Purpose: Copies every tile from one layout to another. The boards must be
+ *          the same size
+ * @param from : const Geometry* - the source's geometry
+ * @param fromCells : const unsigned char* - the source
+ * @param to : const Geometry* - the destination's geometry
+ * @param toCells : unsigned char* - the destination
+ * @return : void
+ */
+
+    for (DWORD y = 1; y <= from->height; y++) {
+        for (DWORD x = 1; x <= from->width; x++) {
+            toCells[GeometryOffset(to, x, y)] = fromCells[GeometryOffset(from, x, y)];
+        }
+    }
+
+    return;
+}
@@ -0,0 +1,72 @@
+/**
+ * Purpose: Board geometry. Scanning, rendering and flagging a board go
+ *          through a Geometry, which picks the code for its size once. The
+ *          three standard difficulties get their own copies with every bound
+ *          a constant, so the compiler unrolls the rows. Any other board up
+ *          to winmine's limits runs the same code with runtime bounds. Boards
+ *          bigger than winmine allows (a 1000x1000 game in a simulator, say)
+ *          are stored in 64x64 tiles, row-major inside each tile and tiles
+ *          row-major across the board, so a tile's neighbors are never more
+ *          than a few cache lines away
+ */
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include<stddef.h>
+#include"winmine.h"
+#include"flagStub.h"
+
+#define GEOMETRY_TILE       64                              // Large boards are stored in 64x64 tiles
+#define GEOMETRY_TILE_SIZE  (GEOMETRY_TILE*GEOMETRY_TILE)   // Bytes per tile
+#define GEOMETRY_MAX_SIDE   8192                            // Biggest tiled board side
+
+// How InitGeometry lays the board out
+#define GEOMETRY_AUTO     0   // Winmine's layout when it fits (specialized for the standard sizes), tiles otherwise
+#define GEOMETRY_RUNTIME  1   // Winmine's layout with runtime bounds, even for the standard sizes
+#define GEOMETRY_TILED    2   // Tiles, whatever the size
+
+typedef struct boardCounts_s {
+    DWORD mines;
+    DWORD unflaggedMines;     // Mines without a flag on them
+    DWORD flagged;            // Flags, right or wrong
+    DWORD questions;
+    DWORD revealed;           // Tiles with the revealed bit set
+    DWORD exploded;           // Mines with the revealed bit set. Only after a loss
+} BoardCounts;
+
+struct geometry_s;
+
+// Adds up what's on the board
+typedef void (*GeometryScan)(const struct geometry_s* geometry, const unsigned char* cells, BoardCounts* counts);
+
+// Draws the board into out, one line per row with tileGlyphs for every tile.
+// Returns the number of bytes written (geometry->renderSize)
+typedef size_t (*GeometryRender)(const struct geometry_s* geometry, const unsigned char* cells, char* out);
+
+// Flags every mine that's covered or question marked and lists where they
+// were (x and y from 1). Returns how many were flagged, which can be more
+// than maxFlagged. Only the first maxFlagged are listed
+typedef DWORD (*GeometryFlag)(const struct geometry_s* geometry, unsigned char* cells, \
+                              struct parameters_s* flagged, DWORD maxFlagged);
+
+typedef struct geometry_s {
+    const char* name;         // beginner, intermediate, expert, custom or tiled
+    DWORD width;
+    DWORD height;
+    int tiled;                // 0 for winmine's layout (32 byte rows and a border), 1 for tiles
+    DWORD tilesAcross;        // Tiled only
+    DWORD tilesDown;
+    size_t cellsSize;         // Bytes the board takes
+    size_t renderSize;        // Bytes render writes
+    GeometryScan scan;
+    GeometryRender render;
+    GeometryFlag flag;
+} Geometry;
+
+int InitGeometry(Geometry* geometry, DWORD width, DWORD height, int layout);
+size_t GeometryOffset(const Geometry* geometry, DWORD x, DWORD y);
+int BuildTiledBoard(const Geometry* geometry, unsigned char* cells, DWORD numMines, unsigned int seed);
+void CopyBoard(const Geometry* from, const unsigned char* fromCells, const Geometry* to, unsigned char* toCells);
+
+#endif
@@ -0,0 +1,339 @@
+/**
+ * Purpose: The honest helper kept up to date between boards. See incrementalSolver.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"incrementalSolver.h"
+
+#define VISIBLE_BYTES 0x0F0F0F0F0F0F0F0FULL   // TILE_VISIBLE_MASK in each byte of a word
+
+void InitIncrementalSolver(IncrementalSolver* solver, int validate) {
+/**
+ * Purpose: Sets up a solver with no board. The first update starts it off
+ * @param solver : IncrementalSolver* - the solver
+ * @param validate : int - non-zero to check every update against SolveVisible
+ * @return : void
+ */
+
+    memset(solver, 0, sizeof(IncrementalSolver));
+    solver->validate = validate;
+}
+
+static void QueueAround(IncrementalSolver* solver, DWORD x, DWORD y) {
+/**
+ * Purpose: Queues the numbers around a tile, and the tile itself if it's a
+ *          number, to be looked at again. Numbers already waiting are skipped
+ * @param solver : IncrementalSolver* - the solver
+ * @param x : DWORD - column of the tile
+ * @param y : DWORD - row of the tile
+ * @return : void
+ */
+
+    for (DWORD row = y - 1; row <= y + 1; row++) {
+        if (row < 1 || row > solver->height) continue;
+
+        for (DWORD column = x - 1; column <= x + 1; column++) {
+            unsigned char visible = solver->kinds[column + row*ROW_STRIDE];
+            if (visible < 1 || visible > 8 || ((solver->pending[row] >> column) & 1)) continue;
+
+            solver->pending[row] |= 1u << column;
+            solver->work[solver->numWork++] = (unsigned short)(column + row*ROW_STRIDE);
+        }
+    }
+}
+
+static DWORD Mark(IncrementalSolver* solver, DWORD top, const uint32_t* rows, int isMine) {
+/**
+ * Purpose: Records three rows worth of tiles as safe or mined and queues the
+ *          numbers around each one that wasn't already known
+ * @param solver : IncrementalSolver* - the solver
+ * @param top : DWORD - field row of rows[0]
+ * @param rows : const uint32_t* - three row masks
+ * @param isMine : int - non-zero for mines, 0 for safe tiles
+ * @return : DWORD - number of tiles that weren't already known
+ */
+
+    uint32_t* known = isMine ? solver->result.mines : solver->result.safe;
+    DWORD added = 0;
+
+    for (DWORD i = 0; i < 3; i++) {
+        uint32_t fresh = rows[i] & ~known[top + i];
+
+        known[top + i] |= fresh;
+        for (; fresh; fresh &= fresh - 1) {
+            QueueAround(solver, (DWORD)CTZ32(fresh), top + i);
+            added++;
+        }
+    }
+
+    if (isMine) solver->result.numMines += added;
+    else solver->result.numSafe += added;
+    return added;
+}
+
+static int Gather(const IncrementalSolver* solver, DWORD x, DWORD y, Constraint* constraint) {
+/**
+ * Purpose: Builds the constraint on one number from what's known right now
+ * @param solver : const IncrementalSolver* - the solver
+ * @param x : DWORD - column of the number
+ * @param y : DWORD - row of the number
+ * @param constraint : Constraint* - receives the constraint
+ * @return : int - 1 if it has unknown tiles, 0 if it doesn't, -1 if it
+ *         contradicts what's known
+ */
+
+    uint32_t around = 7u << (x - 1);
+    int knownMines = 0;
+
+    for (DWORD i = 0; i < 3; i++) {
+        DWORD row = y - 1 + i;
+        constraint->rows[i] = around & solver->covered[row] & ~solver->result.safe[row] & ~solver->result.mines[row];
+        knownMines += POPCOUNT32(around & solver->result.mines[row]);
+    }
+    if (!(constraint->rows[0] | constraint->rows[1] | constraint->rows[2])) return 0;
+
+    constraint->x = x;
+    constraint->y = y;
+    constraint->mines = solver->kinds[x + y*ROW_STRIDE] - knownMines;
+    if (constraint->mines < 0 || constraint->mines > ConstraintSize(constraint)) return -1;
+    return 1;
+}
+
+static DWORD Pair(IncrementalSolver* solver, const Constraint* a, const Constraint* b) {
+/**
+ * Purpose: SolveVisible's pairwise rule for one ordered pair. If B minus A
+ *          has exactly B.mines - A.mines tiles they're all mines and A minus
+ *          B is safe
+ * @param solver : IncrementalSolver* - the solver
+ * @param a : const Constraint* - constraint A
+ * @param b : const Constraint* - constraint B
+ * @return : DWORD - number of tiles found
+ */
+
+    uint32_t bOnly[3];  // B minus A, in B's rows
+    uint32_t aOnly[3];  // A minus B, in A's rows
+    int bOnlySize = 0;
+
+    for (DWORD r = 0; r < 3; r++) {
+        bOnly[r] = b->rows[r] & ~ConstraintRow(a, b->y - 1 + r);
+        aOnly[r] = a->rows[r] & ~ConstraintRow(b, a->y - 1 + r);
+        bOnlySize += POPCOUNT32(bOnly[r]);
+    }
+
+    if (bOnlySize != b->mines - a->mines) return 0;
+    return Mark(solver, b->y - 1, bOnly, 1) + Mark(solver, a->y - 1, aOnly, 0);
+}
+
+static int Evaluate(IncrementalSolver* solver, DWORD offset) {
+/**
+ * Purpose: Looks at one number again: the single number rule, then the
+ *          pairwise rule against every number close enough to share a tile.
+ *          Whatever it finds queues the numbers around it in turn
+ * @param solver : IncrementalSolver* - the solver
+ * @param offset : DWORD - the number's offset in the field
+ * @return : int - 0 on success, 1 if the numbers contradict each other
+ */
+
+    DWORD x = offset % ROW_STRIDE;
+    DWORD y = offset / ROW_STRIDE;
+    Constraint a;
+    int status = Gather(solver, x, y, &a);
+
+    if (status <= 0) return status < 0;
+    solver->evaluated++;
+
+    if (a.mines == 0) {
+        Mark(solver, y - 1, a.rows, 0);
+        return 0;
+    }
+    if (a.mines == ConstraintSize(&a)) {
+        Mark(solver, y - 1, a.rows, 1);
+        return 0;
+    }
+
+    // A found something: it's been queued again if that changed it, and every
+    // number that did change has been queued, so going on with this A is safe
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            int bx = (int)x + dx;
+            int by = (int)y + dy;
+            Constraint b;
+            unsigned char visible;
+
+            if ((!dx && !dy) || bx < 1 || bx > (int)solver->width || by < 1 || by > (int)solver->height) continue;
+            visible = solver->kinds[bx + by*ROW_STRIDE];
+            if (visible < 1 || visible > 8) continue;
+
+            status = Gather(solver, (DWORD)bx, (DWORD)by, &b);
+            if (status < 0) return 1;
+            if (!status) continue;
+
+            Pair(solver, &a, &b);
+            Pair(solver, &b, &a);
+        }
+    }
+
+    return 0;
+}
+
+static void Restart(IncrementalSolver* solver, const unsigned char* kinds, DWORD height, DWORD width) {
+/**
+ * Purpose: Forgets everything and queues every number on the board. Needed
+ *          for the first board, a new game or a board of another size
+ * @param solver : IncrementalSolver* - the solver
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @return : void
+ */
+
+    memset(solver->covered, 0, sizeof(solver->covered));
+    memset(solver->pending, 0, sizeof(solver->pending));
+    memset(solver->result.safe, 0, sizeof(solver->result.safe));
+    memset(solver->result.mines, 0, sizeof(solver->result.mines));
+    solver->result.numSafe  = 0;
+    solver->result.numMines = 0;
+    solver->numWork   = 0;
+    solver->height    = height;
+    solver->width     = width;
+    solver->started   = 1;
+    solver->restarted = 1;
+    solver->changed   = width*height;
+
+    for (DWORD i = 0; i < KIND_GRID_SIZE; i++) solver->kinds[i] = kinds[i] & TILE_VISIBLE_MASK;
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            if (SOLVER_COVERED(solver->kinds[x + y*ROW_STRIDE])) solver->covered[y] |= 1u << x;
+        }
+    }
+    for (DWORD y = 1; y <= height; y++) {
+        if (!(solver->covered[y - 1] | solver->covered[y] | solver->covered[y + 1])) continue;
+        for (DWORD x = 1; x <= width; x++) QueueAround(solver, x, y);
+    }
+}
+
+static int Diff(IncrementalSolver* solver, const unsigned char* kinds) {
+/**
+ * Purpose: Takes in the tiles that changed since the last board, 8 at a
+ *          time until one did. A tile that's been uncovered stops being
+ *          known and queues the numbers around it. Flags and question marks
+ *          coming and going change nothing the helper uses
+ * @param solver : IncrementalSolver* - the solver
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @return : int - 0 on success, 1 if a tile went back under cover or a
+ *         number changed, meaning it's another game
+ */
+
+    for (DWORD y = 1; y <= solver->height; y++) {
+        for (DWORD word = 0; word < ROW_STRIDE; word += sizeof(uint64_t)) {
+            const unsigned char* now = kinds + y*ROW_STRIDE + word;
+            unsigned char* was = solver->kinds + y*ROW_STRIDE + word;
+            uint64_t before, after;
+
+            memcpy(&before, was, sizeof(uint64_t));
+            memcpy(&after, now, sizeof(uint64_t));
+            if (!((before ^ after) & VISIBLE_BYTES)) continue;
+
+            for (DWORD i = 0; i < sizeof(uint64_t); i++) {
+                DWORD x = word + i;
+                unsigned char visible = now[i] & TILE_VISIBLE_MASK;
+                uint32_t bit = 1u << x;
+
+                if (visible == was[i] || x < 1 || x > solver->width) continue;
+                if (!(solver->covered[y] & bit)) return 1;
+                was[i] = visible;
+                if (SOLVER_COVERED(visible)) continue;   // A flag or question mark
+
+                solver->changed++;
+                solver->covered[y] &= ~bit;
+                if (solver->result.safe[y] & bit) solver->result.numSafe--;
+                if (solver->result.mines[y] & bit) solver->result.numMines--;
+                solver->result.safe[y]  &= ~bit;
+                solver->result.mines[y] &= ~bit;
+                QueueAround(solver, x, y);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int Validate(IncrementalSolver* solver, const unsigned char* kinds, int status) {
+/**
+ * Purpose: Runs SolveVisible on the same board and checks it found exactly
+ *          what the update did
+ * @param solver : IncrementalSolver* - the solver, just updated
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param status : int - what the update returned
+ * @return : int - status if they match, INCREMENTAL_MISMATCH if not
+ */
+
+    int expected = SolveVisible(kinds, solver->height, solver->width, &solver->check);
+
+    if (expected != status) {
+        printf("Incremental solver returned %d, SolveVisible %d\n", status, expected);
+        return INCREMENTAL_MISMATCH;
+    }
+    if (status) return status;
+
+    for (DWORD y = 1; y <= solver->height; y++) {
+        uint32_t safe  = solver->result.safe[y] ^ solver->check.safe[y];
+        uint32_t mines = solver->result.mines[y] ^ solver->check.mines[y];
+
+        if (!(safe | mines)) continue;
+        printf("Incremental solver disagrees with SolveVisible at %u, %u: %s\n", (DWORD)CTZ32(safe | mines), y, \
+               safe ? "safe" : "mined");
+        return INCREMENTAL_MISMATCH;
+    }
+
+    return 0;
+}
+
+int UpdateIncremental(IncrementalSolver* solver, const unsigned char* kinds, DWORD height, DWORD width) {
+/**
+ * Purpose: Brings the solver up to a new board. Only the visible part of
+ *          each kind is looked at. Afterward solver->result holds the safe
+ *          and mined tiles SolveVisible would find. It has no constraints;
+ *          ListConstraints fills them in if they're wanted
+ * @param solver : IncrementalSolver* - the solver
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @return : int - 0 on success, 1 if the visible numbers contradict each
+ *         other, INCREMENTAL_MISMATCH if validating and SolveVisible disagrees
+ */
+
+    int status = 0;
+
+    solver->changed   = 0;
+    solver->evaluated = 0;
+    solver->restarted = 0;
+    solver->result.numConstraints = 0;
+    solver->result.passes = 1;
+
+    if (!solver->started || height != solver->height || width != solver->width || Diff(solver, kinds)) {
+        Restart(solver, kinds, height, width);
+    }
+
+    while (solver->numWork && !status) {
+        DWORD offset = solver->work[--solver->numWork];
+
+        solver->pending[offset / ROW_STRIDE] &= ~(1u << (offset % ROW_STRIDE));
+        status = Evaluate(solver, offset);
+    }
+
+    // A tile can only end up both if the numbers contradict each other
+    for (DWORD y = 1; y <= height && !status; y++) {
+        if (solver->result.safe[y] & solver->result.mines[y]) status = 1;
+    }
+
+    // What's known may be wrong now. Start over on the next board
+    if (status) {
+        solver->started = 0;
+        solver->numWork = 0;
+        memset(solver->pending, 0, sizeof(solver->pending));
+    }
+
+    return solver->validate ? Validate(solver, kinds, status) : status;
+}
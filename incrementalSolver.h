@@ -0,0 +1,44 @@
+/**
+ * Purpose: The honest helper, kept up to date instead of started over. What
+ *          it knows (safe and mined tiles) lasts from one board to the next.
+ *          Each new board is diffed against the last, and only the numbers
+ *          around tiles that changed are looked at again, along with the
+ *          numbers around anything that turns out to be safe or mined. An
+ *          update costs about as much as the change did, not the whole
+ *          board. Ends up knowing exactly what SolveVisible would
+ */
+
+#ifndef INCREMENTAL_SOLVER_H
+#define INCREMENTAL_SOLVER_H
+
+#include<stdint.h>
+#include"winmine.h"
+#include"bitboard.h"
+#include"tileDecode.h"
+#include"solver.h"
+
+#define INCREMENTAL_MISMATCH 2   // Validating, and SolveVisible found something else
+
+typedef struct incrementalSolver_s {
+    DWORD width;
+    DWORD height;
+    int started;                                     // Holds a board to diff against
+    int validate;                                    // Run SolveVisible alongside every update and compare
+    unsigned char kinds[KIND_GRID_SIZE];             // Visible kinds of the last board
+    uint32_t covered[BITBOARD_ROWS];                 // Tiles we can't see under
+    uint32_t pending[BITBOARD_ROWS];                 // Numbers waiting to be looked at
+    unsigned short work[MAX_WIDTH*MAX_HEIGHT];       // The same numbers, as offsets
+    DWORD numWork;
+    SolverResult result;                             // Safe and mined tiles. Constraints only from ListConstraints
+    SolverResult check;                              // SolveVisible's answer when validating
+
+    // The last update
+    DWORD changed;                                   // Tiles that changed since the board before
+    DWORD evaluated;                                 // Numbers looked at
+    int restarted;                                   // Non-zero if it had to start over (new game, new size)
+} IncrementalSolver;
+
+void InitIncrementalSolver(IncrementalSolver* solver, int validate);
+int UpdateIncremental(IncrementalSolver* solver, const unsigned char* kinds, DWORD height, DWORD width);
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * Purpose: Running actions on every game at once. See instances.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"instances.h"
+#include"bitboard.h"
+#include"timing.h"
+
+// What a thread pool task needs to run the action on one game
+struct instanceTask_s {
+    Instance* instance;
+    InstanceAction action;
+    void* context;
+};
+
+void InitInstanceSet(InstanceSet* set, char* processName) {
+/**
+ * Purpose: Sets up an empty set. Nothing is looked up until FindInstances
+ * @param set : InstanceSet* - the set to initialize
+ * @param processName : char* - name of the processes (and modules) to attach to
+ * @return : void
+ */
+
+    memset(set, 0, sizeof(InstanceSet));
+    set->processName = processName;
+
+    return;
+}
+
+int FindInstances(InstanceSet* set) {
+/**
+ * Purpose: Brings the set up to date with the games that are running. Games
+ *          that went away are let go, new ones are attached to, and the ones
+ *          already attached keep their sessions
+ * @param set : InstanceSet* - the set
+ * @return : int - number of games in the set
+ */
+
+    DWORD PIDs[MAX_INSTANCES];  // Every matching process
+    int numPIDs = FindProcessPIDs(set->processName, PIDs, MAX_INSTANCES);
+    int kept = 0;
+
+    // Let go of games that went away, keeping the rest in the order they were found
+    for (int i = 0; i < set->numInstances; i++) {
+        if (!SessionAlive(&set->instances[i].session)) {
+            CloseSession(&set->instances[i].session);
+            continue;
+        }
+        if (kept != i) set->instances[kept] = set->instances[i];
+        kept++;
+    }
+    set->numInstances = kept;
+
+    // Attach to the new ones
+    for (int p = 0; p < numPIDs && set->numInstances < MAX_INSTANCES; p++) {
+        Instance* instance = &set->instances[set->numInstances];
+        int known = 0;
+
+        for (int i = 0; i < set->numInstances; i++) known |= set->instances[i].session.PID == PIDs[p];
+        if (known) continue;
+
+        memset(instance, 0, sizeof(Instance));
+        InitSession(&instance->session, set->processName);
+        if (AttachSession(&instance->session, PIDs[p])) continue;
+        set->numInstances++;
+    }
+
+    return set->numInstances;
+}
+
+int SnapshotInstance(Instance* instance, void* context) {
+/**
+ * Purpose: Action that reads the game's snapshot. Enough for the report's
+ *          info on the game
+ * @param instance : Instance* - the game
+ * @param context : void* - unused
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    (void)context;
+    return TakeSnapshot(&instance->session.source, &instance->snapshot);
+}
+
+static void InstanceTask(void* argument) {
+/**
+ * Purpose: Thread pool task that runs the action on one game and times it
+ * @param argument : struct instanceTask_s* - the task
+ * @return : void
+ */
+
+    struct instanceTask_s* task = (struct instanceTask_s*)argument;
+    unsigned long long start = NowNs();
+
+    task->instance->status = task->action(task->instance, task->context);
+    task->instance->busyNs = NowNs() - start;
+}
+
+int RunOnInstances(ThreadPool* pool, InstanceSet* set, int numInstances, InstanceAction action, void* context, \
+                   InstanceReport* report) {
+/**
+ * Purpose: Runs the action on the first numInstances games of the set, one
+ *          task per game. The pool's size bounds how many run at once
+ * @param pool : ThreadPool* - the workers. NULL runs every game on this thread
+ * @param set : InstanceSet* - the games
+ * @param numInstances : int - how many of them to run on
+ * @param action : InstanceAction - what to do to each game
+ * @param context : void* - passed to every action
+ * @param report : InstanceReport* - receives the merged results
+ * @return : int - 0 if the action worked on every game, 1 otherwise
+ */
+
+    struct instanceTask_s tasks[MAX_INSTANCES];
+    TaskGroup group = { 0 };
+    unsigned long long start;
+
+    if (numInstances > set->numInstances) numInstances = set->numInstances;
+    memset(report, 0, sizeof(InstanceReport));
+    report->numInstances = numInstances;
+
+    // The sources count every read and write. Report only this run's
+    for (int i = 0; i < numInstances; i++) {
+        MemorySource* source = &set->instances[i].session.source;
+        report->reads        -= source->numReads;
+        report->bytesRead    -= source->bytesRead;
+        report->writes       -= source->numWrites;
+        report->bytesWritten -= source->bytesWritten;
+    }
+
+    start = NowNs();
+    for (int i = 0; i < numInstances; i++) {
+        tasks[i].instance = &set->instances[i];
+        tasks[i].action   = action;
+        tasks[i].context  = context;
+        SubmitTask(pool, &group, InstanceTask, &tasks[i]);
+    }
+    if (pool) WaitForGroup(pool, &group);
+    report->wallNs = NowNs() - start;
+
+    for (int i = 0; i < numInstances; i++) {
+        Instance* instance = &set->instances[i];
+        MemorySource* source = &instance->session.source;
+
+        report->numFailed    += instance->status != 0;
+        report->busyNs       += instance->busyNs;
+        report->reads        += source->numReads;
+        report->bytesRead    += source->bytesRead;
+        report->writes       += source->numWrites;
+        report->bytesWritten += source->bytesWritten;
+        if (instance->busyNs > report->slowestNs) report->slowestNs = instance->busyNs;
+    }
+
+    return report->numFailed != 0;
+}
+
+void PrintInstanceReport(const InstanceSet* set, const InstanceReport* report) {
+/**
+ * Purpose: Prints a line for each game from its last snapshot, then the totals
+ * @param set : const InstanceSet* - the games
+ * @param report : const InstanceReport* - the merged results of the last run
+ * @return : void
+ */
+
+    static const char* states[3] = { "playing", "won", "lost" };
+    Bitboard board;
+
+    printf("%8s %7s %6s %9s %6s %8s %10s  %s\n", "PID", "size", "mines", "revealed", "flags", "state", "us", "result");
+    for (int i = 0; i < report->numInstances; i++) {
+        const Instance* instance = &set->instances[i];
+        const Snapshot* snapshot = &instance->snapshot;
+        char size[16];
+        int revealed = 0, flags = 0;
+
+        if (snapshot->width < 1 || snapshot->width > MAX_WIDTH || snapshot->height < 1 || snapshot->height > MAX_HEIGHT) {
+            printf("%8u %7s %6s %9s %6s %8s %10.1f  %s\n", instance->session.PID, "-", "-", "-", "-", "-", \
+                   instance->busyNs / 1000.0, instance->status ? "failed" : "no game");
+            continue;
+        }
+
+        PackBitboard(SNAPSHOT_FIELD(snapshot), snapshot->height, snapshot->width, &board);
+        for (DWORD y = 1; y <= snapshot->height; y++) {
+            revealed += POPCOUNT32(board.revealed[y]);
+            flags    += POPCOUNT32(board.flagged[y]);
+        }
+        snprintf(size, sizeof(size), "%ux%u", snapshot->width, snapshot->height);
+        printf("%8u %7s %6u %9d %6d %8s %10.1f  %s\n", instance->session.PID, size, snapshot->numMines, revealed, \
+               flags, states[GameState(&board)], instance->busyNs / 1000.0, instance->status ? "failed" : "ok");
+    }
+
+    printf("%d games, %d failed. %.1f us wall clock, %.1f us of work (%.1f at once), slowest %.1f us\n", \
+           report->numInstances, report->numFailed, report->wallNs / 1000.0, report->busyNs / 1000.0, \
+           report->wallNs ? (double)report->busyNs / (double)report->wallNs : 0.0, report->slowestNs / 1000.0);
+    printf("%llu reads (%llu bytes), %llu writes (%llu bytes)\n\n", report->reads, report->bytesRead, \
+           report->writes, report->bytesWritten);
+
+    return;
+}
+
+void CloseInstances(InstanceSet* set) {
+/**
+ * Purpose: Lets go of every game
+ * @param set : InstanceSet* - the games
+ * @return : void
+ */
+
+    for (int i = 0; i < set->numInstances; i++) CloseSession(&set->instances[i].session);
+    set->numInstances = 0;
+
+    return;
+}
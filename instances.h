@@ -0,0 +1,56 @@
+/**
+ * Purpose: Every running game at once. Each winmine process found gets its
+ *          own session, and an action (snapshot, print info, flag all) runs
+ *          on all of them on a bounded thread pool. The per-game results are
+ *          merged into one report
+ */
+
+#ifndef INSTANCES_H
+#define INSTANCES_H
+
+#include"winmine.h"
+#include"session.h"
+#include"snapshot.h"
+#include"threadPool.h"
+
+#define MAX_INSTANCES     64   // Most games handled at once
+#define INSTANCE_WORKERS  8    // Most games worked on at the same time
+
+typedef struct instance_s {
+    Session session;                 // Attached to one game for as long as it runs
+    Snapshot snapshot;               // What the last action read
+    int status;                      // 0 if the last action worked
+    unsigned long long busyNs;       // How long the last action took
+} Instance;
+
+// Runs on a pool thread with nothing shared but context. Returns 0 on success
+typedef int (*InstanceAction)(Instance* instance, void* context);
+
+typedef struct instanceSet_s {
+    char* processName;               // Name of the processes (and modules) to attach to
+    int numInstances;
+    Instance instances[MAX_INSTANCES];
+} InstanceSet;
+
+// Every instance's results added together
+typedef struct instanceReport_s {
+    int numInstances;
+    int numFailed;
+    unsigned long long wallNs;       // Start of the first action to end of the last
+    unsigned long long busyNs;       // All the actions' times added up
+    unsigned long long slowestNs;
+    unsigned long long reads;
+    unsigned long long bytesRead;
+    unsigned long long writes;
+    unsigned long long bytesWritten;
+} InstanceReport;
+
+void InitInstanceSet(InstanceSet* set, char* processName);
+int FindInstances(InstanceSet* set);
+int SnapshotInstance(Instance* instance, void* context);
+int RunOnInstances(ThreadPool* pool, InstanceSet* set, int numInstances, InstanceAction action, void* context, \
+                   InstanceReport* report);
+void PrintInstanceReport(const InstanceSet* set, const InstanceReport* report);
+void CloseInstances(InstanceSet* set);
+
+#endif
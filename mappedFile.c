@@ -0,0 +1,102 @@
+/**
+ * Purpose: Read only file mappings. See mappedFile.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#ifndef _WIN32
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+#include"mappedFile.h"
+
+int MapFile(const char* path, MappedFile* file) {
+/**
+ * Purpose: Maps path into memory
+ * @param path : const char* - the file to map
+ * @param file : MappedFile* - receives the mapping
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    memset(file, 0, sizeof(MappedFile));
+
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    file->hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, \
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file->hFile == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Error opening %s: %d\n", path, GetLastError());
+        return 1;
+    }
+    if (!GetFileSizeEx(file->hFile, &size)) {
+        fprintf(stderr, "Error getting the size of %s: %d\n", path, GetLastError());
+        CloseHandle(file->hFile);
+        return 1;
+    }
+    file->size = (size_t)size.QuadPart;
+    if (!file->size) return 0;  // Nothing to map
+
+    file->hMapping = CreateFileMappingA(file->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!file->hMapping) {
+        fprintf(stderr, "Error mapping %s: %d\n", path, GetLastError());
+        CloseHandle(file->hFile);
+        return 1;
+    }
+    file->data = (const unsigned char*)MapViewOfFile(file->hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!file->data) {
+        fprintf(stderr, "Error mapping a view of %s: %d\n", path, GetLastError());
+        CloseHandle(file->hMapping);
+        CloseHandle(file->hFile);
+        return 1;
+    }
+#else
+    struct stat info;
+    void* data;
+
+    file->fd = open(path, O_RDONLY);
+    if (file->fd < 0) {
+        perror(path);
+        return 1;
+    }
+    if (fstat(file->fd, &info)) {
+        perror(path);
+        close(file->fd);
+        return 1;
+    }
+    file->size = (size_t)info.st_size;
+    if (!file->size) return 0;  // mmap refuses zero lengths
+
+    data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (data == MAP_FAILED) {
+        perror(path);
+        close(file->fd);
+        return 1;
+    }
+    madvise(data, file->size, MADV_SEQUENTIAL);
+    file->data = (const unsigned char*)data;
+#endif
+
+    return 0;
+}
+
+void UnmapFile(MappedFile* file) {
+/**
+ * Purpose: Unmaps and closes a file mapped by MapFile
+ * @param file : MappedFile* - the mapping
+ * @return : void
+ */
+
+#ifdef _WIN32
+    if (file->data) UnmapViewOfFile(file->data);
+    if (file->hMapping) CloseHandle(file->hMapping);
+    CloseHandle(file->hFile);
+#else
+    if (file->data) munmap((void*)file->data, file->size);
+    close(file->fd);
+#endif
+
+    memset(file, 0, sizeof(MappedFile));
+}
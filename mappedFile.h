@@ -0,0 +1,29 @@
+/**
+ * Purpose: Maps a whole file into memory read only, so tools that chew
+ *          through big archives of boards can index them like one array
+ *          instead of reading them in pieces
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include<stddef.h>
+#ifdef _WIN32
+#include<windows.h>
+#endif
+
+typedef struct mappedFile_s {
+    const unsigned char* data;  // The file's contents. NULL for an empty file
+    size_t size;                // Bytes in data
+#ifdef _WIN32
+    HANDLE hFile;
+    HANDLE hMapping;
+#else
+    int fd;
+#endif
+} MappedFile;
+
+int MapFile(const char* path, MappedFile* file);
+void UnmapFile(MappedFile* file);
+
+#endif
@@ -0,0 +1,323 @@
+/**
+ * Purpose: Backends for reading and writing winmine's memory. See memorySource.h
+ */
+
+#ifndef _WIN32
+#define _GNU_SOURCE  // process_vm_readv
+#endif
+
+#include<stdio.h>
+#include<string.h>
+#include"memorySource.h"
+#include"trace.h"
+
+#ifndef _WIN32
+#include<errno.h>
+#include<sys/types.h>
+#include<sys/uio.h>
+#endif
+
+#ifdef _WIN32
+static int Win32Read(MemorySource* source, DWORD offset, void* buff, size_t length) {
+/**
+ * Purpose: Reads from winmine with ReadProcessMemory
+ * @param source : MemorySource* - the source to read from
+ * @param offset : DWORD - offset from the base of the winmine module
+ * @param buff : void* - receives the data
+ * @param length : size_t - number of bytes to read
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    SIZE_T bytesRead;  // Number of bytes read by ReadProcessMemory
+
+    if (!ReadProcessMemory((HANDLE)source->context, (LPCVOID)(source->baseAddr + offset), \
+                           (LPVOID)buff, length, &bytesRead) || bytesRead != length) {
+        printf("Error calling ReadProcessMemory: %d\n", GetLastError());
+        return 1;
+    }
+
+    return 0;
+}
+
+static int Win32Write(MemorySource* source, DWORD offset, const void* buff, size_t length) {
+/**
+ * Purpose: Writes to winmine with WriteProcessMemory
+ * @param source : MemorySource* - the source to write to
+ * @param offset : DWORD - offset from the base of the winmine module
+ * @param buff : const void* - the data to write
+ * @param length : size_t - number of bytes to write
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    SIZE_T bytesWritten;  // Number of bytes written by WriteProcessMemory
+
+    if (!WriteProcessMemory((HANDLE)source->context, (LPVOID)(source->baseAddr + offset), \
+                            (LPCVOID)buff, length, &bytesWritten) || bytesWritten != length) {
+        printf("Error calling WriteProcessMemory: %d\n", GetLastError());
+        return 1;
+    }
+
+    return 0;
+}
+
+int OpenWin32Source(MemorySource* source, HANDLE hMineSweeper, uintptr_t baseAddr) {
+/**
+ * Purpose: Sets up a source backed by a process handle to winmine. The
+ *          handle still belongs to the caller and is not closed by CloseSource
+ * @param source : MemorySource* - the source to initialize
+ * @param hMineSweeper : HANDLE - process handle with read (and write) access
+ * @param baseAddr : uintptr_t - base address of the winmine module
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    memset(source, 0, sizeof(MemorySource));
+    source->read     = Win32Read;
+    source->write    = Win32Write;
+    source->name     = "ReadProcessMemory";
+    source->context  = (void*)hMineSweeper;
+    source->baseAddr = baseAddr;
+
+    return 0;
+}
+#else
+static int ProcessVmRead(MemorySource* source, DWORD offset, void* buff, size_t length) {
+/**
+ * Purpose: Reads from a (stand-in) process with process_vm_readv
+ * @param source : MemorySource* - the source to read from
+ * @param offset : DWORD - offset from the base of the winmine module
+ * @param buff : void* - receives the data
+ * @param length : size_t - number of bytes to read
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    struct iovec local  = { buff, length };
+    struct iovec remote = { (void*)(source->baseAddr + offset), length };
+
+    if (process_vm_readv((pid_t)(intptr_t)source->context, &local, 1, &remote, 1, 0) != (ssize_t)length) {
+        printf("Error calling process_vm_readv: %d\n", errno);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int ProcessVmWrite(MemorySource* source, DWORD offset, const void* buff, size_t length) {
+/**
+ * Purpose: Writes to a (stand-in) process with process_vm_writev
+ * @param source : MemorySource* - the source to write to
+ * @param offset : DWORD - offset from the base of the winmine module
+ * @param buff : const void* - the data to write
+ * @param length : size_t - number of bytes to write
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    struct iovec local  = { (void*)buff, length };
+    struct iovec remote = { (void*)(source->baseAddr + offset), length };
+
+    if (process_vm_writev((pid_t)(intptr_t)source->context, &local, 1, &remote, 1, 0) != (ssize_t)length) {
+        printf("Error calling process_vm_writev: %d\n", errno);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int ProcessVmWriteRanges(MemorySource* source, const WriteRange* ranges, int numRanges) {
+/**
+ * Purpose: Writes a batch of ranges with a single process_vm_writev
+ * @param source : MemorySource* - the source to write to
+ * @param ranges : const WriteRange* - what to write where
+ * @param numRanges : int - number of ranges. At most WRITE_RANGES_MAX
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    struct iovec local[WRITE_RANGES_MAX];
+    struct iovec remote[WRITE_RANGES_MAX];
+    ssize_t length = 0;
+
+    for (int i = 0; i < numRanges; i++) {
+        local[i].iov_base  = (void*)ranges[i].buff;
+        local[i].iov_len   = ranges[i].length;
+        remote[i].iov_base = (void*)(source->baseAddr + ranges[i].offset);
+        remote[i].iov_len  = ranges[i].length;
+        length += (ssize_t)ranges[i].length;
+    }
+
+    if (process_vm_writev((pid_t)(intptr_t)source->context, local, (unsigned long)numRanges, remote, \
+                          (unsigned long)numRanges, 0) != length) {
+        printf("Error calling process_vm_writev: %d\n", errno);
+        return 1;
+    }
+
+    return 0;
+}
+
+int OpenProcessVmSource(MemorySource* source, int PID, uintptr_t baseAddr) {
+/**
+ * Purpose: Sets up a source backed by another Linux process, normally the
+ *          winmine stand-in (winmineStandIn.c)
+ * @param source : MemorySource* - the source to initialize
+ * @param PID : int - process ID of the target
+ * @param baseAddr : uintptr_t - address the fake winmine module is mapped at
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    memset(source, 0, sizeof(MemorySource));
+    source->read     = ProcessVmRead;
+    source->write    = ProcessVmWrite;
+    source->writeRanges = ProcessVmWriteRanges;
+    source->name     = "process_vm_readv";
+    source->context  = (void*)(intptr_t)PID;
+    source->baseAddr = baseAddr;
+
+    return 0;
+}
+#endif
+
+static int BufferRead(MemorySource* source, DWORD offset, void* buff, size_t length) {
+/**
+ * Purpose: Reads from a module image held in our own memory
+ * @param source : MemorySource* - the source to read from
+ * @param offset : DWORD - offset from the start of the image
+ * @param buff : void* - receives the data
+ * @param length : size_t - number of bytes to read
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    if ((size_t)offset + length > source->imageSize) {
+        printf("Read of %u bytes at 0x%x is outside the buffer\n", (unsigned)length, offset);
+        return 1;
+    }
+    memcpy(buff, (unsigned char*)source->context + offset, length);
+
+    return 0;
+}
+
+static int BufferWrite(MemorySource* source, DWORD offset, const void* buff, size_t length) {
+/**
+ * Purpose: Writes to a module image held in our own memory
+ * @param source : MemorySource* - the source to write to
+ * @param offset : DWORD - offset from the start of the image
+ * @param buff : const void* - the data to write
+ * @param length : size_t - number of bytes to write
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    if ((size_t)offset + length > source->imageSize) {
+        printf("Write of %u bytes at 0x%x is outside the buffer\n", (unsigned)length, offset);
+        return 1;
+    }
+    memcpy((unsigned char*)source->context + offset, buff, length);
+
+    return 0;
+}
+
+int OpenBufferSource(MemorySource* source, unsigned char* image, size_t imageSize) {
+/**
+ * Purpose: Sets up a source backed by a buffer laid out like the winmine
+ *          module (image[MINEFIELD_OFFSET] is the start of the field, etc)
+ * @param source : MemorySource* - the source to initialize
+ * @param image : unsigned char* - the module image. Still owned by the caller
+ * @param imageSize : size_t - size of image in bytes
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    memset(source, 0, sizeof(MemorySource));
+    source->read      = BufferRead;
+    source->write     = BufferWrite;
+    source->name      = "buffer";
+    source->context   = (void*)image;
+    source->imageSize = imageSize;
+
+    return 0;
+}
+
+int ReadSource(MemorySource* source, DWORD offset, void* buff, size_t length) {
+/**
+ * Purpose: Reads length bytes at offset from the source and counts the call
+ * @param source : MemorySource* - the source to read from
+ * @param offset : DWORD - offset from the base of the winmine module
+ * @param buff : void* - receives the data
+ * @param length : size_t - number of bytes to read
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned long long start = TRACE_START();
+
+    source->numReads++;
+    if (source->read(source, offset, buff, length)) return 1;
+    source->bytesRead += length;
+    TRACE_END(TRACE_READ, start, length);
+
+    return 0;
+}
+
+int WriteSource(MemorySource* source, DWORD offset, const void* buff, size_t length) {
+/**
+ * Purpose: Writes length bytes to offset in the source and counts the call
+ * @param source : MemorySource* - the source to write to
+ * @param offset : DWORD - offset from the base of the winmine module
+ * @param buff : const void* - the data to write
+ * @param length : size_t - number of bytes to write
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned long long start = TRACE_START();
+
+    source->numWrites++;
+    if (source->write(source, offset, buff, length)) return 1;
+    source->bytesWritten += length;
+    TRACE_END(TRACE_WRITE, start, length);
+
+    return 0;
+}
+
+int WriteSourceRanges(MemorySource* source, const WriteRange* ranges, int numRanges) {
+/**
+ * Purpose: Writes a batch of ranges and counts the calls it took. Backends
+ *          that can write them all at once do, otherwise it's one write per
+ *          range. Batches bigger than WRITE_RANGES_MAX go over in pieces
+ * @param source : MemorySource* - the source to write to
+ * @param ranges : const WriteRange* - what to write where
+ * @param numRanges : int - number of ranges
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned long long start;
+    size_t length;
+
+    if (!source->writeRanges) {
+        for (int i = 0; i < numRanges; i++) {
+            if (WriteSource(source, ranges[i].offset, ranges[i].buff, ranges[i].length)) return 1;
+        }
+        return 0;
+    }
+
+    for (int first = 0; first < numRanges; first += WRITE_RANGES_MAX) {
+        int count = numRanges - first < WRITE_RANGES_MAX ? numRanges - first : WRITE_RANGES_MAX;
+
+        length = 0;
+        for (int i = first; i < first + count; i++) length += ranges[i].length;
+
+        start = TRACE_START();
+        source->numWrites++;
+        if (source->writeRanges(source, ranges + first, count)) return 1;
+        source->bytesWritten += length;
+        TRACE_END(TRACE_WRITE, start, length);
+    }
+
+    return 0;
+}
+
+void CloseSource(MemorySource* source) {
+/**
+ * Purpose: Releases anything the backend is holding on to
+ * @param source : MemorySource* - the source to close
+ * @return : void
+ */
+
+    if (source->close) source->close(source);
+    source->context = NULL;
+
+    return;
+}
@@ -0,0 +1,56 @@
+/**
+ * Purpose: A small interface over "somewhere that holds winmine's memory". The
+ *          helper can read the real game through ReadProcessMemory, a Linux
+ *          stand-in process through process_vm_readv, or a plain buffer.
+ *          Every backend counts the calls it makes so we can tell how many
+ *          syscalls an operation costs
+ */
+
+#ifndef MEMORY_SOURCE_H
+#define MEMORY_SOURCE_H
+
+#include<stddef.h>
+#include<stdint.h>
+#include"winmine.h"
+
+#define WRITE_RANGES_MAX 1024   // Most ranges a backend is handed at once (Linux's IOV_MAX)
+
+// One piece of a batch of writes
+typedef struct writeRange_s {
+    DWORD offset;        // Relative to the base of the winmine module
+    const void* buff;
+    size_t length;
+} WriteRange;
+
+typedef struct memorySource_s {
+    // Backend operations. offset is relative to the base of the winmine module
+    int (*read)(struct memorySource_s* source, DWORD offset, void* buff, size_t length);
+    int (*write)(struct memorySource_s* source, DWORD offset, const void* buff, size_t length);
+    void (*close)(struct memorySource_s* source);
+    // Optional. Writes every range with one call. Backends without it get one write per range
+    int (*writeRanges)(struct memorySource_s* source, const WriteRange* ranges, int numRanges);
+
+    const char* name;             // Human readable name of the backend
+    void* context;                // Backend specific data (process handle, pid, buffer)
+    uintptr_t baseAddr;           // Base address of the winmine module in the target
+    size_t imageSize;             // Size of the buffer for the buffer backend
+
+    unsigned long long numReads;      // Number of read calls made against the target
+    unsigned long long numWrites;     // Number of write calls made against the target
+    unsigned long long bytesRead;     // Total number of bytes read
+    unsigned long long bytesWritten;  // Total number of bytes written
+} MemorySource;
+
+#ifdef _WIN32
+int OpenWin32Source(MemorySource* source, HANDLE hMineSweeper, uintptr_t baseAddr);
+#else
+int OpenProcessVmSource(MemorySource* source, int PID, uintptr_t baseAddr);
+#endif
+int OpenBufferSource(MemorySource* source, unsigned char* image, size_t imageSize);
+
+int ReadSource(MemorySource* source, DWORD offset, void* buff, size_t length);
+int WriteSource(MemorySource* source, DWORD offset, const void* buff, size_t length);
+int WriteSourceRanges(MemorySource* source, const WriteRange* ranges, int numRanges);
+void CloseSource(MemorySource* source);
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * Purpose: Board difficulty metrics. See metrics.h
+ */
+
+#include<stdint.h>
+#include<string.h>
+#include"metrics.h"
+#include"bitboard.h"
+#include"solver.h"
+
+static DWORD FindRoot(unsigned short* parent, DWORD tile) {
+/**
+ * Purpose: Finds the root of tile's set, halving the path on the way
+ * @param parent : unsigned short* - the union-find forest
+ * @param tile : DWORD - the tile
+ * @return : DWORD - the root
+ */
+
+    while (parent[tile] != tile) {
+        parent[tile] = parent[parent[tile]];
+        tile = parent[tile];
+    }
+    return tile;
+}
+
+int MeasureBoard(const unsigned char* field, DWORD width, DWORD height, DWORD numMines, \
+                 int checkLogic, BoardMetrics* metrics) {
+/**
+ * Purpose: Counts openings, islands and 3BV, and optionally plays the board
+ *          with the honest helper to see whether it can be won without
+ *          guessing. Zeros, the numbers they reveal and the numbers left
+ *          over are all found with shifts on the bitboard. One raster pass
+ *          of union-find then joins each zero to the zeros before it and
+ *          each left over number to the left over numbers before it
+ * @param field : const unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param width : DWORD - the width of the minefield
+ * @param height : DWORD - the height of the minefield
+ * @param numMines : DWORD - the number of mines in the game
+ * @param checkLogic : int - non-zero to play the board out
+ * @param metrics : BoardMetrics* - receives the metrics
+ * @return : int - 0 on success, 1 if the dimensions are invalid
+ */
+
+    Bitboard board;
+    uint32_t zero[BITBOARD_ROWS];                    // Safe tiles with no mines around them
+    uint32_t lone[BITBOARD_ROWS];                    // Numbers no zero touches
+    unsigned short parent[ROW_STRIDE*BITBOARD_ROWS]; // Union-find forest over tile offsets
+    DWORD firstX = 0, firstY = 0;                    // Where the first opening is
+    DWORD loneNumbers = 0;
+
+    if (width < 1 || width > MAX_WIDTH || height < 1 || height > MAX_HEIGHT) return 1;
+
+    memset(metrics, 0, sizeof(BoardMetrics));
+    metrics->width    = width;
+    metrics->height   = height;
+    metrics->numMines = numMines;
+    metrics->density  = (double)numMines / (double)(width*height);
+    metrics->logicSolvable = -1;
+
+    PackBitboard(field, height, width, &board);
+
+    // A zero is a playable tile with no mine on or around it
+    memset(zero, 0, sizeof(zero));
+    memset(lone, 0, sizeof(lone));
+    for (DWORD y = 1; y <= height; y++) {
+        uint32_t near = 0;
+        for (DWORD row = y - 1; row <= y + 1; row++) near |= board.mine[row] | board.mine[row] << 1 | board.mine[row] >> 1;
+        zero[y] = board.playable[y] & ~near;
+    }
+
+    // Clicking a zero reveals its neighbors too. Safe tiles no zero reveals are lone numbers
+    for (DWORD y = 1; y <= height; y++) {
+        uint32_t reached = 0;
+        for (DWORD row = y - 1; row <= y + 1; row++) reached |= zero[row] | zero[row] << 1 | zero[row] >> 1;
+        lone[y] = board.playable[y] & ~board.mine[y] & ~reached;
+        loneNumbers += (DWORD)POPCOUNT32(lone[y]);
+    }
+
+    // Every tile starts a set and every union of two sets leaves one fewer.
+    // A tile only looks back at W, NW, N and NE, which are already placed
+    for (DWORD y = 1; y <= height; y++) {
+        for (int kind = 0; kind < 2; kind++) {
+            const uint32_t* set = kind ? lone : zero;
+            DWORD* sets = kind ? &metrics->islands : &metrics->openings;
+
+            for (uint32_t bits = set[y]; bits; bits &= bits - 1) {
+                DWORD x = (DWORD)CTZ32(bits);
+                DWORD tile = x + y*ROW_STRIDE;
+                DWORD earlier[4] = { tile - 1, tile - ROW_STRIDE - 1, tile - ROW_STRIDE, tile - ROW_STRIDE + 1 };
+
+                if (!kind && !firstX) {
+                    firstX = x;
+                    firstY = y;
+                }
+                parent[tile] = (unsigned short)tile;
+                (*sets)++;
+
+                for (int i = 0; i < 4; i++) {
+                    DWORD rootA, rootB;
+                    if (!((set[earlier[i] / ROW_STRIDE] >> (earlier[i] % ROW_STRIDE)) & 1)) continue;
+                    rootA = FindRoot(parent, tile);
+                    rootB = FindRoot(parent, earlier[i]);
+                    if (rootA == rootB) continue;
+                    parent[rootA] = (unsigned short)rootB;
+                    (*sets)--;
+                }
+            }
+        }
+    }
+
+    // Each opening is one click and every number no opening reveals is one more
+    metrics->bbbv = metrics->openings + loneNumbers;
+
+    // A fresh copy of the board to play on, so clicks already made don't count
+    if (checkLogic) {
+        unsigned char fresh[MINEFIELD_SIZE];
+        SolverResult result;
+
+        memcpy(fresh, field, MINEFIELD_SIZE);
+        for (DWORD y = 1; y <= height; y++) {
+            for (DWORD x = 1; x <= width; x++) {
+                fresh[x + y*ROW_STRIDE] = (unsigned char)(UNCLICKED_SPACE | (fresh[x + y*ROW_STRIDE] & MINE));
+            }
+        }
+
+        metrics->logicSolvable = metrics->openings && \
+            PlayWithoutGuessing(fresh, width, height, firstX, firstY, &result, &metrics->logicClicks) == GAME_WON;
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+/**
+ * Purpose: Difficulty numbers for a board, worked out from where its mines
+ *          are. Anything that's been clicked or flagged is ignored
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include"winmine.h"
+
+typedef struct boardMetrics_s {
+    DWORD width;
+    DWORD height;
+    DWORD numMines;
+    double density;         // Mines per tile
+    DWORD openings;         // Groups of touching tiles with no mines around them
+    DWORD islands;          // Groups of touching numbers that no opening reveals
+    DWORD bbbv;             // 3BV: the fewest clicks that clear the board
+    int logicSolvable;      // 1 if clicking the first opening and then only provably
+                            // safe tiles wins. -1 if it wasn't checked
+    DWORD logicClicks;      // Clicks that took, or made before getting stuck
+} BoardMetrics;
+
+int MeasureBoard(const unsigned char* field, DWORD width, DWORD height, DWORD numMines, \
+                 int checkLogic, BoardMetrics* metrics);
+
+#endif
@@ -0,0 +1,287 @@
+/**
+ * Purpose: Offline batch analyzer. Reads archives of raw snapshot windows
+ *          (SNAPSHOT_SIZE bytes each, exactly what SetMineMetadata reads
+ *          from 0x5330: mine count, width, height, then the minefield),
+ *          measures every board across all cores and writes the results as
+ *          CSV. It can also write archives of synthetic boards to test with
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"winmine.h"
+#include"snapshot.h"
+#include"board.h"
+#include"metrics.h"
+#include"mappedFile.h"
+#include"threadPool.h"
+#include"timing.h"
+
+#define ANALYZE_CHUNK   256  // Boards per task. Big enough to keep queue traffic down
+
+// A run of boards from one archive for one task to measure
+struct chunk_s {
+    const MappedFile* file;
+    size_t first;             // Index of the first board
+    size_t count;
+    int checkLogic;           // Non-zero to play each board out
+    BoardMetrics* metrics;    // Where the results go. metrics[i].width is 0 for a bad board
+};
+
+// Boards that share dimensions and mine count
+struct aggregate_s {
+    DWORD width;
+    DWORD height;
+    DWORD numMines;
+    unsigned long long boards;
+    unsigned long long openings;
+    unsigned long long islands;
+    unsigned long long bbbv;
+    DWORD minBbbv;
+    DWORD maxBbbv;
+    unsigned long long solvable;
+};
+
+void MeasureChunk(void* argument) {
+/**
+ * Purpose: Thread pool task that measures a run of boards
+ * @param argument : struct chunk_s* - the boards
+ * @return : void
+ */
+
+    struct chunk_s* chunk = (struct chunk_s*)argument;
+    Snapshot snapshot;
+
+    for (size_t i = 0; i < chunk->count; i++) {
+        memcpy(snapshot.window, chunk->file->data + (chunk->first + i)*SNAPSHOT_SIZE, SNAPSHOT_SIZE);
+        if (DecodeSnapshot(&snapshot)) {
+            memset(&chunk->metrics[i], 0, sizeof(BoardMetrics));
+            continue;
+        }
+        MeasureBoard(SNAPSHOT_FIELD(&snapshot), snapshot.width, snapshot.height, snapshot.numMines, \
+                     chunk->checkLogic, &chunk->metrics[i]);
+    }
+}
+
+int GenerateArchive(const char* path, long count, DWORD width, DWORD height, DWORD numMines, unsigned int seed) {
+/**
+ * Purpose: Writes count fresh boards, one snapshot window each
+ * @param path : const char* - the archive to create
+ * @param count : long - number of boards
+ * @param width : DWORD - the width of every board
+ * @param height : DWORD - the height of every board
+ * @param numMines : DWORD - mines on every board
+ * @param seed : unsigned int - seed of the first board. Each board after it adds 1
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static unsigned char image[MODULE_IMAGE_SIZE];
+    FILE* archive = fopen(path, "wb");
+
+    if (!archive) {
+        perror(path);
+        return 1;
+    }
+
+    for (long i = 0; i < count; i++) {
+        if (BuildBoard(image, width, height, numMines, seed + (unsigned int)i) || \
+            fwrite(image + SNAPSHOT_OFFSET, SNAPSHOT_SIZE, 1, archive) != 1) {
+            fclose(archive);
+            return 1;
+        }
+    }
+
+    fclose(archive);
+    printf("Wrote %ld %ux%u boards with %u mines to %s\n", count, width, height, numMines, path);
+    return 0;
+}
+
+void PrintUsage(char* name) {
+/**
+ * Purpose: Tells the user how to run the analyzer
+ * @param name : char* - argv[0]
+ * @return : void
+ */
+
+    printf("Usage: %s [-j threads] [-o aggregate.csv] [-b boards.csv] [-n] archive...\n"
+           "       %s -g archive count width height mines seed\n"
+           "  An archive is any number of %u byte snapshot windows back to back.\n"
+           "  -j  worker threads (default: one per core)\n"
+           "  -o  where the per-size aggregates go (default: stdout)\n"
+           "  -b  also write one line per board\n"
+           "  -n  skip playing each board out with the honest helper\n"
+           "  -g  write an archive of fresh synthetic boards\n", name, name, (unsigned)SNAPSHOT_SIZE);
+}
+
+int main(int argc, char** argv) {
+
+    // Local variables
+    static ThreadPool pool;             // Measures the chunks
+    int threads = CountCores();         // Worker threads
+    int checkLogic = 1;                 // Play boards out
+    char* aggregatePath = NULL;         // NULL for stdout
+    char* boardsPath = NULL;            // NULL for no per board output
+    int numFiles = 0;
+    MappedFile* files;
+    BoardMetrics** metrics;             // One array per file
+    struct chunk_s* chunks;
+    size_t numChunks = 0;
+    size_t totalBoards = 0;
+    struct aggregate_s* aggregates = NULL;
+    size_t numAggregates = 0;
+    unsigned long long invalid = 0;
+    unsigned long long start;
+    double seconds;
+    TaskGroup group = { 0 };
+    FILE* out = NULL;
+    int argi = 1;
+
+    if (argc > 1 && strcmp(argv[1], "-g") == 0) {
+        if (argc != 8) {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        return GenerateArchive(argv[2], atol(argv[3]), (DWORD)atoi(argv[4]), (DWORD)atoi(argv[5]), \
+                               (DWORD)atoi(argv[6]), (unsigned int)strtoul(argv[7], NULL, 0));
+    }
+
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (strcmp(argv[argi], "-j") == 0 && argi + 1 < argc) threads = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "-o") == 0 && argi + 1 < argc) aggregatePath = argv[++argi];
+        else if (strcmp(argv[argi], "-b") == 0 && argi + 1 < argc) boardsPath = argv[++argi];
+        else if (strcmp(argv[argi], "-n") == 0) checkLogic = 0;
+        else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (argi == argc) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    // Map every archive and cut it into chunks
+    numFiles = argc - argi;
+    files   = (MappedFile*)calloc((size_t)numFiles, sizeof(MappedFile));
+    metrics = (BoardMetrics**)calloc((size_t)numFiles, sizeof(BoardMetrics*));
+    if (!files || !metrics) return 1;
+    for (int f = 0; f < numFiles; f++) {
+        if (MapFile(argv[argi + f], &files[f])) return 1;
+        if (files[f].size % SNAPSHOT_SIZE) {
+            fprintf(stderr, "%s isn't a whole number of %u byte boards. The last %u bytes are ignored\n", \
+                    argv[argi + f], (unsigned)SNAPSHOT_SIZE, (unsigned)(files[f].size % SNAPSHOT_SIZE));
+        }
+        totalBoards += files[f].size / SNAPSHOT_SIZE;
+        numChunks += (files[f].size / SNAPSHOT_SIZE + ANALYZE_CHUNK - 1) / ANALYZE_CHUNK;
+        metrics[f] = (BoardMetrics*)malloc((files[f].size / SNAPSHOT_SIZE + 1)*sizeof(BoardMetrics));
+        if (!metrics[f]) return 1;
+    }
+    chunks = (struct chunk_s*)malloc((numChunks + 1)*sizeof(struct chunk_s));
+    if (!chunks) return 1;
+
+    if (StartThreadPool(&pool, threads)) return 1;
+    threads = pool.numThreads;  // After clamping
+    start = NowNs();
+    numChunks = 0;
+    for (int f = 0; f < numFiles; f++) {
+        size_t boards = files[f].size / SNAPSHOT_SIZE;
+        for (size_t first = 0; first < boards; first += ANALYZE_CHUNK) {
+            struct chunk_s* chunk = &chunks[numChunks++];
+            chunk->file       = &files[f];
+            chunk->first      = first;
+            chunk->count      = boards - first < ANALYZE_CHUNK ? boards - first : ANALYZE_CHUNK;
+            chunk->checkLogic = checkLogic;
+            chunk->metrics    = metrics[f] + first;
+            SubmitTask(&pool, &group, MeasureChunk, chunk);
+        }
+    }
+    WaitForGroup(&pool, &group);
+    seconds = (double)(NowNs() - start) / 1e9;
+    StopThreadPool(&pool);
+
+    // Per board lines, then the aggregates
+    if (boardsPath) {
+        out = fopen(boardsPath, "w");
+        if (!out) {
+            perror(boardsPath);
+            return 1;
+        }
+        fprintf(out, "file,index,width,height,mines,density,openings,islands,3bv%s\n", \
+                checkLogic ? ",logic_solvable,logic_clicks" : "");
+    }
+    for (int f = 0; f < numFiles; f++) {
+        for (size_t i = 0; i < files[f].size / SNAPSHOT_SIZE; i++) {
+            BoardMetrics* board = &metrics[f][i];
+            struct aggregate_s* aggregate = NULL;
+
+            if (!board->width) {
+                invalid++;
+                continue;
+            }
+            if (boardsPath) {
+                fprintf(out, "%s,%zu,%u,%u,%u,%.4f,%u,%u,%u", argv[argi + f], i, board->width, board->height, \
+                        board->numMines, board->density, board->openings, board->islands, board->bbbv);
+                if (checkLogic) fprintf(out, ",%d,%u", board->logicSolvable, board->logicClicks);
+                fprintf(out, "\n");
+            }
+
+            for (size_t a = 0; a < numAggregates && !aggregate; a++) {
+                if (aggregates[a].width == board->width && aggregates[a].height == board->height && \
+                    aggregates[a].numMines == board->numMines) aggregate = &aggregates[a];
+            }
+            if (!aggregate) {
+                struct aggregate_s* grown = (struct aggregate_s*)realloc(aggregates, (numAggregates + 1)*sizeof(struct aggregate_s));
+                if (!grown) return 1;
+                aggregates = grown;
+                aggregate = &aggregates[numAggregates++];
+                memset(aggregate, 0, sizeof(struct aggregate_s));
+                aggregate->width    = board->width;
+                aggregate->height   = board->height;
+                aggregate->numMines = board->numMines;
+                aggregate->minBbbv  = board->bbbv;
+            }
+            aggregate->boards++;
+            aggregate->openings += board->openings;
+            aggregate->islands += board->islands;
+            aggregate->bbbv += board->bbbv;
+            if (board->bbbv < aggregate->minBbbv) aggregate->minBbbv = board->bbbv;
+            if (board->bbbv > aggregate->maxBbbv) aggregate->maxBbbv = board->bbbv;
+            if (board->logicSolvable == 1) aggregate->solvable++;
+        }
+    }
+    if (boardsPath) fclose(out);
+
+    out = aggregatePath ? fopen(aggregatePath, "w") : stdout;
+    if (!out) {
+        perror(aggregatePath);
+        return 1;
+    }
+    fprintf(out, "width,height,mines,boards,density,mean_openings,mean_islands,mean_3bv,min_3bv,max_3bv%s\n", \
+            checkLogic ? ",logic_solvable" : "");
+    for (size_t a = 0; a < numAggregates; a++) {
+        struct aggregate_s* aggregate = &aggregates[a];
+        fprintf(out, "%u,%u,%u,%llu,%.4f,%.2f,%.2f,%.2f,%u,%u", aggregate->width, aggregate->height, aggregate->numMines, \
+                aggregate->boards, (double)aggregate->numMines / (double)(aggregate->width*aggregate->height), \
+                (double)aggregate->openings / (double)aggregate->boards, (double)aggregate->islands / (double)aggregate->boards, \
+                (double)aggregate->bbbv / (double)aggregate->boards, \
+                aggregate->minBbbv, aggregate->maxBbbv);
+        if (checkLogic) fprintf(out, ",%.4f", (double)aggregate->solvable / (double)aggregate->boards);
+        fprintf(out, "\n");
+    }
+    if (aggregatePath) fclose(out);
+
+    // Throughput goes to stderr so it never ends up in the CSV
+    fprintf(stderr, "%zu boards (%llu invalid) in %.3f s with %d threads: %.0f boards/s, %.0f boards/s/core\n", \
+            totalBoards, invalid, seconds, threads, \
+            totalBoards / seconds, totalBoards / seconds / (threads < CountCores() ? threads : CountCores()));
+
+    for (int f = 0; f < numFiles; f++) {
+        UnmapFile(&files[f]);
+        free(metrics[f]);
+    }
+    free(files);
+    free(metrics);
+    free(chunks);
+    free(aggregates);
+    return 0;
+}
@@ -0,0 +1,2684 @@
+/**
+ * Purpose: Measures the helper's hot paths against synthetic boards (or a
+ *          running stand-in) so changes can be compared by numbers instead
+ *          of by feel
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"board.h"
+#include"memorySource.h"
+#include"snapshot.h"
+#include"render.h"
+#include"watch.h"
+#include"session.h"
+#include"bitboard.h"
+#include"solver.h"
+#include"probability.h"
+#include"metrics.h"
+#include"flagStub.h"
+#include"threadPool.h"
+#include"tileDecode.h"
+#include"timing.h"
+#include"trace.h"
+#include"instances.h"
+#include"geometry.h"
+#include"signature.h"
+#include"directFlag.h"
+#include"autoplay.h"
+#include"incrementalSolver.h"
+#include"boardFeed.h"
+#include"boardPublisher.h"
+
+#ifndef _WIN32
+#include<fcntl.h>
+#include<signal.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/wait.h>
+#endif
+
+#define BENCH_ITERATIONS 200000  // Default number of iterations per benchmark
+#define BRUTE_FORCE_TILES 16     // Frontiers up to this size are checked against brute force
+#define SUITE_BOARDS     16      // Boards per size in the suite, one seed each
+#define SUITE_REPEATS    5       // Times each suite case is run. The median is what gets compared
+#define SUITE_REGRESSION 1.10    // Slower than the baseline by more than this fails the suite
+#define SUITE_REMOTE     0x10000 // Where the stub backend pretends the flag batch was allocated
+
+// Counting allocations means getting in front of malloc. glibc lets a program
+// replace it and still reach the real one underneath
+#if defined(__GLIBC__)
+#define COUNTS_ALLOCATIONS 1
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* pointer, size_t size);
+static unsigned long long allocations;  // malloc, calloc and realloc calls so far
+
+void* malloc(size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(pointer, size);
+}
+#else
+#define COUNTS_ALLOCATIONS 0
+static unsigned long long allocations;  // Never counted. The suite reports -1
+#endif
+
+int LegacyRead(MemorySource* source, Snapshot* snapshot) {
+/**
+ * Purpose: The way SetMineMetadata used to read the game: one read each for
+ *          the mine count, height, width and minefield. Kept around so the
+ *          snapshot engine has something to be compared against
+ * @param source : MemorySource* - where to read from
+ * @param snapshot : Snapshot* - receives the game state
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    if (ReadSource(source, NUM_MINES_OFFSET, &snapshot->numMines, sizeof(DWORD))) return 1;
+    if (ReadSource(source, HEIGHT_OFFSET, &snapshot->height, sizeof(DWORD))) return 1;
+    if (ReadSource(source, WIDTH_OFFSET, &snapshot->width, sizeof(DWORD))) return 1;
+    return ReadSource(source, MINEFIELD_OFFSET, SNAPSHOT_FIELD(snapshot), MINEFIELD_SIZE);
+}
+
+int BenchSnapshot(MemorySource* source, long iterations) {
+/**
+ * Purpose: Compares the four read legacy path against a single read snapshot
+ * @param source : MemorySource* - where to read from
+ * @param iterations : long - number of snapshots to take with each method
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    Snapshot snapshot;
+    unsigned long long start;
+    double seconds;
+
+    printf("Backend: %s\n", source->name);
+
+    source->numReads = 0;
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        if (LegacyRead(source, &snapshot)) return 1;
+    }
+    seconds = (double)(NowNs() - start) / 1e9;
+    printf("legacy four reads:  %12.0f snapshots/s  %6.2f reads/snapshot\n", \
+           (double)iterations / seconds, (double)source->numReads / (double)iterations);
+
+    source->numReads = 0;
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        if (TakeSnapshot(source, &snapshot)) return 1;
+    }
+    seconds = (double)(NowNs() - start) / 1e9;
+    printf("single snapshot:    %12.0f snapshots/s  %6.2f reads/snapshot\n", \
+           (double)iterations / seconds, (double)source->numReads / (double)iterations);
+
+    return 0;
+}
+
+int BenchDecode(MemorySource* source, long iterations) {
+/**
+ * Purpose: Checks the fast tile decoder against the scalar one and then
+ *          measures boards decoded per second with each
+ * @param source : MemorySource* - where to read the board from
+ * @param iterations : long - number of boards to decode with each decoder
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    Snapshot snapshot;
+    unsigned char kinds[KIND_GRID_SIZE];
+    unsigned long long start;
+    unsigned long long checksum = 0;  // Keeps the compiler from skipping the work
+    double seconds;
+
+    if (CheckDecoder()) return 1;
+    printf("Fast decoder matches the scalar decoder byte for byte\n");
+    if (TakeSnapshot(source, &snapshot)) return 1;
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        DecodeFieldScalar(SNAPSHOT_FIELD(&snapshot), snapshot.height, kinds);
+        checksum += kinds[i % KIND_GRID_SIZE];
+    }
+    seconds = (double)(NowNs() - start) / 1e9;
+    printf("scalar decode:      %12.0f boards/s\n", (double)iterations / seconds);
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        DecodeField(SNAPSHOT_FIELD(&snapshot), snapshot.height, kinds);
+        checksum += kinds[i % KIND_GRID_SIZE];
+    }
+    seconds = (double)(NowNs() - start) / 1e9;
+    printf("fast decode:        %12.0f boards/s  (checksum %llu)\n", (double)iterations / seconds, checksum);
+
+    return 0;
+}
+
+int BenchRender(MemorySource* source, long iterations) {
+/**
+ * Purpose: Measures bytes and time per frame for the full renderer and for
+ *          the incremental renderer with nothing, one tile, and a row changed
+ * @param source : MemorySource* - where to read the board from
+ * @param iterations : long - number of frames to render for each case
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static Frame frame;
+    Snapshot snapshot;
+    unsigned char kinds[KIND_GRID_SIZE];
+    unsigned long long start;
+    size_t bytes = 0;
+    double nsPerFrame;
+
+    if (TakeSnapshot(source, &snapshot)) return 1;
+    DecodeField(SNAPSHOT_FIELD(&snapshot), snapshot.height, kinds);
+    InitFrame(&frame);
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) bytes += RenderFrame(&frame, kinds, snapshot.height, snapshot.width, 1);
+    nsPerFrame = (double)(NowNs() - start) / (double)iterations;
+    printf("full frame:         %10.0f ns/frame  %6u bytes/frame\n", nsPerFrame, (unsigned)(bytes / iterations));
+
+    // Unchanged board. The first diff draws everything so it's done up front
+    RenderFrameDiff(&frame, kinds, snapshot.height, snapshot.width);
+    bytes = 0;
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) bytes += RenderFrameDiff(&frame, kinds, snapshot.height, snapshot.width);
+    nsPerFrame = (double)(NowNs() - start) / (double)iterations;
+    printf("diff, unchanged:    %10.0f ns/frame  %6u bytes/frame\n", nsPerFrame, (unsigned)(bytes / iterations));
+
+    // One tile flips back and forth
+    bytes = 0;
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        kinds[1 + ROW_STRIDE] = (unsigned char)(i & 1 ? TILE_FLAG : TILE_UNCLICKED);
+        bytes += RenderFrameDiff(&frame, kinds, snapshot.height, snapshot.width);
+    }
+    nsPerFrame = (double)(NowNs() - start) / (double)iterations;
+    printf("diff, one tile:     %10.0f ns/frame  %6u bytes/frame\n", nsPerFrame, (unsigned)(bytes / iterations));
+
+    // A whole row flips, like a cascade opening up
+    bytes = 0;
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        for (DWORD x = 1; x <= snapshot.width; x++) kinds[x + 2*ROW_STRIDE] = (unsigned char)(i & 1 ? 0 : TILE_UNCLICKED);
+        bytes += RenderFrameDiff(&frame, kinds, snapshot.height, snapshot.width);
+    }
+    nsPerFrame = (double)(NowNs() - start) / (double)iterations;
+    printf("diff, one row:      %10.0f ns/frame  %6u bytes/frame\n", nsPerFrame, (unsigned)(bytes / iterations));
+
+    return 0;
+}
+
+struct watchDriver_s {
+    unsigned char* field;     // Minefield inside the synthetic image
+    unsigned int state;       // Random state for picking tiles
+    unsigned long long poll;  // Polls seen so far
+    unsigned int changeEvery; // Reveal a tile every this many polls
+};
+
+int DriveWatch(void* context) {
+/**
+ * Purpose: onPoll hook that plays the part of the game, clicking (or
+ *          un-clicking) a random tile every few polls
+ * @param context : void* - a struct watchDriver_s
+ * @return : int - always 0 (keep watching)
+ */
+
+    struct watchDriver_s* driver = (struct watchDriver_s*)context;
+    unsigned int pick;
+
+    if (driver->poll++ % driver->changeEvery) return 0;
+
+    pick = NextRandom(&driver->state) % (30*16);
+    unsigned char* tile = driver->field + (pick % 30 + 1) + (pick / 30 + 1)*ROW_STRIDE;
+    if ((*tile & 0x0F) == UNCLICKED_SPACE && !(*tile & REVEALED_TILE)) {
+        *tile = (unsigned char)((*tile & MINE) ? (MINE | FLAG) : REVEALED_TILE | (pick % 9));
+    }
+    else {
+        *tile = (unsigned char)((*tile & MINE) | UNCLICKED_SPACE);  // New game, so to speak
+    }
+
+    return 0;
+}
+
+int BenchWatch(unsigned char* image, long iterations) {
+/**
+ * Purpose: Load tests the watch loop against an in-memory board that a
+ *          driver changes every few polls
+ * @param image : unsigned char* - the synthetic winmine module to watch
+ * @param iterations : long - number of polls
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static WatchStats stats;
+    MemorySource source;
+    WatchConfig config;
+    struct watchDriver_s driver = { image + MINEFIELD_OFFSET, 1, 0, 10 };
+    unsigned long long start;
+    int result;
+
+    OpenBufferSource(&source, image, MODULE_IMAGE_SIZE);
+    InitWatchConfig(&config);
+    config.intervalMs = 0;
+    config.maxPolls   = (unsigned long long)iterations;
+    config.display    = WATCH_QUIET;
+    config.onPoll     = DriveWatch;
+    config.context    = &driver;
+
+    start = NowNs();
+    result = WatchMineField(&source, &config, &stats);
+    printf("%.0f polls/s with a change every %u polls\n",            (double)stats.polls / ((double)(NowNs() - start) / 1e9), driver.changeEvery);
+    PrintWatchStats(&stats);
+
+    CloseSource(&source);
+    return result;
+}
+
+int BenchSession(long iterations) {
+/**
+ * Purpose: Per-command cost of attaching to a running game (or stand-in)
+ *          from scratch every time versus keeping the session around
+ * @param iterations : long - number of commands to time each way
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    Session session;
+    Snapshot snapshot;
+    unsigned long long start;
+
+    InitSession(&session, "winmine.exe");
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        if (EnsureSession(&session) || TakeSnapshot(&session.source, &snapshot)) return 1;
+        CloseSession(&session);
+    }
+    printf("attach every command: %10.1f us/command\n", (double)(NowNs() - start) / 1000.0 / (double)iterations);
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        if (EnsureSession(&session) || TakeSnapshot(&session.source, &snapshot)) return 1;
+    }
+    printf("cached session:       %10.1f us/command  (%llu attaches in total)\n", \
+           (double)(NowNs() - start) / 1000.0 / (double)iterations, session.attaches);
+
+    CloseSession(&session);
+    return 0;
+}
+
+int ByteNeighborMines(const unsigned char* field, DWORD x, DWORD y) {
+/**
+ * Purpose: Neighbor mine count the byte at a time way, for comparison
+ * @param field : const unsigned char* - the raw minefield
+ * @param x : DWORD - column
+ * @param y : DWORD - row
+ * @return : int - 0 through 8
+ */
+
+    int count = 0;
+    for (DWORD dy = y - 1; dy <= y + 1; dy++) {
+        for (DWORD dx = x - 1; dx <= x + 1; dx++) {
+            if ((dx != x || dy != y) && (field[dx + dy*ROW_STRIDE] & MINE)) count++;
+        }
+    }
+    return count;
+}
+
+int BenchBitboard(MemorySource* source, long iterations) {
+/**
+ * Purpose: Checks the bitboard against the byte loops, then times a mine
+ *          scan, all neighbor counts and win/loss detection both ways
+ * @param source : MemorySource* - where to read the board from
+ * @param iterations : long - number of boards to process each way
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    Snapshot snapshot;
+    Bitboard board;
+    struct parameters_s locations[MAX_WIDTH*MAX_HEIGHT];
+    unsigned char counts[ROW_STRIDE*BITBOARD_ROWS];
+    unsigned char roundTrip[MINEFIELD_SIZE];
+    unsigned char* field;
+    unsigned long long start;
+    unsigned long long checksum = 0;
+    unsigned int state = 7;
+
+    if (TakeSnapshot(source, &snapshot)) return 1;
+    field = SNAPSHOT_FIELD(&snapshot);
+
+    // Reveal some safe tiles and flag or question some others so every plane has something in it
+    for (DWORD y = 1; y <= snapshot.height; y++) {
+        for (DWORD x = 1; x <= snapshot.width; x++) {
+            unsigned int roll = NextRandom(&state) % 4;
+            if (field[x + y*ROW_STRIDE] & MINE) field[x + y*ROW_STRIDE] = (unsigned char)(MINE | (roll ? UNCLICKED_SPACE : QUESTION_MARK));
+            else if (roll == 0) field[x + y*ROW_STRIDE] = FLAG;
+            else if (roll == 1) field[x + y*ROW_STRIDE] = (unsigned char)(REVEALED_TILE | ByteNeighborMines(field, x, y));
+        }
+    }
+
+    // The bitboard and the byte loops have to agree before timing means anything
+    PackBitboard(field, snapshot.height, snapshot.width, &board);
+    UnpackBitboard(&board, roundTrip);
+    CountAllNeighbors(&board, counts);
+    for (DWORD y = 0; y <= snapshot.height + 1; y++) {
+        for (DWORD x = 0; x <= snapshot.width + 1; x++) {
+            if (roundTrip[x + y*ROW_STRIDE] != field[x + y*ROW_STRIDE]) {
+                printf("Round trip mismatch at %u,%u: 0x%02x vs 0x%02x\n", x, y, roundTrip[x + y*ROW_STRIDE], field[x + y*ROW_STRIDE]);
+                return 1;
+            }
+            if (x >= 1 && x <= snapshot.width && y >= 1 && y <= snapshot.height && \
+                (counts[x + y*ROW_STRIDE] != ByteNeighborMines(field, x, y) || NeighborMines(&board, x, y) != counts[x + y*ROW_STRIDE])) {
+                printf("Neighbor count mismatch at %u,%u\n", x, y);
+                return 1;
+            }
+        }
+    }
+    printf("Bitboard round trip and neighbor counts match the byte loops\n");
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        DWORD found = 0;
+        int lost = 0, hidden = 0;
+        for (DWORD y = ROW_STRIDE; y <= snapshot.height*ROW_STRIDE; y += ROW_STRIDE) {
+            for (DWORD x = 1; x <= snapshot.width; x++) {
+                if ((field[x + y] & EXPLODED_MINE) == EXPLODED_MINE) lost = 1;
+                if ((field[x + y] & MINE) && field[x + y] != (MINE | FLAG)) {
+                    locations[found].x = (int)x;
+                    locations[found].y = (int)(y/ROW_STRIDE);
+                    found++;
+                }
+                if (!(field[x + y] & (MINE | REVEALED_TILE))) hidden = 1;
+                counts[x + y] = (unsigned char)ByteNeighborMines(field, x, y/ROW_STRIDE);
+            }
+        }
+        checksum += found + (DWORD)lost + (DWORD)hidden + counts[33];
+    }
+    printf("byte loops:   %10.0f ns/board (scan, neighbor counts, win/loss)\n", \
+           (double)(NowNs() - start) / (double)iterations);
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        PackBitboard(field, snapshot.height, snapshot.width, &board);
+        checksum += ListMines(&board, 1, locations, MAX_WIDTH*MAX_HEIGHT) + (DWORD)GameState(&board);
+        CountAllNeighbors(&board, counts);
+        checksum += counts[33];
+    }
+    printf("bitboard:     %10.0f ns/board (pack included, checksum %llu)\n", \
+           (double)(NowNs() - start) / (double)iterations, checksum);
+
+    return 0;
+}
+
+int OpenFirstZero(unsigned char* field, DWORD width, DWORD height) {
+/**
+ * Purpose: Clicks the first tile with no mines around it, so a fresh board
+ *          starts with an opening the way most real games do
+ * @param field : unsigned char* - the raw minefield
+ * @param width : DWORD - width of the field
+ * @param height : DWORD - height of the field
+ * @return : int - 0 on success, 1 if the board has no such tile
+ */
+
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            if (!(field[x + y*ROW_STRIDE] & MINE) && ByteNeighborMines(field, x, y) == 0) {
+                RevealTile(field, width, height, x, y);
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+DWORD MarkMines(unsigned char* field, DWORD width, DWORD height, unsigned int seed) {
+/**
+ * Purpose: Question marks about one covered mine in eight and flags about
+ *          one in eight, the way a game in progress looks
+ * @param field : unsigned char* - the raw minefield
+ * @param width : DWORD - width of the field
+ * @param height : DWORD - height of the field
+ * @param seed : unsigned int - which mines
+ * @return : DWORD - number of flags placed
+ */
+
+    unsigned int state = seed;
+    DWORD flagged = 0;
+
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            unsigned char* tile = field + x + y*ROW_STRIDE;
+            unsigned int roll = NextRandom(&state) % 8;
+            if (!(*tile & MINE) || (*tile & 0x0F) != UNCLICKED_SPACE) continue;
+            if (roll == 0) *tile = (unsigned char)(MINE | QUESTION_MARK);
+            else if (roll == 1) {
+                *tile = (unsigned char)(MINE | FLAG);
+                flagged++;
+            }
+        }
+    }
+
+    return flagged;
+}
+
+int BenchSolver(long iterations) {
+/**
+ * Purpose: Plays expert games using nothing but the honest helper: open a
+ *          zero, then keep clicking every tile it proves safe until it gets
+ *          stuck or the game is won. Each position is checked against the
+ *          hidden mines so a wrong deduction fails the run
+ * @param iterations : long - number of positions to solve
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static unsigned char image[MODULE_IMAGE_SIZE];
+    static SolverResult result;
+    unsigned char kinds[KIND_GRID_SIZE];
+    unsigned char* field = image + MINEFIELD_OFFSET;
+    Bitboard board;
+    unsigned long long solveNs = 0;
+    unsigned long long start;
+    long positions = 0;
+    long games = 0;
+    long won = 0;
+    unsigned long long proven = 0;
+
+    while (positions < iterations) {
+        if (BuildBoard(image, 30, 16, 99, (unsigned int)++games)) return 1;
+        if (OpenFirstZero(field, 30, 16)) continue;
+
+        while (positions < iterations) {
+            DecodeField(field, 16, kinds);
+            for (DWORD i = 0; i < KIND_GRID_SIZE; i++) kinds[i] &= TILE_VISIBLE_MASK;
+
+            start = NowNs();
+            if (SolveVisible(kinds, 16, 30, &result)) {
+                printf("Game %ld: the solver found a contradiction on a real board\n", games);
+                return 1;
+            }
+            solveNs += NowNs() - start;
+            positions++;
+            proven += result.numSafe + result.numMines;
+
+            // Every deduction has to hold up against the hidden mines
+            for (DWORD y = 1; y <= 16; y++) {
+                for (DWORD x = 1; x <= 30; x++) {
+                    int isMine = (field[x + y*ROW_STRIDE] & MINE) != 0;
+                    if ((((result.safe[y] >> x) & 1) && isMine) || (((result.mines[y] >> x) & 1) && !isMine)) {
+                        printf("Game %ld: wrong deduction at %u,%u\n", games, x, y);
+                        return 1;
+                    }
+                }
+            }
+
+            if (!result.numSafe) break;
+            for (DWORD y = 1; y <= 16; y++) {
+                for (uint32_t safe = result.safe[y]; safe; safe &= safe - 1) {
+                    RevealTile(field, 30, 16, (DWORD)CTZ32(safe), y);
+                }
+            }
+        }
+
+        PackBitboard(field, 16, 30, &board);
+        if (GameState(&board) == GAME_WON) won++;
+    }
+
+    printf("solver:       %10.0f ns/position, %.0f positions/s (%ld positions, %.1f tiles proven each)\n", \
+           (double)solveNs / (double)positions, (double)positions * 1e9 / (double)solveNs, positions, \
+           (double)proven / (double)positions);
+    printf("              %ld expert games, %ld won without guessing, no wrong deductions\n", games, won);
+
+    return 0;
+}
+
+struct stuckPosition_s {
+    unsigned char kinds[KIND_GRID_SIZE];   // Visible part only
+    unsigned char field[MINEFIELD_SIZE];   // Hidden mines and all
+    SolverResult* solved;                  // Filled in by whoever computes the position
+    ProbabilityResult* result;
+    unsigned long long ns;                 // Time spent in ComputeProbabilities
+    int status;
+};
+
+int NextStuckPosition(unsigned char* image, unsigned int* seed, struct stuckPosition_s* position) {
+/**
+ * Purpose: Plays expert games with the honest helper until it gets stuck
+ *          before the game is won, and keeps that position. The game then
+ *          carries on from a random safe tile (peeking at the hidden mines)
+ *          on the next call, so positions from late in a game turn up too
+ * @param image : unsigned char* - the game in progress. Zeroed to start a new one
+ * @param seed : unsigned int* - seed of the last game started. Advanced for every game
+ * @param position : struct stuckPosition_s* - receives the position
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static SolverResult result;
+    static unsigned int pickState = 12345;  // Which safe tile to carry on from
+    unsigned char* field = image + MINEFIELD_OFFSET;
+    Bitboard board;
+    DWORD width;
+
+    for (;;) {
+        memcpy(&width, image + WIDTH_OFFSET, sizeof(DWORD));
+        PackBitboard(field, 16, 30, &board);
+        if (!width || GameState(&board) != GAME_IN_PROGRESS) {
+            if (BuildBoard(image, 30, 16, 99, ++*seed)) return 1;
+            if (OpenFirstZero(field, 30, 16)) continue;
+        }
+        else {
+            // Pick up where the last position left off
+            DWORD hidden = 0;
+            for (DWORD y = 1; y <= 16; y++) hidden += (DWORD)POPCOUNT32(board.playable[y] & ~board.mine[y] & ~board.revealed[y]);
+            DWORD pick = NextRandom(&pickState) % hidden;
+            for (DWORD y = 1; y <= 16; y++) {
+                for (uint32_t safe = board.playable[y] & ~board.mine[y] & ~board.revealed[y]; safe; safe &= safe - 1) {
+                    if (pick-- == 0) RevealTile(field, 30, 16, (DWORD)CTZ32(safe), y);
+                }
+            }
+        }
+
+        for (;;) {
+            DecodeField(field, 16, position->kinds);
+            for (DWORD i = 0; i < KIND_GRID_SIZE; i++) position->kinds[i] &= TILE_VISIBLE_MASK;
+            if (SolveVisible(position->kinds, 16, 30, &result)) return 1;
+            if (!result.numSafe) break;
+            for (DWORD y = 1; y <= 16; y++) {
+                for (uint32_t safe = result.safe[y]; safe; safe &= safe - 1) {
+                    RevealTile(field, 30, 16, (DWORD)CTZ32(safe), y);
+                }
+            }
+        }
+
+        PackBitboard(field, 16, 30, &board);
+        if (GameState(&board) == GAME_WON) continue;
+        memcpy(position->field, field, MINEFIELD_SIZE);
+        return 0;
+    }
+}
+
+int BruteForceCheck(const SolverResult* solved, const ProbabilityResult* result) {
+/**
+ * Purpose: Recomputes the frontier chances by trying every arrangement of
+ *          mines on the frontier and compares them with the engine's
+ * @param solved : const SolverResult* - the constraints
+ * @param result : const ProbabilityResult* - the engine's answer
+ * @return : int - 0 if they match, 1 if they don't
+ */
+
+    unsigned short tiles[BRUTE_FORCE_TILES];
+    uint32_t masks[MAX_WIDTH*MAX_HEIGHT];     // Each constraint's tiles as bits of the arrangement
+    double mined[BRUTE_FORCE_TILES] = { 0 };
+    double binomial[MAX_WIDTH*MAX_HEIGHT + 1];
+    double total = 0.0;
+    DWORD n = 0;
+
+    for (DWORD c = 0; c < solved->numConstraints; c++) {
+        const Constraint* constraint = &solved->constraints[c];
+        masks[c] = 0;
+        for (DWORD r = 0; r < 3; r++) {
+            for (uint32_t bits = constraint->rows[r]; bits; bits &= bits - 1) {
+                unsigned short offset = (unsigned short)(CTZ32(bits) + (constraint->y - 1 + r)*ROW_STRIDE);
+                DWORD t = 0;
+                while (t < n && tiles[t] != offset) t++;
+                if (t == n) tiles[n++] = offset;
+                masks[c] |= 1u << t;
+            }
+        }
+    }
+
+    binomial[0] = 1.0;
+    for (DWORD r = 0; r < result->numInterior; r++) binomial[r + 1] = binomial[r]*(double)(result->numInterior - r)/(double)(r + 1);
+
+    for (uint32_t arrangement = 0; arrangement < (1u << n); arrangement++) {
+        int k = POPCOUNT32(arrangement);
+        int valid = k <= result->remainingMines && result->remainingMines - k <= (int)result->numInterior;
+        for (DWORD c = 0; c < solved->numConstraints && valid; c++) {
+            if (POPCOUNT32(arrangement & masks[c]) != solved->constraints[c].mines) valid = 0;
+        }
+        if (!valid) continue;
+
+        double weight = binomial[result->remainingMines - k];
+        total += weight;
+        for (DWORD t = 0; t < n; t++) {
+            if ((arrangement >> t) & 1) mined[t] += weight;
+        }
+    }
+
+    for (DWORD t = 0; t < n; t++) {
+        double expected = mined[t] / total;
+        if (expected - result->chance[tiles[t]] > 1e-5 || result->chance[tiles[t]] - expected > 1e-5) {
+            printf("Tile %u,%u: engine says %f, brute force %f\n", tiles[t] % ROW_STRIDE, tiles[t] / ROW_STRIDE, \
+                   result->chance[tiles[t]], expected);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+ThreadPool* benchPool = NULL;  // The pool ProbabilityTask hands its groups to
+
+void ProbabilityTask(void* argument) {
+/**
+ * Purpose: Thread pool task that works out the chances for one position
+ * @param argument : struct stuckPosition_s* - the position. solved and result must be set
+ * @return : void
+ */
+
+    struct stuckPosition_s* position = (struct stuckPosition_s*)argument;
+    unsigned long long start;
+
+    SolveVisible(position->kinds, 16, 30, position->solved);
+    start = NowNs();
+    position->status = ComputeProbabilities(benchPool, NULL, position->kinds, 16, 30, 99, position->solved, position->result);
+    position->ns = NowNs() - start;
+}
+
+int CompareNs(const void* a, const void* b) {
+/**
+ * Purpose: qsort comparison for unsigned long long
+ * @param a : const void* - first value
+ * @param b : const void* - second value
+ * @return : int - negative, 0 or positive
+ */
+
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return (x > y) - (x < y);
+}
+
+int BenchProbability(long iterations) {
+/**
+ * Purpose: Collects expert positions where the honest helper is stuck and
+ *          works out exact mine chances for each. Small frontiers are
+ *          checked against brute force and every position is checked to
+ *          expect exactly 99 mines. Reports the latency of one position at
+ *          a time (cold cache), then throughput with more and more threads
+ * @param iterations : long - number of positions
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static unsigned char image[MODULE_IMAGE_SIZE];
+    static ThreadPool pool;
+    struct stuckPosition_s* positions;
+    SolverResult* solved;
+    ProbabilityResult* results;
+    unsigned long long* latency;
+    unsigned long long start;
+    unsigned int seed = 0;
+    long checked = 0;
+    DWORD largest = 0;
+    TaskGroup group;
+
+    if (iterations < 1) return 1;
+    positions = (struct stuckPosition_s*)malloc((size_t)iterations*sizeof(struct stuckPosition_s));
+    solved    = (SolverResult*)malloc((size_t)iterations*sizeof(SolverResult));
+    results   = (ProbabilityResult*)malloc((size_t)iterations*sizeof(ProbabilityResult));
+    latency   = (unsigned long long*)malloc((size_t)iterations*sizeof(unsigned long long));
+    if (!positions || !solved || !results || !latency) {
+        printf("Not enough memory for %ld positions\n", iterations);
+        return 1;
+    }
+
+    for (long i = 0; i < iterations; i++) {
+        if (NextStuckPosition(image, &seed, &positions[i])) return 1;
+        positions[i].solved = &solved[i];
+        positions[i].result = &results[i];
+    }
+
+    // One at a time with nothing cached, for worst case latency
+    for (long i = 0; i < iterations; i++) {
+        double expected;
+        ClearProbabilityCache();
+        benchPool = NULL;
+        ProbabilityTask(&positions[i]);
+        if (positions[i].status) {
+            printf("Position %ld: no answer\n", i);
+            return 1;
+        }
+        latency[i] = positions[i].ns;
+        if (results[i].largestComponent > largest) largest = results[i].largestComponent;
+
+        // The chances (proven mines count as 1) have to add up to every mine on the board
+        expected = 0.0;
+        for (DWORD t = 0; t < KIND_GRID_SIZE; t++) {
+            if (results[i].chance[t] > 0.0f) expected += results[i].chance[t];
+        }
+        if (expected - 99.0 > 1e-3 || 99.0 - expected > 1e-3) {
+            printf("Position %ld: chances add up to %f mines, not 99\n", i, expected);
+            return 1;
+        }
+
+        if (results[i].numFrontier <= BRUTE_FORCE_TILES) {
+            if (BruteForceCheck(&solved[i], &results[i])) return 1;
+            checked++;
+        }
+    }
+    qsort(latency, (size_t)iterations, sizeof(unsigned long long), CompareNs);
+    printf("%ld stuck expert positions from %u games, largest group %u tiles, %ld checked by brute force\n", \
+           iterations, seed, largest, checked);
+    printf("latency:      p50 %.1f us, p99 %.1f us, max %.1f us\n", latency[iterations/2] / 1000.0, \
+           latency[iterations*99/100] / 1000.0, latency[iterations - 1] / 1000.0);
+
+    // Throughput. Each position is a task and so is each of its groups
+    for (int threads = 1; threads <= 2*CountCores() && threads <= POOL_MAX_THREADS; threads *= 2) {
+        if (StartThreadPool(&pool, threads)) return 1;
+        benchPool = &pool;
+        ClearProbabilityCache();
+        memset(&group, 0, sizeof(group));
+
+        start = NowNs();
+        for (long i = 0; i < iterations; i++) SubmitTask(&pool, &group, ProbabilityTask, &positions[i]);
+        WaitForGroup(&pool, &group);
+        double seconds = (double)(NowNs() - start) / 1e9;
+        StopThreadPool(&pool);
+
+        unsigned long long steals = 0;
+        for (int i = 0; i < threads; i++) steals += pool.queues[i].steals;
+        printf("%2d threads:   %10.0f positions/s (%.0f per thread, %llu steals)\n", threads, \
+               iterations / seconds, iterations / seconds / threads, steals);
+    }
+    printf("%d cores\n", CountCores());
+
+    free(positions);
+    free(solved);
+    free(results);
+    free(latency);
+    return 0;
+}
+
+int LegacyMetrics(const unsigned char* field, DWORD width, DWORD height, DWORD* openings, DWORD* islands, DWORD* bbbv) {
+/**
+ * Purpose: The way MeasureBoard used to count openings and 3BV: flood out
+ *          from every zero with an explicit stack, one tile at a time, plus
+ *          the same flood over left over numbers for islands. Kept around
+ *          to check the union-find version against and to time it
+ * @param field : const unsigned char* - the raw minefield
+ * @param width : DWORD - width of the field
+ * @param height : DWORD - height of the field
+ * @param openings : DWORD* - receives the number of openings
+ * @param islands : DWORD* - receives the number of islands
+ * @param bbbv : DWORD* - receives the 3BV
+ * @return : int - 0
+ */
+
+    unsigned char counts[ROW_STRIDE*BITBOARD_ROWS];  // Mines around each tile. 9 for a mine or the border
+    unsigned char opened[ROW_STRIDE*BITBOARD_ROWS];  // Revealed by some opening, or already in an island
+    unsigned short stack[MAX_WIDTH*MAX_HEIGHT];
+    Bitboard board;
+
+    PackBitboard(field, height, width, &board);
+    CountAllNeighbors(&board, counts);
+    memset(opened, 0, sizeof(opened));
+    for (DWORD offset = 0; offset < ROW_STRIDE*BITBOARD_ROWS; offset++) {
+        if (!((board.playable[offset / ROW_STRIDE] >> (offset % ROW_STRIDE)) & 1) || ((board.mine[offset / ROW_STRIDE] >> (offset % ROW_STRIDE)) & 1)) {
+            counts[offset] = 9;
+        }
+    }
+    *openings = *islands = *bbbv = 0;
+
+    // Zeros spread to everything around them. Numbers only spread to numbers (islands)
+    for (int pass = 0; pass < 2; pass++) {
+        for (DWORD start = ROW_STRIDE; start < (height + 1)*ROW_STRIDE; start++) {
+            int stackSize = 0;
+            if (opened[start] || counts[start] == 9 || (pass == 0) != (counts[start] == 0)) continue;
+
+            if (pass == 0) (*openings)++;
+            else (*islands)++;
+            opened[start] = 1;
+            stack[stackSize++] = (unsigned short)start;
+            while (stackSize) {
+                DWORD from = stack[--stackSize];
+                for (int dy = -ROW_STRIDE; dy <= ROW_STRIDE; dy += ROW_STRIDE) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        DWORD to = (DWORD)((int)from + dy + dx);
+                        if (opened[to] || counts[to] == 9) continue;
+                        if (pass == 0) {
+                            opened[to] = 1;
+                            if (!counts[to]) stack[stackSize++] = (unsigned short)to;
+                        }
+                        else {
+                            opened[to] = 1;
+                            (*bbbv)++;
+                            stack[stackSize++] = (unsigned short)to;
+                        }
+                    }
+                }
+            }
+            if (pass == 1) (*bbbv)++;
+        }
+    }
+    *bbbv += *openings;
+
+    return 0;
+}
+
+int BenchMetrics(long iterations) {
+/**
+ * Purpose: Checks MeasureBoard's openings, islands and 3BV against the old
+ *          stack flood fill on boards of every standard size, then times both
+ * @param iterations : long - boards to measure each way
+ * @return : int - 0 on success, 1 on a mismatch
+ */
+
+    static unsigned char image[MODULE_IMAGE_SIZE];
+    unsigned char* field = image + MINEFIELD_OFFSET;
+    const DWORD sizes[3][3] = { { 9, 9, 10 }, { 16, 16, 40 }, { 30, 16, 99 } };
+    BoardMetrics metrics;
+    DWORD openings, islands, bbbv;
+    unsigned long long checksum = 0;
+
+    for (int size = 0; size < 3; size++) {
+        DWORD width = sizes[size][0], height = sizes[size][1], numMines = sizes[size][2];
+        unsigned long long start;
+        double legacyNs, unionNs;
+
+        for (unsigned int seed = 1; seed <= 10000; seed++) {
+            if (BuildBoard(image, width, height, numMines, seed)) return 1;
+            MeasureBoard(field, width, height, numMines, 0, &metrics);
+            LegacyMetrics(field, width, height, &openings, &islands, &bbbv);
+            if (metrics.openings != openings || metrics.islands != islands || metrics.bbbv != bbbv) {
+                printf("Mismatch on %ux%u seed %u: openings %u vs %u, islands %u vs %u, 3BV %u vs %u\n", width, height, \
+                       seed, metrics.openings, openings, metrics.islands, islands, metrics.bbbv, bbbv);
+                return 1;
+            }
+        }
+
+        // The same board over and over keeps board generation out of the timing
+        BuildBoard(image, width, height, numMines, 1);
+        start = NowNs();
+        for (long i = 0; i < iterations; i++) {
+            LegacyMetrics(field, width, height, &openings, &islands, &bbbv);
+            checksum += bbbv;
+        }
+        legacyNs = (double)(NowNs() - start) / (double)iterations;
+        start = NowNs();
+        for (long i = 0; i < iterations; i++) {
+            MeasureBoard(field, width, height, numMines, 0, &metrics);
+            checksum += metrics.bbbv;
+        }
+        unionNs = (double)(NowNs() - start) / (double)iterations;
+
+        printf("%2ux%-2u %2u mines: stack flood %7.0f ns/board, union-find %7.0f ns/board (%.1fx), %.0f boards/s\n", \
+               width, height, numMines, legacyNs, unionNs, legacyNs / unionNs, 1e9 / unionNs);
+    }
+    printf("10000 boards of each size match the stack flood fill (checksum %llu)\n", checksum);
+
+    return 0;
+}
+
+// One synthetic board in the suite. pristine never changes, image is what the cases work on
+struct suiteBoard_s {
+    unsigned char pristine[MODULE_IMAGE_SIZE];
+    unsigned char image[MODULE_IMAGE_SIZE];
+    unsigned char remote[MODULE_IMAGE_SIZE];  // Stands in for the memory the flag batch is written to
+    MemorySource source;                      // Reads and writes image
+    MemorySource remoteSource;                // Writes remote
+    DWORD width;
+    DWORD height;
+    DWORD numMines;
+};
+
+// A suite case does one operation on a board and says how many bytes it put out
+typedef int (*SuiteCase)(struct suiteBoard_s* board, unsigned long long* bytes);
+
+// One line of results
+struct suiteResult_s {
+    char name[32];
+    char size[16];
+    double minNs;
+    double medianNs;
+    double allocations;  // Per operation. -1 if they can't be counted here
+    double bytes;        // Per operation
+};
+
+int SuiteDecode(struct suiteBoard_s* board, unsigned long long* bytes) {
+/**
+ * Purpose: What SetMineMetadata does: one read of the snapshot window from
+ *          the buffer backend, then decoding the header and every tile
+ * @param board : struct suiteBoard_s* - the board
+ * @param bytes : unsigned long long* - incremented by the bytes read
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    Snapshot snapshot;
+    unsigned char kinds[KIND_GRID_SIZE];
+
+    if (TakeSnapshot(&board->source, &snapshot) || DecodeSnapshot(&snapshot)) return 1;
+    DecodeField(SNAPSHOT_FIELD(&snapshot), snapshot.height, kinds);
+    *bytes += SNAPSHOT_SIZE;
+    return 0;
+}
+
+int SuiteScan(struct suiteBoard_s* board, unsigned long long* bytes) {
+/**
+ * Purpose: FlagAllMines' scan: pack the field, check the game isn't lost and
+ *          list every mine that isn't flagged yet
+ * @param board : struct suiteBoard_s* - the board
+ * @param bytes : unsigned long long* - incremented by the size of the list
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    Bitboard bitboard;
+    struct parameters_s locations[MAX_WIDTH*MAX_HEIGHT];
+    DWORD found;
+
+    PackBitboard(board->image + MINEFIELD_OFFSET, board->height, board->width, &bitboard);
+    if (GameState(&bitboard) == GAME_LOST) return 1;
+    found = ListMines(&bitboard, 1, locations, board->numMines);
+    *bytes += found*sizeof(struct parameters_s);
+    return 0;
+}
+
+int SuiteRender(struct suiteBoard_s* board, unsigned long long* bytes) {
+/**
+ * Purpose: PrintMineField with the frame going into a buffer instead of
+ *          the terminal
+ * @param board : struct suiteBoard_s* - the board
+ * @param bytes : unsigned long long* - incremented by the size of the frame
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static Frame frame;
+    unsigned char kinds[KIND_GRID_SIZE];
+
+    DecodeField(board->image + MINEFIELD_OFFSET, board->height, kinds);
+    *bytes += RenderFrame(&frame, kinds, board->height, board->width, 1);
+    return 0;
+}
+
+int SuiteFlag(struct suiteBoard_s* board, unsigned long long* bytes) {
+/**
+ * Purpose: FlagAllMines against the buffer backend. The same allocations,
+ *          question mark writes and batch as the real thing, written to a
+ *          buffer instead of winmine. The remote thread is stood in for by a
+ *          loop that does what winmine's flag function does to each tile.
+ *          The board is put back first so every run has the same work to do
+ * @param board : struct suiteBoard_s* - the board
+ * @param bytes : unsigned long long* - incremented by the bytes written to the backends
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned char buff = (unsigned char)(MINE | UNCLICKED_SPACE);
+    unsigned long long written = board->source.bytesWritten + board->remoteSource.bytesWritten;
+    struct parameters_s* mineLocations;
+    struct flagBatch_s* batchView;
+    unsigned char* batch;
+    size_t batchSize;
+    unsigned char* field = board->image + MINEFIELD_OFFSET;
+    DWORD minesFound;
+    DWORD remaining;
+    Bitboard bitboard;
+
+    memcpy(field, board->pristine + MINEFIELD_OFFSET, MINEFIELD_SIZE);
+    memcpy(board->image + MINES_REMAINING_OFFSET, board->pristine + MINES_REMAINING_OFFSET, sizeof(DWORD));
+
+    mineLocations = (struct parameters_s*)malloc(sizeof(struct parameters_s)*board->numMines);
+    if (!mineLocations) return 1;
+    PackBitboard(field, board->height, board->width, &bitboard);
+    minesFound = ListMines(&bitboard, 1, mineLocations, board->numMines);
+
+    for (DWORD i = 0; i < minesFound; i++) {
+        if (!(bitboard.question[mineLocations[i].y] & (1u << mineLocations[i].x))) continue;
+        if (WriteSource(&board->source, MINEFIELD_OFFSET + (DWORD)(mineLocations[i].x + mineLocations[i].y*ROW_STRIDE), &buff, 1)) {
+            free(mineLocations);
+            return 1;
+        }
+    }
+
+    batchSize = FlagBatchSize(minesFound);
+    batch = (unsigned char*)malloc(batchSize);
+    if (!batch) {
+        free(mineLocations);
+        return 1;
+    }
+    BuildFlagBatch(batch, SUITE_REMOTE, SUITE_REMOTE + FLAG_TILE_FUNCTION, mineLocations, minesFound);
+    if (WriteSource(&board->remoteSource, 0, batch, batchSize)) {
+        free(batch);
+        free(mineLocations);
+        return 1;
+    }
+
+    // The remote thread: walk the batch as written and flag each tile
+    batchView = (struct flagBatch_s*)(board->remote + FLAG_BATCH_OFFSET);
+    memcpy(&remaining, board->image + MINES_REMAINING_OFFSET, sizeof(DWORD));
+    for (DWORD i = 0; i < batchView->count; i++) {
+        unsigned char* tile = field + batchView->locations[i].x + batchView->locations[i].y*ROW_STRIDE;
+        *tile = (unsigned char)((*tile & MINE) | FLAG);
+        remaining--;
+    }
+    memcpy(board->image + MINES_REMAINING_OFFSET, &remaining, sizeof(DWORD));
+
+    free(batch);
+    free(mineLocations);
+    *bytes += board->source.bytesWritten + board->remoteSource.bytesWritten - written;
+    return 0;
+}
+
+int SuiteDirectFlag(struct suiteBoard_s* board, unsigned long long* bytes) {
+/**
+ * Purpose: DirectFlagAllMines against the buffer backend: a snapshot, the
+ *          plan and its writes. The board is put back first so every run has
+ *          the same work to do
+ * @param board : struct suiteBoard_s* - the board
+ * @param bytes : unsigned long long* - incremented by the bytes written
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static DirectFlagPlan plan;
+    Snapshot snapshot;
+    unsigned long long written = board->source.bytesWritten;
+
+    memcpy(board->image + MINEFIELD_OFFSET, board->pristine + MINEFIELD_OFFSET, MINEFIELD_SIZE);
+    memcpy(board->image + MINES_REMAINING_OFFSET, board->pristine + MINES_REMAINING_OFFSET, sizeof(DWORD));
+
+    if (DirectFlagAllMines(&board->source, &builtinOffsets, &snapshot, &plan)) return 1;
+    *bytes += board->source.bytesWritten - written;
+    return 0;
+}
+
+int CompareDoubles(const void* a, const void* b) {
+/**
+ * Purpose: qsort comparison for doubles
+ * @param a : const void* - a double
+ * @param b : const void* - another double
+ * @return : int - negative, zero or positive
+ */
+
+    double left = *(const double*)a, right = *(const double*)b;
+    return (left > right) - (left < right);
+}
+
+int CompareToBaseline(const char* path, const struct suiteResult_s* results, int numResults) {
+/**
+ * Purpose: Prints how each case moved since a saved run and counts the
+ *          ones that got slower by more than SUITE_REGRESSION
+ * @param path : const char* - results file from an earlier run
+ * @param results : const struct suiteResult_s* - this run
+ * @param numResults : int - number of results
+ * @return : int - number of regressions, or -1 if the baseline can't be read
+ */
+
+    FILE* baseline = fopen(path, "r");
+    char line[256];
+    int regressions = 0;
+
+    if (!baseline) {
+        perror(path);
+        return -1;
+    }
+
+    printf("\nAgainst %s (median ns/op):\n", path);
+    if (!fgets(line, sizeof(line), baseline)) line[0] = 0;  // Header
+    while (fgets(line, sizeof(line), baseline)) {
+        struct suiteResult_s old;
+        if (sscanf(line, "%31[^,],%15[^,],%lf,%lf,%lf,%lf", old.name, old.size, &old.minNs, &old.medianNs, \
+                   &old.allocations, &old.bytes) != 6) continue;
+        for (int i = 0; i < numResults; i++) {
+            double ratio;
+            if (strcmp(results[i].name, old.name) || strcmp(results[i].size, old.size)) continue;
+            ratio = results[i].medianNs / old.medianNs;
+            printf("  %-8s %-12s %10.1f -> %10.1f  %+6.1f%%%s\n", old.name, old.size, old.medianNs, \
+                   results[i].medianNs, (ratio - 1.0)*100.0, ratio > SUITE_REGRESSION ? "  REGRESSION" : "");
+            if (ratio > SUITE_REGRESSION) regressions++;
+            // The file only keeps a couple of decimals
+            if (results[i].allocations - old.allocations > 0.005 || old.allocations - results[i].allocations > 0.005 || \
+                results[i].bytes - old.bytes > 0.05 || old.bytes - results[i].bytes > 0.05) {
+                printf("  %-8s %-12s allocations %.2f -> %.2f, bytes %.1f -> %.1f\n", old.name, old.size, \
+                       old.allocations, results[i].allocations, old.bytes, results[i].bytes);
+            }
+        }
+    }
+
+    fclose(baseline);
+    return regressions;
+}
+
+int BenchSuite(long iterations, const char* resultsPath, const char* baselinePath) {
+/**
+ * Purpose: The fixed set of benchmarks to compare runs with: decoding,
+ *          the mine scan, rendering, flagging with a remote thread and
+ *          flagging by writing the field on beginner, intermediate
+ *          and expert boards. The boards come from fixed seeds with an
+ *          opening clicked, some tiles flagged and some mines question
+ *          marked, so every run does exactly the same work. Each case runs
+ *          SUITE_REPEATS times and the results go to a CSV file
+ * @param iterations : long - operations per case per repeat
+ * @param resultsPath : const char* - where to write the results
+ * @param baselinePath : const char* - an earlier results file to compare with. NULL for none
+ * @return : int - 0 on success, 1 on failure or a regression
+ */
+
+    static struct suiteBoard_s boards[SUITE_BOARDS];
+    const DWORD sizes[3][3] = { { 9, 9, 10 }, { 16, 16, 40 }, { 30, 16, 99 } };
+    const char* sizeNames[3] = { "beginner", "intermediate", "expert" };
+    const char* caseNames[5] = { "decode", "scan", "render", "flag", "direct" };
+    const SuiteCase cases[5] = { SuiteDecode, SuiteScan, SuiteRender, SuiteFlag, SuiteDirectFlag };
+    struct suiteResult_s results[15];
+    int numResults = 0;
+    FILE* out;
+
+    printf("%ld operations x %d repeats per case, %d boards per size. Allocations %s\n", iterations, \
+           SUITE_REPEATS, SUITE_BOARDS, COUNTS_ALLOCATIONS ? "counted" : "not counted on this platform");
+    printf("%-8s %-12s %12s %12s %10s %10s\n", "case", "size", "min ns/op", "median ns/op", "allocs/op", "bytes/op");
+
+    for (int size = 0; size < 3; size++) {
+        for (int b = 0; b < SUITE_BOARDS; b++) {
+            struct suiteBoard_s* board = &boards[b];
+            unsigned char* field = board->pristine + MINEFIELD_OFFSET;
+            DWORD flagged;
+
+            board->width    = sizes[size][0];
+            board->height   = sizes[size][1];
+            board->numMines = sizes[size][2];
+            if (BuildBoard(board->pristine, board->width, board->height, board->numMines, 1000u*(unsigned)size + (unsigned)b)) return 1;
+            OpenFirstZero(field, board->width, board->height);
+            flagged = board->numMines - MarkMines(field, board->width, board->height, (unsigned int)b);
+            memcpy(board->pristine + MINES_REMAINING_OFFSET, &flagged, sizeof(DWORD));
+            memcpy(board->image, board->pristine, MODULE_IMAGE_SIZE);
+            OpenBufferSource(&board->source, board->image, MODULE_IMAGE_SIZE);
+            OpenBufferSource(&board->remoteSource, board->remote, MODULE_IMAGE_SIZE);
+        }
+
+        for (int c = 0; c < 5; c++) {
+            struct suiteResult_s* result = &results[numResults++];
+            double ns[SUITE_REPEATS];
+            unsigned long long bytes = 0;
+            unsigned long long allocationsBefore = allocations;
+
+            for (int r = 0; r < SUITE_REPEATS; r++) {
+                unsigned long long start = NowNs();
+                for (long i = 0; i < iterations; i++) {
+                    if (cases[c](&boards[i % SUITE_BOARDS], &bytes)) return 1;
+                }
+                ns[r] = (double)(NowNs() - start) / (double)iterations;
+            }
+            qsort(ns, SUITE_REPEATS, sizeof(double), CompareDoubles);
+
+            snprintf(result->name, sizeof(result->name), "%s", caseNames[c]);
+            snprintf(result->size, sizeof(result->size), "%s", sizeNames[size]);
+            result->minNs       = ns[0];
+            result->medianNs    = ns[SUITE_REPEATS / 2];
+            result->allocations = COUNTS_ALLOCATIONS ? \
+                (double)(allocations - allocationsBefore) / (double)(iterations*SUITE_REPEATS) : -1.0;
+            result->bytes       = (double)bytes / (double)(iterations*SUITE_REPEATS);
+            printf("%-8s %-12s %12.1f %12.1f %10.2f %10.1f\n", result->name, result->size, result->minNs, \
+                   result->medianNs, result->allocations, result->bytes);
+        }
+    }
+
+    out = fopen(resultsPath, "w");
+    if (!out) {
+        perror(resultsPath);
+        return 1;
+    }
+    fprintf(out, "case,size,min_ns_per_op,median_ns_per_op,allocations_per_op,bytes_per_op,iterations,repeats\n");
+    for (int i = 0; i < numResults; i++) {
+        fprintf(out, "%s,%s,%.1f,%.1f,%.2f,%.1f,%ld,%d\n", results[i].name, results[i].size, results[i].minNs, \
+                results[i].medianNs, results[i].allocations, results[i].bytes, iterations, SUITE_REPEATS);
+    }
+    fclose(out);
+    printf("Results written to %s\n", resultsPath);
+
+    if (baselinePath) {
+        int regressions = CompareToBaseline(baselinePath, results, numResults);
+        if (regressions < 0) return 1;
+        printf("%d regression%s beyond %.0f%%\n", regressions, regressions == 1 ? "" : "s", (SUITE_REGRESSION - 1.0)*100.0);
+        return regressions > 0;
+    }
+
+    return 0;
+}
+
+void TraceTask(void* argument) {
+/**
+ * Purpose: Thread pool task for BenchTrace. Records trace points as fast as
+ *          it can so the rings wrap while the main thread dumps them
+ * @param argument : long* - number of trace points to record
+ * @return : void
+ */
+
+    long count = *(long*)argument;
+
+    for (long i = 0; i < count; i++) TraceRecord(TRACE_READ, NowNs(), (unsigned long long)(i & 1023), SNAPSHOT_SIZE);
+}
+
+int BenchTrace(MemorySource* source, long iterations) {
+/**
+ * Purpose: Measures what the trace points cost with tracing off and on, then
+ *          has every core record at once while the main thread dumps, and
+ *          checks no trace point went missing
+ * @param source : MemorySource* - where to read the board from
+ * @param iterations : long - number of snapshots to take and decode each way
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static ThreadPool pool;
+    Snapshot snapshot;
+    unsigned char kinds[KIND_GRID_SIZE];
+    TraceCounter counters[TRACE_NUM_KINDS];
+    TaskGroup group = { 0 };
+    unsigned long long start;
+    double perOp[2];
+    long perThread = iterations;
+    int numThreads;
+    int dumps = 0;
+    FILE* sink;
+
+    // Reading and decoding a board is two trace points
+    for (int level = 0; level < 2; level++) {
+        SetTraceLevel(level ? TRACE_RECORD : TRACE_OFF);
+        start = NowNs();
+        for (long i = 0; i < iterations; i++) {
+            if (TakeSnapshot(source, &snapshot)) return 1;
+            DecodeField(SNAPSHOT_FIELD(&snapshot), snapshot.height, kinds);
+        }
+        perOp[level] = (double)(NowNs() - start) / (double)iterations;
+        printf("tracing %-3s  %8.1f ns per snapshot and decode\n", level ? "on" : "off", perOp[level]);
+    }
+    printf("Each trace point costs about %.1f ns when recording\n", (perOp[1] - perOp[0]) / 2.0);
+
+    CollectTraceCounters(counters);
+    if (counters[TRACE_READ].calls != (unsigned long long)iterations || \
+        counters[TRACE_DECODE].calls != (unsigned long long)iterations) {
+        printf("Recorded %llu reads and %llu decodes but expected %ld of each\n", counters[TRACE_READ].calls, \
+               counters[TRACE_DECODE].calls, iterations);
+        return 1;
+    }
+    ResetTrace();
+
+    // Every core records while this thread keeps dumping
+    if (!(sink = tmpfile()) || StartThreadPool(&pool, CountCores())) return 1;
+    numThreads = pool.numThreads;
+    start = NowNs();
+    for (int t = 0; t < numThreads; t++) SubmitTask(&pool, &group, TraceTask, &perThread);
+    while (AtomicAdd(&group.pending, 0)) {
+        rewind(sink);
+        if (DumpTrace(sink, dumps & 1 ? TRACE_CSV : TRACE_JSON)) return 1;
+        dumps++;
+    }
+    WaitForGroup(&pool, &group);
+    printf("%d threads recorded %.0f trace points/s each while %d dumps ran\n", numThreads, \
+           (double)perThread / ((double)(NowNs() - start) / 1e9), dumps);
+    StopThreadPool(&pool);
+    fclose(sink);
+
+    CollectTraceCounters(counters);
+    if (counters[TRACE_READ].calls != (unsigned long long)perThread*(unsigned long long)numThreads) {
+        printf("Recorded %llu trace points but expected %llu\n", counters[TRACE_READ].calls, \
+               (unsigned long long)perThread*(unsigned long long)numThreads);
+        return 1;
+    }
+    printf("Every trace point was counted. p50 %llu ns, p99 %llu ns\n", TracePercentile(&counters[TRACE_READ], 0.5), \
+           TracePercentile(&counters[TRACE_READ], 0.99));
+    SetTraceLevel(TRACE_OFF);
+    ResetTrace();
+
+    return 0;
+}
+
+void ScatterStates(const Geometry* geometry, unsigned char* cells, unsigned int seed) {
+/**
+ * Purpose: Makes a fresh board look played: about one tile in eight is
+ *          revealed, a quarter of the mines are flagged and some of the rest
+ *          question marked, with a few wrong flags thrown in
+ * @param geometry : const Geometry* - the board's geometry
+ * @param cells : unsigned char* - the board
+ * @param seed : unsigned int - which tiles
+ * @return : void
+ */
+
+    unsigned int state = seed | 1;
+
+    for (DWORD y = 1; y <= geometry->height; y++) {
+        for (DWORD x = 1; x <= geometry->width; x++) {
+            unsigned char* tile = cells + GeometryOffset(geometry, x, y);
+            unsigned int roll = NextRandom(&state) % 16;
+
+            if (*tile & MINE) {
+                if (roll < 4) *tile = MINE | FLAG;
+                else if (roll < 6) *tile = MINE | QUESTION_MARK;
+            }
+            else if (roll < 2) *tile = REVEALED_TILE;
+            else if (roll == 2) *tile = FLAG;
+        }
+    }
+}
+
+int CompareLocations(const void* a, const void* b) {
+/**
+ * Purpose: qsort comparator that puts tile locations in row order
+ * @param a : const void* - a struct parameters_s
+ * @param b : const void* - another struct parameters_s
+ * @return : int - negative, zero or positive
+ */
+
+    const struct parameters_s* left = (const struct parameters_s*)a;
+    const struct parameters_s* right = (const struct parameters_s*)b;
+
+    if (left->y != right->y) return left->y - right->y;
+    return left->x - right->x;
+}
+
+int TimeGeometry(const Geometry* geometry, const unsigned char* pristine, unsigned char* cells, char* text, \
+                 struct parameters_s* flagged, long iterations, double* rates) {
+/**
+ * Purpose: Times scan, render and flag on one board. Flagging changes the
+ *          board, so every flag starts from a fresh copy and the copy's own
+ *          time is taken back out
+ * @param geometry : const Geometry* - the board's geometry
+ * @param pristine : const unsigned char* - the board to start from
+ * @param cells : unsigned char* - scratch board
+ * @param text : char* - room for a render
+ * @param flagged : struct parameters_s* - room for every mine
+ * @param iterations : long - times to run each
+ * @param rates : double* - receives million tiles per second for scan, render and flag
+ * @return : int - a checksum so none of the work can be skipped
+ */
+
+    double tiles = (double)geometry->width*geometry->height*(double)iterations;
+    unsigned long long start, copyNs, flagNs;
+    BoardCounts counts;
+    int checksum = 0;
+
+    memcpy(cells, pristine, geometry->cellsSize);
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        geometry->scan(geometry, cells, &counts);
+        checksum += (int)counts.unflaggedMines;
+    }
+    rates[0] = tiles / (double)(NowNs() - start)*1e3;
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) checksum += (int)geometry->render(geometry, cells, text) + text[i % 3];
+    rates[1] = tiles / (double)(NowNs() - start)*1e3;
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        memcpy(cells, pristine, geometry->cellsSize);
+        checksum += cells[i % geometry->cellsSize];
+    }
+    copyNs = NowNs() - start;
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        memcpy(cells, pristine, geometry->cellsSize);
+        checksum += (int)geometry->flag(geometry, cells, flagged, geometry->width*geometry->height);
+    }
+    flagNs = NowNs() - start;
+    flagNs = flagNs > copyNs ? flagNs - copyNs : 1;
+    rates[2] = tiles / (double)flagNs*1e3;
+
+    return checksum;
+}
+
+int BenchGeometry(long iterations) {
+/**
+ * Purpose: Checks that the specialized, runtime and tiled paths agree on
+ *          the standard boards (counts, rendered text, mines flagged and the
+ *          board they leave behind), then reports scan, render and flag
+ *          throughput on each path and on tiled boards up to 2048x2048
+ * @param iterations : long - expert boards' worth of tiles to time each case with
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static const DWORD standard[3][3] = { { 9, 9, 10 }, { 16, 16, 40 }, { 30, 16, 99 } };
+    static const DWORD large[4] = { 64, 256, 1000, 2048 };
+    static const int layouts[3] = { GEOMETRY_AUTO, GEOMETRY_RUNTIME, GEOMETRY_TILED };
+    static unsigned char image[MODULE_IMAGE_SIZE];
+    unsigned char* cells[3] = { NULL, NULL, NULL };     // Pristine board, scratch board, second scratch board
+    char* text[2] = { NULL, NULL };
+    struct parameters_s* flagged[2] = { NULL, NULL };
+    size_t maxCells = (size_t)2048*2048, maxTiles = (size_t)2048*2048;
+    int checksum = 0;
+    int status = 1;
+    double rates[3];
+
+    for (int i = 0; i < 3; i++) cells[i] = (unsigned char*)malloc(maxCells);
+    for (int i = 0; i < 2; i++) {
+        text[i] = (char*)malloc((2048*3 + 1)*2048);
+        flagged[i] = (struct parameters_s*)malloc(maxTiles*sizeof(struct parameters_s));
+    }
+    if (!cells[0] || !cells[1] || !cells[2] || !text[0] || !text[1] || !flagged[0] || !flagged[1]) {
+        printf("Error allocating the boards\n");
+        goto cleanup;
+    }
+
+    printf("%-11s %-13s %14s %14s %14s\n", "board", "path", "scan Mt/s", "render Mt/s", "flag Mt/s");
+    for (int b = 0; b < 3; b++) {
+        DWORD width = standard[b][0], height = standard[b][1];
+        long boardIterations = iterations*(long)(30*16) / (long)(width*height);
+        Geometry reference, geometry;
+        BoardCounts want, got;
+        DWORD numWant, numGot;
+        char size[16];
+
+        // The reference is winmine's own layout, with the board played a bit
+        if (BuildBoard(image, width, height, standard[b][2], b + 1) || \
+            InitGeometry(&reference, width, height, GEOMETRY_AUTO)) goto cleanup;
+        ScatterStates(&reference, image + MINEFIELD_OFFSET, b + 1);
+        memcpy(cells[0], image + MINEFIELD_OFFSET, MINEFIELD_SIZE);
+        reference.scan(&reference, cells[0], &want);
+        reference.render(&reference, cells[0], text[0]);
+        memcpy(cells[1], cells[0], MINEFIELD_SIZE);
+        numWant = reference.flag(&reference, cells[1], flagged[0], (DWORD)maxTiles);
+        qsort(flagged[0], numWant, sizeof(struct parameters_s), CompareLocations);
+        snprintf(size, sizeof(size), "%ux%u", width, height);
+
+        for (int l = 0; l < 3; l++) {
+            unsigned char* pristine = cells[2];
+
+            if (InitGeometry(&geometry, width, height, layouts[l])) goto cleanup;
+            if (geometry.tiled) BuildTiledBoard(&geometry, pristine, 0, 1);
+            else memcpy(pristine, image + MINEFIELD_OFFSET, MINEFIELD_SIZE);
+            CopyBoard(&reference, cells[0], &geometry, pristine);
+
+            // Same answers as the reference, whatever the path
+            geometry.scan(&geometry, pristine, &got);
+            geometry.render(&geometry, pristine, text[1]);
+            {
+                static unsigned char after[MINEFIELD_SIZE];
+                unsigned char* scratch = (unsigned char*)malloc(geometry.cellsSize);
+                int same;
+
+                if (!scratch) goto cleanup;
+                memcpy(scratch, pristine, geometry.cellsSize);
+                numGot = geometry.flag(&geometry, scratch, flagged[1], (DWORD)maxTiles);
+                qsort(flagged[1], numGot, sizeof(struct parameters_s), CompareLocations);
+                memcpy(after, cells[1], MINEFIELD_SIZE);
+                CopyBoard(&geometry, scratch, &reference, after);
+                same = memcmp(after, cells[1], MINEFIELD_SIZE) == 0;
+                free(scratch);
+
+                if (memcmp(&got, &want, sizeof(BoardCounts)) || memcmp(text[0], text[1], reference.renderSize) || \
+                    numGot != numWant || memcmp(flagged[0], flagged[1], numWant*sizeof(struct parameters_s)) || !same) {
+                    printf("%s %s path doesn't match winmine's layout\n", size, geometry.name);
+                    goto cleanup;
+                }
+            }
+
+            checksum += TimeGeometry(&geometry, pristine, cells[1], text[1], flagged[1], boardIterations, rates);
+            printf("%-11s %-13s %14.1f %14.1f %14.1f\n", size, geometry.name, rates[0], rates[1], rates[2]);
+        }
+    }
+    printf("Specialized, runtime and tiled paths agree on every standard board\n");
+
+    for (int b = 0; b < 4; b++) {
+        Geometry geometry;
+        DWORD side = large[b];
+        long boardIterations = iterations*(long)(30*16) / (long)(side*side);
+        char size[16];
+
+        if (boardIterations < 3) boardIterations = 3;
+        if (InitGeometry(&geometry, side, side, GEOMETRY_AUTO) || \
+            BuildTiledBoard(&geometry, cells[0], side*side / 5, b + 1)) goto cleanup;
+        ScatterStates(&geometry, cells[0], b + 1);
+        snprintf(size, sizeof(size), "%ux%u", side, side);
+        checksum += TimeGeometry(&geometry, cells[0], cells[1], text[1], flagged[1], boardIterations, rates);
+        printf("%-11s %-13s %14.1f %14.1f %14.1f\n", size, geometry.name, rates[0], rates[1], rates[2]);
+    }
+    printf("(checksum %d)\n", checksum);
+    status = 0;
+
+cleanup:
+    for (int i = 0; i < 3; i++) free(cells[i]);
+    for (int i = 0; i < 2; i++) {
+        free(text[i]);
+        free(flagged[i]);
+    }
+    return status;
+}
+
+long NaiveFindPattern(const Pattern* pattern, const unsigned char* image, size_t size) {
+/**
+ * Purpose: What FindPattern is measured against: every position, every byte
+ * @param pattern : const Pattern* - what to look for
+ * @param image : const unsigned char* - where to look
+ * @param size : size_t - bytes in image
+ * @return : long - offset of the first match, or -1
+ */
+
+    for (size_t pos = 0; pos + pattern->length <= size; pos++) {
+        size_t i = 0;
+        while (i < pattern->length && (image[pos + i] & pattern->mask[i]) == pattern->bytes[i]) i++;
+        if (i == pattern->length) return (long)pos;
+    }
+
+    return -1;
+}
+
+int LoadModuleFile(const char* path, unsigned char* image, size_t size) {
+/**
+ * Purpose: Reads a module image (a dump of winmine's memory from its base
+ *          address) from a file
+ * @param path : const char* - the file
+ * @param image : unsigned char* - receives the module. Zero filled past the end of the file
+ * @param size : size_t - bytes in image
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    FILE* file = fopen(path, "rb");
+    size_t numRead;
+
+    if (!file) {
+        printf("Unable to open %s\n", path);
+        return 1;
+    }
+    memset(image, 0, size);
+    numRead = fread(image, 1, size, file);
+    fclose(file);
+    if (numRead < SIGNATURE_CODE_SIZE) {
+        printf("%s is too small to be a winmine module (%lu bytes)\n", path, (unsigned long)numRead);
+        return 1;
+    }
+
+    return 0;
+}
+
+int BenchSignature(long iterations, const char* modulePath) {
+/**
+ * Purpose: Writes a fake module with the signatures planted in it to a file,
+ *          loads it back and checks the scan finds the built-in offsets. Then
+ *          checks a build with everything moved, and one with no signatures
+ *          (which has to fall back to the built-in offsets). Times a whole
+ *          scan against checking every position, and attaching with and
+ *          without the cache. Given a module file, scans that instead
+ * @param iterations : long - number of scans to time
+ * @param modulePath : const char* - a module dump to scan, or NULL for the fake ones
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static unsigned char image[MODULE_IMAGE_SIZE];   // Too big for the stack
+    static const char* sources[3] = { "built-in", "scanned", "cached" };
+    const char* moduleFile = "mineBench-module.bin";
+    const char* cacheFile  = "mineBench-offsets.txt";
+    WinmineOffsets moved = builtinOffsets, found;
+    Pattern patterns[8];
+    MemorySource source;
+    unsigned long long start, scanNs, naiveNs, resolveNs[2];
+    long naiveIterations = iterations / 50 + 1;
+    int from[2];
+    long checksum = 0;
+    FILE* file;
+
+    if (modulePath) {
+        if (LoadModuleFile(modulePath, image, MODULE_IMAGE_SIZE)) return 1;
+        if (ScanOffsets(image, SIGNATURE_CODE_SIZE, WINMINE_IMAGE_BASE, &found)) {
+            printf("No usable signatures in %s\n", modulePath);
+            return 1;
+        }
+        printf("%s: flag function 0x%x, mines 0x%x, width 0x%x, height 0x%x, minefield 0x%x, mines left 0x%x\n", \
+               modulePath, found.flagTileFunction, found.numMines, found.width, found.height, found.minefield, \
+               found.minesRemaining);
+        printf("%s the built-in offsets\n", memcmp(&found, &builtinOffsets, sizeof(WinmineOffsets)) ? "Differs from" : "Same as");
+        return 0;
+    }
+
+    // A module on disk, the way a dump of the real thing would be scanned
+    if (BuildBoard(image, 30, 16, 99, 1) || \
+        PlantSignatures(image, SIGNATURE_CODE_SIZE, WINMINE_IMAGE_BASE, &builtinOffsets, 1)) return 1;
+    file = fopen(moduleFile, "wb");
+    if (!file || fwrite(image, MODULE_IMAGE_SIZE, 1, file) != 1) {
+        printf("Unable to write %s\n", moduleFile);
+        if (file) fclose(file);
+        return 1;
+    }
+    fclose(file);
+    if (LoadModuleFile(moduleFile, image, MODULE_IMAGE_SIZE)) return 1;
+    remove(moduleFile);
+    if (ScanOffsets(image, SIGNATURE_CODE_SIZE, WINMINE_IMAGE_BASE, &found) || \
+        memcmp(&found, &builtinOffsets, sizeof(WinmineOffsets))) {
+        printf("Scanning the module file didn't find the built-in offsets\n");
+        return 1;
+    }
+
+    // A build with the data and the flag function somewhere else
+    {
+        static unsigned char other[MODULE_IMAGE_SIZE];
+
+        moved.flagTileFunction = 0x2A10;
+        moved.numMines  += 0x120;
+        moved.width     += 0x120;
+        moved.height    += 0x120;
+        moved.minefield += 0x120;
+        moved.minesRemaining += 0x40;
+        if (PlantSignatures(other, SIGNATURE_CODE_SIZE, WINMINE_IMAGE_BASE, &moved, 7) || \
+            ScanOffsets(other, SIGNATURE_CODE_SIZE, WINMINE_IMAGE_BASE, &found) || \
+            memcmp(&found, &moved, sizeof(WinmineOffsets))) {
+            printf("Scanning a module with moved offsets didn't find them\n");
+            return 1;
+        }
+
+        // Noise and no signatures
+        PlantSignatures(other, SIGNATURE_CODE_SIZE, WINMINE_IMAGE_BASE, &moved, 9);
+        for (int s = 0; s < numWinmineSignatures; s++) {
+            Pattern pattern;
+            long match;
+
+            ParsePattern(winmineSignatures[s].pattern, &pattern);
+            while ((match = FindPattern(&pattern, other, SIGNATURE_CODE_SIZE)) >= 0) other[match + pattern.anchor] ^= 0xFF;
+        }
+        if (!ScanOffsets(other, SIGNATURE_CODE_SIZE, WINMINE_IMAGE_BASE, &found)) {
+            printf("A module without signatures still resolved\n");
+            return 1;
+        }
+    }
+    printf("Found the offsets in a module file, in a build with them moved, and nothing in a build without signatures\n");
+
+    // Every signature, both ways, with the same answers
+    for (int s = 0; s < numWinmineSignatures; s++) {
+        if (ParsePattern(winmineSignatures[s].pattern, &patterns[s])) return 1;
+        if (FindPattern(&patterns[s], image, SIGNATURE_CODE_SIZE) != NaiveFindPattern(&patterns[s], image, SIGNATURE_CODE_SIZE)) {
+            printf("FindPattern and the naive search disagree on the %s\n", winmineSignatures[s].name);
+            return 1;
+        }
+    }
+
+    start = NowNs();
+    for (long i = 0; i < iterations; i++) {
+        for (int s = 0; s < numWinmineSignatures; s++) checksum += FindPattern(&patterns[s], image, SIGNATURE_CODE_SIZE);
+    }
+    scanNs = NowNs() - start;
+    start = NowNs();
+    for (long i = 0; i < naiveIterations; i++) {
+        for (int s = 0; s < numWinmineSignatures; s++) checksum += NaiveFindPattern(&patterns[s], image, SIGNATURE_CODE_SIZE);
+    }
+    naiveNs = NowNs() - start;
+
+    printf("%-28s %12s %12s\n", "search (0x5000 bytes)", "us/scan", "MB/s");
+    printf("%-28s %12.2f %12.0f\n", "vector + Horspool", scanNs / 1000.0 / iterations, \
+           (double)SIGNATURE_CODE_SIZE*numWinmineSignatures*iterations / (double)scanNs*1e3);
+    printf("%-28s %12.2f %12.0f\n", "every position", naiveNs / 1000.0 / naiveIterations, \
+           (double)SIGNATURE_CODE_SIZE*numWinmineSignatures*naiveIterations / (double)naiveNs*1e3);
+
+    // Attaching: the first time scans and fills the cache, the second reads it
+    remove(cacheFile);
+    OpenBufferSource(&source, image, MODULE_IMAGE_SIZE);
+    for (int i = 0; i < 2; i++) {
+        start = NowNs();
+        from[i] = ResolveOffsets(&source, cacheFile, &found);
+        resolveNs[i] = NowNs() - start;
+        if (memcmp(&found, &builtinOffsets, sizeof(WinmineOffsets))) {
+            printf("ResolveOffsets came back with the wrong offsets\n");
+            return 1;
+        }
+        printf("%-28s %12.2f %12s\n", i ? "resolve, second attach" : "resolve, first attach", resolveNs[i] / 1000.0, \
+               sources[from[i]]);
+    }
+    if (from[0] != OFFSETS_SCANNED || from[1] != OFFSETS_CACHED) {
+        printf("Expected a scan and then a cache hit\n");
+        remove(cacheFile);
+        return 1;
+    }
+
+    // A cache line pointing outside the module is turned down, scanned again and replaced
+    moved = builtinOffsets;
+    moved.minefield = moved.numMines = moved.width = moved.height = MODULE_IMAGE_SIZE;
+    remove(cacheFile);
+    SaveCachedOffsets(cacheFile, HashModule(image, SIGNATURE_CODE_SIZE), &moved);
+    from[0] = ResolveOffsets(&source, cacheFile, &found);
+    from[1] = ResolveOffsets(&source, cacheFile, &found);
+    remove(cacheFile);
+    if (from[0] != OFFSETS_SCANNED || from[1] != OFFSETS_CACHED || memcmp(&found, &builtinOffsets, sizeof(WinmineOffsets))) {
+        printf("A bad cache line wasn't scanned again and replaced\n");
+        return 1;
+    }
+    printf("A bad cache line was scanned again and replaced\n");
+
+    // With PE headers the key is the build's, whatever the loader did to the imports
+    {
+        DWORD peHeader = 0x80, timestamp = 0x3B7D8410;
+        uint64_t key[3];
+
+        memset(image, 0, PE_HEADERS);
+        image[0] = 'M';
+        image[1] = 'Z';
+        memcpy(image + 0x3C, &peHeader, sizeof(DWORD));
+        memcpy(image + peHeader, "PE\0\0", 4);
+        memcpy(image + peHeader + 8, &timestamp, sizeof(DWORD));
+        key[0] = HashModule(image, SIGNATURE_CODE_SIZE);
+        image[0x1000] ^= 0xFF;
+        key[1] = HashModule(image, SIGNATURE_CODE_SIZE);
+        image[peHeader + 8] ^= 1;
+        key[2] = HashModule(image, SIGNATURE_CODE_SIZE);
+        if (key[0] != key[1] || key[0] == key[2]) {
+            printf("The module key should follow the PE timestamp and nothing past the headers\n");
+            return 1;
+        }
+    }
+    printf("(checksum %ld)\n", checksum);
+
+    return 0;
+}
+
+int SnapshotRounds(Instance* instance, void* context) {
+/**
+ * Purpose: Instance action for BenchInstances. Reads the game's snapshot
+ *          over and over
+ * @param instance : Instance* - the game
+ * @param context : long* - how many snapshots to take
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    long rounds = *(long*)context;
+
+    for (long i = 0; i < rounds; i++) {
+        if (TakeSnapshot(&instance->session.source, &instance->snapshot)) return 1;
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+pid_t StartStandIn(const char* standIn, DWORD width, DWORD height, DWORD numMines, unsigned int seed) {
+/**
+ * Purpose: Starts a stand-in in the background. Its chatter goes nowhere
+ * @param standIn : const char* - path to winmineStandIn
+ * @param width : DWORD - width of its board
+ * @param height : DWORD - height of its board
+ * @param numMines : DWORD - mines on its board
+ * @param seed : unsigned int - seed for its board
+ * @return : pid_t - the stand-in's PID, or -1 on failure
+ */
+
+    char arguments[4][16];
+    pid_t child;
+
+    snprintf(arguments[0], sizeof(arguments[0]), "%u", width);
+    snprintf(arguments[1], sizeof(arguments[1]), "%u", height);
+    snprintf(arguments[2], sizeof(arguments[2]), "%u", numMines);
+    snprintf(arguments[3], sizeof(arguments[3]), "%u", seed);
+
+    child = fork();
+    if (child < 0) {
+        perror("Error starting a stand-in");
+        return -1;
+    }
+    if (!child) {
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) dup2(devNull, 1);
+        execl(standIn, standIn, arguments[0], arguments[1], arguments[2], arguments[3], (char*)NULL);
+        _exit(127);
+    }
+
+    return child;
+}
+#endif
+
+int CheckDirectFlag(const Snapshot* before, const unsigned char* after, DWORD remaining) {
+/**
+ * Purpose: Checks a direct flag did exactly its job: every covered or
+ *          question marked mine is flagged, nothing else moved, and the
+ *          counter is the mine count less every flag (wrong ones too)
+ * @param before : const Snapshot* - the game before
+ * @param after : const unsigned char* - the minefield after
+ * @param remaining : DWORD - the mines remaining counter after
+ * @return : int - 0 if it's right, 1 otherwise
+ */
+
+    const unsigned char* field = SNAPSHOT_FIELD(before);
+    DWORD flags = 0;
+
+    for (int i = 0; i < MINEFIELD_SIZE; i++) {
+        DWORD x = (DWORD)i % ROW_STRIDE, y = (DWORD)i / ROW_STRIDE;
+        int onBoard = x >= 1 && x <= before->width && y >= 1 && y <= before->height;
+        int shouldFlag = onBoard && (field[i] == (MINE | UNCLICKED_SPACE) || field[i] == (MINE | QUESTION_MARK));
+
+        if (after[i] != (shouldFlag ? (MINE | FLAG) : field[i])) return 1;
+        flags += onBoard && (after[i] & 0x0F) == FLAG && !(after[i] & REVEALED_TILE);
+    }
+
+    return remaining != before->numMines - flags;
+}
+
+int BenchDirectFlag(long iterations, const char* standIn) {
+/**
+ * Purpose: Direct-write flagging. Against the buffer backend, played boards
+ *          of each size are flagged with different gaps allowed inside a
+ *          range, every result checked, and the writes, bytes and time per
+ *          board reported next to what the remote thread path writes. Then
+ *          one stand-in per size is flagged through process_vm_writev, all
+ *          the ranges in one call and then one call per range
+ * @param iterations : long - boards flagged per case
+ * @param standIn : const char* - path to winmineStandIn
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static struct suiteBoard_s boards[SUITE_BOARDS];   // Too big for the stack
+    static DirectFlagPlan plan;
+    static Snapshot snapshot;
+    const DWORD sizes[3][3] = { { 9, 9, 10 }, { 16, 16, 40 }, { 30, 16, 99 } };
+    const DWORD gaps[4] = { 0, 8, DIRECT_FLAG_GAP, MINEFIELD_SIZE };
+    int status = 1;
+
+    printf("%-8s %-14s %9s %9s %9s %10s\n", "size", "path", "ranges", "writes", "bytes", "ns/board");
+    for (int size = 0; size < 3; size++) {
+        char name[16];
+        double questions = 0.0, unflagged = 0.0;
+
+        snprintf(name, sizeof(name), "%ux%u", sizes[size][0], sizes[size][1]);
+        for (int b = 0; b < SUITE_BOARDS; b++) {
+            struct suiteBoard_s* board = &boards[b];
+            unsigned char* field = board->pristine + MINEFIELD_OFFSET;
+            Bitboard bitboard;
+            DWORD flagged;
+
+            board->width    = sizes[size][0];
+            board->height   = sizes[size][1];
+            board->numMines = sizes[size][2];
+            if (BuildBoard(board->pristine, board->width, board->height, board->numMines, 7000u*(unsigned)size + (unsigned)b)) return 1;
+            OpenFirstZero(field, board->width, board->height);
+            flagged = MarkMines(field, board->width, board->height, (unsigned int)b);
+
+            // And one flag in the wrong place
+            for (DWORD i = board->width; i < board->width*board->height; i++) {
+                unsigned char* tile = field + (i % board->width + 1) + (i / board->width + 1)*ROW_STRIDE;
+                if (*tile != UNCLICKED_SPACE) continue;
+                *tile = FLAG;
+                flagged++;
+                break;
+            }
+            flagged = board->numMines - flagged;
+            memcpy(board->pristine + MINES_REMAINING_OFFSET, &flagged, sizeof(DWORD));
+            memcpy(board->image, board->pristine, MODULE_IMAGE_SIZE);
+            OpenBufferSource(&board->source, board->image, MODULE_IMAGE_SIZE);
+
+            // What the remote thread path would send
+            PackBitboard(field, board->height, board->width, &bitboard);
+            for (DWORD y = 1; y <= board->height; y++) {
+                questions += POPCOUNT32(bitboard.question[y] & bitboard.mine[y]);
+                unflagged += POPCOUNT32(bitboard.mine[y] & ~bitboard.flagged[y]);
+            }
+        }
+        questions /= SUITE_BOARDS;
+        unflagged /= SUITE_BOARDS;
+        printf("%-8s %-14s %9s %9.1f %9.1f %10s  (+ alloc, thread, wait, free)\n", name, "remote thread", "-", \
+               questions + 1.0, questions + FlagBatchSize(0) + unflagged*sizeof(struct parameters_s), "-");
+
+        for (int g = 0; g < 4; g++) {
+            unsigned long long ranges = 0, writes = 0, bytes = 0, busyNs = 0;
+            char path[16];
+
+            for (long i = 0; i < iterations; i++) {
+                struct suiteBoard_s* board = &boards[i % SUITE_BOARDS];
+                unsigned long long start, writesBefore = board->source.numWrites, bytesBefore = board->source.bytesWritten;
+                DWORD remaining;
+
+                memcpy(board->image + MINEFIELD_OFFSET, board->pristine + MINEFIELD_OFFSET, MINEFIELD_SIZE);
+                memcpy(board->image + MINES_REMAINING_OFFSET, board->pristine + MINES_REMAINING_OFFSET, sizeof(DWORD));
+
+                start = NowNs();
+                if (TakeSnapshot(&board->source, &snapshot) || PlanDirectFlag(&snapshot, &builtinOffsets, gaps[g], &plan) || \
+                    ApplyDirectFlag(&board->source, &plan)) return 1;
+                busyNs += NowNs() - start;
+
+                memcpy(&remaining, board->image + MINES_REMAINING_OFFSET, sizeof(DWORD));
+                if (CheckDirectFlag(&snapshot, board->image + MINEFIELD_OFFSET, remaining)) {
+                    printf("Direct flag with a gap of %u left board %ld wrong\n", gaps[g], i % SUITE_BOARDS);
+                    return 1;
+                }
+                ranges += (unsigned long long)plan.numRanges;
+                writes += board->source.numWrites - writesBefore;
+                bytes  += board->source.bytesWritten - bytesBefore;
+            }
+            snprintf(path, sizeof(path), "gap %u", gaps[g]);
+            printf("%-8s %-14s %9.1f %9.1f %9.1f %10.1f\n", name, path, (double)ranges / iterations, \
+                   (double)writes / iterations, (double)bytes / iterations, (double)busyNs / iterations);
+        }
+    }
+    printf("Every direct flag left the right field and counter behind\n");
+
+    // A build with the block somewhere else: the board at the built-in
+    // offsets is a different game, and has to be left alone
+    {
+        static unsigned char moved[MODULE_IMAGE_SIZE];
+        WinmineOffsets offsets = builtinOffsets;
+        MemorySource source;
+        DWORD remaining;
+
+        offsets.numMines  += 0x120;
+        offsets.width     += 0x120;
+        offsets.height    += 0x120;
+        offsets.minefield += 0x120;
+        offsets.minesRemaining += 0x40;
+        memcpy(moved, boards[1].pristine, MODULE_IMAGE_SIZE);
+        memcpy(moved + offsets.numMines, boards[0].pristine + SNAPSHOT_OFFSET, SNAPSHOT_SIZE);
+        memcpy(moved + offsets.minesRemaining, boards[0].pristine + MINES_REMAINING_OFFSET, sizeof(DWORD));
+        memcpy(boards[1].image, moved, MODULE_IMAGE_SIZE);
+        OpenBufferSource(&source, moved, MODULE_IMAGE_SIZE);
+        if (DirectFlagAllMines(&source, &offsets, &snapshot, &plan)) return 1;
+        memcpy(&remaining, moved + offsets.minesRemaining, sizeof(DWORD));
+        if (CheckDirectFlag(&snapshot, moved + offsets.minefield, remaining) || \
+            memcmp(moved + SNAPSHOT_OFFSET, boards[1].image + SNAPSHOT_OFFSET, offsets.numMines - SNAPSHOT_OFFSET)) {
+            printf("Direct flag didn't follow a build with the minefield moved\n");
+            return 1;
+        }
+    }
+    printf("Direct flag followed a build with the minefield moved\n\n");
+
+#ifdef _WIN32
+    (void)standIn;
+    printf("Starting stand-ins is only supported on Linux\n");
+    status = 0;
+#else
+    {
+        static InstanceSet games;
+        pid_t children[3] = { -1, -1, -1 };
+        long rounds = iterations / 10 + 1;
+
+        InitInstanceSet(&games, "winmine.exe");
+        for (int size = 0; size < 3; size++) {
+            children[size] = StartStandIn(standIn, sizes[size][0], sizes[size][1], sizes[size][2], (unsigned int)size + 1);
+            if (children[size] < 0) goto cleanup;
+        }
+        for (int tries = 0; FindInstances(&games) < 3; tries++) {
+            if (tries == 500) {
+                printf("Only found %d of 3 stand-ins. Is %s the stand-in?\n", games.numInstances, standIn);
+                goto cleanup;
+            }
+            SleepMs(10);
+        }
+
+        printf("%-8s %-28s %7s %7s %7s %10s\n", "size", "process_vm_writev", "ranges", "writes", "bytes", "us/board");
+        for (int i = 0; i < games.numInstances; i++) {
+            Session* session = &games.instances[i].session;
+            MemorySource* source = &session->source;
+            unsigned char played[MINEFIELD_SIZE];
+            DWORD playedRemaining, remaining;
+            char name[16];
+
+            // Play a little: an opening, some marks and the counter to match
+            if (TakeSnapshot(source, &snapshot)) goto cleanup;
+            memcpy(played, SNAPSHOT_FIELD(&snapshot), MINEFIELD_SIZE);
+            OpenFirstZero(played, snapshot.width, snapshot.height);
+            playedRemaining = snapshot.numMines - MarkMines(played, snapshot.width, snapshot.height, (unsigned int)i);
+            snprintf(name, sizeof(name), "%ux%u", snapshot.width, snapshot.height);
+
+            for (int batched = 1; batched >= 0; batched--) {
+                int (*writeRanges)(MemorySource*, const WriteRange*, int) = source->writeRanges;
+                unsigned long long busyNs = 0, writes = 0, bytes = 0;
+
+                if (!batched) source->writeRanges = NULL;
+                for (long round = 0; round < rounds; round++) {
+                    unsigned long long start, writesBefore, bytesBefore;
+
+                    if (WriteSource(source, session->offsets.minefield, played, MINEFIELD_SIZE) || \
+                        WriteSource(source, session->offsets.minesRemaining, &playedRemaining, sizeof(DWORD))) goto cleanup;
+                    writesBefore = source->numWrites;
+                    bytesBefore  = source->bytesWritten;
+
+                    start = NowNs();
+                    if (DirectFlagAllMines(source, &session->offsets, &snapshot, &plan)) goto cleanup;
+                    busyNs += NowNs() - start;
+                    writes += source->numWrites - writesBefore;
+                    bytes  += source->bytesWritten - bytesBefore;
+
+                    // Read it back out of the other process
+                    {
+                        Snapshot after;
+                        if (TakeSnapshot(source, &after) || \
+                            ReadSource(source, session->offsets.minesRemaining, &remaining, sizeof(DWORD))) goto cleanup;
+                        if (CheckDirectFlag(&snapshot, SNAPSHOT_FIELD(&after), remaining)) {
+                            printf("Stand-in %u was left wrong\n", session->PID);
+                            goto cleanup;
+                        }
+                    }
+                }
+                source->writeRanges = writeRanges;
+                printf("%-8s %-28s %7d %7.1f %7.1f %10.2f\n", name, batched ? "one call for every range" : "one call per range", \
+                       plan.numRanges, (double)writes / rounds, (double)bytes / rounds, busyNs / 1000.0 / rounds);
+            }
+        }
+        printf("Every stand-in read back with the right field and counter\n");
+        status = 0;
+
+cleanup:
+        CloseInstances(&games);
+        for (int i = 0; i < 3; i++) {
+            if (children[i] <= 0) continue;
+            kill(children[i], SIGTERM);
+            waitpid(children[i], NULL, 0);
+        }
+    }
+#endif
+
+    return status;
+}
+
+#ifndef _WIN32
+int WaitForClicks(AutoplayTarget* target) {
+/**
+ * Purpose: Waits for a stand-in to click everything it's been sent
+ * @param target : AutoplayTarget* - the stand-in
+ * @return : int - 0 once it has, 1 if it stopped clicking
+ */
+
+    DWORD sequence, clicked;
+
+    for (int tries = 0; tries < 2000; tries++) {
+        if (target->progress(target, &sequence, &clicked)) return 1;
+        if (!(sequence & 1) && clicked == target->sent) return 0;
+        SleepMs(1);
+    }
+    printf("The stand-in stopped taking clicks\n");
+    return 1;
+}
+
+int CheckQuestionClick(AutoplayTarget* target) {
+/**
+ * Purpose: Clicks question marks on a stand-in the way winmine takes them:
+ *          one over a safe tile opens, one over a mine goes off
+ * @param target : AutoplayTarget* - the stand-in
+ * @return : int - 0 if both did, 1 if not
+ */
+
+    unsigned char field[MINEFIELD_SIZE];
+    unsigned short tile;
+    unsigned char question;
+    Snapshot snapshot;
+
+    for (int mine = 0; mine <= 1; mine++) {
+        // The safe one comes first so the mine isn't moved out from under a first click
+        if ((!mine && target->newGame(target, 77)) || WaitForClicks(target) || TakeSnapshot(target->source, &snapshot)) return 1;
+        memcpy(field, SNAPSHOT_FIELD(&snapshot), MINEFIELD_SIZE);
+        for (tile = ROW_STRIDE + 1; tile < MINEFIELD_SIZE; tile++) {
+            if ((field[tile] & 0x0F) == UNCLICKED_SPACE && !!(field[tile] & MINE) == mine) break;
+        }
+        if (tile == MINEFIELD_SIZE) return 1;
+        question = (unsigned char)((field[tile] & MINE) | QUESTION_MARK);
+        if (WriteSource(target->source, MINEFIELD_OFFSET + tile, &question, 1) || target->click(target, &tile, 1)) return 1;
+        target->sent++;
+        if (WaitForClicks(target) || ReadSource(target->source, MINEFIELD_OFFSET + tile, &question, 1)) return 1;
+        if (mine ? question != EXPLODED_MINE : !(question & REVEALED_TILE)) {
+            printf("A question mark over %s was left at 0x%02x after a click\n", mine ? "a mine" : "a safe tile", question);
+            return 1;
+        }
+    }
+    printf("Question marks open like any covered tile\n");
+    return 0;
+}
+#endif
+
+int BenchAutoplay(long games, const char* standIn) {
+/**
+ * Purpose: Closed loop autoplay against a stand-in expert game, which clicks
+ *          with winmine's reveal cascade. The same boards are played one
+ *          click per read, batched and pipelined. Reports how many were
+ *          won, what each game cost in batches, boards, reads and writes,
+ *          the time to finish a board and moves per second. Every mode has
+ *          to win and lose the same games
+ * @param games : long - boards to play with each mode
+ * @param standIn : const char* - path to winmineStandIn
+ * @return : int - 0 on success, 1 on failure
+ */
+
+#ifdef _WIN32
+    (void)games;
+    (void)standIn;
+    printf("Starting stand-ins is only supported on Linux\n");
+    return 1;
+#else
+    static InstanceSet found;
+    static ThreadPool pool;
+    const char* modes[3] = { "one click per read", "batched", "pipelined" };
+    AutoplayTarget target;
+    AutoplayConfig config;
+    AutoplayStats stats;
+    unsigned char* outcomes = NULL;   // Each game's result under each mode
+    int poolStarted = 0;
+    int status = 1;
+    pid_t child;
+
+    if (games < 1) games = 200;
+    InitInstanceSet(&found, "winmine.exe");
+    child = StartStandIn(standIn, 30, 16, 99, 1);
+    if (child < 0) return 1;
+    for (int tries = 0; FindInstances(&found) < 1; tries++) {
+        if (tries == 500) {
+            printf("Couldn't find the stand-in. Is %s the stand-in?\n", standIn);
+            goto cleanup;
+        }
+        SleepMs(10);
+    }
+    outcomes = (unsigned char*)calloc((size_t)games, 3);
+    if (!outcomes || OpenAutoplayTarget(&target, &found.instances[0].session)) goto cleanup;
+    if (CheckQuestionClick(&target)) goto cleanup;
+    poolStarted = !StartThreadPool(&pool, 2);
+    if (!poolStarted) goto cleanup;
+    InitAutoplayConfig(&config);
+
+    printf("%ld expert boards per mode through the %s, %d core(s)\n", games, target.name, CountCores());
+    printf("%-20s %6s %8s %8s %8s %8s %8s %9s %9s %9s\n", "mode", "won", "moves", "batches", "boards", "reads", \
+           "writes", "ms/game", "ms/win", "moves/s");
+    for (int mode = AUTOPLAY_SINGLE; mode <= AUTOPLAY_PIPELINED; mode++) {
+        unsigned long long moves = 0, batches = 0, boards = 0, reads = 0, writes = 0, wallNs = 0, winNs = 0;
+        unsigned long long readNs = 0, solveNs = 0, clickNs = 0;
+        long won = 0;
+
+        config.mode = mode;
+        for (long g = 0; g < games; g++) {
+            config.seed = (unsigned int)g + 1;
+            if (target.newGame(&target, 1000u + (unsigned int)g) || AutoplayGame(&pool, &target, &config, &stats)) {
+                printf("Board %ld didn't finish %s\n", g, modes[mode]);
+                PrintAutoplayStats(&stats);
+                goto cleanup;
+            }
+            outcomes[g*3 + mode] = (unsigned char)stats.result;
+            won     += stats.result == GAME_WON;
+            moves   += stats.moves;
+            batches += stats.batches;
+            boards  += stats.boards;
+            reads   += stats.reads;
+            writes  += stats.writes;
+            wallNs  += stats.wallNs;
+            readNs  += stats.readNs;
+            solveNs += stats.solveNs;
+            clickNs += stats.clickNs;
+            if (stats.result == GAME_WON) winNs += stats.wallNs;
+        }
+        printf("%-20s %6ld %8.1f %8.1f %8.1f %8.1f %8.1f %9.3f %9.3f %9.0f\n", modes[mode], won, (double)moves / games, \
+               (double)batches / games, (double)boards / games, (double)reads / games, (double)writes / games, \
+               wallNs / 1e6 / games, won ? winNs / 1e6 / won : 0.0, moves / ((double)wallNs / 1e9));
+        printf("%-20s busy reading %.3f ms, solving %.3f ms, clicking %.3f ms per game\n", "", readNs / 1e6 / games, \
+               solveNs / 1e6 / games, clickNs / 1e6 / games);
+    }
+
+    for (long g = 0; g < games; g++) {
+        if (outcomes[g*3] == outcomes[g*3 + 1] && outcomes[g*3] == outcomes[g*3 + 2]) continue;
+        printf("Board %ld ended differently: %d, %d and %d\n", g, outcomes[g*3], outcomes[g*3 + 1], outcomes[g*3 + 2]);
+        goto cleanup;
+    }
+    printf("Every mode won and lost the same boards\n");
+    status = 0;
+
+cleanup:
+    if (poolStarted) StopThreadPool(&pool);
+    free(outcomes);
+    CloseInstances(&found);
+    kill(child, SIGTERM);
+    waitpid(child, NULL, 0);
+    return status;
+#endif
+}
+
+int BenchIncremental(long games) {
+/**
+ * Purpose: Plays expert games one click at a time and brings the
+ *          incremental solver up to each new board, timing it against
+ *          SolveVisible starting over on the same board. Clicks are split
+ *          by how many tiles they opened, so single tiles and big cascades
+ *          can be compared. A second solver validates every update against
+ *          SolveVisible, and the timed one has to match it too. Clicks are
+ *          proven safe tiles when there are any, otherwise a safe tile
+ *          found by peeking at the hidden mines
+ * @param games : long - number of games to play
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static unsigned char image[MODULE_IMAGE_SIZE];
+    static IncrementalSolver timed;
+    static IncrementalSolver checked;
+    static SolverResult full;
+    const char* names[3] = { "single tile", "2-15 tiles", "cascade 16+" };
+    unsigned long long count[3] = { 0 }, incrementalNs[3] = { 0 }, fullNs[3] = { 0 }, evaluated[3] = { 0 };
+    unsigned char kinds[KIND_GRID_SIZE];
+    unsigned char* field = image + MINEFIELD_OFFSET;
+    unsigned int pickState = 1;
+    unsigned long long start;
+    Bitboard board;
+    long won = 0;
+
+    if (games < 1) games = 200;
+    for (long g = 0; g < games; g++) {
+        int opened = 0;   // Tiles the last click opened. 0 for a new game
+
+        if (BuildBoard(image, 30, 16, 99, (unsigned int)g + 1)) return 1;
+        InitIncrementalSolver(&timed, 0);
+        InitIncrementalSolver(&checked, 1);
+
+        for (;;) {
+            DWORD pick, hidden = 0;
+            int bucket = opened <= 1 ? 0 : opened < 16 ? 1 : 2;
+
+            DecodeField(field, 16, kinds);
+            for (DWORD i = 0; i < KIND_GRID_SIZE; i++) kinds[i] &= TILE_VISIBLE_MASK;
+
+            start = NowNs();
+            if (UpdateIncremental(&timed, kinds, 16, 30)) {
+                printf("Game %ld: the incremental solver found a contradiction on a real board\n", g + 1);
+                return 1;
+            }
+            if (opened) {
+                incrementalNs[bucket] += NowNs() - start;
+                evaluated[bucket] += timed.evaluated;
+            }
+            start = NowNs();
+            SolveVisible(kinds, 16, 30, &full);
+            if (opened) {
+                fullNs[bucket] += NowNs() - start;
+                count[bucket]++;
+            }
+            if (UpdateIncremental(&checked, kinds, 16, 30) || \
+                memcmp(timed.result.safe, full.safe, sizeof(full.safe)) || \
+                memcmp(timed.result.mines, full.mines, sizeof(full.mines))) {
+                printf("Game %ld: the incremental solver and SolveVisible disagree\n", g + 1);
+                return 1;
+            }
+
+            PackBitboard(field, 16, 30, &board);
+            if (GameState(&board) != GAME_IN_PROGRESS) break;
+
+            // A proven safe tile, or a peek. Only one click per update either way
+            pick = 0;
+            for (DWORD y = 1; y <= 16 && !pick; y++) {
+                if (timed.result.safe[y]) pick = (DWORD)CTZ32(timed.result.safe[y]) + y*ROW_STRIDE;
+            }
+            if (!pick) {
+                for (DWORD y = 1; y <= 16; y++) hidden += (DWORD)POPCOUNT32(board.playable[y] & ~board.mine[y] & ~board.revealed[y]);
+                hidden = NextRandom(&pickState) % hidden;
+                for (DWORD y = 1; y <= 16 && !pick; y++) {
+                    for (uint32_t safe = board.playable[y] & ~board.mine[y] & ~board.revealed[y]; safe; safe &= safe - 1) {
+                        if (hidden-- == 0) {
+                            pick = (DWORD)CTZ32(safe) + y*ROW_STRIDE;
+                            break;
+                        }
+                    }
+                }
+            }
+            opened = RevealTile(field, 30, 16, pick % ROW_STRIDE, pick / ROW_STRIDE);
+            if (opened < 1) {
+                printf("Game %ld: clicking %u,%u opened nothing\n", g + 1, pick % ROW_STRIDE, pick / ROW_STRIDE);
+                return 1;
+            }
+        }
+        won += GameState(&board) == GAME_WON;
+    }
+
+    printf("incremental: %ld expert games played one click at a time, %ld won, every update matched SolveVisible\n", \
+           games, won);
+    printf("%-14s %8s %14s %14s %8s %12s\n", "click opened", "clicks", "incremental ns", "recompute ns", "speedup", \
+           "numbers seen");
+    for (int b = 0; b < 3; b++) {
+        if (!count[b]) continue;
+        printf("%-14s %8llu %14.0f %14.0f %7.1fx %12.1f\n", names[b], count[b], (double)incrementalNs[b] / count[b], \
+               (double)fullNs[b] / count[b], (double)fullNs[b] / (double)incrementalNs[b], \
+               (double)evaluated[b] / count[b]);
+    }
+
+    return 0;
+}
+
+#ifndef _WIN32
+struct feedReader_s {
+    unsigned long long reads;        // Views begun
+    unsigned long long torn;         // Of those, thrown away by the seqlock
+    unsigned long long boards;       // Boards read and kept
+    unsigned long long undetected;   // Kept boards that were torn anyway. Has to be 0
+    unsigned long long ns;           // Time spent reading
+};
+
+static void ReadFeed(const char* name, unsigned long long durationNs, int out) {
+/**
+ * Purpose: One reader of the feed stress test, run in its own process.
+ *          Checks every board in place against the pattern the publisher
+ *          writes (every window byte and the mine count come from the
+ *          board's number) and sends its counts back when time's up
+ * @param name : const char* - the feed's name
+ * @param durationNs : unsigned long long - how long to read for
+ * @param out : int - pipe to write the counts to
+ * @return : void
+ */
+
+    struct feedReader_s counts = { 0 };
+    BoardFeed feed;
+    BoardView view;
+    unsigned long long start;
+
+    if (OpenBoardFeed(&feed, name)) _exit(1);
+    start = NowNs();
+    while ((counts.ns = NowNs() - start) < durationNs) {
+        unsigned char expected;
+        int whole = 1;
+
+        if (BeginBoardView(&feed, &view)) continue;
+        expected = (unsigned char)view.sequence;
+        if (view.slot->numMines != (DWORD)view.sequence) whole = 0;
+        for (DWORD i = 0; i < SNAPSHOT_SIZE; i++) whole &= view.slot->window[i] == expected;
+        if (!BoardViewValid(&feed, &view)) continue;
+
+        counts.boards++;
+        counts.undetected += !whole;
+    }
+
+    counts.reads = feed.reads;
+    counts.torn  = feed.torn;
+    CloseBoardFeed(&feed);
+    if (write(out, &counts, sizeof(counts)) != (ssize_t)sizeof(counts)) _exit(1);
+    _exit(0);
+}
+#endif
+
+#ifndef _WIN32
+int CheckPublisherTakeover(const char* name) {
+/**
+ * Purpose: A publisher can take over a feed whose publisher is gone, but
+ *          not one whose publisher is still running
+ * @param name : const char* - a feed name nobody is using
+ * @return : int - 0 if both went the way they should, 1 if not
+ */
+
+    static BoardPublisher first, second;
+    pid_t gone = fork();
+    int status;
+
+    if (gone < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (!gone) _exit(0);
+    waitpid(gone, NULL, 0);
+    if (OpenBoardPublisher(&first, name)) return 1;
+    if (!OpenBoardPublisher(&second, name)) {
+        printf("A second publisher took over a live feed\n");
+        CloseBoardPublisher(&second);
+        CloseBoardPublisher(&first);
+        return 1;
+    }
+
+    // Leave it the way a crash would: still named, mapped by nobody, owned by a dead PID
+    first.shared->publisherPid = (DWORD)gone;
+    munmap(first.shared, sizeof(SharedBoard));
+    close(first.fd);
+    if (OpenBoardPublisher(&second, name)) {
+        printf("A dead publisher's feed couldn't be taken over\n");
+        shm_unlink(name);
+        return 1;
+    }
+    status = second.shared->publisherPid != (DWORD)getpid();
+    CloseBoardPublisher(&second);
+    if (!status) printf("A live publisher's feed was left alone and a dead one's taken over\n");
+    return status;
+}
+#endif
+
+int BenchFeed(long seconds, int readers) {
+/**
+ * Purpose: Stress test for the shared board feed. A publisher writes
+ *          boards into the ring as fast as it can while that many reader
+ *          processes read them in place through the client library. Every
+ *          board a reader keeps is checked against what the publisher wrote.
+ *          Reports boards published and read per second, the torn read
+ *          rate the seqlock caught, and fails if a torn board got past it
+ * @param seconds : long - how long the readers read for
+ * @param readers : int - number of reader processes
+ * @return : int - 0 on success, 1 on failure
+ */
+
+#ifdef _WIN32
+    (void)seconds;
+    (void)readers;
+    printf("The feed stress test is only supported on Linux\n");
+    return 1;
+#else
+    static BoardPublisher publisher;
+    static Snapshot board;
+    struct feedReader_s total = { 0 };
+    char name[64];
+    int results[2];
+    int running = 0;
+    int status = 0;
+    unsigned long long start, publishNs;
+
+    if (seconds < 1) seconds = 2;
+    if (readers < 1) readers = 8;
+    snprintf(name, sizeof(name), "/minesweeperHelperBench%d", (int)getpid());
+    if (CheckPublisherTakeover(name)) return 1;
+    if (OpenBoardPublisher(&publisher, name)) return 1;
+    if (pipe(results)) {
+        perror("pipe");
+        CloseBoardPublisher(&publisher);
+        return 1;
+    }
+    board.height = 16;
+    board.width  = 30;
+
+    for (int r = 0; r < readers; r++) {
+        pid_t child = fork();
+        if (child < 0) {
+            perror("fork");
+            status = 1;
+            break;
+        }
+        if (!child) {
+            close(results[0]);
+            ReadFeed(name, (unsigned long long)seconds * 1000000000ull, results[1]);
+        }
+        running++;
+    }
+    close(results[1]);
+
+    // Publish until every reader is done
+    start = NowNs();
+    while (running) {
+        for (int i = 0; i < 256; i++) {
+            unsigned long long number = publisher.published + 1;
+            memset(board.window, (unsigned char)number, SNAPSHOT_SIZE);
+            board.numMines = (DWORD)number;
+            PublishSnapshot(&publisher, &board, NowNs());
+        }
+        while (running && waitpid(-1, NULL, WNOHANG) > 0) running--;
+    }
+    publishNs = NowNs() - start;
+
+    for (int r = 0; r < readers; r++) {
+        struct feedReader_s counts;
+        if (read(results[0], &counts, sizeof(counts)) != (ssize_t)sizeof(counts)) {
+            printf("Reader %d didn't report back\n", r);
+            status = 1;
+            continue;
+        }
+        total.reads      += counts.reads;
+        total.torn       += counts.torn;
+        total.boards     += counts.boards;
+        total.undetected += counts.undetected;
+        total.ns         += counts.ns;
+    }
+    close(results[0]);
+    CloseBoardPublisher(&publisher);
+
+    printf("feed: %d readers for %ld s against one publisher, %d core(s), %d slots\n", readers, seconds, CountCores(), \
+           BOARD_FEED_SLOTS);
+    printf("  published %llu boards, %.0f boards/s\n", publisher.published, publisher.published * 1e9 / publishNs);
+    printf("  read %llu boards, %.0f boards/s in all, %.0f per reader\n", total.boards, \
+           total.boards * 1e9 / ((double)total.ns / readers), total.boards * 1e9 / (double)total.ns);
+    printf("  torn reads caught: %llu of %llu (%.4f%%)\n", total.torn, total.reads, \
+           total.reads ? total.torn * 100.0 / total.reads : 0.0);
+    printf("  torn boards that got through: %llu\n", total.undetected);
+    return status || total.undetected || !total.boards;
+#endif
+}
+
+int BenchInstances(long rounds, int count, const char* standIn) {
+/**
+ * Purpose: Starts count stand-ins, finds and attaches to all of them the way
+ *          option a does, then reads 1, 2, 4... of them at once through
+ *          process_vm_readv on a pool bounded like option a's. Reports how
+ *          throughput grows with the number of games and the merged report
+ * @param rounds : long - snapshots to take of each game per run
+ * @param count : int - number of stand-ins to start
+ * @param standIn : const char* - path to winmineStandIn
+ * @return : int - 0 on success, 1 on failure
+ */
+
+#ifdef _WIN32
+    (void)rounds;
+    (void)count;
+    (void)standIn;
+    printf("Starting stand-ins is only supported on Linux\n");
+    return 1;
+#else
+    static InstanceSet games;
+    static ThreadPool pool;
+    pid_t children[MAX_INSTANCES];
+    InstanceReport report;
+    double oneGame = 0.0;
+    int status = 1;
+    int started = 0;
+
+    if (count < 1 || count > MAX_INSTANCES) count = 8;
+    InitInstanceSet(&games, "winmine.exe");
+
+    // Each stand-in gets its own board
+    for (; started < count; started++) {
+        children[started] = StartStandIn(standIn, 30, 16, 99, (unsigned int)started + 1);
+        if (children[started] < 0) goto cleanup;
+    }
+
+    // They only take the name winmine.exe once their module is mapped
+    for (int tries = 0; FindInstances(&games) < count; tries++) {
+        if (tries == 500) {
+            printf("Only found %d of %d stand-ins. Is %s the stand-in?\n", games.numInstances, count, standIn);
+            goto cleanup;
+        }
+        SleepMs(10);
+    }
+    printf("Attached to %d games\n", games.numInstances);
+
+    printf("games  workers  snapshots/s  per game/s   MB/s  wall ms  work ms\n");
+    for (int n = 1; ; n = n*2 < count ? n*2 : count) {
+        int workers = n < INSTANCE_WORKERS ? n : INSTANCE_WORKERS;
+        double rate;
+
+        if (StartThreadPool(&pool, workers)) goto cleanup;
+        RunOnInstances(&pool, &games, n, SnapshotRounds, &rounds, &report);
+        StopThreadPool(&pool);
+        if (report.numFailed) {
+            printf("%d of %d games couldn't be read\n", report.numFailed, n);
+            goto cleanup;
+        }
+
+        rate = (double)rounds*n / ((double)report.wallNs / 1e9);
+        if (n == 1) oneGame = rate;
+        printf("%5d %8d %12.0f %11.0f %6.1f %8.2f %8.2f  (%.2fx one game)\n", n, workers, rate, rate / n, \
+               (double)report.bytesRead / ((double)report.wallNs / 1e9) / 1e6, report.wallNs / 1e6, \
+               report.busyNs / 1e6, rate / oneGame);
+        if (n == count) break;
+    }
+
+    // One snapshot of every game, reported the way option a does
+    printf("\n");
+    if (StartThreadPool(&pool, INSTANCE_WORKERS)) goto cleanup;
+    RunOnInstances(&pool, &games, games.numInstances, SnapshotInstance, NULL, &report);
+    StopThreadPool(&pool);
+    PrintInstanceReport(&games, &report);
+    status = report.numFailed != 0;
+
+cleanup:
+    CloseInstances(&games);
+    for (int i = 0; i < started; i++) {
+        if (children[i] <= 0) continue;
+        kill(children[i], SIGTERM);
+        waitpid(children[i], NULL, 0);
+    }
+    return status;
+#endif
+}
+
+void PrintUsage(char* name) {
+/**
+ * Purpose: Tells the user how to run the benchmarks
+ * @param name : char* - argv[0]
+ * @return : void
+ */
+
+    printf("Usage: %s snapshot|decode|render|watch|session|bitboard|solver|probability|metrics|trace|geometry|signature|directflag [iterations] [pid baseAddr]\n"
+           "       %s suite [iterations] [results.csv] [baseline.csv]\n"
+           "       %s instances [snapshots] [games] [./winmineStandIn]\n"
+           "       %s signature [iterations] [module.bin]\n"
+           "       %s directflag [iterations] [./winmineStandIn]\n"
+           "       %s autoplay [games] [./winmineStandIn]\n"
+           "       %s incremental [games]\n"
+           "       %s feed [seconds] [readers]\n"
+           "  Without a pid the benchmark runs against an in-memory expert board.\n"
+           "  With one, it reads a running winmineStandIn through process_vm_readv.\n"
+           "  session finds a running winmine.exe (or stand-in) by name\n"
+           "  suite runs the fixed benchmarks on every board size, writes them to\n"
+           "  results.csv (default bench.csv) and fails if any case got more than\n"
+           "  10%% slower than baseline.csv\n"
+           "  instances starts that many stand-ins (default 8) and reads them all at once\n"
+           "  signature scans module.bin (a dump of winmine from its base) instead of fake modules\n"
+           "  autoplay plays boards on a stand-in one click per read, batched and pipelined\n"
+           "  incremental times solver updates after single clicks and cascades against starting over\n"
+           "  feed publishes boards to shared memory as fast as it can with that many readers (default 8)\n", \
+           name, name, name, name, name, name, name, name);
+}
+
+int main(int argc, char** argv) {
+
+    // Local variables
+    static unsigned char image[MODULE_IMAGE_SIZE];  // Synthetic winmine module
+    MemorySource source;                            // Where the benchmarks read from
+    long iterations = BENCH_ITERATIONS;
+    int result;
+
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (argc > 2) iterations = atol(argv[2]);
+    if (strcmp(argv[1], "suite") == 0) {
+        return BenchSuite(argc > 2 ? iterations : 100000, argc > 3 ? argv[3] : "bench.csv", argc > 4 ? argv[4] : NULL);
+    }
+    if (strcmp(argv[1], "signature") == 0) return BenchSignature(argc > 2 ? iterations : 20000, argc > 3 ? argv[3] : NULL);
+    if (strcmp(argv[1], "directflag") == 0) {
+        return BenchDirectFlag(argc > 2 ? iterations : 100000, argc > 3 ? argv[3] : "./winmineStandIn");
+    }
+    if (strcmp(argv[1], "autoplay") == 0) return BenchAutoplay(argc > 2 ? iterations : 200, argc > 3 ? argv[3] : "./winmineStandIn");
+    if (strcmp(argv[1], "incremental") == 0) return BenchIncremental(argc > 2 ? iterations : 200);
+    if (strcmp(argv[1], "feed") == 0) return BenchFeed(argc > 2 ? iterations : 2, argc > 3 ? atoi(argv[3]) : 8);
+    if (strcmp(argv[1], "instances") == 0) {
+        return BenchInstances(argc > 2 ? iterations : 20000, argc > 3 ? atoi(argv[3]) : 8, \
+                              argc > 4 ? argv[4] : "./winmineStandIn");
+    }
+
+    // Pick the memory backend
+    if (argc > 4) {
+#ifdef _WIN32
+        printf("Attaching to a process by PID is only supported on Linux\n");
+        return 1;
+#else
+        OpenProcessVmSource(&source, atoi(argv[3]), (uintptr_t)strtoull(argv[4], NULL, 0));
+#endif
+    }
+    else {
+        if (BuildBoard(image, 30, 16, 99, 1)) return 1;
+        OpenBufferSource(&source, image, sizeof(image));
+    }
+
+    if (strcmp(argv[1], "snapshot") == 0) result = BenchSnapshot(&source, iterations);
+    else if (strcmp(argv[1], "decode") == 0) result = BenchDecode(&source, iterations);
+    else if (strcmp(argv[1], "render") == 0) result = BenchRender(&source, iterations);
+    else if (strcmp(argv[1], "watch") == 0) result = BenchWatch(image, iterations);
+    else if (strcmp(argv[1], "session") == 0) result = BenchSession(iterations);
+    else if (strcmp(argv[1], "bitboard") == 0) result = BenchBitboard(&source, iterations);
+    else if (strcmp(argv[1], "solver") == 0) result = BenchSolver(iterations);
+    else if (strcmp(argv[1], "probability") == 0) result = BenchProbability(iterations);
+    else if (strcmp(argv[1], "metrics") == 0) result = BenchMetrics(iterations);
+    else if (strcmp(argv[1], "trace") == 0) result = BenchTrace(&source, iterations);
+    else if (strcmp(argv[1], "geometry") == 0) result = BenchGeometry(iterations);
+    else {
+        PrintUsage(argv[0]);
+        result = 1;
+    }
+
+    CloseSource(&source);
+    return result;
+}
@@ -0,0 +1,284 @@
+/**
+ * Purpose: Replays snapshot logs written by the helper's record option.
+ *          Prints any single frame, plays the whole game back in the
+ *          terminal, or measures how fast frames can be rebuilt and
+ *          rendered. It can also write a log of a synthetic game to test with
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"winmine.h"
+#include"board.h"
+#include"bitboard.h"
+#include"solver.h"
+#include"tileDecode.h"
+#include"render.h"
+#include"snapshotLog.h"
+#include"timing.h"
+
+int FrameDimensions(const unsigned char* frame, DWORD* height, DWORD* width) {
+/**
+ * Purpose: Pulls the field's dimensions out of a frame
+ * @param frame : const unsigned char* - the frame
+ * @param height : DWORD* - receives the height
+ * @param width : DWORD* - receives the width
+ * @return : int - 0 on success, 1 if they're out of range (nothing recorded yet)
+ */
+
+    memcpy(height, LOG_FRAME_DWORD(frame, HEIGHT_OFFSET), sizeof(DWORD));
+    memcpy(width, LOG_FRAME_DWORD(frame, WIDTH_OFFSET), sizeof(DWORD));
+    return *width < 1 || *width > MAX_WIDTH || *height < 1 || *height > MAX_HEIGHT;
+}
+
+int PrintFrame(LogReader* log, unsigned long long index) {
+/**
+ * Purpose: Prints one frame the same way option 2 of the helper does
+ * @param log : LogReader* - the log
+ * @param index : unsigned long long - the frame
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static Frame frame;                   // Too big for the stack
+    unsigned char kinds[KIND_GRID_SIZE];
+    DWORD height, width, numMines, remaining;
+
+    if (SeekFrame(log, index)) {
+        printf("There's no frame %llu. The log has %llu\n", index, log->numFrames);
+        return 1;
+    }
+    if (FrameDimensions(log->frame, &height, &width)) {
+        printf("Frame %llu has no minefield in it\n", index);
+        return 1;
+    }
+    memcpy(&numMines, LOG_FRAME_DWORD(log->frame, NUM_MINES_OFFSET), sizeof(DWORD));
+    memcpy(&remaining, LOG_FRAME_REMAINING(log->frame), sizeof(DWORD));
+
+    DecodeField(LOG_FRAME_FIELD(log->frame), height, kinds);
+    RenderFrame(&frame, kinds, height, width, 1);
+    WriteFrame(&frame);
+    printf("Frame %llu of %llu at %.3f s. %u mines, %d not flagged\n", index, log->numFrames, \
+           log->timeMs / 1000.0, numMines, (int)remaining);
+    return 0;
+}
+
+int PlayLog(LogReader* log, double speed) {
+/**
+ * Purpose: Plays the log back, redrawing only the tiles that change
+ * @param log : LogReader* - the log
+ * @param speed : double - 1 for real time, 2 for twice as fast, 0 for no waiting
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static Frame frame;
+    unsigned char kinds[KIND_GRID_SIZE];
+    DWORD height, width, remaining;
+    unsigned long long lastMs = 0;
+
+    InitFrame(&frame);
+    for (unsigned long long i = 0; i < log->numFrames; i++) {
+        if (SeekFrame(log, i)) return 1;
+        if (FrameDimensions(log->frame, &height, &width)) continue;
+        if (speed > 0 && log->timeMs > lastMs) SleepMs((unsigned int)((log->timeMs - lastMs) / speed));
+        lastMs = log->timeMs;
+
+        DecodeField(LOG_FRAME_FIELD(log->frame), height, kinds);
+        RenderFrameDiff(&frame, kinds, height, width);
+        WriteFrame(&frame);
+    }
+
+    memcpy(&remaining, LOG_FRAME_REMAINING(log->frame), sizeof(DWORD));
+    printf("\n%llu frames over %.3f s. %d mines not flagged\n", log->numFrames, log->timeMs / 1000.0, (int)remaining);
+    return 0;
+}
+
+int BenchLog(LogReader* log, long seeks) {
+/**
+ * Purpose: Times rebuilding and rendering frames: straight through, backwards
+ *          (every step is a keyframe plus up to 63 deltas) and at random
+ * @param log : LogReader* - the log
+ * @param seeks : long - number of random seeks
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static Frame frame;
+    unsigned char kinds[KIND_GRID_SIZE];
+    DWORD height, width;
+    unsigned int state = 1;
+    const char* names[3] = { "forward", "backward", "random" };
+
+    if (!log->numFrames) return 1;
+
+    for (int pass = 0; pass < 3; pass++) {
+        long count = pass == 2 ? seeks : (long)log->numFrames;
+        unsigned long long records = log->recordsApplied;
+        unsigned long long start = NowNs();
+        double seconds;
+
+        log->current = log->numFrames;  // Nothing cached from the last pass
+        for (long i = 0; i < count; i++) {
+            unsigned long long index = pass == 0 ? (unsigned long long)i : \
+                                       pass == 1 ? log->numFrames - 1 - (unsigned long long)i : \
+                                       NextRandom(&state) % log->numFrames;
+            if (SeekFrame(log, index)) return 1;
+            if (FrameDimensions(log->frame, &height, &width)) continue;
+            DecodeField(LOG_FRAME_FIELD(log->frame), height, kinds);
+            RenderFrame(&frame, kinds, height, width, 1);
+        }
+        seconds = (double)(NowNs() - start) / 1e9;
+
+        printf("%-8s %8ld frames in %.3f s: %10.0f frames/s, %.1f records decoded per frame\n", names[pass], \
+               count, seconds, count / seconds, (double)(log->recordsApplied - records) / (double)count);
+    }
+
+    return 0;
+}
+
+int PrintSummary(LogReader* log, const char* path) {
+/**
+ * Purpose: Prints what's in a log and how well it compressed
+ * @param log : LogReader* - the log
+ * @param path : const char* - its name
+ * @return : int - 0
+ */
+
+    unsigned long long numKeyframes = (log->numFrames + LOG_KEYFRAME_INTERVAL - 1) / LOG_KEYFRAME_INTERVAL;
+    unsigned long long keyframeBytes = 0;
+    unsigned long long lastMs = 0;
+
+    // A keyframe's record ends where the next record starts
+    for (unsigned long long k = 0; k < numKeyframes; k++) {
+        size_t at = log->keyframes[k];
+        if (SeekFrame(log, k*LOG_KEYFRAME_INTERVAL)) return 1;
+        keyframeBytes += log->next - at;
+    }
+    if (log->numFrames) {
+        SeekFrame(log, log->numFrames - 1);
+        lastMs = log->timeMs;
+    }
+
+    printf("%s: %llu frames (%llu keyframes) over %.3f s in %zu bytes\n", path, log->numFrames, numKeyframes, \
+           lastMs / 1000.0, log->file.size);
+    if (log->numFrames > numKeyframes) {
+        printf("  keyframes %.1f bytes each, deltas %.1f bytes each (raw frames are %u bytes)\n", \
+               (double)keyframeBytes / (double)numKeyframes, \
+               (double)(log->file.size - LOG_MAGIC_SIZE - keyframeBytes) / (double)(log->numFrames - numKeyframes), \
+               (unsigned)LOG_FRAME_SIZE);
+    }
+    return 0;
+}
+
+int GenerateLog(const char* path, DWORD width, DWORD height, DWORD numMines, unsigned int seed) {
+/**
+ * Purpose: Records a synthetic game one move per frame. The player clicks
+ *          every tile the honest helper proves safe, flags every mine it
+ *          proves, and when stuck clicks a tile it knows is safe by peeking
+ * @param path : const char* - the log to write
+ * @param width : DWORD - the width of the board
+ * @param height : DWORD - the height of the board
+ * @param numMines : DWORD - mines on the board
+ * @param seed : unsigned int - the board's seed
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static unsigned char image[MODULE_IMAGE_SIZE];
+    static SolverResult result;
+    unsigned char* field = image + MINEFIELD_OFFSET;
+    unsigned char kinds[KIND_GRID_SIZE];
+    MemorySource source;
+    LogWriter log;
+    Bitboard board;
+    unsigned int state = seed;
+    DWORD remaining = numMines;
+    int changed;
+
+    if (BuildBoard(image, width, height, numMines, seed) || \
+        OpenBufferSource(&source, image, sizeof(image)) || OpenLogWriter(&log, path)) return 1;
+    if (RecordFrame(&log, &source, &changed)) return 1;
+
+    for (;;) {
+        PackBitboard(field, height, width, &board);
+        if (GameState(&board) != GAME_IN_PROGRESS) break;
+
+        DecodeField(field, height, kinds);
+        for (DWORD i = 0; i < KIND_GRID_SIZE; i++) kinds[i] &= TILE_VISIBLE_MASK;
+        if (SolveVisible(kinds, height, width, &result)) memset(&result, 0, sizeof(result));
+
+        // Flags first, then safe clicks. Each is its own frame
+        for (DWORD y = 1; y <= height; y++) {
+            for (uint32_t mines = result.mines[y]; mines; mines &= mines - 1) {
+                unsigned char* tile = field + (DWORD)CTZ32(mines) + y*ROW_STRIDE;
+                if ((*tile & ~MINE) == FLAG) continue;
+                *tile = (unsigned char)((*tile & MINE) | FLAG);
+                remaining--;
+                memcpy(image + MINES_REMAINING_OFFSET, &remaining, sizeof(DWORD));
+                if (RecordFrame(&log, &source, &changed)) return 1;
+            }
+            for (uint32_t safe = result.safe[y]; safe; safe &= safe - 1) {
+                if (RevealTile(field, width, height, (DWORD)CTZ32(safe), y) > 0 && \
+                    RecordFrame(&log, &source, &changed)) return 1;
+            }
+        }
+
+        // Stuck. Click some covered tile that isn't a mine
+        if (!result.numSafe) {
+            DWORD x, y;
+            do {
+                x = 1 + NextRandom(&state) % width;
+                y = 1 + NextRandom(&state) % height;
+            } while (field[x + y*ROW_STRIDE] & (MINE | REVEALED_TILE));
+            RevealTile(field, width, height, x, y);
+            if (RecordFrame(&log, &source, &changed)) return 1;
+        }
+    }
+
+    printf("Wrote %llu frames in %llu bytes to %s (%.1f bytes per frame, raw frames are %u)\n", log.frames, \
+           log.bytes, path, (double)log.bytes / (double)log.frames, (unsigned)LOG_FRAME_SIZE);
+    CloseLogWriter(&log);
+    CloseSource(&source);
+    return 0;
+}
+
+void PrintUsage(char* name) {
+/**
+ * Purpose: Tells the user how to run the replayer
+ * @param name : char* - argv[0]
+ * @return : void
+ */
+
+    printf("Usage: %s log               summary of the log\n"
+           "       %s log frame         print one frame\n"
+           "       %s -p log [speed]    play the game back (speed 0 doesn't wait)\n"
+           "       %s -b log [seeks]    time rebuilding and rendering frames\n"
+           "       %s -g log width height mines seed\n"
+           "                             record a synthetic game\n", name, name, name, name, name);
+}
+
+int main(int argc, char** argv) {
+
+    // Local variables
+    static LogReader log;   // Holds a whole frame. Too big for the stack
+    int status;
+
+    if (argc == 7 && strcmp(argv[1], "-g") == 0) {
+        return GenerateLog(argv[2], (DWORD)atoi(argv[3]), (DWORD)atoi(argv[4]), (DWORD)atoi(argv[5]), \
+                           (unsigned int)strtoul(argv[6], NULL, 0));
+    }
+
+    if (argc >= 3 && (strcmp(argv[1], "-p") == 0 || strcmp(argv[1], "-b") == 0)) {
+        if (OpenLogReader(&log, argv[2])) return 1;
+        if (argv[1][1] == 'p') status = PlayLog(&log, argc > 3 ? atof(argv[3]) : 1.0);
+        else status = BenchLog(&log, argc > 3 ? atol(argv[3]) : 100000);
+    }
+    else if (argc == 2 || (argc == 3 && argv[1][0] != '-')) {
+        if (OpenLogReader(&log, argv[1])) return 1;
+        status = argc == 2 ? PrintSummary(&log, argv[1]) : PrintFrame(&log, strtoull(argv[2], NULL, 0));
+    }
+    else {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    CloseLogReader(&log);
+    return status;
+}
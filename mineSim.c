@@ -0,0 +1,197 @@
+/**
+ * Purpose: Estimates how often a strategy wins at each difficulty by
+ *          playing millions of synthetic games across every core, and
+ *          measures how well that scales with threads
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"winmine.h"
+#include"simulator.h"
+#include"threadPool.h"
+
+#define SIM_GAMES  100000  // Default games per difficulty
+
+double SquareRoot(double value) {
+/**
+ * Purpose: Newton's method square root, so the simulator doesn't need libm
+ * @param value : double - a number that isn't negative
+ * @return : double - its square root
+ */
+
+    double guess = value > 1.0 ? value : 1.0;
+
+    if (value <= 0.0) return 0.0;
+    for (int i = 0; i < 64; i++) {
+        double next = 0.5*(guess + value / guess);
+        if (next == guess) break;
+        guess = next;
+    }
+    return guess;
+}
+
+int ParseDifficulty(const char* text, SimConfig* config) {
+/**
+ * Purpose: Reads a difficulty as beginner, intermediate, expert or WxHxM
+ * @param text : const char* - the difficulty
+ * @param config : SimConfig* - receives the width, height and mine count
+ * @return : int - 0 on success, 1 if it isn't a valid board
+ */
+
+    if (strcmp(text, "beginner") == 0) text = "9x9x10";
+    else if (strcmp(text, "intermediate") == 0) text = "16x16x40";
+    else if (strcmp(text, "expert") == 0) text = "30x16x99";
+
+    if (sscanf(text, "%ux%ux%u", &config->width, &config->height, &config->numMines) != 3 || \
+        config->width < 1 || config->width > MAX_WIDTH || config->height < 1 || config->height > MAX_HEIGHT || \
+        config->numMines >= config->width*config->height) {
+        printf("%s isn't a valid board. Use beginner, intermediate, expert or WxHxM\n", text);
+        return 1;
+    }
+    return 0;
+}
+
+void PrintStats(const SimConfig* config, const SimStats* stats) {
+/**
+ * Purpose: Prints the win rate with a 95% confidence interval, then speed
+ * @param config : const SimConfig* - what was played
+ * @param stats : const SimStats* - how it went
+ * @return : void
+ */
+
+    double rate = stats->games ? (double)stats->wins / (double)stats->games : 0.0;
+    double margin = stats->games ? 1.96*SquareRoot(rate*(1.0 - rate) / (double)stats->games) : 0.0;
+
+    printf("%2ux%-2u %3u mines  %-11s %10llu games  win rate %6.2f%% +/- %.2f%%  %5.1f clicks, %4.2f guesses per game\n", \
+           config->width, config->height, config->numMines, config->strategy->name, stats->games, rate*100.0, \
+           margin*100.0, (double)stats->clicks / (double)stats->games, (double)stats->guesses / (double)stats->games);
+    printf("    %.0f games/s over %d threads (%.1f million games/hour). Per thread:", \
+           (double)stats->games / stats->seconds, stats->numThreads, (double)stats->games / stats->seconds*3600.0 / 1e6);
+    for (int t = 0; t < stats->numThreads; t++) printf(" %.0f", stats->threadRate[t]);
+    printf("\n");
+}
+
+int RunScaling(SimConfig* config, int maxThreads) {
+/**
+ * Purpose: Plays the same games with 1, 2, 4... threads and reports the
+ *          speedup over one thread and how close to linear it is. The games
+ *          don't depend on which thread plays them, so every run has to
+ *          win exactly as often
+ * @param config : SimConfig* - what to play
+ * @param maxThreads : int - the most threads to try
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    static ThreadPool pool;
+    SimStats stats;
+    double oneThread = 0.0;
+    unsigned long long wins = 0;
+
+    printf("%d cores. More threads than that can't go any faster\n", CountCores());
+    printf("threads    games/s  speedup  efficiency  slowest thread  fastest thread\n");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double rate, slowest, fastest;
+
+        if (StartThreadPool(&pool, threads)) return 1;
+        if (RunSimulation(&pool, config, &stats)) return 1;
+        StopThreadPool(&pool);
+
+        rate = (double)stats.games / stats.seconds;
+        if (threads == 1) {
+            oneThread = rate;
+            wins = stats.wins;
+        }
+        else if (stats.wins != wins) {
+            printf("%d threads won %llu games but 1 thread won %llu. Games depend on the thread\n", \
+                   threads, stats.wins, wins);
+            return 1;
+        }
+
+        slowest = fastest = stats.threadRate[0];
+        for (int t = 1; t < stats.numThreads; t++) {
+            if (stats.threadRate[t] < slowest) slowest = stats.threadRate[t];
+            if (stats.threadRate[t] > fastest) fastest = stats.threadRate[t];
+        }
+        printf("%7d %10.0f %7.2fx %10.0f%% %15.0f %15.0f\n", threads, rate, rate / oneThread, \
+               rate / oneThread / threads*100.0, slowest, fastest);
+    }
+    printf("Every thread count won the same %llu of %llu games\n", wins, config->games);
+    return 0;
+}
+
+void PrintUsage(char* name) {
+/**
+ * Purpose: Tells the user how to run the simulator
+ * @param name : char* - argv[0]
+ * @return : void
+ */
+
+    printf("Usage: %s [-j threads] [-n games] [-s strategy] [-r seed] [-scale] [difficulty...]\n"
+           "  difficulty is beginner, intermediate, expert or WxHxM (default: all three)\n"
+           "  -j      threads (default: one per core)\n"
+           "  -n      games per difficulty (default %d)\n"
+           "  -r      seed. The same seed plays the same games\n"
+           "  -scale  play with 1, 2, 4... threads up to -j and report the speedup\n"
+           "  -s      strategy:\n", name, SIM_GAMES);
+    for (int i = 0; i < numSimStrategies; i++) {
+        printf("            %-12s %s\n", simStrategies[i].name, simStrategies[i].description);
+    }
+}
+
+int main(int argc, char** argv) {
+
+    // Local variables
+    static ThreadPool pool;
+    SimConfig config;
+    SimStats stats;
+    int threads = CountCores();
+    int scaling = 0;
+    int argi = 1;
+    char* defaults[3] = { "beginner", "intermediate", "expert" };
+    char** difficulties;
+    int numDifficulties;
+
+    memset(&config, 0, sizeof(config));
+    config.games    = SIM_GAMES;
+    config.seed     = 1;
+    config.strategy = FindStrategy("logic");
+
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (strcmp(argv[argi], "-j") == 0 && argi + 1 < argc) threads = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "-n") == 0 && argi + 1 < argc) config.games = strtoull(argv[++argi], NULL, 0);
+        else if (strcmp(argv[argi], "-r") == 0 && argi + 1 < argc) config.seed = (unsigned int)strtoul(argv[++argi], NULL, 0);
+        else if (strcmp(argv[argi], "-scale") == 0) scaling = 1;
+        else if (strcmp(argv[argi], "-s") == 0 && argi + 1 < argc) {
+            config.strategy = FindStrategy(argv[++argi]);
+            if (!config.strategy) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        }
+        else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > POOL_MAX_THREADS) threads = POOL_MAX_THREADS;
+    difficulties    = argi < argc ? argv + argi : defaults;
+    numDifficulties = argi < argc ? argc - argi : 3;
+
+    if (!scaling && StartThreadPool(&pool, threads)) return 1;
+    for (int d = 0; d < numDifficulties; d++) {
+        if (ParseDifficulty(difficulties[d], &config)) return 1;
+        if (scaling) {
+            printf("%ux%u with %u mines, %llu games, %s strategy\n", config.width, config.height, config.numMines, \
+                   config.games, config.strategy->name);
+            if (RunScaling(&config, threads)) return 1;
+            continue;
+        }
+        if (RunSimulation(&pool, &config, &stats)) return 1;
+        PrintStats(&config, &stats);
+    }
+    if (!scaling) StopThreadPool(&pool);
+
+    return 0;
+}
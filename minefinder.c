@@ -7,398 +7,525 @@
  */
 
 #include<stdio.h>
+#include<string.h>
+#ifdef _WIN32
 #include<windows.h>
-#include<tlhelp32.h>
-
-#define FLAG_TILE_FUNCTION     0x374F  // Offset to the function that flags a given tile
-#define NUM_MINES_OFFSET       0x5330  // Offset to the position in memory with the number of mines
-#define MINEFIELD_OFFSET       0x5340  // Offset to the start of the minefield in memory
-#define WIDTH_OFFSET           0x5334  // Offset to the position in memory containing the width of the field
-#define HEIGHT_OFFSET          0x5338  // Offset to the position in memory containing the height of the field
-#define MINES_REMAINING_OFFSET 0x5194  // Offset to the number of mines left to be found
-#define MINEFIELD_SIZE         0x35F   // Size of the minefield in memory
-#define BUFF_SIZE              1024    // Size of buffers
-#define MINE                   0x80    // A mine in memory
-#define REVEALED_TILE          0x40    // A tile that's been clicked on that's not a bomb
-#define UNCLICKED_SPACE        0x0F    // An unclicked tile in memory
-#define FLAG                   0x0E    // A flag in memory
-#define QUESTION_MARK          0x0D    // A question mark in memory
-#define EXPLODED_MINE          0xCC    // The mine you clicked on to lose the game
-#define WRONG_MINE             0x0B    // You put a flag over something that wasn't a mine
-#define REVEALED_MINE          0x0A    // Value of the least significant byte in memory when all mines are revealed
-#define SHELLCODE_LENGTH       0x17    // Size of the shellcode
-#define SHELLCODE_CALL_OFFSET  0x11    // Offset to the call operand in the shellcode
-#define INST_AFTER_CALL_OFFSET 0x15    // Offset to the instruction after the CALL instruction in the shellcode
-
-DWORD GetProcessPID(char* processName);
-BYTE* GetModuleBaseAddress(DWORD PID, char* moduleName, size_t lenModuleName);
+#include<conio.h>
+#else
+#include<sys/select.h>
+#endif
+#include"winmine.h"
+#include"memorySource.h"
+#include"session.h"
+#include"snapshot.h"
+#include"flagStub.h"
+#include"tileDecode.h"
+#include"render.h"
+#include"geometry.h"
+#include"watch.h"
+#include"timing.h"
+#include"bitboard.h"
+#include"solver.h"
+#include"probability.h"
+#include"threadPool.h"
+#include"snapshotLog.h"
+#include"metrics.h"
+#include"trace.h"
+#include"instances.h"
+#include"directFlag.h"
+#include"autoplay.h"
+#include"boardPublisher.h"
+
+#define FLAG_BATCH_TIMEOUT     5000    // Milliseconds to wait for the flagging thread to finish
+
 void PrintMineField(unsigned char* field, DWORD height, DWORD width);
-int FlagAllMines(HANDLE hMineSweeper, DWORD baseAddr, DWORD width, DWORD height, unsigned char* mineField, DWORD numMines);
-int SetMineMetadata(HANDLE hMineSweeper, DWORD* numMines, DWORD* height, DWORD* width, unsigned char* mineField, DWORD baseAddr);
+void PrintHonestHelp(unsigned char* field, DWORD height, DWORD width, DWORD numMines);
+int RecordGame(MemorySource* source, const char* path, unsigned int intervalMs);
+int PublishGame(MemorySource* source, unsigned int intervalMs);
+int SaveTrace(const char* path, int format);
+int RunOnAllGames(InstanceSet* games, ThreadPool* pool, const char* action);
+#ifdef _WIN32
+int FlagAllMines(HANDLE hMineSweeper, DWORD baseAddr, const WinmineOffsets* offsets, DWORD width, DWORD height, \
+                 unsigned char* mineField, DWORD numMines);
+#endif
+int SetMineMetadata(MemorySource* source, DWORD* numMines, DWORD* height, DWORD* width, unsigned char* mineField);
+
+int StopOnKeyPress(void* context) {
+/**
+ * Purpose: onPoll hook for the watch mode. Stops watching when a key is hit
+ * @param context : void* - unused
+ * @return : int - non-zero if a key was pressed
+ */
 
-int debug = 0;
+    (void)context;
+#ifdef _WIN32
+    if (!_kbhit()) return 0;
+    _getch();
+    return 1;
+#else
+    // Terminals hand us input a line at a time so this waits for Enter
+    fd_set input;
+    struct timeval noWait = { 0, 0 };
+    char line[64];
+
+    FD_ZERO(&input);
+    FD_SET(0, &input);
+    if (select(1, &input, NULL, NULL, &noWait) <= 0) return 0;
+    if (!fgets(line, sizeof(line), stdin)) return 1;
+    return 1;
+#endif
+}
 
-DWORD GetProcessPID(char* processName) {
+void PrintMineField(unsigned char* field, DWORD height, DWORD width) {
 /**
- * Purpose: Enumerates all processes looking for a process with the specified
- *          name. Returns the process ID of the first matching process
- * @param processName : char* - null term string containing the name of the process to match. Case sensitive
- * @return : DWORD - process ID of the first process with a matching name or 0 if error
+ * Purpose: Prints out the given minefield. This should be the same minefield
+ *          that was read from memory. The whole thing goes out in one write.
+ *          The tiles are drawn by the board's Geometry
+ * @param field : unsigned char* - the minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @return : void - zip. nada.
  */
 
-    // Initialize the PROCESSENTRY32 structure
-    PROCESSENTRY32 processInformation;
-    processInformation.dwSize = sizeof(PROCESSENTRY32);  // As per https://docs.microsoft.com/en-us/windows/win32/api/tlhelp32/ns-tlhelp32-processentry32
+    // Local variables
+    static Frame frame;                   // The formatted minefield. Too big for the stack
+    Geometry geometry;                    // Picks the render for this size
 
-    if (debug) printf("Searching the process list for process %s via the executable name\n", processName);
+    if (InitGeometry(&geometry, width, height, GEOMETRY_AUTO) || geometry.tiled) return;
+    RenderFrameGeometry(&frame, &geometry, field, 1);
+    WriteFrame(&frame);
 
-    // Get a list of running processes
-    HANDLE hProcessSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (hProcessSnap == INVALID_HANDLE_VALUE) {
-        printf("Error calling CreateToolhelp32Snapshot: %d\n", GetLastError());
-        return 0;
-    }
+    DEBUG_PRINT("Rendered %u bytes in %llu ns\n", (unsigned)frame.length, frame.frameNs);
 
-    // Get the first Process in the list
-    if (!Process32First(hProcessSnap, &processInformation)) {
-        printf("Error calling Process32first: %d\n", GetLastError());
-        CloseHandle(hProcessSnap);
-        return 0;
-    }
+    return;
+}
 
-    // Iterate through all Processs in the snapshot, searching for
-    // the process by name
-    do {
-        // If the executable name matches, tell the user we found it and clean up
-        if (strncmp(processInformation.szExeFile, processName, 12) == 0) {
-            if (debug) printf("Found %s. Process id %d\n", processName, processInformation.th32ProcessID);
-            CloseHandle(hProcessSnap);
-            return processInformation.th32ProcessID;
-        }
-    } while (Process32Next(hProcessSnap, &processInformation));
+int RecordGame(MemorySource* source, const char* path, unsigned int intervalMs) {
+/**
+ * Purpose: Polls the game and appends every snapshot that changed to a log
+ *          until a key is pressed. mineReplay plays the log back
+ * @param source : MemorySource* - the game
+ * @param path : const char* - the log to create
+ * @param intervalMs : unsigned int - milliseconds between polls
+ * @return : int - 0 on success, 1 on failure
+ */
 
-    printf("Unable to find process %s. Is it running?\n", processName);
-    CloseHandle(hProcessSnap);
+    // Local variables
+    static LogWriter log;               // Holds a whole frame. Too big for the stack
+    unsigned long long polls = 0;       // Snapshots taken
+    int changed;                        // Whether the last poll wrote a frame
+    int status = 0;
+
+    if (OpenLogWriter(&log, path)) return 1;
+    printf("Recording to %s. Press a key to stop\n", path);
+
+    while (!StopOnKeyPress(NULL)) {
+        if (RecordFrame(&log, source, &changed)) {
+            status = 1;
+            break;
+        }
+        polls++;
+        if (changed) DEBUG_PRINT("Frame %llu, %llu bytes so far\n", log.frames, log.bytes);
+        SleepMs(intervalMs);
+    }
 
-    return 0;
+    printf("Recorded %llu frames from %llu polls in %llu bytes (%.1f bytes per frame)\n\n", log.frames, polls, \
+           log.bytes, log.frames ? (double)log.bytes / (double)log.frames : 0.0);
+    CloseLogWriter(&log);
+    return status;
 }
 
-BYTE* GetModuleBaseAddress(DWORD PID, char* moduleName, size_t lenModuleName) {
+int PublishGame(MemorySource* source, unsigned int intervalMs) {
 /**
- * Purpose: Gets the base address of a given PID in memory
- * @param PID : DWORD - the ID of the process
- * @param moduleName : char*  - the null terminated name of the module
- * @param lenModuleName : size_t - the length of the moduleName string with the null term
- * @return: BYTE*  - the base address of the process in memory or NULL if error
+ * Purpose: Polls the game and publishes every snapshot that changed to the
+ *          shared board feed until a key is pressed, so other tools can
+ *          read the board without attaching to the game themselves
+ * @param source : MemorySource* - the game
+ * @param intervalMs : unsigned int - milliseconds between polls
+ * @return : int - 0 on success, 1 on failure
  */
 
-    // Initialize the MODULEENTRY32 structure
-    MODULEENTRY32 moduleInformation;
-    moduleInformation.dwSize = sizeof(MODULEENTRY32);
+    // Local variables
+    static BoardPublisher publisher;    // Holds a whole window. Too big for the stack
+    static Snapshot snapshot;
+    int changed;                        // Whether the last poll published a board
+    int status = 0;
+
+    if (OpenBoardPublisher(&publisher, NULL)) return 1;
+    printf("Publishing to %s. Press a key to stop\n", publisher.name);
+
+    while (!StopOnKeyPress(NULL)) {
+        if (PublishIfChanged(&publisher, source, &snapshot, &changed)) {
+            status = 1;
+            break;
+        }
+        if (changed) DEBUG_PRINT("Board %llu published\n", publisher.published);
+        SleepMs(intervalMs);
+    }
 
-    if (debug) printf("Getting the module %s base address from process ID %d\n", moduleName, PID);
+    printf("Published %llu boards from %llu polls\n\n", publisher.published, publisher.polls);
+    CloseBoardPublisher(&publisher);
+    return status;
+}
 
-    // Take a snapshot of all modules in the specified process
-    HANDLE hModuleSnap = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE32 | TH32CS_SNAPMODULE, PID);
-    if (hModuleSnap == INVALID_HANDLE_VALUE) {
-        printf("Error calling CreateToolhelp32Snapshot: %d\n", GetLastError());
-        return NULL;
-    }
+int SaveTrace(const char* path, int format) {
+/**
+ * Purpose: Writes everything traced so far to a file (or the screen), prints
+ *          where the time went and starts counting again from zero
+ * @param path : const char* - the file, or - for the screen
+ * @param format : int - TRACE_JSON or TRACE_CSV
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    // Local variables
+    TraceCounter counters[TRACE_NUM_KINDS];  // Every thread's totals
+    FILE* out = stdout;
+    int status;
 
-    // Get the first module in the list
-    if (!Module32First(hModuleSnap, &moduleInformation)) {
-        printf("Error calling Module32First: %d\n", GetLastError());
-        CloseHandle(hModuleSnap);
-        return NULL;
+    if (strcmp(path, "-") != 0 && !(out = fopen(path, "w"))) {
+        perror("Error opening the trace file");
+        return 1;
+    }
+    status = DumpTrace(out, format);
+    if (out != stdout) fclose(out);
+    if (status) {
+        printf("Error writing the trace\n");
+        return 1;
     }
 
-    // Iterate through all modules in the snapshot, searching for
-    // the specified module
-    do {
-        if (strncmp(moduleInformation.szModule, moduleName, lenModuleName) == 0) {
-            if (debug) printf("Module base address is 0x%08x\n", (DWORD)moduleInformation.modBaseAddr);
-            CloseHandle(hModuleSnap);
-            return moduleInformation.modBaseAddr;
-        }
-    } while(Module32Next(hModuleSnap, &moduleInformation));
+    CollectTraceCounters(counters);
+    printf("%-14s %8s %10s %12s %10s %10s %10s\n", "", "calls", "bytes", "total us", "p50 us", "p99 us", "max us");
+    for (int k = 0; k < TRACE_NUM_KINDS; k++) {
+        if (!counters[k].calls) continue;
+        printf("%-14s %8llu %10llu %12.1f %10.1f %10.1f %10.1f\n", TraceKindName(k), counters[k].calls, \
+               counters[k].bytes, counters[k].totalNs / 1000.0, TracePercentile(&counters[k], 0.5) / 1000.0, \
+               TracePercentile(&counters[k], 0.99) / 1000.0, counters[k].maxNs / 1000.0);
+    }
+    printf("Trace saved\n\n");
+    ResetTrace();
 
-    printf("Unable to find module %s in process ID %d\n", moduleName, PID);
-    return NULL;
+    return 0;
 }
 
-void PrintMineField(unsigned char* field, DWORD height, DWORD width) {
+void PrintHonestHelp(unsigned char* field, DWORD height, DWORD width, DWORD numMines) {
 /**
- * Purpose: Prints out the given minefield. This should be the same minefield
- *          that was read from memory
+ * Purpose: Prints the minefield with every tile the visible numbers prove
+ *          safe or mined marked on it. Unlike option 2 this never looks at
+ *          the hidden mine bits, so it only tells the player what they could
+ *          have worked out themselves. When nothing is provably safe it
+ *          shows each covered tile's exact chance of being a mine instead
  * @param field : unsigned char* - the minefield
  * @param height : DWORD - the height of the minefield
  * @param width : DWORD - the width of the minefield
- * @return : void - zip. nada.
+ * @param numMines : DWORD - the number of mines in the game
+ * @return : void
  */
 
-    // Each row (width) is 32 bytes so heigh must be *32 to get the proper index
-    height = height * 32;
-    unsigned char currPos;
-
-    // Print out the legend
-    printf("Legend:\n------\nB: Unexploded bomb\n_: Blank clicked tile\n"
-           "*: exploded bomb\n?: Question mark\n : (space) Blank unclicked tile\n"
-           "F: Flag\nX: Incorrectly placed flag. Only shows up after you lose\n\n   ");
-
-    // Print out the X axis
-    for (DWORD x = 1; x <= width; x++) {
-        printf(" %2d", x);
+    // Local variables
+    static Frame frame;                   // The formatted minefield. Too big for the stack
+    static SolverResult result;           // Proven tiles and the leftover frontier
+    static ProbabilityResult chances;     // Mine chances when the solver is stuck
+    static ThreadPool pool;               // Counts frontier groups in parallel. Started on first use
+    static int poolStarted = 0;
+    unsigned char kinds[KIND_GRID_SIZE];  // What each tile is
+    unsigned long long start;             // When solving started
+    unsigned long long solveNs;           // How long solving took
+
+    DecodeField(field, height, kinds);
+
+    // Only what the player can see goes to the solver and the printout
+    for (DWORD i = 0; i < KIND_GRID_SIZE; i++) kinds[i] &= TILE_VISIBLE_MASK;
+
+    start = NowNs();
+    if (SolveVisible(kinds, height, width, &result)) {
+        printf("The numbers on the board contradict each other\n\n");
+        return;
     }
-    
-    // Print out the border
-    printf("\n   ");
-    for (DWORD x = 1; x <= width; x++) {
-        printf("---");
+    solveNs = NowNs() - start;
+
+    if (result.numSafe) {
+        RenderFrameOverlay(&frame, kinds, height, width, result.safe, result.mines, NULL);
+        WriteFrame(&frame);
+        printf("Safe tiles: %u\t\tMines: %u\t\tSolved in %.1f us (%d passes)\n\n", \
+               result.numSafe, result.numMines, solveNs / 1000.0, result.passes);
+        return;
     }
-    printf("--\n");
-
-    // Print out the minefield
-    for (DWORD y = 32; y <= height; y+=32) {
-
-        // But first print out the Y axis and border
-        printf("%2d |", y/32);
-
-        // Print out the specific tile
-        for (DWORD x = 1; x <= width; x++) {
-            
-            currPos = field[x + y];
 
-            // Map out each tile position
-            if ((currPos & EXPLODED_MINE) == EXPLODED_MINE) printf(" * ");
-            else if ((currPos & MINE) == MINE) {
-                if ((currPos & FLAG) == FLAG && !((currPos ^ MINE) > FLAG)) printf(" BF");
-                else if ((currPos & QUESTION_MARK) == QUESTION_MARK && !((currPos ^ MINE) > QUESTION_MARK)) printf(" B?");
-                else printf(" B ");
-            }
-            else if ((currPos & REVEALED_TILE) == REVEALED_TILE) {
-                if (currPos > REVEALED_TILE) printf(" %d ", currPos ^ REVEALED_TILE);
-                else printf(" _ ");
-            }
-            else if ((currPos & UNCLICKED_SPACE) == UNCLICKED_SPACE) printf("   ");
-            else if ((currPos & FLAG) == FLAG) printf("  F");
-            else if ((currPos & QUESTION_MARK) == QUESTION_MARK) printf("  ?");
-            else if ((currPos & WRONG_MINE) == WRONG_MINE) printf(" X ");
-        }
-
-        printf("\n");
+    // Stuck. Work out how likely each covered tile is to be a mine
+    if (!poolStarted) {
+        ClearProbabilityCache();
+        poolStarted = !StartThreadPool(&pool, CountCores());
+    }
+    start = NowNs();
+    if (ComputeProbabilities(poolStarted ? &pool : NULL, NULL, kinds, height, width, numMines, &result, &chances)) {
+        printf("Couldn't work out the mine chances for this board\n\n");
+        return;
     }
+    solveNs += NowNs() - start;
+
+    RenderFrameOverlay(&frame, kinds, height, width, result.safe, result.mines, chances.chance);
+    WriteFrame(&frame);
+    printf("Nothing is provably safe. Best guess: %u,%u (%.1f%% chance of a mine)\n", \
+           chances.bestX, chances.bestY, chances.bestChance*100.0f);
+    if (chances.numInterior) printf("Tiles away from any number: %.1f%% each\n", chances.interiorChance*100.0);
+    DEBUG_PRINT("%u frontier tiles in %u groups (largest %u, %u cached), %llu states\n", \
+                chances.numFrontier, chances.numComponents, chances.largestComponent, \
+                chances.cacheHits, chances.states);
+    printf("Mines: %u\t\tSolved in %.1f us (%d passes)\n\n", result.numMines, solveNs / 1000.0, result.passes);
 
     return;
 }
 
-int FlagAllMines(HANDLE hMineSweeper, DWORD baseAddr, DWORD width, \
+#ifdef _WIN32
+int FlagAllMines(HANDLE hMineSweeper, DWORD baseAddr, const WinmineOffsets* offsets, DWORD width, \
                  DWORD height, unsigned char* mineField, DWORD numMines) {
 /**
- * Purpose: Puts a flag over every mine
+ * Purpose: Puts a flag over every mine. All of the mines go over in one batch
+ *          and a single remote thread flags them (see flagStub.c). The board
+ *          is scanned and its mines found through the board's Geometry
  * @param hMineSweeper : HANDLE - process handle to minesweeper
  * @param baseAddr : DWORD - the base address of the minesweeper process in memory
+ * @param offsets : const WinmineOffsets* - where this build keeps the minefield and flag function
  * @param width : DWORD - the width of the minefield
  * @param height : DWORD - the height of the minefield
  * @param mineField : unsigned char* - the minefield in memory
  * @return : int - 0 on success, 1 on failure
  */
 
-    // To pass two or more arguments to CreateRemoteThread, we'll use a struct
-    // to put two ints on the stack
-    struct parameters_s {
-        int x;
-        int y;
-    };
-
     // Local variables
     unsigned char buff = (unsigned char)(MINE | UNCLICKED_SPACE);
     struct parameters_s *mineLocations = (struct parameters_s*)malloc(sizeof(struct parameters_s)*numMines);
-    DWORD minesFound = 0;         // Number of mines found
-    DWORD foundExplodedMine = 0;  // Did we find an exploded mine?
+    DWORD minesFound = 0;         // Number of unflagged mines found
     int errorCode = 0;            // A better name would have been "returnCode"
     SIZE_T bytesWritten;          // Receives the number of bytes WriteProcessMemory wrote
-    int currOffset;               // The current mine we're dealing with
+    DWORD currOffset;             // The current tile we're dealing with
     HANDLE hThread;               // Handle to the remote thread created by CreateRemoteThread
-
-    // Our shellcode to call with CreateRemoteThread. Allows us to
-    // pass multiple parameters via use of a pointer to a structure
-    unsigned char shellcode[] = "\x55\x8B\xEC\x8B\x45\x08\x8B\x48\x04"  // ASM pre-amble, pushing x + y coords on stack
-                                "\x51\x8B\x55\x08\x8B\x02\x50\xE8\x00"  // calling the right click function in winmine
-                                "\x00\x00\x00\x5D\xC3";                 // poping EBP and returning. Lesson learned here
-                                                                        // is that threads don't exit properly if you're
-                                                                        // debugging them
-
-    // Iterate through the minefield finding the location of all mines
-    for (DWORD y = 32; y <= height*32; y+=32) {
-        for (DWORD x = 1; x <= width; x++) {
-
-            // Did we find an exploded mine?
-            if ((mineField[x + y] & EXPLODED_MINE) == EXPLODED_MINE) {
-                foundExplodedMine = 1;
-                break;
-            }
-
-            // Did we find a mine?
-            if ((mineField[x + y] & MINE) == MINE) {
-                mineLocations[minesFound].x = (int)x;
-                mineLocations[minesFound].y = (int)y/32;
-                minesFound++;
-            }
-        }
-
-        // Did we find an exploded mine?
-        if (foundExplodedMine) { break; }
+    DWORD waitResult;             // What WaitForSingleObject said about the remote thread
+    unsigned char* batch;         // The stub plus every mine location
+    size_t batchSize;             // Size of batch in bytes
+    LPVOID spaceForBatch;         // Where the batch lives in minesweeper
+    Geometry geometry;            // Picks the scan and flag code for this size
+    BoardCounts counts;           // What the scan found
+    unsigned char flagged[MINEFIELD_SIZE];  // The field as it would look flagged
+    unsigned long long start;     // When the current call started, if tracing
+
+    if (!mineLocations) {
+        printf("Error allocating space for the mine locations\n");
+        return 1;
+    }
+    if (InitGeometry(&geometry, width, height, GEOMETRY_AUTO) || geometry.tiled) {
+        free(mineLocations);
+        return 1;
     }
 
-    // If the game isn't over, flag all the mines
-    if (!foundExplodedMine) {
-
-        // Allocate space in the remote process for our shellcode
-        LPVOID spaceForShellcode = VirtualAllocEx(hMineSweeper, NULL, SHELLCODE_LENGTH, \
-                                                  MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
-        if (!spaceForShellcode) {
-            printf("Error allocating space for the shellcode: %d\n", GetLastError());
-            free(mineLocations);
-            return 1;
-        }
-
-        // Allocate space in the remote process for us to write our arguments to
-        LPVOID spaceForParameter = VirtualAllocEx(hMineSweeper, NULL, sizeof(struct parameters_s), \
-                                                  MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-        if (!spaceForParameter) {
-            printf("Error allocating space for the shellcode parameters: %d\n", GetLastError());
-            free(mineLocations);
-            VirtualFreeEx(hMineSweeper, spaceForShellcode, SHELLCODE_LENGTH, MEM_RELEASE);
-            return 1;
-        }
-
-        // Dynamically calculate the operand for the CALL instruction in the shellcode
-        int callOpOffset = ((int)baseAddr + FLAG_TILE_FUNCTION) \
-                           - ((int)spaceForShellcode + INST_AFTER_CALL_OFFSET);
-        
-        // Copy the bytes over to an unsigned char array. No need to reverse the byte
-        // ordering as they're already reversed in memory
-        memcpy(shellcode + SHELLCODE_CALL_OFFSET, &callOpOffset, sizeof(int));
-
-        // Write the shellcode to memory
-        if (!WriteProcessMemory(hMineSweeper, spaceForShellcode, (LPCVOID)shellcode, SHELLCODE_LENGTH, \
-                                &bytesWritten)) {
+    // Find every mine that doesn't have a flag yet
+    geometry.scan(&geometry, mineField, &counts);
+    if (counts.exploded) {
+        printf("Found an exploded mine. The game is already over. Start a new game first\n");
+        free(mineLocations);
+        return 0;
+    }
+    if (!counts.unflaggedMines) {
+        free(mineLocations);
+        return 0;
+    }
+    memcpy(flagged, mineField, MINEFIELD_SIZE);
+    minesFound = geometry.flag(&geometry, flagged, mineLocations, numMines);
+    if (minesFound > numMines) minesFound = numMines;
+
+    // Change the mines that are question marks to blank tiles. Otherwise the
+    // flag function would just clear the question mark
+    for (DWORD i = 0; i < minesFound; i++) {
+        currOffset = (DWORD)GeometryOffset(&geometry, (DWORD)mineLocations[i].x, (DWORD)mineLocations[i].y);
+        if (mineField[currOffset] != (MINE | QUESTION_MARK)) continue;
+
+        start = TRACE_START();
+        if (!WriteProcessMemory(hMineSweeper, (LPVOID)(baseAddr + offsets->minefield + currOffset), \
+                                (LPCVOID)&buff, 1, &bytesWritten)) {
             printf("Error calling WriteProcessMemory: %d\n", GetLastError());
             free(mineLocations);
-            VirtualFreeEx(hMineSweeper, spaceForShellcode, SHELLCODE_LENGTH, MEM_RELEASE);
-            VirtualFreeEx(hMineSweeper, spaceForParameter, sizeof(struct parameters_s), MEM_RELEASE);
             return 1;
         }
+        TRACE_END(TRACE_WRITE, start, 1);
+    }
 
-        // For each mine location, mark it as flagged
-        for (int i = 0; i < (int)numMines; i++) {
-
-            // Get the location of the mine relative to the start of the mine
-            // field in the target process
-            currOffset = mineLocations[i].x + mineLocations[i].y*32;
-
-            // First make sure the tile doesn't already have a flag
-            if (mineField[currOffset] == (FLAG | MINE)) continue;
-
-            // Change the mine to a blank tile if it's a question mark
-            if (mineField[currOffset] == (MINE | QUESTION_MARK)) {
-                if (!WriteProcessMemory(hMineSweeper, \
-                                       (LPVOID)(baseAddr + MINEFIELD_OFFSET + currOffset), \
-                                       (LPCVOID)&buff, 1, &bytesWritten)) {
-                    printf("Error calling WriteProcessMemory: %d\n", GetLastError());
-                    free(mineLocations);
-                    errorCode = 1;
-                    break;
-                }
-            }
-
-            // Call the function in minesweeper to add a flag. Will need to allocate memory in
-            // the target process, write a struct containing x, y coord to mem, pass the struct as the param
-            if (!WriteProcessMemory(hMineSweeper, spaceForParameter, &(mineLocations[i]), \
-                                    sizeof(struct parameters_s), &bytesWritten)) {
-                printf("Error calling WriteProcessMemory: %d\n", GetLastError());
-                errorCode = 1;
-                break;
-            }
+    // Allocate space in the remote process for the stub and every mine location
+    batchSize = FlagBatchSize(minesFound);
+    batch = (unsigned char*)malloc(batchSize);
+    start = TRACE_START();
+    spaceForBatch = VirtualAllocEx(hMineSweeper, NULL, batchSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+    TRACE_END(TRACE_ALLOC, start, batchSize);
+    if (!batch || !spaceForBatch) {
+        printf("Error allocating space for the shellcode: %d\n", GetLastError());
+        free(batch);
+        free(mineLocations);
+        return 1;
+    }
 
-            // Create the remote thread and wait for it to finish executing.
-            // Otherwise, we could overwrite spaceForParameter before the
-            // thread gets a chance to use it.
-            hThread = CreateRemoteThread(hMineSweeper, NULL, 0, (LPTHREAD_START_ROUTINE)spaceForShellcode,\
-                                         spaceForParameter, 0, NULL);
-            if (!hThread) {
-                printf("Error calling CreateRemoteThread: %d\n", GetLastError());
+    // Point the stub's CALL at the flag function and write everything over at once
+    BuildFlagBatch(batch, (uint32_t)(uintptr_t)spaceForBatch, baseAddr + offsets->flagTileFunction, \
+                   mineLocations, minesFound);
+    start = TRACE_START();
+    if (!WriteProcessMemory(hMineSweeper, spaceForBatch, (LPCVOID)batch, batchSize, &bytesWritten)) {
+        printf("Error calling WriteProcessMemory: %d\n", GetLastError());
+        errorCode = 1;
+    }
+    TRACE_END(TRACE_WRITE, start, batchSize);
+
+    // One thread flags the whole board
+    if (!errorCode) {
+        start = TRACE_START();
+        hThread = CreateRemoteThread(hMineSweeper, NULL, 0, (LPTHREAD_START_ROUTINE)spaceForBatch, \
+                                     (LPVOID)((BYTE*)spaceForBatch + FLAG_BATCH_OFFSET), 0, NULL);
+        TRACE_END(TRACE_CREATE_THREAD, start, 0);
+        if (!hThread) {
+            printf("Error calling CreateRemoteThread: %d\n", GetLastError());
+            errorCode = 1;
+        }
+        else {
+            // If the thread is still running we can't free the memory out from under it
+            start = TRACE_START();
+            waitResult = WaitForSingleObject(hThread, FLAG_BATCH_TIMEOUT);
+            TRACE_END(TRACE_WAIT_THREAD, start, 0);
+            if (waitResult != WAIT_OBJECT_0) {
+                printf("Flagging thread didn't finish in time. Leaving its memory allocated\n");
+                spaceForBatch = NULL;
                 errorCode = 1;
-                break;
             }
-            WaitForSingleObject(hThread, 1000);
             CloseHandle(hThread);
         }
-        VirtualFreeEx(hMineSweeper, spaceForShellcode, SHELLCODE_LENGTH, MEM_RELEASE);
-        VirtualFreeEx(hMineSweeper, spaceForParameter, sizeof(struct parameters_s), MEM_RELEASE);
-    } // END if (!foundExplodedMine)
-    else {
-        printf("Found an exploded mine. The game is already over. Start a new game first\n");
+    }
+    if (spaceForBatch) {
+        start = TRACE_START();
+        VirtualFreeEx(hMineSweeper, spaceForBatch, 0, MEM_RELEASE);
+        TRACE_END(TRACE_FREE, start, 0);
     }
 
     // "-STEP ON YOUR RIGHT FOOT- FREE YOUR MEMORY ALLOCATIONS, DON'T FORGET IT"
     //     - Spongebob Squarepants on dynamic memory allocation
+    free(batch);
     free(mineLocations);
 
     return errorCode;
 }
 
-int SetMineMetadata(HANDLE hMineSweeper, DWORD* numMines, DWORD* height, DWORD* width, \
-                    unsigned char* mineField, DWORD baseAddr) {
+#endif
+
+#ifdef _WIN32
+int FlagInstance(Instance* instance, void* context) {
+/**
+ * Purpose: Instance action that flags every mine in one game, then reads it
+ *          again so the report shows the flags
+ * @param instance : Instance* - the game
+ * @param context : void* - unused
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    (void)context;
+    if (TakeSnapshot(&instance->session.source, &instance->snapshot)) return 1;
+    if (FlagAllMines(instance->session.hProcess, (DWORD)instance->session.baseAddr, &instance->session.offsets, \
+                     instance->snapshot.width, instance->snapshot.height, SNAPSHOT_FIELD(&instance->snapshot), instance->snapshot.numMines)) {
+        return 1;
+    }
+    return TakeSnapshot(&instance->session.source, &instance->snapshot);
+}
+#endif
+
+int DirectFlagInstance(Instance* instance, void* context) {
+/**
+ * Purpose: Instance action that flags every mine in one game by writing its
+ *          minefield, then reads it again so the report shows the flags
+ * @param instance : Instance* - the game
+ * @param context : void* - unused
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    DirectFlagPlan plan;  // Only this game's
+
+    (void)context;
+    if (DirectFlagAllMines(&instance->session.source, &instance->session.offsets, &instance->snapshot, &plan)) return 1;
+    return TakeSnapshot(&instance->session.source, &instance->snapshot);
+}
+
+int RunOnAllGames(InstanceSet* games, ThreadPool* pool, const char* action) {
+/**
+ * Purpose: Finds every running game and does the same thing to all of them
+ *          at once, then prints one report for the lot
+ * @param games : InstanceSet* - the games attached to so far
+ * @param pool : ThreadPool* - the workers
+ * @param action : const char* - info, snapshot (info plus every minefield), flag or write (flag by writing the field)
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    // Local variables
+    InstanceReport report;          // Every game's results added up
+    InstanceAction run = SnapshotInstance;
+
+    if (strcmp(action, "flag") == 0) {
+#ifdef _WIN32
+        run = FlagInstance;
+#else
+        printf("Flagging with a remote thread is only supported on Windows\n\n");
+        return 1;
+#endif
+    }
+    else if (strcmp(action, "write") == 0) run = DirectFlagInstance;
+    else if (strcmp(action, "info") != 0 && strcmp(action, "snapshot") != 0) {
+        printf("Unknown action %s. Use info, snapshot, flag or write\n\n", action);
+        return 1;
+    }
+
+    if (!FindInstances(games)) {
+        printf("Unable to find any %s processes. Are they running?\n\n", games->processName);
+        return 1;
+    }
+
+    RunOnInstances(pool, games, games->numInstances, run, NULL, &report);
+
+    // Printing isn't done on the workers or the fields would come out interleaved
+    if (strcmp(action, "snapshot") == 0) {
+        for (int i = 0; i < games->numInstances; i++) {
+            Snapshot* snapshot = &games->instances[i].snapshot;
+            if (games->instances[i].status || snapshot->width < 1 || snapshot->width > MAX_WIDTH) continue;
+            printf("Process %u\n", games->instances[i].session.PID);
+            PrintMineField(SNAPSHOT_FIELD(snapshot), snapshot->height, snapshot->width);
+        }
+    }
+    PrintInstanceReport(games, &report);
+
+    return report.numFailed != 0;
+}
+
+int SetMineMetadata(MemorySource* source, DWORD* numMines, DWORD* height, DWORD* width, \
+                    unsigned char* mineField) {
 /**
  * Purpose: Sets information about the current minesweeper game including the
- *          dimensions of the minefield, the minefield itself, and the number of mines
- * @param hMineSweeper : HANDLE - process handle to minesweeper with PROCESS_ALL_ACCESS
+ *          dimensions of the minefield, the minefield itself, and the number of mines.
+ *          Everything is pulled out of a single snapshot read
+ * @param source : MemorySource* - where to read minesweeper's memory from
  * @param numMines : DWORD* - the total number of mines in the minefield
  * @param height : DWORD* - the height of the minefield
  * @param width : DWORD* - the width of the minefield
  * @param mineField : unsigned char* - the minefield
- * @param baseAddr : DWORD - Base address of the minesweeper module in the minesweeper process
  * @return int - 0 if success, 1 if failure. Otherwise, all data "returned"
  *         is set in the parameter pointers
  */
 
     // Local Variables
-    SIZE_T bytesRead;               // Number of bytes read by ReadProcessMemory
-    SIZE_T bytesToRead = 4;         // Number of bytes we want ReadProcessMemory to read
-    unsigned int buff;              // Pointer to data read by ReadProcessMemory
-
-    // Getting the number of mines
-    if (!ReadProcessMemory(hMineSweeper, (LPCVOID)(baseAddr + NUM_MINES_OFFSET), \
-                          (LPVOID)numMines, bytesToRead, &bytesRead)) {
-        printf("Error reading the number of mines from memory: %d\n", GetLastError());
-        return 1;
-    }
+    Snapshot snapshot;  // Mine count, dimensions and minefield in one buffer
+    int status;
 
-    // Get the height of the minefield
-    bytesToRead = 1;
-    if (!ReadProcessMemory(hMineSweeper, (LPCVOID)(baseAddr + HEIGHT_OFFSET), \
-        (LPVOID)&buff, bytesToRead, &bytesRead)) {
-        printf("Error reading the height of minefield from memory: %d\n", GetLastError());
-        return 1;
-    }
-    *height = (DWORD)buff;
-
-    // Get the width of the minefield
-    if (!ReadProcessMemory(hMineSweeper, (LPCVOID)(baseAddr + WIDTH_OFFSET), \
-        (LPVOID)&buff, bytesToRead, &bytesRead)) {
-        printf("Error reading the width of minefield from memory: %d\n", GetLastError());
-        return 1;
+    status = TakeSnapshot(source, &snapshot);
+    if (status == SNAPSHOT_NOT_A_GAME) {
+        printf("Snapshot doesn't look like a minefield (width %u, height %u, mines %u)\n", \
+               snapshot.width, snapshot.height, snapshot.numMines);
     }
-    *width = (DWORD)buff;
+    if (status) return 1;
 
-    // Read the minefield
-    bytesToRead = MINEFIELD_SIZE;
-    if (!ReadProcessMemory(hMineSweeper, (LPCVOID)(baseAddr + MINEFIELD_OFFSET), \
-        mineField, bytesToRead, &bytesRead)) {
-        printf("Error reading the minefield from memory: %d\n", GetLastError());
-        return 1;
-    }
+    *numMines = snapshot.numMines;
+    *height   = snapshot.height;
+    *width    = snapshot.width;
+    memcpy(mineField, SNAPSHOT_FIELD(&snapshot), MINEFIELD_SIZE);
 
     return 0;
 }
@@ -407,15 +534,35 @@ int main(void) {
 
     // Local variables
     char* mineSweeperName     = "winmine.exe";            // Name of minesweeper exe
-    size_t lenMineSweeperName = strlen(mineSweeperName);  // length of exe name
     char input = '0';               // The user's selection
-    DWORD MineSweeperPID;           // PID of minesweeper
-    DWORD baseAddr;                 // Base address of the minesweeper module in the minesweeper process
-    HANDLE hMineSweeper;            // Handle with full permissions to winmine
+    Session session;                // PID, base address and handle of minesweeper. Looked up once
     unsigned char buff[BUFF_SIZE];  // Pointer to array of minefield data
     DWORD numMines;                 // Number of mines in the minefield
     DWORD height;                   // How high is our minefield?
     DWORD width;                    // The girth of our minefield
+    WatchConfig watchConfig;        // How often to poll in watch mode
+    static WatchStats watchStats;   // Latency and change counters from watch mode
+    unsigned long long commandStart;  // When the current menu action started
+    char logPath[256];              // Where option 8 records to
+    unsigned int recordInterval;    // How often option 8 or d polls
+    BoardMetrics boardMetrics;      // 3BV, openings and islands for option 9
+    char traceFormat[8];            // json or csv for option 0
+    int tracing = 0;                // Whether option 0 started a trace. Option 4 leaves it recording
+    static InstanceSet games;       // Every running game for option a. Too big for the stack
+    static ThreadPool gamePool;     // Works on up to INSTANCE_WORKERS games at once. Started on first use
+    int gamePoolStarted = 0;
+    char gameAction[16];            // What option a does to every game
+    static const char* offsetSources[3] = { "built-in", "scanned", "cached" };
+    static Snapshot flagSnapshot;   // What option b diffs against. Too big for the stack
+    static DirectFlagPlan flagPlan; // What option b wrote
+    unsigned long long writesBefore, bytesBefore;
+    unsigned long long flagStart;   // When option 3 or b started, if tracing
+    AutoplayTarget autoplayTarget;  // Where option c clicks
+    AutoplayConfig autoplayConfig;
+    AutoplayStats autoplayStats;
+
+    InitSession(&session, mineSweeperName);
+    InitInstanceSet(&games, mineSweeperName);
 
     while (input != '5') {
 
@@ -426,36 +573,42 @@ int main(void) {
             " 3) Flag all mines\n"
             " 4) Toggle debug messages\n"
             " 5) Exit\n"
+            " 6) Watch minefield (press a key to stop)\n"
+            " 7) Honest helper (safe tiles from visible numbers only)\n"
+            " 8) Record game to a log (press a key to stop)\n"
+            " 9) Print board metrics (3BV, openings and islands)\n"
+            " 0) Trace timings (pick again to save them as JSON or CSV)\n"
+            " a) Every running game at once (info, snapshot, flag or write)\n"
+            " b) Flag all mines by writing the minefield (no remote thread)\n"
+            " c) Autoplay the game to the end\n"
+            " d) Publish the board to shared memory for other tools (press a key to stop)\n"
             "Select an option: ");
         input = (char)getc(stdin);
 
         // Not sure the best way to deal with the newline character when getting a char
         while (input == '\n') input = (char)getc(stdin);
 
-        if (input == '1' || input == '2' || input == '3') {
-            // Get the PID of the minesweeper process
-            MineSweeperPID = GetProcessPID(mineSweeperName);
-            if (!MineSweeperPID) continue;
+        if (input == '1' || input == '2' || input == '3' || input == '6' || input == '7' || \
+            input == '8' || input == '9' || input == 'b' || input == 'c' || input == 'd') {
+            commandStart = NowNs();
 
-            // Get the base address of the module in memory
-            baseAddr = (DWORD)GetModuleBaseAddress(MineSweeperPID, mineSweeperName, lenMineSweeperName);
-            if (!baseAddr) continue;
-
-            // Open the process
-            hMineSweeper = OpenProcess(PROCESS_ALL_ACCESS, FALSE, MineSweeperPID);
-            if (!hMineSweeper) {
-                printf("Unable to get a handle to minesweeper using OpenProcess: %d\n", GetLastError());
-                return 1;
-            }
+            // Find and open minesweeper, unless we're still attached from last time
+            if (EnsureSession(&session)) continue;
 
             // Get metadata about the minefield
-            if (SetMineMetadata(hMineSweeper, &numMines, &height, &width, buff, baseAddr)) { continue; }
+            if (SetMineMetadata(&session.source, &numMines, &height, &width, buff)) {
+                CloseSession(&session);
+                continue;
+            }
 
             // Interpret the input
             switch (input) {
                 case '1':  // Print info
-                    printf("PID: %d\t\tHeight: %d\t\tWidth: %d\t\tMines: %d\n\n", \
-                           MineSweeperPID, height, width, numMines);
+                    printf("PID: %d\t\tHeight: %d\t\tWidth: %d\t\tMines: %d\n", \
+                           session.PID, height, width, numMines);
+                    printf("Offsets (%s): flag function 0x%x, minefield 0x%x, mines left 0x%x\n\n", \
+                           offsetSources[session.offsetsFrom], session.offsets.flagTileFunction, \
+                           session.offsets.minefield, session.offsets.minesRemaining);
                     break;
 
                 case '2':  // Print minefield
@@ -463,23 +616,111 @@ int main(void) {
                     break;
 
                 case '3':  // Flag all mines
-                    FlagAllMines(hMineSweeper, baseAddr, width, height, buff, numMines);
+#ifdef _WIN32
+                    flagStart = TRACE_START();
+                    FlagAllMines(session.hProcess, (DWORD)session.baseAddr, &session.offsets, width, height, buff, numMines);
+                    TRACE_END(TRACE_FLAG_ALL, flagStart, 0);
+#else
+                    printf("Flagging with a remote thread is only supported on Windows\n");
+#endif
+                    break;
+
+                case '6':  // Watch minefield
+                    InitWatchConfig(&watchConfig);
+                    printf("Poll interval in milliseconds: ");
+                    if (scanf("%u", &watchConfig.intervalMs) != 1) watchConfig.intervalMs = WATCH_INTERVAL_MS;
+                    watchConfig.onPoll = StopOnKeyPress;
+                    WatchMineField(&session.source, &watchConfig, &watchStats);
+                    PrintWatchStats(&watchStats);
+                    break;
+
+                case '7':  // Honest helper
+                    PrintHonestHelp(buff, height, width, numMines);
+                    break;
+
+                case '8':  // Record game
+                    printf("Log file: ");
+                    if (scanf("%255s", logPath) != 1) break;
+                    printf("Poll interval in milliseconds: ");
+                    if (scanf("%u", &recordInterval) != 1) recordInterval = WATCH_INTERVAL_MS;
+                    RecordGame(&session.source, logPath, recordInterval);
+                    break;
+
+                case '9':  // Board metrics
+                    if (MeasureBoard(buff, width, height, numMines, 1, &boardMetrics)) {
+                        printf("Can't measure a %ux%u board. Is a game open?\n\n", width, height);
+                        break;
+                    }
+                    printf("3BV: %u\t\tOpenings: %u\t\tIslands: %u\t\tDensity: %.1f%%\n", boardMetrics.bbbv, \
+                           boardMetrics.openings, boardMetrics.islands, boardMetrics.density*100.0);
+                    printf("Winnable without guessing from the first opening: %s\n\n", \
+                           boardMetrics.logicSolvable == 1 ? "yes" : "no");
+                    break;
+
+                case 'b':  // Flag all mines by writing the field
+                    writesBefore = session.source.numWrites;
+                    bytesBefore  = session.source.bytesWritten;
+                    flagStart = TRACE_START();
+                    if (DirectFlagAllMines(&session.source, &session.offsets, &flagSnapshot, &flagPlan)) break;
+                    TRACE_END(TRACE_FLAG_ALL, flagStart, flagPlan.bytesToWrite);
+                    printf("Flagged %u mines: %d ranges in %llu writes, %llu bytes\n\n", flagPlan.minesFlagged, \
+                           flagPlan.numRanges, session.source.numWrites - writesBefore, \
+                           session.source.bytesWritten - bytesBefore);
+                    break;
+
+                case 'c':  // Autoplay. The reader and clicker run on the game pool
+                    if (!gamePoolStarted) gamePoolStarted = !StartThreadPool(&gamePool, INSTANCE_WORKERS);
+                    if (OpenAutoplayTarget(&autoplayTarget, &session)) break;
+                    InitAutoplayConfig(&autoplayConfig);
+                    AutoplayGame(gamePoolStarted ? &gamePool : NULL, &autoplayTarget, &autoplayConfig, &autoplayStats);
+                    PrintAutoplayStats(&autoplayStats);
+                    break;
+
+                case 'd':  // Publish the board for other tools
+                    printf("Poll interval in milliseconds: ");
+                    if (scanf("%u", &recordInterval) != 1) recordInterval = WATCH_INTERVAL_MS;
+                    PublishGame(&session.source, recordInterval);
             }
 
-            // Clean up
-            CloseHandle(hMineSweeper);
+            DEBUG_PRINT("Command took %.1f us (%llu attaches so far)\n", \
+                        (NowNs() - commandStart) / 1000.0, session.attaches);
         }
         else {
             // Interpret the input
             switch (input) {
-                case '4':  // Toggle debug messages
-                    if (debug) {
+                case '0':  // Trace
+                    if (!tracing) {
+                        tracing = 1;
+                        if (traceLevel == TRACE_OFF) SetTraceLevel(TRACE_RECORD);
+                        printf("Tracing started. Do what you want to measure, then pick 0 again to save it\n\n");
+                        break;
+                    }
+                    printf("Format (json or csv): ");
+                    if (scanf("%7s", traceFormat) != 1) break;
+                    printf("File (- for the screen): ");
+                    if (scanf("%255s", logPath) != 1) break;
+                    SaveTrace(logPath, strcmp(traceFormat, "csv") == 0 ? TRACE_CSV : TRACE_JSON);
+
+                    // Saving stops the trace. Debug messages keep theirs
+                    tracing = 0;
+                    if (traceLevel == TRACE_RECORD) SetTraceLevel(TRACE_OFF);
+                    break;
+
+                case 'a':  // Every running game
+                    printf("Action (info, snapshot, flag or write): ");
+                    if (scanf("%15s", gameAction) != 1) break;
+                    if (!gamePoolStarted) gamePoolStarted = !StartThreadPool(&gamePool, INSTANCE_WORKERS);
+                    RunOnAllGames(&games, gamePoolStarted ? &gamePool : NULL, gameAction);
+                    break;
+
+                case '4':  // Toggle debug messages. Debugging traces too
+                    if (traceLevel == TRACE_VERBOSE) {
                         printf("Debugging disabled\n");
-                        debug = 0;
+                        SetTraceLevel(tracing ? TRACE_RECORD : TRACE_OFF);
                     }
                     else {
                         printf("Debugging enabled\n");
-                        debug = 1;
+                        SetTraceLevel(TRACE_VERBOSE);
                     }
 
                 case '5':  // Exit
@@ -491,5 +732,8 @@ int main(void) {
         }
     }  // End interactive while loop
 
+    if (gamePoolStarted) StopThreadPool(&gamePool);
+    CloseInstances(&games);
+    CloseSession(&session);
     return 0;
 }
\ No newline at end of file
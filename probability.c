@@ -0,0 +1,763 @@
+/**
+ * Purpose: Exact mine probabilities. See probability.h
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"probability.h"
+#include"tileDecode.h"
+
+#define NO_STATE  0xFFFFFFFFu
+
+// A group of frontier tiles and the numbers around them
+typedef struct component_s {
+    const SolverResult* solved;    // Where the constraints live
+    ProbabilityCache* cache;       // Where counted groups are remembered
+    DWORD numTiles;
+    unsigned short* tiles;         // Offsets (x + y*32) in ascending order
+    DWORD numConstraints;
+    unsigned short* constraints;   // Indexes into solved->constraints, in ascending order
+    double* weights;               // Arrangements using k mines, k = 0..numTiles
+    double* tileWeights;           // Of those, the ones with tile t mined: [t*(numTiles + 1) + k]
+    unsigned long long states;     // Sweep states visited
+    int cacheHit;                  // Non-zero if the cache had the answer
+    int status;                    // 0 on success, 1 if the group was too big to count
+} Component;
+
+// Counting a group is a sweep over its tiles in a fixed order. After t tiles
+// the only thing that matters about the choices made so far is how many
+// mines each half-counted number has seen. Arrangements that agree on that
+// are counted together, which is what keeps a long frontier from blowing up
+typedef struct sweepState_s {
+    unsigned char key[PROB_MAX_OPEN/2];  // Mines seen by each open number, 4 bits each
+    unsigned int forward;    // Offset of the counts of ways to get here, by mines used so far
+    unsigned int backward;   // Offset of the counts of ways to finish from here, by mines still to place
+    unsigned int next[2];    // State after the next tile is safe (0) or a mine (1)
+} SweepState;
+
+typedef struct sweep_s {
+    SweepState* states;
+    DWORD numStates;
+    DWORD maxStates;
+    double* weights;         // Every forward and backward count
+    DWORD numWeights;
+    DWORD maxWeights;
+    unsigned int* table;     // Hash of the layer being built
+    DWORD tableSize;
+} Sweep;
+
+static ProbabilityCache sharedCache;  // For callers that don't bring their own
+static int sharedCacheReady = 0;
+
+static void EmptyCache(ProbabilityCache* cache) {
+/**
+ * Purpose: Frees every entry in a cache. The caller holds its lock
+ * @param cache : ProbabilityCache* - the cache
+ * @return : void
+ */
+
+    for (DWORD i = 0; i < PROB_CACHE_SLOTS; i++) {
+        free(cache->entries[i].signature);
+        free(cache->entries[i].weights);
+        memset(&cache->entries[i], 0, sizeof(ProbabilityCacheEntry));
+    }
+}
+
+void ClearProbabilityCache(void) {
+/**
+ * Purpose: Forgets every group in the shared cache. The first call also sets
+ *          the cache up, so call it once before using the engine from several
+ *          threads at a time
+ * @return : void
+ */
+
+    if (!sharedCacheReady) {
+        InitProbabilityCache(&sharedCache);
+        sharedCacheReady = 1;
+    }
+
+    AcquireLock(&sharedCache.lock);
+    EmptyCache(&sharedCache);
+    ReleaseLock(&sharedCache.lock);
+}
+
+void InitProbabilityCache(ProbabilityCache* cache) {
+/**
+ * Purpose: Sets up an empty cache of the caller's own
+ * @param cache : ProbabilityCache* - the cache
+ * @return : void
+ */
+
+    memset(cache->entries, 0, sizeof(cache->entries));
+    InitLock(&cache->lock);
+}
+
+void FreeProbabilityCache(ProbabilityCache* cache) {
+/**
+ * Purpose: Frees everything a cache from InitProbabilityCache remembered
+ * @param cache : ProbabilityCache* - the cache
+ * @return : void
+ */
+
+    EmptyCache(cache);
+    DestroyLock(&cache->lock);
+}
+
+static unsigned int BuildSignature(const Component* component, unsigned char* signature, unsigned long long* hash) {
+/**
+ * Purpose: Describes a group independent of where it sits on the board.
+ *          Its tiles plus the position and mine count of each number are
+ *          enough: every covered unknown tile around a number is in the group
+ * @param component : const Component* - the group
+ * @param signature : unsigned char* - receives the description
+ * @param hash : unsigned long long* - receives an FNV-1a hash of it
+ * @return : unsigned int - bytes written to signature
+ */
+
+    DWORD minX = MAX_WIDTH + 1;
+    DWORD minY = component->tiles[0] / ROW_STRIDE;  // Tiles are sorted so the first is in the top row
+    unsigned int length = 0;
+
+    for (DWORD i = 0; i < component->numTiles; i++) {
+        if (component->tiles[i] % ROW_STRIDE < minX) minX = component->tiles[i] % ROW_STRIDE;
+    }
+
+    // Numbers can sit one row or column before the first tile
+    for (DWORD i = 0; i < component->numTiles; i++) {
+        signature[length++] = (unsigned char)(component->tiles[i] % ROW_STRIDE + 1 - minX);
+        signature[length++] = (unsigned char)(component->tiles[i] / ROW_STRIDE + 1 - minY);
+    }
+    signature[length++] = 0xFF;  // Tiles never use this so it separates them from the numbers
+    for (DWORD i = 0; i < component->numConstraints; i++) {
+        const Constraint* constraint = &component->solved->constraints[component->constraints[i]];
+        signature[length++] = (unsigned char)(constraint->x + 1 - minX);
+        signature[length++] = (unsigned char)(constraint->y + 1 - minY);
+        signature[length++] = (unsigned char)constraint->mines;
+    }
+
+    *hash = 0xCBF29CE484222325ULL;
+    for (unsigned int i = 0; i < length; i++) {
+        *hash ^= signature[i];
+        *hash *= 0x100000001B3ULL;
+    }
+
+    return length;
+}
+
+static int GrowSweep(Sweep* sweep, DWORD states, DWORD weights) {
+/**
+ * Purpose: Makes room for more states and counts
+ * @param sweep : Sweep* - the sweep
+ * @param states : DWORD - states about to be added
+ * @param weights : DWORD - counts about to be added
+ * @return : int - 0 on success, 1 if the sweep is too big or out of memory
+ */
+
+    if (sweep->numStates + states > sweep->maxStates) {
+        DWORD maxStates = sweep->maxStates ? sweep->maxStates*2 : 1024;
+        SweepState* grown = (SweepState*)realloc(sweep->states, maxStates*sizeof(SweepState));
+        if (!grown) return 1;
+        sweep->states = grown;
+        sweep->maxStates = maxStates;
+    }
+
+    if (sweep->numWeights + weights > sweep->maxWeights) {
+        DWORD maxWeights = sweep->maxWeights ? sweep->maxWeights*2 : 16384;
+        double* grown;
+        while (maxWeights < sweep->numWeights + weights) maxWeights *= 2;
+        if (maxWeights > PROB_MAX_WEIGHTS) return 1;
+        grown = (double*)realloc(sweep->weights, maxWeights*sizeof(double));
+        if (!grown) return 1;
+        sweep->weights = grown;
+        sweep->maxWeights = maxWeights;
+    }
+
+    return 0;
+}
+
+static unsigned int HashKey(const unsigned char* key) {
+/**
+ * Purpose: Hashes a sweep state's key
+ * @param key : const unsigned char* - PROB_MAX_OPEN/2 bytes
+ * @return : unsigned int - the hash
+ */
+
+    unsigned int hash = 2166136261u;
+    for (DWORD i = 0; i < PROB_MAX_OPEN/2; i++) hash = (hash ^ key[i]) * 16777619u;
+    return hash;
+}
+
+static DWORD FindState(Sweep* sweep, DWORD layerStart, const unsigned char* key, DWORD forwardLength) {
+/**
+ * Purpose: Finds the state with key in the layer being built, adding it
+ *          (with zeroed forward counts) if it isn't there yet
+ * @param sweep : Sweep* - the sweep
+ * @param layerStart : DWORD - index of the layer's first state
+ * @param key : const unsigned char* - the state's key
+ * @param forwardLength : DWORD - number of forward counts a state in this layer has
+ * @return : DWORD - index of the state, or NO_STATE if the sweep got too big
+ */
+
+    DWORD layerSize = sweep->numStates - layerStart;
+    DWORD slot;
+
+    // Keep the table at most half full
+    if ((layerSize + 1)*2 > sweep->tableSize) {
+        DWORD tableSize = sweep->tableSize ? sweep->tableSize*2 : 256;
+        unsigned int* table = (unsigned int*)malloc(tableSize*sizeof(unsigned int));
+        if (!table) return NO_STATE;
+        memset(table, 0xFF, tableSize*sizeof(unsigned int));
+        for (DWORD i = layerStart; i < sweep->numStates; i++) {
+            slot = HashKey(sweep->states[i].key) & (tableSize - 1);
+            while (table[slot] != NO_STATE) slot = (slot + 1) & (tableSize - 1);
+            table[slot] = i;
+        }
+        free(sweep->table);
+        sweep->table = table;
+        sweep->tableSize = tableSize;
+    }
+
+    slot = HashKey(key) & (sweep->tableSize - 1);
+    while (sweep->table[slot] != NO_STATE) {
+        if (memcmp(sweep->states[sweep->table[slot]].key, key, PROB_MAX_OPEN/2) == 0) return sweep->table[slot];
+        slot = (slot + 1) & (sweep->tableSize - 1);
+    }
+
+    if (GrowSweep(sweep, 1, forwardLength)) return NO_STATE;
+    SweepState* state = &sweep->states[sweep->numStates];
+    memcpy(state->key, key, PROB_MAX_OPEN/2);
+    state->forward  = sweep->numWeights;
+    state->backward = 0;
+    state->next[0]  = NO_STATE;
+    state->next[1]  = NO_STATE;
+    memset(sweep->weights + sweep->numWeights, 0, forwardLength*sizeof(double));
+    sweep->numWeights += forwardLength;
+
+    sweep->table[slot] = sweep->numStates;
+    return sweep->numStates++;
+}
+
+static int CountComponent(Component* component) {
+/**
+ * Purpose: Counts a group's arrangements by mines used, in total and with
+ *          each tile mined. One forward sweep counts the ways to reach each
+ *          state, one backward sweep the ways to finish from it, and a tile's
+ *          counts come from pairing the two across that tile
+ * @param component : Component* - the group. Its weights must be allocated
+ * @return : int - 0 on success, 1 if the group was too big to count
+ */
+
+    DWORD n = component->numTiles;
+    DWORD m = component->numConstraints;
+    short local[ROW_STRIDE*BITBOARD_ROWS];  // Offset to index in component->tiles
+    unsigned short order[MAX_WIDTH*MAX_HEIGHT];   // Sweep order, as indexes into component->tiles
+    DWORD position[MAX_WIDTH*MAX_HEIGHT];         // Where each tile falls in the sweep
+    unsigned char tileCons[MAX_WIDTH*MAX_HEIGHT][8];   // Numbers touching each tile
+    unsigned char numTileCons[MAX_WIDTH*MAX_HEIGHT];
+    unsigned short* consTiles;    // Tiles around each number, 8 per number
+    unsigned char* numConsTiles;
+    DWORD* first;                 // Sweep position of each number's first and last tile
+    DWORD* last;
+    unsigned char* slot;          // Which 4 bits of the key each number uses while open
+    DWORD* layerStart;            // Index of the first state after t tiles
+    Sweep sweep;
+    int status = 1;
+
+    memset(&sweep, 0, sizeof(Sweep));
+    consTiles    = (unsigned short*)malloc(m*8*sizeof(unsigned short));
+    numConsTiles = (unsigned char*)calloc(m, 1);
+    first        = (DWORD*)malloc(m*sizeof(DWORD));
+    last         = (DWORD*)malloc(m*sizeof(DWORD));
+    slot         = (unsigned char*)malloc(m);
+    layerStart   = (DWORD*)malloc((n + 2)*sizeof(DWORD));
+    if (!consTiles || !numConsTiles || !first || !last || !slot || !layerStart) goto done;
+
+    for (DWORD t = 0; t < n; t++) {
+        local[component->tiles[t]] = (short)t;
+        numTileCons[t] = 0;
+    }
+    for (DWORD c = 0; c < m; c++) {
+        const Constraint* constraint = &component->solved->constraints[component->constraints[c]];
+        for (DWORD r = 0; r < 3; r++) {
+            for (uint32_t bits = constraint->rows[r]; bits; bits &= bits - 1) {
+                DWORD t = (DWORD)local[CTZ32(bits) + (constraint->y - 1 + r)*ROW_STRIDE];
+                consTiles[c*8 + numConsTiles[c]++] = (unsigned short)t;
+                tileCons[t][numTileCons[t]++] = (unsigned char)c;
+            }
+        }
+    }
+
+    // Breadth first from the top left tile keeps the number of open numbers
+    // down to roughly the width of the frontier instead of its length
+    {
+        DWORD head = 0, tail = 0;
+        for (DWORD t = 0; t < n; t++) position[t] = NO_STATE;
+        order[tail++] = 0;
+        position[0] = 0;
+        while (head < tail) {
+            DWORD t = order[head++];
+            for (DWORD i = 0; i < numTileCons[t]; i++) {
+                DWORD c = tileCons[t][i];
+                for (DWORD j = 0; j < numConsTiles[c]; j++) {
+                    DWORD u = consTiles[c*8 + j];
+                    if (position[u] != NO_STATE) continue;
+                    position[u] = tail;
+                    order[tail++] = (unsigned short)u;
+                }
+            }
+        }
+    }
+
+    // Hand out key slots. A number holds one from its first tile to its last
+    {
+        unsigned int used = 0;  // Bit s set if slot s is taken
+        for (DWORD c = 0; c < m; c++) {
+            first[c] = NO_STATE;
+            last[c]  = 0;
+            for (DWORD j = 0; j < numConsTiles[c]; j++) {
+                DWORD p = position[consTiles[c*8 + j]];
+                if (p < first[c]) first[c] = p;
+                if (p > last[c]) last[c] = p;
+            }
+        }
+        for (DWORD p = 0; p < n; p++) {
+            DWORD t = order[p];
+            for (DWORD i = 0; i < numTileCons[t]; i++) {
+                DWORD c = tileCons[t][i];
+                if (first[c] != p) continue;
+                if (used == 0xFFFFFFFFu) goto done;  // More than PROB_MAX_OPEN open numbers
+                slot[c] = (unsigned char)CTZ32(~used);
+                used |= 1u << slot[c];
+            }
+            for (DWORD i = 0; i < numTileCons[t]; i++) {
+                DWORD c = tileCons[t][i];
+                if (last[c] == p) used &= ~(1u << slot[c]);
+            }
+        }
+    }
+
+    // Forward: every state after p tiles, and the ways to get there
+    {
+        unsigned char key[PROB_MAX_OPEN/2];
+        memset(key, 0, sizeof(key));
+        layerStart[0] = 0;
+        if (FindState(&sweep, 0, key, 1) == NO_STATE) goto done;
+        sweep.weights[0] = 1.0;
+    }
+
+    for (DWORD p = 0; p < n; p++) {
+        DWORD t = order[p];
+        layerStart[p + 1] = sweep.numStates;
+        memset(sweep.table, 0xFF, sweep.tableSize*sizeof(unsigned int));
+
+        for (DWORD s = layerStart[p]; s < layerStart[p + 1]; s++) {
+            for (DWORD mine = 0; mine <= 1; mine++) {
+                unsigned char key[PROB_MAX_OPEN/2];
+                int valid = 1;
+                DWORD next;
+
+                memcpy(key, sweep.states[s].key, sizeof(key));
+                for (DWORD i = 0; i < numTileCons[t] && valid; i++) {
+                    DWORD c = tileCons[t][i];
+                    int need = component->solved->constraints[component->constraints[c]].mines;
+                    int shift = (slot[c] & 1)*4;
+                    int seen = ((key[slot[c] >> 1] >> shift) & 0x0F) + (int)mine;
+                    int left = 0;  // Tiles of this number after this one
+
+                    for (DWORD j = 0; j < numConsTiles[c]; j++) {
+                        if (position[consTiles[c*8 + j]] > p) left++;
+                    }
+                    if (seen > need || seen + left < need) valid = 0;
+                    if (last[c] == p) seen = 0;  // Closed numbers leave the key
+                    key[slot[c] >> 1] = (unsigned char)((key[slot[c] >> 1] & ~(0x0F << shift)) | (seen << shift));
+                }
+                if (!valid) continue;
+
+                next = FindState(&sweep, layerStart[p + 1], key, p + 2);
+                if (next == NO_STATE) goto done;
+                sweep.states[s].next[mine] = next;
+
+                double* from = sweep.weights + sweep.states[s].forward;
+                double* to   = sweep.weights + sweep.states[next].forward + mine;
+                for (DWORD k = 0; k <= p; k++) to[k] += from[k];
+            }
+        }
+    }
+    layerStart[n + 1] = sweep.numStates;
+    component->states = sweep.numStates;
+
+    // Backward: the ways to finish from every state, by mines still to place
+    for (DWORD p = n + 1; p-- > 0;) {
+        DWORD length = n - p + 1;
+        if (GrowSweep(&sweep, 0, (layerStart[p + 1] - layerStart[p])*length)) goto done;
+
+        for (DWORD s = layerStart[p]; s < layerStart[p + 1]; s++) {
+            double* to = sweep.weights + sweep.numWeights;
+            sweep.states[s].backward = sweep.numWeights;
+            sweep.numWeights += length;
+            memset(to, 0, length*sizeof(double));
+
+            if (p == n) {
+                to[0] = 1.0;  // Every number closed, nothing left to place
+                continue;
+            }
+            for (DWORD mine = 0; mine <= 1; mine++) {
+                if (sweep.states[s].next[mine] == NO_STATE) continue;
+                double* from = sweep.weights + sweep.states[sweep.states[s].next[mine]].backward;
+                for (DWORD k = 0; k + 1 < length; k++) to[k + mine] += from[k];
+            }
+        }
+    }
+
+    memcpy(component->weights, sweep.weights + sweep.states[0].backward, (n + 1)*sizeof(double));
+
+    // Mined tile p: ways to reach the state before it times ways to finish after it
+    memset(component->tileWeights, 0, n*(n + 1)*sizeof(double));
+    for (DWORD p = 0; p < n; p++) {
+        double* tileWeights = component->tileWeights + order[p]*(n + 1);
+        for (DWORD s = layerStart[p]; s < layerStart[p + 1]; s++) {
+            if (sweep.states[s].next[1] == NO_STATE) continue;
+            const double* before = sweep.weights + sweep.states[s].forward;
+            const double* after  = sweep.weights + sweep.states[sweep.states[s].next[1]].backward;
+            for (DWORD a = 0; a <= p; a++) {
+                if (before[a] == 0.0) continue;
+                for (DWORD b = 0; b < n - p; b++) tileWeights[a + b + 1] += before[a]*after[b];
+            }
+        }
+    }
+
+    status = 0;
+
+done:
+    free(sweep.states);
+    free(sweep.weights);
+    free(sweep.table);
+    free(consTiles);
+    free(numConsTiles);
+    free(first);
+    free(last);
+    free(slot);
+    free(layerStart);
+    return status;
+}
+
+static void CountComponentTask(void* argument) {
+/**
+ * Purpose: Thread pool task that counts one group, going through the cache
+ * @param argument : Component* - the group
+ * @return : void
+ */
+
+    Component* component = (Component*)argument;
+    DWORD n = component->numTiles;
+    DWORD numWeights = (n + 1)*(n + 1);  // Totals then one row per tile
+    unsigned char* signature;
+    unsigned long long hash;
+    unsigned int length;
+    ProbabilityCache* cache = component->cache;
+    ProbabilityCacheEntry* entry;
+
+    component->weights = (double*)malloc(numWeights*sizeof(double));
+    signature = (unsigned char*)malloc(2*n + 1 + 3*component->numConstraints);
+    if (!component->weights || !signature) {
+        free(signature);
+        component->status = 1;
+        return;
+    }
+    component->tileWeights = component->weights + n + 1;
+
+    length = BuildSignature(component, signature, &hash);
+    entry  = &cache->entries[hash % PROB_CACHE_SLOTS];
+
+    AcquireLock(&cache->lock);
+    if (entry->signature && entry->hash == hash && entry->length == length && \
+        memcmp(entry->signature, signature, length) == 0) {
+        memcpy(component->weights, entry->weights, numWeights*sizeof(double));
+        component->cacheHit = 1;
+    }
+    ReleaseLock(&cache->lock);
+    if (component->cacheHit) {
+        free(signature);
+        return;
+    }
+
+    component->status = CountComponent(component);
+    if (component->status) {
+        free(signature);
+        return;
+    }
+
+    double* weights = (double*)malloc(numWeights*sizeof(double));
+    if (!weights) {
+        free(signature);
+        return;
+    }
+    memcpy(weights, component->weights, numWeights*sizeof(double));
+
+    AcquireLock(&cache->lock);
+    free(entry->signature);
+    free(entry->weights);
+    entry->hash      = hash;
+    entry->length    = length;
+    entry->signature = signature;
+    entry->numTiles  = n;
+    entry->weights   = weights;
+    ReleaseLock(&cache->lock);
+}
+
+static void Convolve(const double* a, DWORD lengthA, const double* b, DWORD lengthB, double* out) {
+/**
+ * Purpose: Multiplies two count-by-mines lists. out[k] is the number of ways
+ *          to use k mines between the two
+ * @param a : const double* - the first list
+ * @param lengthA : DWORD - its length
+ * @param b : const double* - the second list
+ * @param lengthB : DWORD - its length
+ * @param out : double* - receives lengthA + lengthB - 1 counts
+ * @return : void
+ */
+
+    memset(out, 0, (lengthA + lengthB - 1)*sizeof(double));
+    for (DWORD i = 0; i < lengthA; i++) {
+        if (a[i] == 0.0) continue;
+        for (DWORD j = 0; j < lengthB; j++) out[i + j] += a[i]*b[j];
+    }
+}
+
+int ComputeProbabilities(ThreadPool* pool, ProbabilityCache* cache, const unsigned char* kinds, DWORD height, \
+                         DWORD width, DWORD totalMines, const SolverResult* solved, ProbabilityResult* result) {
+/**
+ * Purpose: Works out the chance that every covered tile is a mine, given
+ *          what the player can see and the total number of mines
+ * @param pool : ThreadPool* - counts the groups in parallel. NULL counts them one at a time
+ * @param cache : ProbabilityCache* - remembers counted groups. NULL uses the shared cache
+ * @param kinds : const unsigned char* - the decoded minefield (visible part only is used)
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param totalMines : DWORD - mines in the game (NUM_MINES_OFFSET)
+ * @param solved : const SolverResult* - SolveVisible's result for the same kinds
+ * @param result : ProbabilityResult* - receives the chances
+ * @return : int - 0 on success, 1 if no arrangement of mines fits or a group was too big
+ */
+
+    unsigned short owner[ROW_STRIDE*BITBOARD_ROWS];  // Constraint that first claimed each frontier tile + 1
+    unsigned short parent[MAX_WIDTH*MAX_HEIGHT];     // Union-find over constraints
+    unsigned short root[MAX_WIDTH*MAX_HEIGHT];       // Component of each constraint's root
+    unsigned short tileList[MAX_WIDTH*MAX_HEIGHT];
+    unsigned short constraintList[MAX_WIDTH*MAX_HEIGHT];
+    Component components[MAX_WIDTH*MAX_HEIGHT];
+    uint32_t frontier[BITBOARD_ROWS];
+    uint32_t covered[BITBOARD_ROWS];
+    DWORD numComponents = 0;
+    DWORD numInterior = 0;
+    DWORD numFrontier = 0;
+    TaskGroup group = { 0 };
+    double *binomial = NULL, *prefix = NULL, *suffix = NULL, *others = NULL, *g = NULL;
+    DWORD* prefixStart = NULL;
+    double total = 0.0;
+    int remaining = (int)totalMines - (int)solved->numMines;
+    int status = 1;
+
+    if (!cache) {
+        if (!sharedCacheReady) ClearProbabilityCache();
+        cache = &sharedCache;
+    }
+
+    for (DWORD i = 0; i < ROW_STRIDE*BITBOARD_ROWS; i++) result->chance[i] = -1.0f;
+    result->interiorChance   = 0.0;
+    result->remainingMines   = remaining;
+    result->cacheHits        = 0;
+    result->states           = 0;
+    result->largestComponent = 0;
+    result->bestX = result->bestY = 0;
+    result->bestChance = 2.0f;
+    if (remaining < 0) return 1;
+
+    // Join numbers that share a tile
+    memset(owner, 0, sizeof(owner));
+    memset(frontier, 0, sizeof(frontier));
+    for (DWORD c = 0; c < solved->numConstraints; c++) parent[c] = (unsigned short)c;
+    for (DWORD c = 0; c < solved->numConstraints; c++) {
+        const Constraint* constraint = &solved->constraints[c];
+        for (DWORD r = 0; r < 3; r++) {
+            DWORD row = constraint->y - 1 + r;
+            frontier[row] |= constraint->rows[r];
+            for (uint32_t bits = constraint->rows[r]; bits; bits &= bits - 1) {
+                DWORD offset = (DWORD)CTZ32(bits) + row*ROW_STRIDE;
+                if (!owner[offset]) {
+                    owner[offset] = (unsigned short)(c + 1);
+                    continue;
+                }
+                DWORD a = c, b = owner[offset] - 1u;
+                while (parent[a] != a) a = parent[a] = parent[parent[a]];
+                while (parent[b] != b) b = parent[b] = parent[parent[b]];
+                if (a != b) parent[a > b ? a : b] = (unsigned short)(a < b ? a : b);
+            }
+        }
+    }
+
+    // Number the components and hand each a slice of the tile and constraint lists
+    for (DWORD c = 0; c < solved->numConstraints; c++) {
+        DWORD r = c;
+        while (parent[r] != r) r = parent[r];
+        if (r == c) {
+            memset(&components[numComponents], 0, sizeof(Component));
+            components[numComponents].solved = solved;
+            components[numComponents].cache  = cache;
+            root[c] = (unsigned short)numComponents++;
+        }
+        root[c] = root[r];
+        components[root[c]].numConstraints++;
+    }
+    for (DWORD y = 1; y <= height; y++) {
+        for (uint32_t bits = frontier[y]; bits; bits &= bits - 1) {
+            components[root[owner[CTZ32(bits) + y*ROW_STRIDE] - 1]].numTiles++;
+        }
+    }
+    {
+        DWORD tileAt = 0, constraintAt = 0;
+        for (DWORD i = 0; i < numComponents; i++) {
+            components[i].tiles = tileList + tileAt;
+            components[i].constraints = constraintList + constraintAt;
+            tileAt += components[i].numTiles;
+            constraintAt += components[i].numConstraints;
+            if (components[i].numTiles > result->largestComponent) result->largestComponent = components[i].numTiles;
+            components[i].numTiles = components[i].numConstraints = 0;
+        }
+        numFrontier = tileAt;
+    }
+    for (DWORD c = 0; c < solved->numConstraints; c++) {
+        Component* component = &components[root[c]];
+        component->constraints[component->numConstraints++] = (unsigned short)c;
+    }
+    for (DWORD y = 1; y <= height; y++) {
+        for (uint32_t bits = frontier[y]; bits; bits &= bits - 1) {
+            DWORD offset = (DWORD)CTZ32(bits) + y*ROW_STRIDE;
+            Component* component = &components[root[owner[offset] - 1]];
+            component->tiles[component->numTiles++] = (unsigned short)offset;
+        }
+    }
+
+    // Count every group. Each one is a task so idle threads can steal them
+    for (DWORD i = 0; i < numComponents; i++) SubmitTask(pool, &group, CountComponentTask, &components[i]);
+    WaitForGroup(pool, &group);
+
+    for (DWORD i = 0; i < numComponents; i++) {
+        if (components[i].status) goto done;
+        result->states += components[i].states;
+        if (components[i].cacheHit) result->cacheHits++;
+    }
+
+    // Covered tiles that no number touches
+    memset(covered, 0, sizeof(covered));
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            unsigned char visible = kinds[x + y*ROW_STRIDE] & TILE_VISIBLE_MASK;
+            if (visible == TILE_UNCLICKED || visible == TILE_FLAG || visible == TILE_QUESTION) covered[y] |= 1u << x;
+        }
+        numInterior += (DWORD)POPCOUNT32(covered[y] & ~frontier[y] & ~solved->safe[y] & ~solved->mines[y]);
+    }
+
+    // binomial[r] = ways to put r mines on the interior tiles
+    binomial    = (double*)calloc(numInterior + 1, sizeof(double));
+    prefix      = (double*)malloc((numComponents + 1)*(numFrontier + 1)*sizeof(double));
+    suffix      = (double*)malloc((numComponents + 1)*(numFrontier + 1)*sizeof(double));
+    others      = (double*)malloc((numFrontier + 1)*sizeof(double));
+    g           = (double*)malloc((numFrontier + 1)*sizeof(double));
+    prefixStart = (DWORD*)malloc((numComponents + 2)*sizeof(DWORD));
+    if (!binomial || !prefix || !suffix || !others || !g || !prefixStart) goto done;
+    binomial[0] = 1.0;
+    for (DWORD r = 0; r < numInterior; r++) binomial[r + 1] = binomial[r]*(double)(numInterior - r)/(double)(r + 1);
+
+    // prefix[j] covers groups before j and suffix[j] groups j and after. A
+    // group's tiles are then weighed against every other group and the interior
+    {
+        DWORD length = 1;
+        prefixStart[0] = 1;  // Length of each prefix list
+        prefix[0] = 1.0;
+        for (DWORD j = 0; j < numComponents; j++) {
+            Convolve(prefix + j*(numFrontier + 1), length, components[j].weights, components[j].numTiles + 1, \
+                     prefix + (j + 1)*(numFrontier + 1));
+            length += components[j].numTiles;
+            prefixStart[j + 1] = length;
+        }
+
+        suffix[numComponents*(numFrontier + 1)] = 1.0;
+        length = 1;
+        for (DWORD j = numComponents; j-- > 0;) {
+            Convolve(suffix + (j + 1)*(numFrontier + 1), length, components[j].weights, components[j].numTiles + 1, \
+                     suffix + j*(numFrontier + 1));
+            length += components[j].numTiles;
+        }
+    }
+
+    // All arrangements, weighted by the ways to place what's left on the interior
+    for (DWORD k = 0; k < prefixStart[numComponents] && (int)k <= remaining; k++) {
+        if ((DWORD)(remaining - (int)k) <= numInterior) total += prefix[numComponents*(numFrontier + 1) + k]*binomial[remaining - k];
+    }
+    if (total <= 0.0) goto done;
+
+    if (numInterior) {
+        double mined = 0.0;
+        for (DWORD k = 0; k < prefixStart[numComponents] && (int)k < remaining; k++) {
+            if ((DWORD)(remaining - (int)k) <= numInterior) {
+                mined += prefix[numComponents*(numFrontier + 1) + k]*binomial[remaining - k]*(double)(remaining - (int)k);
+            }
+        }
+        result->interiorChance = mined / (double)numInterior / total;
+    }
+
+    for (DWORD j = 0; j < numComponents; j++) {
+        Component* component = &components[j];
+        DWORD n = component->numTiles;
+        DWORD otherLength = prefixStart[j] + (prefixStart[numComponents] - prefixStart[j + 1]);
+
+        // g[a] = ways for everything else to hold the remaining - a mines
+        Convolve(prefix + j*(numFrontier + 1), prefixStart[j], suffix + (j + 1)*(numFrontier + 1), \
+                 prefixStart[numComponents] - prefixStart[j + 1] + 1, others);
+        for (DWORD a = 0; a <= n; a++) {
+            g[a] = 0.0;
+            for (DWORD b = 0; b < otherLength && (int)(a + b) <= remaining; b++) {
+                if ((DWORD)(remaining - (int)(a + b)) <= numInterior) g[a] += others[b]*binomial[remaining - (a + b)];
+            }
+        }
+
+        for (DWORD t = 0; t < n; t++) {
+            double mined = 0.0;
+            for (DWORD a = 1; a <= n; a++) mined += component->tileWeights[t*(n + 1) + a]*g[a];
+            result->chance[component->tiles[t]] = (float)(mined / total);
+        }
+    }
+
+    // Everything else that's covered: proven tiles and the interior
+    for (DWORD y = 1; y <= height; y++) {
+        for (uint32_t bits = covered[y]; bits; bits &= bits - 1) {
+            DWORD offset = (DWORD)CTZ32(bits) + y*ROW_STRIDE;
+            if ((solved->safe[y] >> (offset % ROW_STRIDE)) & 1) result->chance[offset] = 0.0f;
+            else if ((solved->mines[y] >> (offset % ROW_STRIDE)) & 1) result->chance[offset] = 1.0f;
+            else if (!((frontier[y] >> (offset % ROW_STRIDE)) & 1)) result->chance[offset] = (float)result->interiorChance;
+
+            if (result->chance[offset] < result->bestChance) {
+                result->bestChance = result->chance[offset];
+                result->bestX = offset % ROW_STRIDE;
+                result->bestY = y;
+            }
+        }
+    }
+
+    result->numFrontier   = numFrontier;
+    result->numInterior   = numInterior;
+    result->numComponents = numComponents;
+    status = 0;
+
+done:
+    for (DWORD i = 0; i < numComponents; i++) free(components[i].weights);
+    free(binomial);
+    free(prefix);
+    free(suffix);
+    free(others);
+    free(g);
+    free(prefixStart);
+    return status;
+}
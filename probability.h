@@ -0,0 +1,59 @@
+/**
+ * Purpose: Exact mine probabilities for when the honest helper gets stuck.
+ *          The frontier (covered tiles next to a number) is split into
+ *          groups that share no numbers. Each group's consistent mine
+ *          arrangements are counted by how many mines they use, the groups
+ *          are counted in parallel on a thread pool, and the counts are
+ *          combined with the number of ways to place the rest of the mines
+ *          on the tiles no number touches
+ */
+
+#ifndef PROBABILITY_H
+#define PROBABILITY_H
+
+#include"winmine.h"
+#include"solver.h"
+#include"threadPool.h"
+
+#define PROB_MAX_OPEN     32          // Most half-counted numbers a sweep can track (4 bits each)
+#define PROB_MAX_WEIGHTS  (1 << 24)   // Give up on a group whose sweep needs more counts than this
+#define PROB_CACHE_SLOTS  4096        // Groups remembered between calls
+
+typedef struct probabilityResult_s {
+    float chance[ROW_STRIDE*BITBOARD_ROWS];  // Chance each covered tile is a mine. -1 for everything else
+    double interiorChance;         // Chance for a covered tile no number touches
+    int remainingMines;            // Mines not proven yet: the total minus proven mines
+    DWORD numFrontier;             // Covered tiles next to a number
+    DWORD numInterior;             // Covered tiles no number touches
+    DWORD numComponents;           // Groups of frontier tiles that share no numbers
+    DWORD largestComponent;        // Tiles in the biggest group
+    DWORD cacheHits;               // Groups answered from the cache
+    unsigned long long states;     // Sweep states visited across every group
+    DWORD bestX;                   // The covered tile least likely to be a mine
+    DWORD bestY;
+    float bestChance;              // Its chance of being a mine
+} ProbabilityResult;
+
+typedef struct probabilityCacheEntry_s {
+    unsigned long long hash;
+    unsigned int length;           // Bytes in signature
+    unsigned char* signature;      // The group's shape, moved to the top left corner
+    DWORD numTiles;
+    double* weights;               // numTiles + 1 counts then numTiles*(numTiles + 1) tile counts
+} ProbabilityCacheEntry;
+
+// Groups already counted, so the same shape anywhere on the board is only
+// counted once. There's one shared cache for callers that pass NULL, and
+// callers that shouldn't contend for it (the simulator's threads) keep their own
+typedef struct probabilityCache_s {
+    ProbabilityCacheEntry entries[PROB_CACHE_SLOTS];  // Direct mapped on the signature's hash
+    PoolLock lock;
+} ProbabilityCache;
+
+void ClearProbabilityCache(void);
+void InitProbabilityCache(ProbabilityCache* cache);
+void FreeProbabilityCache(ProbabilityCache* cache);
+int ComputeProbabilities(ThreadPool* pool, ProbabilityCache* cache, const unsigned char* kinds, DWORD height, \
+                         DWORD width, DWORD totalMines, const SolverResult* solved, ProbabilityResult* result);
+
+#endif
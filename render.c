@@ -0,0 +1,311 @@
+/**
+ * Purpose: The buffered minefield renderer. See render.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"render.h"
+#include"timing.h"
+#include"trace.h"
+
+#ifndef _WIN32
+#include<unistd.h>
+#endif
+
+#define LEGEND "Legend:\n------\nB: Unexploded bomb\n_: Blank clicked tile\n" \
+               "*: exploded bomb\n?: Question mark\n : (space) Blank unclicked tile\n" \
+               "F: Flag\nX: Incorrectly placed flag. Only shows up after you lose\n\n"
+#define OVERLAY_LEGEND "Helper:\n------\nS: Provably safe\nM: Provably a mine\n" \
+                       "NN%: Chance of a mine (only when nothing is provably safe)\n\n"
+#define ANSI_HOME_AND_CLEAR "\x1b[H\x1b[2J"
+
+static void Append(Frame* frame, const char* text, size_t length) {
+/**
+ * Purpose: Adds text to the end of the frame
+ * @param frame : Frame* - the frame being built
+ * @param text : const char* - what to add
+ * @param length : size_t - number of bytes in text
+ * @return : void
+ */
+
+    memcpy(frame->text + frame->length, text, length);
+    frame->length += length;
+}
+
+static void AppendNumber(Frame* frame, unsigned int number, int minWidth) {
+/**
+ * Purpose: Adds a number to the frame, right aligned in at least minWidth
+ *          characters (the same as printf's "%2d" for minWidth 2)
+ * @param frame : Frame* - the frame being built
+ * @param number : unsigned int - the number to add
+ * @param minWidth : int - pad with spaces on the left up to this width
+ * @return : void
+ */
+
+    char digits[10];
+    int numDigits = 0;
+
+    do {
+        digits[numDigits++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number);
+
+    for (int i = numDigits; i < minWidth; i++) frame->text[frame->length++] = ' ';
+    while (numDigits) frame->text[frame->length++] = digits[--numDigits];
+}
+
+static void AppendCursorMove(Frame* frame, DWORD row, DWORD column) {
+/**
+ * Purpose: Adds an ANSI escape that moves the cursor to row, column
+ * @param frame : Frame* - the frame being built
+ * @param row : DWORD - 1 based screen row
+ * @param column : DWORD - 1 based screen column
+ * @return : void
+ */
+
+    Append(frame, "\x1b[", 2);
+    AppendNumber(frame, row, 0);
+    frame->text[frame->length++] = ';';
+    AppendNumber(frame, column, 0);
+    frame->text[frame->length++] = 'H';
+}
+
+void InitFrame(Frame* frame) {
+/**
+ * Purpose: Gets a frame ready for use. The first incremental frame after
+ *          this is always drawn in full
+ * @param frame : Frame* - the frame to initialize
+ * @return : void
+ */
+
+    frame->length       = 0;
+    frame->width        = 0;
+    frame->height       = 0;
+    frame->frameNs      = 0;
+    frame->tilesChanged = 0;
+
+    return;
+}
+
+static void AppendAxis(Frame* frame, DWORD width) {
+/**
+ * Purpose: Adds the X axis and the border under it
+ * @param frame : Frame* - the frame being built
+ * @param width : DWORD - the width of the minefield
+ * @return : void
+ */
+
+    // Print out the X axis
+    Append(frame, "   ", 3);
+    for (DWORD x = 1; x <= width; x++) {
+        frame->text[frame->length++] = ' ';
+        AppendNumber(frame, x, 2);
+    }
+
+    // Print out the border
+    Append(frame, "\n   ", 4);
+    for (DWORD x = 1; x <= width; x++) {
+        Append(frame, "---", 3);
+    }
+    Append(frame, "--\n", 3);
+}
+
+static void AppendBoard(Frame* frame, const unsigned char* kinds, DWORD height, DWORD width, \
+                        const uint32_t* safe, const uint32_t* mines, const float* chance) {
+/**
+ * Purpose: Adds the X axis, border and every row of the minefield
+ * @param frame : Frame* - the frame being built
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param safe : const uint32_t* - row masks drawn as S instead of the tile. May be NULL
+ * @param mines : const uint32_t* - row masks drawn as M instead of the tile. May be NULL
+ * @param chance : const float* - mine chance per tile, drawn as a percentage where it's
+ *                 between 0 and 1. May be NULL
+ * @return : void
+ */
+
+    AppendAxis(frame, width);
+
+    // Print out the minefield. Each row is 32 bytes
+    for (DWORD y = 1; y <= height; y++) {
+        AppendNumber(frame, y, 2);
+        Append(frame, " |", 2);
+        for (DWORD x = 1; x <= width; x++) {
+            if (safe && (safe[y] >> x) & 1) Append(frame, " S ", 3);
+            else if (mines && (mines[y] >> x) & 1) Append(frame, " M ", 3);
+            else if (chance && chance[x + y*ROW_STRIDE] > 0.0f && chance[x + y*ROW_STRIDE] < 1.0f) {
+                int percent = (int)(chance[x + y*ROW_STRIDE]*100.0f + 0.5f);
+                AppendNumber(frame, (unsigned int)(percent < 1 ? 1 : percent > 99 ? 99 : percent), 2);
+                frame->text[frame->length++] = '%';
+            }
+            else Append(frame, tileGlyphs[kinds[x + y*ROW_STRIDE]], 3);
+        }
+        frame->text[frame->length++] = '\n';
+    }
+}
+
+size_t RenderFrame(Frame* frame, const unsigned char* kinds, DWORD height, DWORD width, int withLegend) {
+/**
+ * Purpose: Formats the whole minefield (the same text PrintMineField has
+ *          always printed) into the frame
+ * @param frame : Frame* - receives the formatted text
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param withLegend : int - non-zero to put the legend above the field
+ * @return : size_t - number of bytes in the frame
+ */
+
+    unsigned long long start = NowNs();
+
+    frame->length = 0;
+    if (withLegend) Append(frame, LEGEND, sizeof(LEGEND) - 1);
+    AppendBoard(frame, kinds, height, width, NULL, NULL, NULL);
+
+    frame->frameNs = NowNs() - start;
+    TRACE_SPAN(TRACE_RENDER, start, frame->frameNs, frame->length);
+    return frame->length;
+}
+
+size_t RenderFrameGeometry(Frame* frame, const Geometry* geometry, const unsigned char* field, int withLegend) {
+/**
+ * Purpose: Formats the whole minefield the way RenderFrame does, straight
+ *          from the raw field. The tiles are drawn by the geometry's render,
+ *          so the standard sizes get their unrolled copies
+ * @param frame : Frame* - receives the formatted text
+ * @param geometry : const Geometry* - the board's geometry. Must be winmine's layout
+ * @param field : const unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param withLegend : int - non-zero to put the legend above the field
+ * @return : size_t - number of bytes in the frame. 0 for a tiled geometry
+ */
+
+    char rows[(MAX_WIDTH*3 + 1)*MAX_HEIGHT];  // The tiles, a line per row
+    size_t rowLength = (size_t)geometry->width*3 + 1;
+    unsigned long long start = NowNs();
+
+    frame->length = 0;
+    if (geometry->tiled) return 0;
+    geometry->render(geometry, field, rows);
+
+    if (withLegend) Append(frame, LEGEND, sizeof(LEGEND) - 1);
+    AppendAxis(frame, geometry->width);
+    for (DWORD y = 1; y <= geometry->height; y++) {
+        AppendNumber(frame, y, 2);
+        Append(frame, " |", 2);
+        Append(frame, rows + (y - 1)*rowLength, rowLength);
+    }
+
+    frame->frameNs = NowNs() - start;
+    TRACE_SPAN(TRACE_RENDER, start, frame->frameNs, frame->length);
+    return frame->length;
+}
+
+size_t RenderFrameOverlay(Frame* frame, const unsigned char* kinds, DWORD height, DWORD width, \
+                          const uint32_t* safe, const uint32_t* mines, const float* chance) {
+/**
+ * Purpose: Formats the whole minefield with the helper's findings drawn over
+ *          the covered tiles
+ * @param frame : Frame* - receives the formatted text
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param safe : const uint32_t* - row masks of tiles to draw as S
+ * @param mines : const uint32_t* - row masks of tiles to draw as M
+ * @param chance : const float* - mine chance of each tile. May be NULL
+ * @return : size_t - number of bytes in the frame
+ */
+
+    unsigned long long start = NowNs();
+
+    frame->length = 0;
+    Append(frame, LEGEND, sizeof(LEGEND) - 1);
+    Append(frame, OVERLAY_LEGEND, sizeof(OVERLAY_LEGEND) - 1);
+    AppendBoard(frame, kinds, height, width, safe, mines, chance);
+
+    frame->frameNs = NowNs() - start;
+    TRACE_SPAN(TRACE_RENDER, start, frame->frameNs, frame->length);
+    return frame->length;
+}
+
+size_t RenderFrameDiff(Frame* frame, const unsigned char* kinds, DWORD height, DWORD width) {
+/**
+ * Purpose: Formats only what changed since the last call. The first frame
+ *          (or one with new dimensions) clears the screen and draws
+ *          everything. After that each changed tile costs a cursor move and
+ *          a glyph, and an unchanged board costs nothing at all
+ * @param frame : Frame* - receives the formatted text
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @return : size_t - number of bytes in the frame
+ */
+
+    unsigned long long start = NowNs();
+    DWORD lastChanged = 0;  // Offset of the last tile drawn, so neighbors skip the cursor move
+
+    frame->length = 0;
+    frame->tilesChanged = 0;
+
+    if (frame->width != width || frame->height != height) {
+        Append(frame, ANSI_HOME_AND_CLEAR, sizeof(ANSI_HOME_AND_CLEAR) - 1);
+        AppendBoard(frame, kinds, height, width, NULL, NULL, NULL);
+        frame->tilesChanged = width*height;
+        frame->width  = width;
+        frame->height = height;
+    }
+    else {
+        for (DWORD y = 1; y <= height; y++) {
+
+            // Most rows don't change between polls
+            if (memcmp(frame->previous + y*ROW_STRIDE + 1, kinds + y*ROW_STRIDE + 1, width) == 0) continue;
+
+            for (DWORD x = 1; x <= width; x++) {
+                DWORD offset = x + y*ROW_STRIDE;
+                if (frame->previous[offset] == kinds[offset]) continue;
+
+                // Row 1 is the X axis and row 2 the border. Tiles start after "%2d |"
+                if (offset != lastChanged + 1) AppendCursorMove(frame, y + 2, 5 + (x - 1)*3);
+                Append(frame, tileGlyphs[kinds[offset]], 3);
+                lastChanged = offset;
+                frame->tilesChanged++;
+            }
+        }
+
+        // Park the cursor under the field
+        if (frame->tilesChanged) AppendCursorMove(frame, height + 3, 1);
+    }
+
+    memcpy(frame->previous, kinds, (height + 2)*ROW_STRIDE);
+    frame->frameNs = NowNs() - start;
+    TRACE_SPAN(TRACE_RENDER, start, frame->frameNs, frame->length);
+    return frame->length;
+}
+
+int WriteFrame(Frame* frame) {
+/**
+ * Purpose: Sends the frame to stdout with a single write
+ * @param frame : Frame* - the frame to write
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    if (!frame->length) return 0;
+
+    // Anything printf buffered has to go out first
+    fflush(stdout);
+
+#ifdef _WIN32
+    DWORD bytesWritten;
+    if (!WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), frame->text, (DWORD)frame->length, &bytesWritten, NULL)) {
+        printf("Error writing the minefield: %d\n", GetLastError());
+        return 1;
+    }
+#else
+    if (write(1, frame->text, frame->length) != (ssize_t)frame->length) {
+        printf("Error writing the minefield\n");
+        return 1;
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+/**
+ * Purpose: Formats the minefield into one preallocated buffer so a frame goes
+ *          out with a single write. The incremental mode remembers the last
+ *          frame and only emits ANSI cursor moves and glyphs for tiles that
+ *          changed
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include<stddef.h>
+#include<stdint.h>
+#include"winmine.h"
+#include"tileDecode.h"
+#include"geometry.h"
+
+#define FRAME_BUFFER_SIZE 16384  // Big enough for a full frame or a diff of every tile
+
+typedef struct frame_s {
+    char text[FRAME_BUFFER_SIZE];           // The formatted frame
+    size_t length;                          // Number of bytes in text
+    unsigned char previous[KIND_GRID_SIZE]; // Kinds drawn by the last incremental frame
+    DWORD width;                            // Dimensions of the last incremental frame.
+    DWORD height;                           // 0 if nothing's been drawn yet
+    unsigned long long frameNs;             // Time spent formatting the last frame
+    size_t tilesChanged;                    // Tiles redrawn by the last incremental frame
+} Frame;
+
+void InitFrame(Frame* frame);
+size_t RenderFrame(Frame* frame, const unsigned char* kinds, DWORD height, DWORD width, int withLegend);
+size_t RenderFrameGeometry(Frame* frame, const Geometry* geometry, const unsigned char* field, int withLegend);
+size_t RenderFrameOverlay(Frame* frame, const unsigned char* kinds, DWORD height, DWORD width, \
+                          const uint32_t* safe, const uint32_t* mines, const float* chance);
+size_t RenderFrameDiff(Frame* frame, const unsigned char* kinds, DWORD height, DWORD width);
+int WriteFrame(Frame* frame);
+
+#endif
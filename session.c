@@ -0,0 +1,387 @@
+/**
+ * Purpose: Finding winmine and staying attached to it. See session.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"session.h"
+#include"timing.h"
+#include"trace.h"
+
+#ifdef _WIN32
+#include<tlhelp32.h>
+#else
+#include<dirent.h>
+#include<errno.h>
+#include<stdlib.h>
+#include<sys/types.h>
+#endif
+
+#ifdef _WIN32
+int FindProcessPIDs(char* processName, DWORD* PIDs, int maxPIDs) {
+/**
+ * Purpose: Enumerates all processes looking for processes with the specified
+ *          name
+ * @param processName : char* - null term string containing the name of the process to match. Case sensitive
+ * @param PIDs : DWORD* - receives the process ID of every match, in the order they were found
+ * @param maxPIDs : int - how many PIDs fit
+ * @return : int - number of matches found (at most maxPIDs). 0 if none or error
+ */
+
+    int numPIDs = 0;
+
+    // Initialize the PROCESSENTRY32 structure
+    PROCESSENTRY32 processInformation;
+    processInformation.dwSize = sizeof(PROCESSENTRY32);  // As per https://docs.microsoft.com/en-us/windows/win32/api/tlhelp32/ns-tlhelp32-processentry32
+
+    DEBUG_PRINT("Searching the process list for process %s via the executable name\n", processName);
+
+    // Get a list of running processes
+    HANDLE hProcessSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (hProcessSnap == INVALID_HANDLE_VALUE) {
+        printf("Error calling CreateToolhelp32Snapshot: %d\n", GetLastError());
+        return 0;
+    }
+
+    // Get the first Process in the list
+    if (!Process32First(hProcessSnap, &processInformation)) {
+        printf("Error calling Process32first: %d\n", GetLastError());
+        CloseHandle(hProcessSnap);
+        return 0;
+    }
+
+    // Iterate through all Processs in the snapshot, searching for
+    // the process by name
+    do {
+        // If the executable name matches, tell the user we found it
+        if (strncmp(processInformation.szExeFile, processName, 12) == 0) {
+            DEBUG_PRINT("Found %s. Process id %d\n", processName, processInformation.th32ProcessID);
+            PIDs[numPIDs++] = processInformation.th32ProcessID;
+        }
+    } while (numPIDs < maxPIDs && Process32Next(hProcessSnap, &processInformation));
+
+    CloseHandle(hProcessSnap);
+
+    return numPIDs;
+}
+
+uintptr_t GetModuleBaseAddress(DWORD PID, char* moduleName, size_t lenModuleName) {
+/**
+ * Purpose: Gets the base address of a given PID in memory
+ * @param PID : DWORD - the ID of the process
+ * @param moduleName : char*  - the null terminated name of the module
+ * @param lenModuleName : size_t - the length of the moduleName string with the null term
+ * @return: uintptr_t  - the base address of the process in memory or 0 if error
+ */
+
+    // Initialize the MODULEENTRY32 structure
+    MODULEENTRY32 moduleInformation;
+    moduleInformation.dwSize = sizeof(MODULEENTRY32);
+
+    DEBUG_PRINT("Getting the module %s base address from process ID %d\n", moduleName, PID);
+
+    // Take a snapshot of all modules in the specified process
+    HANDLE hModuleSnap = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE32 | TH32CS_SNAPMODULE, PID);
+    if (hModuleSnap == INVALID_HANDLE_VALUE) {
+        printf("Error calling CreateToolhelp32Snapshot: %d\n", GetLastError());
+        return 0;
+    }
+
+    // Get the first module in the list
+    if (!Module32First(hModuleSnap, &moduleInformation)) {
+        printf("Error calling Module32First: %d\n", GetLastError());
+        CloseHandle(hModuleSnap);
+        return 0;
+    }
+
+    // Iterate through all modules in the snapshot, searching for
+    // the specified module
+    do {
+        if (strncmp(moduleInformation.szModule, moduleName, lenModuleName) == 0) {
+            DEBUG_PRINT("Module base address is 0x%08x\n", (DWORD)moduleInformation.modBaseAddr);
+            CloseHandle(hModuleSnap);
+            return (uintptr_t)moduleInformation.modBaseAddr;
+        }
+    } while(Module32Next(hModuleSnap, &moduleInformation));
+
+    printf("Unable to find module %s in process ID %d\n", moduleName, PID);
+    CloseHandle(hModuleSnap);
+    return 0;
+}
+#else
+int FindProcessPIDs(char* processName, DWORD* PIDs, int maxPIDs) {
+/**
+ * Purpose: Walks /proc looking for processes with the specified name (as
+ *          shown in /proc/<pid>/comm)
+ * @param processName : char* - null term string containing the name of the process to match. Case sensitive
+ * @param PIDs : DWORD* - receives the process ID of every match, in the order /proc lists them
+ * @param maxPIDs : int - how many PIDs fit
+ * @return : int - number of matches found (at most maxPIDs). 0 if none or error
+ */
+
+    DIR* proc;               // The /proc directory
+    struct dirent* entry;    // One entry in /proc
+    char path[300];          // /proc/<pid>/comm
+    char comm[64];           // Contents of comm
+    FILE* commFile;
+    int numPIDs = 0;
+
+    DEBUG_PRINT("Searching the process list for process %s via /proc\n", processName);
+
+    proc = opendir("/proc");
+    if (!proc) {
+        printf("Error opening /proc: %d\n", errno);
+        return 0;
+    }
+
+    while (numPIDs < maxPIDs && (entry = readdir(proc))) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9') continue;
+
+        snprintf(path, sizeof(path), "/proc/%s/comm", entry->d_name);
+        commFile = fopen(path, "r");
+        if (!commFile) continue;  // It went away while we were looking
+        if (fgets(comm, sizeof(comm), commFile)) {
+            comm[strcspn(comm, "\n")] = '\0';
+            if (strcmp(comm, processName) == 0) {
+                PIDs[numPIDs++] = (DWORD)atoi(entry->d_name);
+                DEBUG_PRINT("Found %s. Process id %s\n", processName, entry->d_name);
+            }
+        }
+        fclose(commFile);
+    }
+    closedir(proc);
+
+    return numPIDs;
+}
+
+static unsigned long long ProcessStartTime(DWORD PID) {
+/**
+ * Purpose: When a process started, in clock ticks since boot, from field 22
+ *          of /proc/<pid>/stat. A PID that's been reused by another process
+ *          has a different start time
+ * @param PID : DWORD - the ID of the process
+ * @return : unsigned long long - the start time, or 0 if the process is gone
+ */
+
+    char path[64];       // /proc/<pid>/stat
+    char stat[1024];     // Its contents
+    char* field;
+    unsigned long long startTime = 0;
+    FILE* statFile;
+    size_t length;
+
+    snprintf(path, sizeof(path), "/proc/%u/stat", PID);
+    statFile = fopen(path, "r");
+    if (!statFile) return 0;
+    length = fread(stat, 1, sizeof(stat) - 1, statFile);
+    fclose(statFile);
+    stat[length] = '\0';
+
+    // The name (field 2) can hold spaces and parentheses. Everything after its
+    // closing parenthesis is space separated, starting with field 3
+    field = strrchr(stat, ')');
+    if (!field) return 0;
+    for (int i = 3; i <= 22 && field; i++) field = strchr(field + 1, ' ');
+    if (field) startTime = strtoull(field + 1, NULL, 10);
+
+    return startTime;
+}
+
+uintptr_t GetModuleBaseAddress(DWORD PID, char* moduleName, size_t lenModuleName) {
+/**
+ * Purpose: Gets the address the module is mapped at from /proc/<pid>/maps.
+ *          The stand-in maps its module from a memfd named after winmine
+ * @param PID : DWORD - the ID of the process
+ * @param moduleName : char*  - the null terminated name of the module
+ * @param lenModuleName : size_t - the length of the moduleName string with the null term
+ * @return: uintptr_t  - the base address of the module or 0 if error
+ */
+
+    char path[64];       // /proc/<pid>/maps
+    char line[512];      // One mapping
+    FILE* maps;
+    uintptr_t baseAddr = 0;
+
+    (void)lenModuleName;
+    DEBUG_PRINT("Getting the module %s base address from process ID %d\n", moduleName, PID);
+
+    snprintf(path, sizeof(path), "/proc/%u/maps", PID);
+    maps = fopen(path, "r");
+    if (!maps) {
+        printf("Error opening %s: %d\n", path, errno);
+        return 0;
+    }
+
+    while (!baseAddr && fgets(line, sizeof(line), maps)) {
+        if (strstr(line, moduleName)) baseAddr = (uintptr_t)strtoull(line, NULL, 16);
+    }
+    fclose(maps);
+
+    if (!baseAddr) printf("Unable to find module %s in process ID %d\n", moduleName, PID);
+    else DEBUG_PRINT("Module base address is 0x%08lx\n", (unsigned long)baseAddr);
+
+    return baseAddr;
+}
+#endif
+
+DWORD GetProcessPID(char* processName) {
+/**
+ * Purpose: Finds the first process with the specified name
+ * @param processName : char* - null term string containing the name of the process to match. Case sensitive
+ * @return : DWORD - process ID of the first process with a matching name or 0 if error
+ */
+
+    DWORD PID;
+
+    if (!FindProcessPIDs(processName, &PID, 1)) {
+        printf("Unable to find process %s. Is it running?\n", processName);
+        return 0;
+    }
+
+    return PID;
+}
+
+void InitSession(Session* session, char* processName) {
+/**
+ * Purpose: Sets up an unattached session. Nothing is looked up until
+ *          EnsureSession is called
+ * @param session : Session* - the session to initialize
+ * @param processName : char* - name of the process (and module) to attach to
+ * @return : void
+ */
+
+    memset(session, 0, sizeof(Session));
+    session->processName = processName;
+
+    return;
+}
+
+int SessionAlive(Session* session) {
+/**
+ * Purpose: Cheap check that the process we're attached to is still running
+ * @param session : Session* - the session to check
+ * @return : int - non-zero if the session is attached to a live process
+ */
+
+    if (!session->PID) return 0;
+
+#ifdef _WIN32
+    DWORD exitCode;
+    return GetExitCodeProcess(session->hProcess, &exitCode) && exitCode == STILL_ACTIVE;
+#else
+    // A PID on its own can be handed to a new process once the game exits
+    return session->startTime && ProcessStartTime(session->PID) == session->startTime;
+#endif
+}
+
+int AttachSession(Session* session, DWORD PID) {
+/**
+ * Purpose: Attaches the session to one particular process: looks up the
+ *          module, opens the process and resolves the build's offsets
+ * @param session : Session* - the session to attach. Must not be attached already
+ * @param PID : DWORD - the process to attach to
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned long long start = NowNs();
+    unsigned long long stepStart;  // When the module lookup started, if tracing
+    char cachePath[512];           // Where the offset cache lives
+
+    session->attaches++;
+    session->PID = PID;
+
+    // Get the base address of the module in memory
+    stepStart = TRACE_START();
+    session->baseAddr = GetModuleBaseAddress(session->PID, session->processName, strlen(session->processName));
+    TRACE_END(TRACE_FIND_MODULE, stepStart, 0);
+    if (!session->baseAddr) {
+        session->PID = 0;
+        return 1;
+    }
+
+    // Open the process
+#ifdef _WIN32
+    session->hProcess = OpenProcess(PROCESS_ALL_ACCESS, FALSE, session->PID);
+    if (!session->hProcess) {
+        printf("Unable to get a handle to minesweeper using OpenProcess: %d\n", GetLastError());
+        session->PID = 0;
+        return 1;
+    }
+    OpenWin32Source(&session->source, session->hProcess, session->baseAddr);
+#else
+    session->startTime = ProcessStartTime(session->PID);
+    if (!session->startTime) {
+        printf("Process %d went away while attaching\n", session->PID);
+        session->PID = 0;
+        return 1;
+    }
+    OpenProcessVmSource(&session->source, (int)session->PID, session->baseAddr);
+#endif
+
+    // The cache makes this one read and a hash for a build we've seen before
+    session->offsetsFrom = ResolveOffsets(&session->source, OffsetCachePath(cachePath, sizeof(cachePath)), \
+                                          &session->offsets);
+    if (session->offsets.minefield != MINEFIELD_OFFSET) {
+        printf("Process %d's minefield is at 0x%x, not 0x%x. Only flagging follows it\n", session->PID, \
+               session->offsets.minefield, MINEFIELD_OFFSET);
+    }
+
+    session->attachNs = NowNs() - start;
+    TRACE_SPAN(TRACE_ATTACH, start, session->attachNs, 0);
+    DEBUG_PRINT("Attached to process %d in %.1f us\n", session->PID, session->attachNs / 1000.0);
+
+    return 0;
+}
+
+int EnsureSession(Session* session) {
+/**
+ * Purpose: Makes sure the session is attached to a running game. If it
+ *          already is, this is a single liveness check. Otherwise the
+ *          process and module are looked up again and the process opened
+ * @param session : Session* - the session to attach
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned long long start;
+    unsigned long long stepStart;  // When the process lookup started, if tracing
+    DWORD PID;
+
+    if (SessionAlive(session)) return 0;
+    if (session->PID) {
+        DEBUG_PRINT("Process %d went away. Attaching again\n", session->PID);
+        CloseSession(session);
+    }
+
+    start = NowNs();
+
+    // Get the PID of the minesweeper process
+    stepStart = TRACE_START();
+    PID = GetProcessPID(session->processName);
+    TRACE_END(TRACE_FIND_PROCESS, stepStart, 0);
+    if (!PID || AttachSession(session, PID)) return 1;
+
+    // Finding the process counts as part of attaching
+    session->attachNs = NowNs() - start;
+
+    return 0;
+}
+
+void CloseSession(Session* session) {
+/**
+ * Purpose: Lets go of the game. The next EnsureSession looks everything up again
+ * @param session : Session* - the session to close
+ * @return : void
+ */
+
+    if (!session->PID) return;
+
+    CloseSource(&session->source);
+#ifdef _WIN32
+    CloseHandle(session->hProcess);
+    session->hProcess = NULL;
+#endif
+    session->PID = 0;
+    session->baseAddr = 0;
+
+    return;
+}
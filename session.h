@@ -0,0 +1,44 @@
+/**
+ * Purpose: A persistent attachment to winmine. The PID, module base address
+ *          and process handle are looked up once and reused until the game
+ *          goes away, instead of walking every process and module for every
+ *          menu action. Attaching also works out the build's offsets (see
+ *          signature.h)
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include<stddef.h>
+#include<stdint.h>
+#include"winmine.h"
+#include"memorySource.h"
+#include"signature.h"
+
+typedef struct session_s {
+    char* processName;              // Name of the process (and module) to attach to
+    DWORD PID;                      // Process ID of the game. 0 if not attached
+    uintptr_t baseAddr;             // Base address of the winmine module in the game
+#ifdef _WIN32
+    HANDLE hProcess;                // Handle with full permissions to the game
+#else
+    unsigned long long startTime;   // When the game started, so a reused PID isn't taken for it
+#endif
+    MemorySource source;            // Reads (and writes) the game's memory
+    WinmineOffsets offsets;         // Where this build keeps things. Found once per attach
+    int offsetsFrom;                // OFFSETS_CACHED, OFFSETS_SCANNED or OFFSETS_BUILTIN
+    unsigned long long attaches;    // Number of full lookups done
+    unsigned long long attachNs;    // Time spent on the last lookup
+} Session;
+
+int FindProcessPIDs(char* processName, DWORD* PIDs, int maxPIDs);
+DWORD GetProcessPID(char* processName);
+uintptr_t GetModuleBaseAddress(DWORD PID, char* moduleName, size_t lenModuleName);
+
+void InitSession(Session* session, char* processName);
+int SessionAlive(Session* session);
+int AttachSession(Session* session, DWORD PID);
+int EnsureSession(Session* session);
+void CloseSession(Session* session);
+
+#endif
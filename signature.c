@@ -0,0 +1,506 @@
+/**
+ * Purpose: Resolving winmine's offsets from signatures. See signature.h
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"signature.h"
+#include"bitboard.h"
+#include"board.h"
+#include"trace.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+#define FNV_OFFSET  0xCBF29CE484222325ull
+#define FNV_PRIME   0x100000001B3ull
+
+// The build the #defines in winmine.h came from
+const WinmineOffsets builtinOffsets = {
+    FLAG_TILE_FUNCTION, NUM_MINES_OFFSET, WIDTH_OFFSET, HEIGHT_OFFSET, MINEFIELD_OFFSET, MINES_REMAINING_OFFSET
+};
+
+// The code around each reference to the values the helper needs
+const Signature winmineSignatures[] = {
+    // SHL EAX,5 / MOV AL,[EAX+ECX+minefield]. Reading the tile at x, y
+    { "minefield", "C1 E0 05 8A 84 08 ?? ?? ?? ??", 1,
+      { { offsetof(WinmineOffsets, minefield), 6, SIGNATURE_ABSOLUTE } } },
+    // MOV EAX,[width] / MOV ECX,[height] / IMUL ECX,EAX. Counting the tiles
+    { "board size", "A1 ?? ?? ?? ?? 8B 0D ?? ?? ?? ?? 0F AF C8", 2,
+      { { offsetof(WinmineOffsets, width), 1, SIGNATURE_ABSOLUTE },
+        { offsetof(WinmineOffsets, height), 7, SIGNATURE_ABSOLUTE } } },
+    // MOV EAX,[mines] / MOV [minesRemaining],EAX / XOR EAX,EAX / MOV [...],EAX. Starting a game
+    { "mine counts", "A1 ?? ?? ?? ?? A3 ?? ?? ?? ?? 33 C0 A3", 2,
+      { { offsetof(WinmineOffsets, numMines), 1, SIGNATURE_ABSOLUTE },
+        { offsetof(WinmineOffsets, minesRemaining), 6, SIGNATURE_ABSOLUTE } } },
+    // PUSH [ESP+8] / PUSH [ESP+8] / CALL flag / RET 8. The right click handler passing x, y along
+    { "flag function", "FF 74 24 08 FF 74 24 08 E8 ?? ?? ?? ?? C2 08 00", 1,
+      { { offsetof(WinmineOffsets, flagTileFunction), 9, SIGNATURE_CALL } } },
+};
+const int numWinmineSignatures = sizeof(winmineSignatures) / sizeof(winmineSignatures[0]);
+
+static int HexDigit(char c) {
+/**
+ * Purpose: Value of one hex digit
+ * @param c : char - the digit
+ * @return : int - 0 through 15, or -1 if c isn't a hex digit
+ */
+
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int ParsePattern(const char* text, Pattern* pattern) {
+/**
+ * Purpose: Turns "C1 E0 ?? 8A" into bytes, a mask and the Horspool table.
+ *          A wildcard can match any byte, so no shift may go past the last
+ *          one before the end of the pattern
+ * @param text : const char* - hex bytes separated by spaces, ?? for any byte
+ * @param pattern : Pattern* - receives the pattern
+ * @return : int - 0 on success, 1 if the text isn't a valid pattern
+ */
+
+    size_t maxShift;
+
+    memset(pattern, 0, sizeof(Pattern));
+    while (*text) {
+        int high, low;
+
+        if (*text == ' ') {
+            text++;
+            continue;
+        }
+        if (pattern->length == SIGNATURE_MAX_LENGTH || !text[1]) break;
+
+        if (text[0] == '?' && text[1] == '?') pattern->mask[pattern->length] = 0;
+        else {
+            high = HexDigit(text[0]);
+            low  = HexDigit(text[1]);
+            if (high < 0 || low < 0) break;
+            pattern->bytes[pattern->length] = (unsigned char)(high << 4 | low);
+            pattern->mask[pattern->length]  = 0xFF;
+        }
+        pattern->length++;
+        text += 2;
+    }
+    if (*text || !pattern->length) {
+        printf("Invalid signature pattern near \"%s\"\n", text);
+        return 1;
+    }
+
+    // The anchor is the first byte that has to match
+    while (pattern->anchor < pattern->length && !pattern->mask[pattern->anchor]) pattern->anchor++;
+    if (pattern->anchor == pattern->length) {
+        printf("A signature pattern can't be all wildcards\n");
+        return 1;
+    }
+
+    // Shift by the window's last byte. A wildcard matches everything, so
+    // it caps every shift at its distance from the end
+    maxShift = pattern->length;
+    for (size_t i = 0; i + 1 < pattern->length; i++) {
+        if (!pattern->mask[i]) maxShift = pattern->length - 1 - i;
+    }
+    for (int c = 0; c < 256; c++) pattern->skip[c] = maxShift;
+    for (size_t i = 0; i + 1 < pattern->length; i++) {
+        size_t shift = pattern->length - 1 - i;
+        if (pattern->mask[i] && shift < pattern->skip[pattern->bytes[i]]) pattern->skip[pattern->bytes[i]] = shift;
+    }
+
+    return 0;
+}
+
+static const unsigned char* FindByte(const unsigned char* from, const unsigned char* end, unsigned char value) {
+/**
+ * Purpose: First occurrence of value in [from, end), 16 bytes at a time
+ *          where SSE2 is around
+ * @param from : const unsigned char* - where to start looking
+ * @param end : const unsigned char* - one past the last byte to look at
+ * @param value : unsigned char - the byte to look for
+ * @return : const unsigned char* - the byte, or NULL if it isn't there
+ */
+
+#ifdef HAVE_SSE2
+    __m128i needle = _mm_set1_epi8((char)value);
+
+    while (end - from >= 16) {
+        int found = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)from), needle));
+        if (found) return from + CTZ32((uint32_t)found);
+        from += 16;
+    }
+#endif
+    while (from < end) {
+        if (*from == value) return from;
+        from++;
+    }
+
+    return NULL;
+}
+
+long FindPattern(const Pattern* pattern, const unsigned char* image, size_t size) {
+/**
+ * Purpose: Finds the first match of the pattern. Candidates come from a
+ *          vector search for the anchor byte. A candidate that doesn't match
+ *          moves the window on by the Horspool shift for its last byte before
+ *          the vector search picks up again
+ * @param pattern : const Pattern* - what to look for
+ * @param image : const unsigned char* - where to look
+ * @param size : size_t - bytes in image
+ * @return : long - offset of the match in image, or -1 if there isn't one
+ */
+
+    size_t length = pattern->length;
+    size_t pos = 0;
+
+    if (size < length) return -1;
+    while (pos + length <= size) {
+        const unsigned char* candidate = FindByte(image + pos + pattern->anchor, image + size - (length - 1 - pattern->anchor), \
+                                                  pattern->bytes[pattern->anchor]);
+        size_t i;
+
+        if (!candidate) return -1;
+        pos = (size_t)(candidate - image) - pattern->anchor;
+
+        // Check from the end, where a wrong match usually shows first
+        for (i = length; i > 0; i--) {
+            if ((image[pos + i - 1] & pattern->mask[i - 1]) != pattern->bytes[i - 1]) break;
+        }
+        if (i == 0) return (long)pos;
+
+        pos += pattern->skip[image[pos + length - 1]];
+    }
+
+    return -1;
+}
+
+static uint64_t Fnv1a(const unsigned char* data, size_t size) {
+/**
+ * Purpose: FNV-1a, 8 bytes at a time
+ * @param data : const unsigned char* - what to hash
+ * @param size : size_t - bytes to hash
+ * @return : uint64_t - the hash
+ */
+
+    uint64_t hash = FNV_OFFSET;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(uint64_t));
+        hash = (hash ^ word)*FNV_PRIME;
+    }
+    for (; i < size; i++) hash = (hash ^ data[i])*FNV_PRIME;
+
+    return hash;
+}
+
+uint64_t HashModule(const unsigned char* image, size_t size) {
+/**
+ * Purpose: A key for the module's build that's the same every time it's
+ *          loaded. The loader patches the import table and the game changes
+ *          its data, so neither can go in. A real module is keyed on its PE
+ *          file header (which has the link timestamp) plus the checksum,
+ *          image size and entry point from the optional header. A module
+ *          without PE headers (the stand-in's, the benchmarks') has no
+ *          imports, so its code past the headers is hashed instead
+ * @param image : const unsigned char* - the start of the module
+ * @param size : size_t - bytes of it that were read
+ * @return : uint64_t - the key
+ */
+
+    unsigned char key[32];  // File header, then SizeOfImage, CheckSum and AddressOfEntryPoint
+    DWORD peHeader;
+
+    if (size >= PE_HEADERS && image[0] == 'M' && image[1] == 'Z') {
+        memcpy(&peHeader, image + 0x3C, sizeof(DWORD));
+        if (peHeader <= PE_HEADERS - 0x5C && memcmp(image + peHeader, "PE\0\0", 4) == 0) {
+            memcpy(key, image + peHeader + 4, 20);
+            memcpy(key + 20, image + peHeader + 24 + 56, sizeof(DWORD));
+            memcpy(key + 24, image + peHeader + 24 + 64, sizeof(DWORD));
+            memcpy(key + 28, image + peHeader + 24 + 16, sizeof(DWORD));
+            return Fnv1a(key, sizeof(key));
+        }
+    }
+    if (size <= PE_HEADERS) return Fnv1a(image, size);
+
+    return Fnv1a(image + PE_HEADERS, size - PE_HEADERS);
+}
+
+static int CheckOffsets(const WinmineOffsets* offsets) {
+/**
+ * Purpose: Sanity checks what a scan found or the cache said. The mine
+ *          count, width, height and minefield have to sit together the way
+ *          snapshots read them (the whole block can move), the data has to
+ *          be past the code and inside the part of the module the helper
+ *          reads, and the flag function has to be in the code. Catches a
+ *          signature that matched the wrong code and a cache line that's
+ *          stale or was edited
+ * @param offsets : const WinmineOffsets* - the offsets to check
+ * @return : int - 0 if they make sense, 1 otherwise
+ */
+
+    const WinmineOffsets* builtin = &builtinOffsets;
+
+    if (offsets->width - offsets->numMines != builtin->width - builtin->numMines || \
+        offsets->height - offsets->numMines != builtin->height - builtin->numMines || \
+        offsets->minefield - offsets->numMines != builtin->minefield - builtin->numMines) return 1;
+    if (offsets->numMines < SIGNATURE_CODE_SIZE || offsets->minefield + MINEFIELD_SIZE > MODULE_IMAGE_SIZE || \
+        offsets->minesRemaining < SIGNATURE_CODE_SIZE || offsets->minesRemaining + sizeof(DWORD) > MODULE_IMAGE_SIZE) return 1;
+
+    return offsets->flagTileFunction < PE_HEADERS || offsets->flagTileFunction >= SIGNATURE_CODE_SIZE;
+}
+
+int ScanOffsets(const unsigned char* image, size_t size, uint32_t imageBase, WinmineOffsets* offsets) {
+/**
+ * Purpose: Scans the module for every signature and reads the offsets out
+ *          of the matches
+ * @param image : const unsigned char* - the module, from its base address
+ * @param size : size_t - bytes of it to scan
+ * @param imageBase : uint32_t - the address the code's absolute addresses are relative to
+ * @param offsets : WinmineOffsets* - receives the offsets. Left alone on failure
+ * @return : int - 0 on success, 1 if a signature wasn't found or the results don't make sense
+ */
+
+    WinmineOffsets found;
+
+    memset(&found, 0, sizeof(WinmineOffsets));
+    for (int s = 0; s < numWinmineSignatures; s++) {
+        const Signature* signature = &winmineSignatures[s];
+        Pattern pattern;
+        long match;
+
+        if (ParsePattern(signature->pattern, &pattern)) return 1;
+        match = FindPattern(&pattern, image, size);
+        if (match < 0) {
+            DEBUG_PRINT("Signature for the %s not found\n", signature->name);
+            return 1;
+        }
+
+        for (int o = 0; o < signature->numOperands; o++) {
+            const SignatureOperand* operand = &signature->operands[o];
+            size_t at = (size_t)match + operand->position;
+            uint32_t value;
+
+            if (at + sizeof(uint32_t) > size) return 1;
+            memcpy(&value, image + at, sizeof(uint32_t));
+            if (operand->kind == SIGNATURE_CALL) value = (uint32_t)(at + sizeof(uint32_t)) + value;
+            else value -= imageBase;
+            memcpy((unsigned char*)&found + operand->field, &value, sizeof(DWORD));
+        }
+        DEBUG_PRINT("Signature for the %s found at 0x%lx\n", signature->name, (unsigned long)match);
+    }
+
+    if (CheckOffsets(&found)) {
+        DEBUG_PRINT("Signatures matched but the offsets don't make sense\n");
+        return 1;
+    }
+    *offsets = found;
+
+    return 0;
+}
+
+const char* OffsetCachePath(char* path, size_t size) {
+/**
+ * Purpose: Where the offset cache lives: the user's local application data
+ *          on Windows and their home directory everywhere else
+ * @param path : char* - receives the path
+ * @param size : size_t - bytes in path
+ * @return : const char* - path, or NULL if there's nowhere to put the cache
+ */
+
+#ifdef _WIN32
+    const char* directory = getenv("LOCALAPPDATA");
+    if (!directory) directory = getenv("APPDATA");
+#else
+    const char* directory = getenv("HOME");
+#endif
+
+    if (!directory || !*directory) return NULL;
+    if (snprintf(path, size, "%s%s", directory, OFFSET_CACHE_NAME) >= (int)size) return NULL;
+
+    return path;
+}
+
+int LoadCachedOffsets(const char* path, uint64_t hash, WinmineOffsets* offsets) {
+/**
+ * Purpose: Looks the module up in the cache. One line per module: the hash,
+ *          then the offsets in hex in WinmineOffsets order. A line is checked
+ *          the same way a scan is, so a bad one counts as a miss
+ * @param path : const char* - the cache file
+ * @param hash : uint64_t - the module's HashModule
+ * @param offsets : WinmineOffsets* - receives the offsets if the module is there. Left alone otherwise
+ * @return : int - 0 if it was found, 1 otherwise
+ */
+
+    FILE* cache = fopen(path, "r");
+    char line[256];
+    int found = 0;
+
+    if (!cache) return 1;
+    while (!found && fgets(line, sizeof(line), cache)) {
+        unsigned long long lineHash;
+        unsigned int values[6];
+        WinmineOffsets cached;
+
+        if (sscanf(line, "%llx %x %x %x %x %x %x", &lineHash, &values[0], &values[1], &values[2], &values[3], \
+                   &values[4], &values[5]) != 7 || lineHash != hash) continue;
+        cached.flagTileFunction = values[0];
+        cached.numMines         = values[1];
+        cached.width            = values[2];
+        cached.height           = values[3];
+        cached.minefield        = values[4];
+        cached.minesRemaining   = values[5];
+        if (CheckOffsets(&cached)) {
+            DEBUG_PRINT("The cache's offsets for module %016llx don't make sense. Scanning again\n", lineHash);
+            break;
+        }
+        *offsets = cached;
+        found = 1;
+    }
+    fclose(cache);
+
+    return !found;
+}
+
+int SaveCachedOffsets(const char* path, uint64_t hash, const WinmineOffsets* offsets) {
+/**
+ * Purpose: Adds the module to the cache. Any line it already had (one that
+ *          LoadCachedOffsets turned down) is dropped, so the file never has
+ *          two answers for one module
+ * @param path : const char* - the cache file. Created if it isn't there
+ * @param hash : uint64_t - the module's HashModule
+ * @param offsets : const WinmineOffsets* - what it resolved to
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    FILE* cache = fopen(path, "r");
+    char* kept = NULL;   // Every other module's line
+    size_t keptLength = 0;
+    char line[256];
+    int failed;
+
+    if (cache) {
+        while (fgets(line, sizeof(line), cache)) {
+            unsigned long long lineHash;
+            size_t length = strlen(line);
+            char* grown;
+
+            if (sscanf(line, "%llx", &lineHash) == 1 && lineHash == hash) continue;
+            grown = (char*)realloc(kept, keptLength + length);
+            if (!grown) {
+                free(kept);
+                fclose(cache);
+                return 1;
+            }
+            kept = grown;
+            memcpy(kept + keptLength, line, length);
+            keptLength += length;
+        }
+        fclose(cache);
+    }
+
+    cache = fopen(path, "w");
+    if (!cache) {
+        printf("Unable to open the offset cache %s\n", path);
+        free(kept);
+        return 1;
+    }
+    failed = keptLength && fwrite(kept, keptLength, 1, cache) != 1;
+    free(kept);
+    failed |= fprintf(cache, "%016llx %x %x %x %x %x %x\n", (unsigned long long)hash, offsets->flagTileFunction, \
+                      offsets->numMines, offsets->width, offsets->height, offsets->minefield, \
+                      offsets->minesRemaining) < 0;
+    failed |= fclose(cache) != 0;
+
+    return failed;
+}
+
+int ResolveOffsets(MemorySource* source, const char* cachePath, WinmineOffsets* offsets) {
+/**
+ * Purpose: Works out the offsets for the module the source reads. The code
+ *          is read in one go and hashed. A module already in the cache, with
+ *          offsets that pass the same checks as a scan, is done. Otherwise
+ *          it's scanned and the result cached. If the scan comes up empty
+ *          the built-in offsets are used
+ * @param source : MemorySource* - the game
+ * @param cachePath : const char* - the cache file. NULL to always scan
+ * @param offsets : WinmineOffsets* - receives the offsets
+ * @return : int - OFFSETS_CACHED, OFFSETS_SCANNED or OFFSETS_BUILTIN
+ */
+
+    static unsigned char code[SIGNATURE_CODE_SIZE];  // Too big for the stack
+    uint32_t imageBase = source->baseAddr ? (uint32_t)source->baseAddr : WINMINE_IMAGE_BASE;
+    uint64_t hash;
+
+    *offsets = builtinOffsets;
+    if (ReadSource(source, 0, code, SIGNATURE_CODE_SIZE)) return OFFSETS_BUILTIN;
+
+    hash = HashModule(code, SIGNATURE_CODE_SIZE);
+    if (cachePath && !LoadCachedOffsets(cachePath, hash, offsets)) {
+        DEBUG_PRINT("Offsets for module %016llx came from the cache\n", (unsigned long long)hash);
+        return OFFSETS_CACHED;
+    }
+    if (ScanOffsets(code, SIGNATURE_CODE_SIZE, imageBase, offsets)) {
+        DEBUG_PRINT("No signatures matched module %016llx. Using the built-in offsets\n", (unsigned long long)hash);
+        return OFFSETS_BUILTIN;
+    }
+    if (cachePath) SaveCachedOffsets(cachePath, hash, offsets);
+
+    return OFFSETS_SCANNED;
+}
+
+int PlantSignatures(unsigned char* image, size_t size, uint32_t imageBase, const WinmineOffsets* offsets, \
+                    unsigned int seed) {
+/**
+ * Purpose: Fills the code part of a fake module with noise, then writes one
+ *          copy of every signature into it, wildcards filled with noise and
+ *          operands pointing at the given offsets. Gives the stand-in and the
+ *          benchmarks something to scan
+ * @param image : unsigned char* - the fake module
+ * @param size : size_t - bytes of code to fill. At most SIGNATURE_CODE_SIZE
+ * @param imageBase : uint32_t - the address the module is mapped at
+ * @param offsets : const WinmineOffsets* - where the operands should point
+ * @param seed : unsigned int - seed for the noise and where the signatures go
+ * @return : int - 0 on success, 1 if size is too small
+ */
+
+    unsigned int state = seed ? seed : 0x2545F491;  // xorshift can't start at 0
+    size_t slot = (size - PE_HEADERS) / (size_t)numWinmineSignatures;
+
+    if (size > SIGNATURE_CODE_SIZE || size < PE_HEADERS + (size_t)numWinmineSignatures*SIGNATURE_MAX_LENGTH*2) {
+        printf("Can't plant signatures in 0x%lx bytes\n", (unsigned long)size);
+        return 1;
+    }
+
+    // Headers are left alone. The rest is noise
+    for (size_t i = PE_HEADERS; i < size; i++) image[i] = (unsigned char)NextRandom(&state);
+
+    // One signature somewhere in each slot
+    for (int s = 0; s < numWinmineSignatures; s++) {
+        const Signature* signature = &winmineSignatures[s];
+        size_t at = PE_HEADERS + s*slot + NextRandom(&state) % (slot - SIGNATURE_MAX_LENGTH);
+        Pattern pattern;
+
+        if (ParsePattern(signature->pattern, &pattern)) return 1;
+        for (size_t i = 0; i < pattern.length; i++) {
+            if (pattern.mask[i]) image[at + i] = pattern.bytes[i];
+        }
+        for (int o = 0; o < signature->numOperands; o++) {
+            const SignatureOperand* operand = &signature->operands[o];
+            size_t operandAt = at + operand->position;
+            uint32_t value;
+
+            memcpy(&value, (const unsigned char*)offsets + operand->field, sizeof(DWORD));
+            if (operand->kind == SIGNATURE_CALL) value -= (uint32_t)(operandAt + sizeof(uint32_t));
+            else value += imageBase;
+            memcpy(image + operandAt, &value, sizeof(uint32_t));
+        }
+    }
+
+    return 0;
+}
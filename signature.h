@@ -0,0 +1,86 @@
+/**
+ * Purpose: Finds winmine's offsets from its code instead of trusting the
+ *          #defines in winmine.h, which only hold for one build. Each offset
+ *          is read out of an instruction that uses it (the SHL EAX,5 that
+ *          indexes the minefield, the CALL to the flag function, ...) found
+ *          with a byte pattern scan. What a module resolved to is cached in
+ *          the user's profile, keyed on its PE headers, so attaching to the
+ *          same build again skips the scan
+ */
+
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+#include<stddef.h>
+#include<stdint.h>
+#include"winmine.h"
+#include"memorySource.h"
+
+#define SIGNATURE_MAX_LENGTH    32          // Longest pattern, in bytes
+#define SIGNATURE_MAX_OPERANDS  2           // Most offsets one pattern can give
+#define SIGNATURE_CODE_SIZE     0x5000      // Headers and code. Everything before .data
+#define PE_HEADERS              0x400       // Headers come first in the image. Code starts after them
+#define WINMINE_IMAGE_BASE      0x01000000  // Where winmine asks to be loaded. Absolute addresses in its code assume it
+#ifdef _WIN32
+#define OFFSET_CACHE_NAME       "\\winmineOffsets.txt"    // In %LOCALAPPDATA%
+#else
+#define OFFSET_CACHE_NAME       "/.winmineOffsets.txt"    // In $HOME
+#endif
+
+// What an operand holds
+#define SIGNATURE_ABSOLUTE  0   // The address of the value (an absolute DWORD)
+#define SIGNATURE_CALL      1   // A CALL's rel32, counted from the end of the operand
+
+// Where ResolveOffsets got its answer
+#define OFFSETS_BUILTIN  0   // Nothing matched. The winmine.h values
+#define OFFSETS_SCANNED  1
+#define OFFSETS_CACHED   2
+
+typedef struct winmineOffsets_s {
+    DWORD flagTileFunction;
+    DWORD numMines;
+    DWORD width;
+    DWORD height;
+    DWORD minefield;
+    DWORD minesRemaining;
+} WinmineOffsets;
+
+// One offset to pull out of a match
+typedef struct signatureOperand_s {
+    size_t field;      // offsetof(WinmineOffsets, ...)
+    int position;      // Byte in the pattern where the operand starts
+    int kind;          // SIGNATURE_ABSOLUTE or SIGNATURE_CALL
+} SignatureOperand;
+
+typedef struct signature_s {
+    const char* name;
+    const char* pattern;     // Hex bytes separated by spaces. ?? matches anything
+    int numOperands;
+    SignatureOperand operands[SIGNATURE_MAX_OPERANDS];
+} Signature;
+
+// A pattern ready to search with
+typedef struct pattern_s {
+    size_t length;
+    size_t anchor;                        // First byte that isn't a wildcard. Candidates are found by it
+    unsigned char bytes[SIGNATURE_MAX_LENGTH];
+    unsigned char mask[SIGNATURE_MAX_LENGTH];  // 0xFF where the byte must match, 0 for ??
+    size_t skip[256];                     // Horspool shift by the window's last byte
+} Pattern;
+
+extern const WinmineOffsets builtinOffsets;
+extern const Signature winmineSignatures[];
+extern const int numWinmineSignatures;
+
+int ParsePattern(const char* text, Pattern* pattern);
+long FindPattern(const Pattern* pattern, const unsigned char* image, size_t size);
+uint64_t HashModule(const unsigned char* image, size_t size);
+const char* OffsetCachePath(char* path, size_t size);
+int ScanOffsets(const unsigned char* image, size_t size, uint32_t imageBase, WinmineOffsets* offsets);
+int LoadCachedOffsets(const char* path, uint64_t hash, WinmineOffsets* offsets);
+int SaveCachedOffsets(const char* path, uint64_t hash, const WinmineOffsets* offsets);
+int ResolveOffsets(MemorySource* source, const char* cachePath, WinmineOffsets* offsets);
+int PlantSignatures(unsigned char* image, size_t size, uint32_t imageBase, const WinmineOffsets* offsets, \
+                    unsigned int seed);
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ * Purpose: Monte Carlo games. See simulator.h
+ */
+
+#include<stdlib.h>
+#include<string.h>
+#include"simulator.h"
+#include"board.h"
+#include"bitboard.h"
+#include"tileDecode.h"
+#include"timing.h"
+
+// What a thread pool task needs to play its share of the games
+struct simTask_s {
+    const SimConfig* config;
+    SimArena* arena;
+    volatile long* nextChunk;   // Shared. The next chunk of games nobody has claimed
+    long numChunks;
+};
+
+static DWORD GuessCovered(SimArena* arena, DWORD width, DWORD height) {
+/**
+ * Purpose: Picks a covered tile at random
+ * @param arena : SimArena* - the game. kinds says what's covered
+ * @param width : DWORD - the width of the board
+ * @param height : DWORD - the height of the board
+ * @return : DWORD - the tile's offset, or 0 if nothing is covered
+ */
+
+    DWORD covered = 0;
+    DWORD pick;
+
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) covered += arena->kinds[x + y*ROW_STRIDE] == TILE_UNCLICKED;
+    }
+    if (!covered) return 0;
+
+    pick = NextRandom(&arena->state) % covered;
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            if (arena->kinds[x + y*ROW_STRIDE] == TILE_UNCLICKED && !pick--) return x + y*ROW_STRIDE;
+        }
+    }
+    return 0;
+}
+
+static DWORD CollectSafe(SimArena* arena, DWORD height) {
+/**
+ * Purpose: Copies every tile the solver proved safe into the move list
+ * @param arena : SimArena* - the game, with arena->solved filled in
+ * @param height : DWORD - the height of the board
+ * @return : DWORD - number of moves
+ */
+
+    DWORD numMoves = 0;
+
+    for (DWORD y = 1; y <= height; y++) {
+        for (uint32_t safe = arena->solved.safe[y]; safe; safe &= safe - 1) {
+            arena->moves[numMoves++] = (unsigned short)((DWORD)CTZ32(safe) + y*ROW_STRIDE);
+        }
+    }
+    return numMoves;
+}
+
+static DWORD RandomMove(SimArena* arena, DWORD width, DWORD height, DWORD numMines, DWORD* guessed) {
+/**
+ * Purpose: Clicks a random covered tile every turn. The floor every other
+ *          strategy should beat
+ * @param arena : SimArena* - the game. kinds says what the player sees
+ * @param width : DWORD - the width of the board
+ * @param height : DWORD - the height of the board
+ * @param numMines : DWORD - mines in the game
+ * @param guessed : DWORD* - receives the number of moves that are guesses
+ * @return : DWORD - number of moves in arena->moves
+ */
+
+    (void)numMines;
+    arena->moves[0] = (unsigned short)GuessCovered(arena, width, height);
+    *guessed = 1;
+    return arena->moves[0] ? 1 : 0;
+}
+
+static DWORD LogicMove(SimArena* arena, DWORD width, DWORD height, DWORD numMines, DWORD* guessed) {
+/**
+ * Purpose: Clicks everything the honest helper proves safe. When it's stuck,
+ *          clicks a random covered tile
+ * @param arena : SimArena* - the game. kinds says what the player sees
+ * @param width : DWORD - the width of the board
+ * @param height : DWORD - the height of the board
+ * @param numMines : DWORD - mines in the game
+ * @param guessed : DWORD* - receives the number of moves that are guesses
+ * @return : DWORD - number of moves in arena->moves
+ */
+
+    DWORD numMoves;
+
+    (void)numMines;
+    *guessed = 0;
+    if (!SolveVisible(arena->kinds, height, width, &arena->solved) && (numMoves = CollectSafe(arena, height))) {
+        return numMoves;
+    }
+
+    *guessed = 1;
+    arena->moves[0] = (unsigned short)GuessCovered(arena, width, height);
+    return arena->moves[0] ? 1 : 0;
+}
+
+static DWORD ProbabilityMove(SimArena* arena, DWORD width, DWORD height, DWORD numMines, DWORD* guessed) {
+/**
+ * Purpose: Clicks everything the honest helper proves safe. When it's stuck,
+ *          clicks the tile least likely to be a mine
+ * @param arena : SimArena* - the game. kinds says what the player sees
+ * @param width : DWORD - the width of the board
+ * @param height : DWORD - the height of the board
+ * @param numMines : DWORD - mines in the game
+ * @param guessed : DWORD* - receives the number of moves that are guesses
+ * @return : DWORD - number of moves in arena->moves
+ */
+
+    DWORD numMoves;
+
+    *guessed = 0;
+    if (SolveVisible(arena->kinds, height, width, &arena->solved)) return 0;  // The board contradicts itself
+    if ((numMoves = CollectSafe(arena, height))) return numMoves;
+
+    *guessed = 1;
+    if (!ComputeProbabilities(NULL, &arena->cache, arena->kinds, height, width, numMines, &arena->solved, \
+                              &arena->chances) && arena->chances.bestX) {
+        arena->moves[0] = (unsigned short)(arena->chances.bestX + arena->chances.bestY*ROW_STRIDE);
+        return 1;
+    }
+    arena->moves[0] = (unsigned short)GuessCovered(arena, width, height);
+    return arena->moves[0] ? 1 : 0;
+}
+
+const Strategy simStrategies[] = {
+    { "random",      "a random covered tile every turn", RandomMove },
+    { "logic",       "proven safe tiles, then a random guess", LogicMove },
+    { "probability", "proven safe tiles, then the least likely mine", ProbabilityMove },
+};
+const int numSimStrategies = sizeof(simStrategies) / sizeof(simStrategies[0]);
+
+const Strategy* FindStrategy(const char* name) {
+/**
+ * Purpose: Looks up a built in strategy by name
+ * @param name : const char* - the strategy's name
+ * @return : const Strategy* - the strategy, or NULL if there's no such thing
+ */
+
+    for (int i = 0; i < numSimStrategies; i++) {
+        if (strcmp(simStrategies[i].name, name) == 0) return &simStrategies[i];
+    }
+    return NULL;
+}
+
+int PlayGame(SimArena* arena, const SimConfig* config, unsigned long long index) {
+/**
+ * Purpose: Plays game number index to the end. The board and every random
+ *          guess come from the seed and index alone, so a game plays out
+ *          the same on any thread
+ * @param arena : SimArena* - the calling thread's arena, with its cache set up by InitProbabilityCache
+ * @param config : const SimConfig* - board size and strategy
+ * @param index : unsigned long long - which game to play
+ * @return : int - GAME_WON or GAME_LOST
+ */
+
+    unsigned char* field = arena->image + MINEFIELD_OFFSET;
+    DWORD safeTiles = config->width*config->height - config->numMines;
+    DWORD revealed = 0;
+    int firstClick = 1;
+    unsigned long long mixed = (index + 1)*0x9E3779B97F4A7C15ull ^ config->seed;
+
+    // xorshift can't start at 0, and nearby indexes shouldn't give nearby states
+    mixed ^= mixed >> 31;
+    arena->state = (unsigned int)(mixed ^ (mixed >> 32)) | 1;
+    if (BuildBoard(arena->image, config->width, config->height, config->numMines, NextRandom(&arena->state))) return GAME_LOST;
+
+    for (;;) {
+        DWORD guessed;
+        DWORD numMoves;
+
+        DecodeField(field, config->height, arena->kinds);
+        for (DWORD i = 0; i < KIND_GRID_SIZE; i++) arena->kinds[i] &= TILE_VISIBLE_MASK;
+        numMoves = config->strategy->move(arena, config->width, config->height, config->numMines, &guessed);
+        if (!numMoves) return GAME_LOST;
+        arena->guesses += guessed;
+
+        for (DWORD i = 0; i < numMoves; i++) {
+            DWORD x = arena->moves[i] % ROW_STRIDE, y = arena->moves[i] / ROW_STRIDE;
+            int opened;
+
+            if (firstClick) {
+                MoveFirstClickMine(field, config->width, config->height, x, y);
+                firstClick = 0;
+            }
+            opened = RevealTile(field, config->width, config->height, x, y);
+            arena->clicks++;
+            if (opened < 0) return GAME_LOST;
+            revealed += (DWORD)opened;
+            if (revealed == safeTiles) return GAME_WON;
+        }
+    }
+}
+
+static void SimulateTask(void* argument) {
+/**
+ * Purpose: Thread pool task that claims chunks of games until there are none
+ *          left and plays them in its arena
+ * @param argument : struct simTask_s* - the task
+ * @return : void
+ */
+
+    struct simTask_s* task = (struct simTask_s*)argument;
+    SimArena* arena = task->arena;
+    unsigned long long start = NowNs();
+
+    for (;;) {
+        long chunk = AtomicAdd(task->nextChunk, 1) - 1;
+        unsigned long long first = (unsigned long long)chunk*SIM_CHUNK;
+        unsigned long long last = first + SIM_CHUNK;
+
+        if (chunk >= task->numChunks) break;
+        if (last > task->config->games) last = task->config->games;
+        for (unsigned long long i = first; i < last; i++) {
+            arena->wins += PlayGame(arena, task->config, i) == GAME_WON;
+            arena->games++;
+        }
+    }
+
+    arena->busyNs = NowNs() - start;
+}
+
+int RunSimulation(ThreadPool* pool, const SimConfig* config, SimStats* stats) {
+/**
+ * Purpose: Plays config->games games with one task per pool thread. Each
+ *          task gets its own arena and claims games SIM_CHUNK at a time
+ * @param pool : ThreadPool* - the threads. NULL plays everything on this thread
+ * @param config : const SimConfig* - what to play
+ * @param stats : SimStats* - receives the totals and each thread's rate
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    int numThreads = pool ? pool->numThreads : 1;
+    SimArena* arenas;
+    struct simTask_s tasks[POOL_MAX_THREADS];
+    volatile long nextChunk = 0;  // Chunks claimed so far
+    TaskGroup group = { 0 };
+    unsigned long long start;
+
+    memset(stats, 0, sizeof(SimStats));
+    arenas = (SimArena*)calloc((size_t)numThreads, sizeof(SimArena));
+    if (!arenas) return 1;
+    for (int t = 0; t < numThreads; t++) InitProbabilityCache(&arenas[t].cache);
+
+    start = NowNs();
+    for (int t = 0; t < numThreads; t++) {
+        tasks[t].config    = config;
+        tasks[t].arena     = &arenas[t];
+        tasks[t].nextChunk = &nextChunk;
+        tasks[t].numChunks = (long)((config->games + SIM_CHUNK - 1) / SIM_CHUNK);
+        SubmitTask(pool, &group, SimulateTask, &tasks[t]);
+    }
+    if (pool) WaitForGroup(pool, &group);
+    stats->seconds = (double)(NowNs() - start) / 1e9;
+
+    stats->numThreads = numThreads;
+    for (int t = 0; t < numThreads; t++) {
+        stats->games   += arenas[t].games;
+        stats->wins    += arenas[t].wins;
+        stats->clicks  += arenas[t].clicks;
+        stats->guesses += arenas[t].guesses;
+        stats->threadRate[t] = arenas[t].busyNs ? (double)arenas[t].games / ((double)arenas[t].busyNs / 1e9) : 0.0;
+    }
+
+    for (int t = 0; t < numThreads; t++) FreeProbabilityCache(&arenas[t].cache);
+    free(arenas);
+    return 0;
+}
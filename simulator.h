@@ -0,0 +1,76 @@
+/**
+ * Purpose: Headless Monte Carlo games. Boards are built in winmine's own
+ *          memory layout, the first click follows winmine's rule, and a
+ *          strategy decides every click from the visible tiles alone. Games
+ *          are spread over a thread pool and every thread plays out of its
+ *          own arena, so nothing is allocated or shared per game
+ */
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include"winmine.h"
+#include"tileDecode.h"
+#include"solver.h"
+#include"probability.h"
+#include"threadPool.h"
+
+#define SIM_CHUNK       64    // Games a thread claims at a time
+#define SIM_MAX_MOVES   (MAX_WIDTH*MAX_HEIGHT)
+
+// Everything one thread needs to play games. Allocated once per thread and
+// padded so two threads' counters never share a cache line
+typedef struct simArena_s {
+    unsigned char image[MODULE_IMAGE_SIZE];  // The board, laid out like winmine's module
+    unsigned char kinds[KIND_GRID_SIZE];     // What the player can see
+    unsigned short moves[SIM_MAX_MOVES];     // Tile offsets the strategy wants clicked
+    SolverResult solved;
+    ProbabilityResult chances;
+    ProbabilityCache cache;                  // Groups this thread has counted. Not shared, so never waited on
+    unsigned int state;                      // Random state for the current game
+    unsigned long long games;                // Games this arena played
+    unsigned long long wins;
+    unsigned long long clicks;
+    unsigned long long guesses;              // Clicks the strategy couldn't prove safe
+    unsigned long long busyNs;               // Time spent playing
+    char padding[64];
+} SimArena;
+
+// A strategy fills arena->moves with tiles to click from arena->kinds and
+// returns how many there are. It says how many of them are guesses through
+// guessed. Returning 0 gives the game up (counted as a loss)
+typedef DWORD (*StrategyMove)(SimArena* arena, DWORD width, DWORD height, DWORD numMines, DWORD* guessed);
+
+typedef struct strategy_s {
+    const char* name;
+    const char* description;
+    StrategyMove move;
+} Strategy;
+
+typedef struct simConfig_s {
+    DWORD width;
+    DWORD height;
+    DWORD numMines;
+    unsigned long long games;
+    unsigned int seed;               // Game i always gets the same board and guesses
+    const Strategy* strategy;
+} SimConfig;
+
+typedef struct simStats_s {
+    unsigned long long games;
+    unsigned long long wins;
+    unsigned long long clicks;
+    unsigned long long guesses;
+    double seconds;                  // Wall clock for the whole run
+    int numThreads;
+    double threadRate[POOL_MAX_THREADS];  // Games per second of each thread while it was busy
+} SimStats;
+
+extern const Strategy simStrategies[];
+extern const int numSimStrategies;
+
+const Strategy* FindStrategy(const char* name);
+int PlayGame(SimArena* arena, const SimConfig* config, unsigned long long index);
+int RunSimulation(ThreadPool* pool, const SimConfig* config, SimStats* stats);
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * Purpose: Single read snapshots of the winmine game state. See snapshot.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"snapshot.h"
+
+static DWORD WindowDword(const unsigned char* window, DWORD offset) {
+/**
+ * Purpose: Pulls a little endian DWORD out of the snapshot window
+ * @param window : const unsigned char* - the raw snapshot window
+ * @param offset : DWORD - module offset of the DWORD (ex. WIDTH_OFFSET)
+ * @return : DWORD - the value at that offset
+ */
+
+    DWORD value;
+    memcpy(&value, window + (offset - SNAPSHOT_OFFSET), sizeof(DWORD));
+    return value;
+}
+
+int DecodeSnapshot(Snapshot* snapshot) {
+/**
+ * Purpose: Fills in the mine count and dimensions from the raw window that
+ *          was already copied into the snapshot. Says nothing itself, since
+ *          archives hand it any number of windows that aren't games
+ * @param snapshot : Snapshot* - snapshot with a populated window
+ * @return : int - 0 on success, SNAPSHOT_NOT_A_GAME if the window doesn't look like a game
+ */
+
+    snapshot->numMines = WindowDword(snapshot->window, NUM_MINES_OFFSET);
+    snapshot->height   = WindowDword(snapshot->window, HEIGHT_OFFSET);
+    snapshot->width    = WindowDword(snapshot->window, WIDTH_OFFSET);
+
+    // Everything else indexes the field with these so make sure they're sane
+    if (snapshot->width < 1 || snapshot->width > MAX_WIDTH || \
+        snapshot->height < 1 || snapshot->height > MAX_HEIGHT || \
+        snapshot->numMines > snapshot->width * snapshot->height) {
+        return SNAPSHOT_NOT_A_GAME;
+    }
+
+    return 0;
+}
+
+int TakeSnapshot(MemorySource* source, Snapshot* snapshot) {
+/**
+ * Purpose: Reads the whole 0x5330 - 0x569F window in one go and decodes it
+ * @param source : MemorySource* - where to read winmine's memory from
+ * @param snapshot : Snapshot* - receives the game state
+ * @return : int - 0 on success, 1 if it couldn't be read, SNAPSHOT_NOT_A_GAME if it isn't a game
+ */
+
+    return TakeSnapshotAt(source, SNAPSHOT_OFFSET, snapshot);
+}
+
+int TakeSnapshotAt(MemorySource* source, DWORD offset, Snapshot* snapshot) {
+/**
+ * Purpose: Takes a snapshot of a build that keeps the window somewhere
+ *          else. The block moves as a whole, so everything inside it is
+ *          where SNAPSHOT_FIELD and DecodeSnapshot expect
+ * @param source : MemorySource* - where to read winmine's memory from
+ * @param offset : DWORD - where the window starts (the build's mine count offset)
+ * @param snapshot : Snapshot* - receives the game state
+ * @return : int - 0 on success, 1 if it couldn't be read, SNAPSHOT_NOT_A_GAME if it isn't a game
+ */
+
+    if (ReadSource(source, offset, snapshot->window, SNAPSHOT_SIZE)) {
+        printf("Error reading the minefield snapshot from memory\n");
+        return 1;
+    }
+
+    return DecodeSnapshot(snapshot);
+}
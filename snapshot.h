@@ -0,0 +1,28 @@
+/**
+ * Purpose: Grabs the mine count, field dimensions and minefield out of winmine
+ *          with a single read and decodes them from that one buffer
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include"winmine.h"
+#include"memorySource.h"
+
+typedef struct snapshot_s {
+    DWORD numMines;                       // Total number of mines in the field
+    DWORD height;                         // Height of the field in tiles
+    DWORD width;                          // Width of the field in tiles
+    unsigned char window[SNAPSHOT_SIZE];  // Raw bytes from SNAPSHOT_OFFSET onwards
+} Snapshot;
+
+#define SNAPSHOT_NOT_A_GAME 2  // The window's dimensions or mine count are out of range
+
+// Pointer to the minefield inside a snapshot's raw window
+#define SNAPSHOT_FIELD(snapshot) ((snapshot)->window + (MINEFIELD_OFFSET - SNAPSHOT_OFFSET))
+
+int TakeSnapshot(MemorySource* source, Snapshot* snapshot);
+int TakeSnapshotAt(MemorySource* source, DWORD offset, Snapshot* snapshot);
+int DecodeSnapshot(Snapshot* snapshot);
+
+#endif
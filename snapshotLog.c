@@ -0,0 +1,380 @@
+/**
+ * Purpose: Delta compressed snapshot logs. See snapshotLog.h
+ */
+
+#include<stdlib.h>
+#include<string.h>
+#include"snapshotLog.h"
+#include"timing.h"
+
+#define RUN_MIN         3       // Shorter runs are cheaper as part of a literal
+#define LITERAL_MAX     0x80
+#define REPEAT_MAX      (0x3F + 2)
+#define SKIP_MAX        (0x3FFF + 1)
+
+size_t EncodeRuns(const unsigned char* data, size_t length, unsigned char* out) {
+/**
+ * Purpose: Run length encodes data. Trailing zeros are left off
+ * @param data : const unsigned char* - what to encode
+ * @param length : size_t - how many bytes of it
+ * @param out : unsigned char* - receives the tokens. Needs length + length/LITERAL_MAX + 1 bytes
+ * @return : size_t - the number of bytes written to out
+ */
+
+    size_t used = 0;
+    size_t literal = 0;   // Where the literal being built starts in out
+    size_t literalLength = 0;
+    size_t end = length;
+
+    while (end && !data[end - 1]) end--;
+
+    for (size_t i = 0; i < end;) {
+        size_t run = 1;
+        while (i + run < end && data[i + run] == data[i]) run++;
+
+        if (run >= RUN_MIN || (run == 2 && !literalLength)) {
+            literalLength = 0;
+            if (!data[i]) {
+                if (run > SKIP_MAX) run = SKIP_MAX;
+                out[used++] = (unsigned char)(0xC0 | ((run - 1) >> 8));
+                out[used++] = (unsigned char)((run - 1) & 0xFF);
+            }
+            else {
+                if (run > REPEAT_MAX) run = REPEAT_MAX;
+                out[used++] = (unsigned char)(0x80 | (run - 2));
+                out[used++] = data[i];
+            }
+            i += run;
+            continue;
+        }
+
+        // Short runs join the current literal
+        for (size_t j = 0; j < run; j++) {
+            if (!literalLength || literalLength == LITERAL_MAX) {
+                literal = used++;
+                literalLength = 0;
+            }
+            out[literal] = (unsigned char)literalLength;
+            out[used++] = data[i + j];
+            literalLength++;
+        }
+        i += run;
+    }
+
+    return used;
+}
+
+int DecodeRuns(const unsigned char* in, size_t inLength, unsigned char* data, size_t length) {
+/**
+ * Purpose: XORs the bytes encoded by EncodeRuns into data. Skipped and
+ *          trailing bytes are zero so they leave data alone
+ * @param in : const unsigned char* - the tokens
+ * @param inLength : size_t - how many bytes of tokens
+ * @param data : unsigned char* - the bytes to XOR into
+ * @param length : size_t - the size of data
+ * @return : int - 0 on success, 1 if the tokens are corrupt
+ */
+
+    size_t at = 0;
+    size_t i = 0;
+
+    while (i < inLength) {
+        unsigned char c = in[i++];
+        size_t count;
+
+        if (c < 0x80) {
+            count = (size_t)c + 1;
+            if (i + count > inLength || at + count > length) return 1;
+            for (size_t j = 0; j < count; j++) data[at + j] ^= in[i + j];
+            i += count;
+        }
+        else if (c < 0xC0) {
+            count = (size_t)(c & 0x3F) + 2;
+            if (i >= inLength || at + count > length) return 1;
+            for (size_t j = 0; j < count; j++) data[at + j] ^= in[i];
+            i++;
+        }
+        else {
+            if (i >= inLength) return 1;
+            count = ((size_t)(c & 0x3F) << 8 | in[i++]) + 1;
+            if (at + count > length) return 1;
+        }
+        at += count;
+    }
+
+    return 0;
+}
+
+static size_t PutVarint(unsigned char* out, unsigned long long value) {
+/**
+ * Purpose: Writes value seven bits at a time, low bits first
+ * @param out : unsigned char* - where to write. Needs up to 10 bytes
+ * @param value : unsigned long long - the number
+ * @return : size_t - bytes written
+ */
+
+    size_t used = 0;
+    while (value >= 0x80) {
+        out[used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[used++] = (unsigned char)value;
+    return used;
+}
+
+static int GetVarint(const unsigned char* in, size_t length, size_t* at, unsigned long long* value) {
+/**
+ * Purpose: Reads a number written by PutVarint
+ * @param in : const unsigned char* - the bytes
+ * @param length : size_t - how many bytes there are
+ * @param at : size_t* - where the number starts. Moved past it
+ * @param value : unsigned long long* - receives the number
+ * @return : int - 0 on success, 1 if it runs off the end
+ */
+
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*at >= length) return 1;
+        *value |= (unsigned long long)(in[*at] & 0x7F) << shift;
+        if (!(in[(*at)++] & 0x80)) return 0;
+    }
+    return 1;
+}
+
+int OpenLogWriter(LogWriter* log, const char* path) {
+/**
+ * Purpose: Creates a new log, replacing anything at path
+ * @param log : LogWriter* - receives the writer
+ * @param path : const char* - where to write the log
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    memset(log, 0, sizeof(LogWriter));
+    log->file = fopen(path, "wb");
+    if (!log->file) {
+        perror(path);
+        return 1;
+    }
+    if (fwrite(LOG_MAGIC, LOG_MAGIC_SIZE, 1, log->file) != 1) {
+        perror(path);
+        fclose(log->file);
+        return 1;
+    }
+    log->bytes = LOG_MAGIC_SIZE;
+    log->startNs = NowNs();
+    return 0;
+}
+
+int AppendFrame(LogWriter* log, const unsigned char* frame) {
+/**
+ * Purpose: Appends a frame to the log
+ * @param log : LogWriter* - the log
+ * @param frame : const unsigned char* - LOG_FRAME_SIZE bytes laid out as in snapshotLog.h
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned char delta[LOG_FRAME_SIZE];
+    unsigned char record[LOG_MAX_RECORD];
+    unsigned char payload[LOG_FRAME_SIZE*2];
+    unsigned long long now = (NowNs() - log->startNs) / 1000000;  // Milliseconds. Rounding never piles up
+    int keyframe = log->frames % LOG_KEYFRAME_INTERVAL == 0;
+    size_t payloadSize;
+    size_t used = 0;
+
+    for (size_t i = 0; i < LOG_FRAME_SIZE; i++) delta[i] = keyframe ? frame[i] : (unsigned char)(frame[i] ^ log->previous[i]);
+    payloadSize = EncodeRuns(delta, LOG_FRAME_SIZE, payload);
+
+    record[used++] = keyframe ? LOG_KEYFRAME : LOG_DELTA;
+    used += PutVarint(record + used, payloadSize);
+    used += PutVarint(record + used, now - log->lastMs);
+    memcpy(record + used, payload, payloadSize);
+    used += payloadSize;
+
+    // One write per record so a crash leaves at most one torn record at the end
+    if (fwrite(record, used, 1, log->file) != 1) {
+        perror("Error writing to the log");
+        return 1;
+    }
+
+    memcpy(log->previous, frame, LOG_FRAME_SIZE);
+    log->frames++;
+    log->bytes += used;
+    log->lastMs = now;
+    return 0;
+}
+
+int RecordFrame(LogWriter* log, MemorySource* source, int* changed) {
+/**
+ * Purpose: Reads the snapshot window and the remaining mine counter and
+ *          appends them if anything moved since the last frame
+ * @param log : LogWriter* - the log
+ * @param source : MemorySource* - the game to read
+ * @param changed : int* - set to 1 if a frame was written, 0 if not
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    unsigned char frame[LOG_FRAME_SIZE];
+
+    *changed = 0;
+    if (ReadSource(source, SNAPSHOT_OFFSET, frame, SNAPSHOT_SIZE) || \
+        ReadSource(source, MINES_REMAINING_OFFSET, LOG_FRAME_REMAINING(frame), sizeof(DWORD))) return 1;
+
+    if (log->frames && !memcmp(frame, log->previous, LOG_FRAME_SIZE)) return 0;
+    *changed = 1;
+    return AppendFrame(log, frame);
+}
+
+void CloseLogWriter(LogWriter* log) {
+/**
+ * Purpose: Flushes and closes the log
+ * @param log : LogWriter* - the log
+ * @return : void
+ */
+
+    if (log->file) fclose(log->file);
+    log->file = NULL;
+}
+
+int OpenLogReader(LogReader* log, const char* path) {
+/**
+ * Purpose: Maps a log and indexes its keyframes. A torn record at the end
+ *          (the recorder was killed mid write) is ignored
+ * @param log : LogReader* - receives the reader
+ * @param path : const char* - the log
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    size_t at = LOG_MAGIC_SIZE;
+    size_t capacity = 64;
+    unsigned long long timeMs = 0;
+
+    memset(log, 0, sizeof(LogReader));
+    if (MapFile(path, &log->file)) return 1;
+    if (log->file.size < LOG_MAGIC_SIZE || memcmp(log->file.data, LOG_MAGIC, LOG_MAGIC_SIZE)) {
+        fprintf(stderr, "%s isn't a snapshot log\n", path);
+        UnmapFile(&log->file);
+        return 1;
+    }
+
+    log->keyframes  = (size_t*)malloc(capacity*sizeof(size_t));
+    log->keyframeMs = (unsigned long long*)malloc(capacity*sizeof(unsigned long long));
+    if (!log->keyframes || !log->keyframeMs) {
+        CloseLogReader(log);
+        return 1;
+    }
+
+    // Only the record headers are touched here. Payloads are skipped over
+    while (at < log->file.size) {
+        size_t start = at;
+        unsigned char type = log->file.data[at++];
+        unsigned long long payloadSize, deltaMs;
+        int keyframe = log->numFrames % LOG_KEYFRAME_INTERVAL == 0;
+
+        if (GetVarint(log->file.data, log->file.size, &at, &payloadSize) || \
+            GetVarint(log->file.data, log->file.size, &at, &deltaMs) || \
+            payloadSize > log->file.size - at) break;
+        if (type != (keyframe ? LOG_KEYFRAME : LOG_DELTA)) {
+            fprintf(stderr, "%s is corrupt at byte %zu\n", path, start);
+            break;
+        }
+        timeMs += deltaMs;
+
+        if (keyframe) {
+            size_t index = (size_t)(log->numFrames / LOG_KEYFRAME_INTERVAL);
+            if (index == capacity) {
+                size_t* offsets;
+                unsigned long long* times;
+                capacity *= 2;
+                offsets = (size_t*)realloc(log->keyframes, capacity*sizeof(size_t));
+                if (offsets) log->keyframes = offsets;
+                times = (unsigned long long*)realloc(log->keyframeMs, capacity*sizeof(unsigned long long));
+                if (times) log->keyframeMs = times;
+                if (!offsets || !times) {
+                    CloseLogReader(log);
+                    return 1;
+                }
+            }
+            log->keyframes[index]  = start;
+            log->keyframeMs[index] = timeMs;
+        }
+        log->numFrames++;
+        at += (size_t)payloadSize;
+    }
+
+    log->current = log->numFrames;
+    return 0;
+}
+
+static int ApplyRecord(LogReader* log) {
+/**
+ * Purpose: Decodes the record at log->next into log->frame
+ * @param log : LogReader* - the reader
+ * @return : int - 0 on success, 1 if the record is corrupt
+ */
+
+    size_t at = log->next;
+    unsigned long long payloadSize, deltaMs;
+    unsigned char type = log->file.data[at++];
+
+    GetVarint(log->file.data, log->file.size, &at, &payloadSize);
+    GetVarint(log->file.data, log->file.size, &at, &deltaMs);
+    if (type == LOG_KEYFRAME) memset(log->frame, 0, LOG_FRAME_SIZE);
+    if (DecodeRuns(log->file.data + at, (size_t)payloadSize, log->frame, LOG_FRAME_SIZE)) return 1;
+
+    log->timeMs += deltaMs;
+    log->next = at + (size_t)payloadSize;
+    log->recordsApplied++;
+    return 0;
+}
+
+int SeekFrame(LogReader* log, unsigned long long index) {
+/**
+ * Purpose: Rebuilds frame index into log->frame. Moving forward a little
+ *          applies the deltas in between. Anything else starts from the
+ *          closest keyframe at or before index, so no seek decodes more than
+ *          LOG_KEYFRAME_INTERVAL records
+ * @param log : LogReader* - the reader
+ * @param index : unsigned long long - the frame to rebuild
+ * @return : int - 0 on success, 1 if index is past the end or the log is corrupt
+ */
+
+    unsigned long long keyframe = index / LOG_KEYFRAME_INTERVAL;
+
+    if (index >= log->numFrames) return 1;
+    if (index == log->current) return 0;
+
+    if (log->current >= log->numFrames || index < log->current || \
+        log->current / LOG_KEYFRAME_INTERVAL != keyframe) {
+        log->next    = log->keyframes[keyframe];
+        log->current = keyframe*LOG_KEYFRAME_INTERVAL;
+        log->timeMs  = log->keyframeMs[keyframe];
+        if (ApplyRecord(log)) {
+            log->current = log->numFrames;
+            return 1;
+        }
+        log->timeMs = log->keyframeMs[keyframe];  // Already counted by the index
+    }
+
+    while (log->current < index) {
+        if (ApplyRecord(log)) {
+            log->current = log->numFrames;
+            return 1;
+        }
+        log->current++;
+    }
+
+    return 0;
+}
+
+void CloseLogReader(LogReader* log) {
+/**
+ * Purpose: Unmaps the log and frees the index
+ * @param log : LogReader* - the reader
+ * @return : void
+ */
+
+    if (log->file.size) UnmapFile(&log->file);
+    free(log->keyframes);
+    free(log->keyframeMs);
+    memset(log, 0, sizeof(LogReader));
+}
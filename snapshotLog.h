@@ -0,0 +1,73 @@
+/**
+ * Purpose: Records a game as an append-only log of snapshots. A frame is
+ *          the snapshot window (mine count, dimensions and minefield) plus
+ *          MINES_REMAINING. Each frame is stored as the XOR against the frame
+ *          before it, run length encoded, so a move costs a few bytes
+ *          instead of a whole window. Every LOG_KEYFRAME_INTERVAL frames a
+ *          keyframe (XOR against nothing) lets a reader jump straight in
+ *
+ *          File layout: LOG_MAGIC, then one record per frame:
+ *            type (LOG_KEYFRAME or LOG_DELTA), varint payload length,
+ *            varint milliseconds since the previous frame, payload
+ *          Payload tokens:
+ *            0x00 - 0x7F  literal: the next c + 1 bytes
+ *            0x80 - 0xBF  repeat: the next byte (c & 0x3F) + 2 times
+ *            0xC0 - 0xFF  skip: ((c & 0x3F) << 8 | next byte) + 1 zero bytes
+ *          Anything past the last token is zero
+ */
+
+#ifndef SNAPSHOT_LOG_H
+#define SNAPSHOT_LOG_H
+
+#include<stdio.h>
+#include"winmine.h"
+#include"memorySource.h"
+#include"mappedFile.h"
+
+#define LOG_MAGIC               "WMLOG\x01\r\n"  // 8 bytes. The \r\n catches text mode mangling
+#define LOG_MAGIC_SIZE          8
+#define LOG_FRAME_SIZE          (SNAPSHOT_SIZE + sizeof(DWORD))  // Snapshot window then MINES_REMAINING
+#define LOG_KEYFRAME_INTERVAL   64    // Frame i is a keyframe when i % 64 == 0
+#define LOG_KEYFRAME            0x4B  // 'K'
+#define LOG_DELTA               0x44  // 'D'
+#define LOG_MAX_RECORD          (LOG_FRAME_SIZE*2 + 16)  // Worst case record size
+
+// Where the pieces of a frame are
+#define LOG_FRAME_FIELD(frame)  ((frame) + (MINEFIELD_OFFSET - SNAPSHOT_OFFSET))
+#define LOG_FRAME_DWORD(frame, offset) ((frame) + ((offset) - SNAPSHOT_OFFSET))
+#define LOG_FRAME_REMAINING(frame) ((frame) + SNAPSHOT_SIZE)
+
+typedef struct logWriter_s {
+    FILE* file;
+    unsigned char previous[LOG_FRAME_SIZE];  // The last frame written
+    unsigned long long frames;               // Frames written
+    unsigned long long bytes;                // Bytes written, magic included
+    unsigned long long startNs;              // When the log was opened
+    unsigned long long lastMs;               // Time of the last frame since startNs
+} LogWriter;
+
+typedef struct logReader_s {
+    MappedFile file;
+    unsigned long long numFrames;
+    size_t* keyframes;                       // File offset of every keyframe
+    unsigned long long* keyframeMs;          // And its time since recording began
+    unsigned char frame[LOG_FRAME_SIZE];     // The frame SeekFrame last rebuilt
+    unsigned long long current;              // Its index. numFrames if nothing's been rebuilt
+    unsigned long long timeMs;               // Its time since recording began
+    size_t next;                             // File offset of the record after it
+    unsigned long long recordsApplied;       // Records decoded by SeekFrame so far
+} LogReader;
+
+size_t EncodeRuns(const unsigned char* data, size_t length, unsigned char* out);
+int DecodeRuns(const unsigned char* in, size_t inLength, unsigned char* data, size_t length);
+
+int OpenLogWriter(LogWriter* log, const char* path);
+int AppendFrame(LogWriter* log, const unsigned char* frame);
+int RecordFrame(LogWriter* log, MemorySource* source, int* changed);
+void CloseLogWriter(LogWriter* log);
+
+int OpenLogReader(LogReader* log, const char* path);
+int SeekFrame(LogReader* log, unsigned long long index);
+void CloseLogReader(LogReader* log);
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * Purpose: Constraint propagation over the visible minefield. See solver.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"solver.h"
+#include"tileDecode.h"
+#include"board.h"
+
+uint32_t ConstraintRow(const Constraint* constraint, DWORD row) {
+/**
+ * Purpose: The constraint's unknown tiles in an absolute row of the field
+ * @param constraint : const Constraint* - the constraint
+ * @param row : DWORD - row of the field
+ * @return : uint32_t - the tiles as a row mask. 0 if row is out of reach
+ */
+
+    if (row + 1 < constraint->y || row > constraint->y + 1) return 0;
+    return constraint->rows[row + 1 - constraint->y];
+}
+
+int ConstraintSize(const Constraint* constraint) {
+/**
+ * Purpose: Number of unknown tiles in a constraint
+ * @param constraint : const Constraint* - the constraint
+ * @return : int - 0 through 8
+ */
+
+    return POPCOUNT32(constraint->rows[0]) + POPCOUNT32(constraint->rows[1]) + POPCOUNT32(constraint->rows[2]);
+}
+
+static DWORD MarkTiles(SolverResult* result, DWORD top, const uint32_t* rows, int isMine) {
+/**
+ * Purpose: Records three rows worth of tiles as safe or mined
+ * @param result : SolverResult* - where the known tiles are kept
+ * @param top : DWORD - field row of rows[0]
+ * @param rows : const uint32_t* - three row masks
+ * @param isMine : int - non-zero for mines, 0 for safe tiles
+ * @return : DWORD - number of tiles that weren't already known
+ */
+
+    uint32_t* known = isMine ? result->mines : result->safe;
+    DWORD added = 0;
+
+    for (DWORD i = 0; i < 3; i++) {
+        uint32_t fresh = rows[i] & ~known[top + i];
+        added += (DWORD)POPCOUNT32(fresh);
+        known[top + i] |= fresh;
+    }
+
+    if (isMine) result->numMines += added;
+    else result->numSafe += added;
+    return added;
+}
+
+static int BuildConstraints(const unsigned char* kinds, DWORD height, DWORD width, \
+                            const uint32_t* covered, SolverResult* result, short* index) {
+/**
+ * Purpose: Makes a constraint for every revealed number that still touches
+ *          a tile we know nothing about
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param covered : const uint32_t* - row masks of tiles the player can't see under
+ * @param result : SolverResult* - known tiles in, constraints out
+ * @param index : short* - receives constraint number + 1 at each number's offset
+ * @return : int - 0 on success, 1 if the numbers contradict each other
+ */
+
+    result->numConstraints = 0;
+    memset(index, 0, sizeof(short)*ROW_STRIDE*BITBOARD_ROWS);
+
+    for (DWORD y = 1; y <= height; y++) {
+
+        // Rows with nothing covered around them can't hold a constraint
+        if (!(covered[y - 1] | covered[y] | covered[y + 1])) continue;
+
+        for (DWORD x = 1; x <= width; x++) {
+            unsigned char visible = kinds[x + y*ROW_STRIDE] & TILE_VISIBLE_MASK;
+            if (visible < 1 || visible > 8) continue;
+
+            Constraint* constraint = &result->constraints[result->numConstraints];
+            uint32_t around = 7u << (x - 1);
+            int knownMines = 0;
+
+            for (DWORD i = 0; i < 3; i++) {
+                DWORD row = y - 1 + i;
+                constraint->rows[i] = around & covered[row] & ~result->safe[row] & ~result->mines[row];
+                knownMines += POPCOUNT32(around & result->mines[row]);
+            }
+            if (!(constraint->rows[0] | constraint->rows[1] | constraint->rows[2])) continue;
+
+            constraint->x = x;
+            constraint->y = y;
+            constraint->mines = visible - knownMines;
+            if (constraint->mines < 0 || constraint->mines > ConstraintSize(constraint)) return 1;
+
+            index[x + y*ROW_STRIDE] = (short)++result->numConstraints;
+        }
+    }
+
+    return 0;
+}
+
+static DWORD PairwisePass(SolverResult* result, const short* index, DWORD height, DWORD width) {
+/**
+ * Purpose: Compares every constraint with the ones close enough to share a
+ *          tile. If B minus A has exactly B.mines - A.mines tiles then all of
+ *          them are mines and A minus B is safe. With A a subset of B this is
+ *          the usual subset rule
+ * @param result : SolverResult* - constraints in, newly known tiles out
+ * @param index : const short* - constraint number + 1 at each number's offset
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @return : DWORD - number of tiles found
+ */
+
+    DWORD found = 0;
+
+    for (DWORD i = 0; i < result->numConstraints; i++) {
+        const Constraint* a = &result->constraints[i];
+
+        for (int dy = -2; dy <= 2; dy++) {
+            for (int dx = -2; dx <= 2; dx++) {
+                int bx = (int)a->x + dx;
+                int by = (int)a->y + dy;
+                if ((!dx && !dy) || bx < 1 || bx > (int)width || by < 1 || by > (int)height) continue;
+
+                short other = index[bx + by*ROW_STRIDE];
+                if (!other) continue;
+                const Constraint* b = &result->constraints[other - 1];
+
+                uint32_t bOnly[3];  // B minus A, in B's rows
+                uint32_t aOnly[3];  // A minus B, in A's rows
+                int bOnlySize = 0;
+                for (DWORD r = 0; r < 3; r++) {
+                    bOnly[r] = b->rows[r] & ~ConstraintRow(a, b->y - 1 + r);
+                    aOnly[r] = a->rows[r] & ~ConstraintRow(b, a->y - 1 + r);
+                    bOnlySize += POPCOUNT32(bOnly[r]);
+                }
+
+                if (bOnlySize != b->mines - a->mines) continue;
+                found += MarkTiles(result, b->y - 1, bOnly, 1);
+                found += MarkTiles(result, a->y - 1, aOnly, 0);
+            }
+        }
+    }
+
+    return found;
+}
+
+int SolveVisible(const unsigned char* kinds, DWORD height, DWORD width, SolverResult* result) {
+/**
+ * Purpose: Finds every covered tile that single-number and pairwise
+ *          reasoning can prove safe or mined, looping until nothing new
+ *          turns up. Only the visible part of each kind is looked at
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param result : SolverResult* - receives the safe and mined tiles
+ * @return : int - 0 on success, 1 if the visible numbers contradict each other
+ */
+
+    uint32_t covered[BITBOARD_ROWS];            // Tiles we can't see under
+    short index[ROW_STRIDE*BITBOARD_ROWS];      // Which constraint sits on which number
+    DWORD found = 1;
+
+    memset(result->safe, 0, sizeof(result->safe));
+    memset(result->mines, 0, sizeof(result->mines));
+    memset(covered, 0, sizeof(covered));
+    result->numSafe  = 0;
+    result->numMines = 0;
+    result->passes   = 0;
+
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            unsigned char visible = kinds[x + y*ROW_STRIDE] & TILE_VISIBLE_MASK;
+            if (SOLVER_COVERED(visible)) covered[y] |= 1u << x;
+        }
+    }
+
+    while (found) {
+        found = 0;
+        result->passes++;
+        if (BuildConstraints(kinds, height, width, covered, result, index)) return 1;
+
+        // Single numbers first: all of its unknowns are safe or all are mines
+        for (DWORD i = 0; i < result->numConstraints; i++) {
+            Constraint* constraint = &result->constraints[i];
+            if (constraint->mines == 0) found += MarkTiles(result, constraint->y - 1, constraint->rows, 0);
+            else if (constraint->mines == ConstraintSize(constraint)) {
+                found += MarkTiles(result, constraint->y - 1, constraint->rows, 1);
+            }
+        }
+
+        // Only bother with pairs once the cheap rule runs dry
+        if (!found) found = PairwisePass(result, index, height, width);
+    }
+
+    // A tile can only end up both if the numbers contradict each other
+    for (DWORD y = 1; y <= height; y++) {
+        if (result->safe[y] & result->mines[y]) return 1;
+    }
+
+    return 0;
+}
+
+int ListConstraints(const unsigned char* kinds, DWORD height, DWORD width, SolverResult* result) {
+/**
+ * Purpose: Fills in the frontier for safe and mined tiles that were found
+ *          some other way (see incrementalSolver.h), the same as SolveVisible
+ *          leaves it when it gets stuck
+ * @param kinds : const unsigned char* - the decoded minefield
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @param result : SolverResult* - known tiles in, constraints out
+ * @return : int - 0 on success, 1 if the visible numbers contradict each other
+ */
+
+    uint32_t covered[BITBOARD_ROWS];
+    short index[ROW_STRIDE*BITBOARD_ROWS];
+
+    memset(covered, 0, sizeof(covered));
+    for (DWORD y = 1; y <= height; y++) {
+        for (DWORD x = 1; x <= width; x++) {
+            if (SOLVER_COVERED(kinds[x + y*ROW_STRIDE] & TILE_VISIBLE_MASK)) covered[y] |= 1u << x;
+        }
+    }
+
+    return BuildConstraints(kinds, height, width, covered, result, index);
+}
+
+int PlayWithoutGuessing(unsigned char* field, DWORD width, DWORD height, DWORD x, DWORD y, \
+                        SolverResult* result, DWORD* clicks) {
+/**
+ * Purpose: Clicks x, y and then every tile the honest helper proves safe,
+ *          over and over, until the game is won or nothing is provably safe
+ * @param field : unsigned char* - the raw minefield. Tiles get revealed in place
+ * @param width : DWORD - the width of the minefield
+ * @param height : DWORD - the height of the minefield
+ * @param x : DWORD - column of the first click
+ * @param y : DWORD - row of the first click
+ * @param result : SolverResult* - scratch space for the solver
+ * @param clicks : DWORD* - receives the number of clicks made
+ * @return : int - GAME_WON, GAME_LOST (the first click was a mine) or
+ *         GAME_IN_PROGRESS if the game can't go on without a guess
+ */
+
+    unsigned char kinds[KIND_GRID_SIZE];  // The visible part of the field
+    Bitboard board;
+
+    *clicks = 1;
+    if (RevealTile(field, width, height, x, y) < 0) return GAME_LOST;
+
+    for (;;) {
+        int opened = 0;   // Tiles this round of clicks opened
+
+        DecodeField(field, height, kinds);
+        for (DWORD i = 0; i < KIND_GRID_SIZE; i++) kinds[i] &= TILE_VISIBLE_MASK;
+        if (SolveVisible(kinds, height, width, result) || !result->numSafe) break;
+
+        for (DWORD row = 1; row <= height; row++) {
+            for (uint32_t safe = result->safe[row]; safe; safe &= safe - 1) {
+                DWORD column = (DWORD)CTZ32(safe);
+                unsigned char* tile = field + column + row*ROW_STRIDE;
+                int revealed;
+
+                // Flags and question marks count as covered, so a proven safe
+                // tile can have one. It's wrong, so take it off before clicking
+                if (!(*tile & REVEALED_TILE) && ((*tile & 0x0F) == FLAG || (*tile & 0x0F) == QUESTION_MARK)) {
+                    *tile = (unsigned char)((*tile & MINE) | UNCLICKED_SPACE);
+                }
+
+                // A cascade from an earlier click may have opened this one already
+                revealed = RevealTile(field, width, height, column, row);
+                if (revealed > 0) {
+                    (*clicks)++;
+                    opened += revealed;
+                }
+            }
+        }
+
+        // Nothing opened means the same safe tiles would come back forever
+        if (!opened) break;
+    }
+
+    PackBitboard(field, height, width, &board);
+    return GameState(&board);
+}
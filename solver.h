@@ -0,0 +1,46 @@
+/**
+ * Purpose: The "honest helper". Works only from what a player can see (the
+ *          numbers on revealed tiles and which tiles are still covered) and
+ *          finds tiles that are provably safe or provably mined. Flags and
+ *          question marks are treated as covered tiles since the player
+ *          might have put them in the wrong place
+ */
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include<stdint.h>
+#include"winmine.h"
+#include"bitboard.h"
+#include"tileDecode.h"
+
+// Tiles the player can't see under. Flags and question marks count
+#define SOLVER_COVERED(visible) ((visible) == TILE_UNCLICKED || (visible) == TILE_FLAG || (visible) == TILE_QUESTION)
+
+// Every revealed number next to a covered tile is a constraint: the covered
+// tiles around it (at most 3 rows, so 3 row masks) hold exactly mines mines
+typedef struct constraint_s {
+    DWORD x;             // Column of the number
+    DWORD y;             // Row of the number
+    uint32_t rows[3];    // Unknown neighbors in rows y - 1, y and y + 1
+    int mines;           // Mines still to be found among them
+} Constraint;
+
+typedef struct solverResult_s {
+    uint32_t safe[BITBOARD_ROWS];    // Covered tiles that can't be mines
+    uint32_t mines[BITBOARD_ROWS];   // Covered tiles that must be mines
+    DWORD numSafe;                   // Number of bits set in safe
+    DWORD numMines;                  // Number of bits set in mines
+    DWORD numConstraints;            // Constraints left when the solver got stuck
+    int passes;                      // Times the solver went over the frontier
+    Constraint constraints[MAX_WIDTH*MAX_HEIGHT];  // The frontier when the solver got stuck
+} SolverResult;
+
+uint32_t ConstraintRow(const Constraint* constraint, DWORD row);
+int ConstraintSize(const Constraint* constraint);
+int SolveVisible(const unsigned char* kinds, DWORD height, DWORD width, SolverResult* result);
+int ListConstraints(const unsigned char* kinds, DWORD height, DWORD width, SolverResult* result);
+int PlayWithoutGuessing(unsigned char* field, DWORD width, DWORD height, DWORD x, DWORD y, \
+                        SolverResult* result, DWORD* clicks);
+
+#endif
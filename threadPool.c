@@ -0,0 +1,489 @@
+/**
+ * Purpose: Work-stealing thread pool. See threadPool.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#ifndef _WIN32
+#include<sched.h>
+#include<time.h>
+#include<unistd.h>
+#endif
+#include"threadPool.h"
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Which pool and queue the current thread belongs to. Outside threads use
+// the pool's last queue
+static THREAD_LOCAL ThreadPool* currentPool = NULL;
+static THREAD_LOCAL int currentQueue = 0;
+
+void InitLock(PoolLock* lock) {
+/**
+ * Purpose: Sets up a lock
+ * @param lock : PoolLock* - the lock
+ * @return : void
+ */
+
+#ifdef _WIN32
+    InitializeCriticalSection(lock);
+#else
+    pthread_mutex_init(lock, NULL);
+#endif
+}
+
+void AcquireLock(PoolLock* lock) {
+/**
+ * Purpose: Takes a lock, waiting for it if needed
+ * @param lock : PoolLock* - the lock
+ * @return : void
+ */
+
+#ifdef _WIN32
+    EnterCriticalSection(lock);
+#else
+    pthread_mutex_lock(lock);
+#endif
+}
+
+void ReleaseLock(PoolLock* lock) {
+/**
+ * Purpose: Gives a lock back
+ * @param lock : PoolLock* - the lock
+ * @return : void
+ */
+
+#ifdef _WIN32
+    LeaveCriticalSection(lock);
+#else
+    pthread_mutex_unlock(lock);
+#endif
+}
+
+void DestroyLock(PoolLock* lock) {
+/**
+ * Purpose: Frees a lock set up by InitLock
+ * @param lock : PoolLock* - the lock
+ * @return : void
+ */
+
+#ifdef _WIN32
+    DeleteCriticalSection(lock);
+#else
+    pthread_mutex_destroy(lock);
+#endif
+}
+
+void InitCondition(PoolCondition* condition) {
+/**
+ * Purpose: Sets up a condition threads can sleep on until another wakes them
+ * @param condition : PoolCondition* - the condition
+ * @return : void
+ */
+
+#ifdef _WIN32
+    InitializeConditionVariable(condition);
+#else
+    pthread_cond_init(condition, NULL);
+#endif
+}
+
+void WaitCondition(PoolCondition* condition, PoolLock* lock) {
+/**
+ * Purpose: Releases lock, sleeps until woken and takes lock again. Wake ups
+ *          can be spurious, so callers check what they wait for in a loop
+ * @param condition : PoolCondition* - the condition
+ * @param lock : PoolLock* - held by the caller
+ * @return : void
+ */
+
+#ifdef _WIN32
+    SleepConditionVariableCS(condition, lock, INFINITE);
+#else
+    pthread_cond_wait(condition, lock);
+#endif
+}
+
+void WaitConditionFor(PoolCondition* condition, PoolLock* lock, unsigned int milliseconds) {
+/**
+ * Purpose: WaitCondition that also gives up after a while
+ * @param condition : PoolCondition* - the condition
+ * @param lock : PoolLock* - held by the caller
+ * @param milliseconds : unsigned int - longest to sleep
+ * @return : void
+ */
+
+#ifdef _WIN32
+    SleepConditionVariableCS(condition, lock, milliseconds);
+#else
+    struct timespec until;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec  += milliseconds / 1000;
+    until.tv_nsec += (long)(milliseconds % 1000)*1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(condition, lock, &until);
+#endif
+}
+
+void WakeOne(PoolCondition* condition) {
+/**
+ * Purpose: Wakes one thread sleeping on a condition, if there is one
+ * @param condition : PoolCondition* - the condition
+ * @return : void
+ */
+
+#ifdef _WIN32
+    WakeConditionVariable(condition);
+#else
+    pthread_cond_signal(condition);
+#endif
+}
+
+void WakeAll(PoolCondition* condition) {
+/**
+ * Purpose: Wakes every thread sleeping on a condition
+ * @param condition : PoolCondition* - the condition
+ * @return : void
+ */
+
+#ifdef _WIN32
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif
+}
+
+void DestroyCondition(PoolCondition* condition) {
+/**
+ * Purpose: Frees a condition set up by InitCondition
+ * @param condition : PoolCondition* - the condition
+ * @return : void
+ */
+
+#ifdef _WIN32
+    (void)condition;
+#else
+    pthread_cond_destroy(condition);
+#endif
+}
+
+void YieldThread(void) {
+/**
+ * Purpose: Lets another thread run
+ * @return : void
+ */
+
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+long AtomicAdd(volatile long* value, long amount) {
+/**
+ * Purpose: Adds to a counter shared between threads
+ * @param value : volatile long* - the counter
+ * @param amount : long - what to add. Negative to subtract
+ * @return : long - the counter's new value
+ */
+
+#ifdef _WIN32
+    return InterlockedExchangeAdd(value, amount) + amount;
+#else
+    return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+#endif
+}
+
+int CountCores(void) {
+/**
+ * Purpose: Number of processors the helper can run on
+ * @return : int - at least 1
+ */
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+#endif
+}
+
+static int TakeTask(ThreadPool* pool, int self, int outside, Task* task) {
+/**
+ * Purpose: Finds the next task to run. The newest task in our own queue
+ *          first, then the oldest task in everyone else's
+ * @param pool : ThreadPool* - the pool
+ * @param self : int - index of the caller's queue
+ * @param outside : int - non-zero to also take from the outside queue, even
+ *                  when it's the caller's own
+ * @param task : Task* - receives the task
+ * @return : int - 1 if a task was found, 0 if every queue is empty
+ */
+
+    WorkerQueue* queue = &pool->queues[self];
+
+    if (!AtomicAdd(&pool->queued, 0)) return 0;
+
+    AcquireLock(&queue->lock);
+    if (queue->bottom != queue->top && (outside || self != pool->numThreads)) {
+        *task = queue->tasks[--queue->bottom & (POOL_QUEUE_SIZE - 1)];
+        queue->executed++;
+        ReleaseLock(&queue->lock);
+        AtomicAdd(&pool->queued, -1);
+        return 1;
+    }
+    ReleaseLock(&queue->lock);
+
+    for (int i = 1; i <= pool->numThreads; i++) {
+        WorkerQueue* victim = &pool->queues[(self + i) % (pool->numThreads + 1)];
+        if (!outside && victim->index == pool->numThreads) continue;
+
+        AcquireLock(&victim->lock);
+        if (victim->bottom != victim->top) {
+            *task = victim->tasks[victim->top++ & (POOL_QUEUE_SIZE - 1)];
+            ReleaseLock(&victim->lock);
+            AtomicAdd(&pool->queued, -1);
+
+            // Outside threads all share the last queue, so its counts need its lock
+            AcquireLock(&queue->lock);
+            queue->executed++;
+            queue->steals++;
+            ReleaseLock(&queue->lock);
+            return 1;
+        }
+        ReleaseLock(&victim->lock);
+    }
+
+    return 0;
+}
+
+static void RunTask(ThreadPool* pool, Task* task) {
+/**
+ * Purpose: Runs a task and marks it finished in its group. Wakes whoever is
+ *          waiting on the group if it was the last one
+ * @param pool : ThreadPool* - the pool the task came from. May be NULL
+ * @param task : Task* - the task
+ * @return : void
+ */
+
+    task->function(task->argument);
+    if (AtomicAdd(&task->group->pending, -1) || !pool) return;
+
+    // Waiters check pending under idleLock, so this can't slip in before they sleep
+    AcquireLock(&pool->idleLock);
+    WakeAll(&pool->finished);
+    ReleaseLock(&pool->idleLock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI WorkerMain(LPVOID argument) {
+#else
+static void* WorkerMain(void* argument) {
+#endif
+/**
+ * Purpose: A worker thread. Runs tasks until the pool is stopped, sleeping
+ *          whenever every queue is empty
+ * @param argument : WorkerQueue* - this worker's queue
+ * @return : 0
+ */
+
+    WorkerQueue* queue = (WorkerQueue*)argument;
+    ThreadPool* pool = queue->pool;
+    Task task;
+
+    currentPool  = pool;
+    currentQueue = queue->index;
+
+    for (;;) {
+        if (TakeTask(pool, queue->index, 1, &task)) {
+            RunTask(pool, &task);
+            continue;
+        }
+
+        // Submitters bump queued before they signal under idleLock, so checking
+        // it under the same lock can't miss a wake up
+        AcquireLock(&pool->idleLock);
+        while (!AtomicAdd(&pool->queued, 0) && !pool->stopping) {
+            WaitCondition(&pool->wake, &pool->idleLock);
+        }
+        ReleaseLock(&pool->idleLock);
+        if (pool->stopping && !AtomicAdd(&pool->queued, 0)) break;
+    }
+
+    return 0;
+}
+
+static void JoinWorkers(ThreadPool* pool, int started) {
+/**
+ * Purpose: Tells the workers to stop once the queues are empty and waits
+ *          for them to exit
+ * @param pool : ThreadPool* - the pool
+ * @param started : int - how many of the pool's threads were started
+ * @return : void
+ */
+
+    AcquireLock(&pool->idleLock);
+    pool->stopping = 1;
+    WakeAll(&pool->wake);
+    ReleaseLock(&pool->idleLock);
+
+    for (int i = 0; i < started; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+}
+
+static void DestroyPool(ThreadPool* pool) {
+/**
+ * Purpose: Destroys every lock and condition StartThreadPool set up. The
+ *          workers have to be gone already
+ * @param pool : ThreadPool* - the pool
+ * @return : void
+ */
+
+    for (int i = 0; i <= pool->numThreads; i++) DestroyLock(&pool->queues[i].lock);
+    DestroyLock(&pool->idleLock);
+    DestroyCondition(&pool->wake);
+    DestroyCondition(&pool->finished);
+    pool->numThreads = 0;
+}
+
+int StartThreadPool(ThreadPool* pool, int numThreads) {
+/**
+ * Purpose: Starts the worker threads
+ * @param pool : ThreadPool* - the pool to start
+ * @param numThreads : int - number of workers. Clamped to 1..POOL_MAX_THREADS
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    if (numThreads < 1) numThreads = 1;
+    if (numThreads > POOL_MAX_THREADS) numThreads = POOL_MAX_THREADS;
+
+    memset(pool, 0, sizeof(ThreadPool));
+    for (int i = 0; i <= numThreads; i++) {
+        pool->queues[i].pool  = pool;
+        pool->queues[i].index = i;
+        InitLock(&pool->queues[i].lock);
+    }
+    InitLock(&pool->idleLock);
+    InitCondition(&pool->wake);
+    InitCondition(&pool->finished);
+
+    // Workers need the final count to find the outside queue
+    pool->numThreads = numThreads;
+    for (int i = 0; i < numThreads; i++) {
+#ifdef _WIN32
+        pool->threads[i] = CreateThread(NULL, 0, WorkerMain, &pool->queues[i], 0, NULL);
+        if (!pool->threads[i]) {
+            printf("Error starting a worker thread: %d\n", GetLastError());
+#else
+        if (pthread_create(&pool->threads[i], NULL, WorkerMain, &pool->queues[i])) {
+            printf("Error starting a worker thread\n");
+#endif
+            // Stop the ones that started, then undo everything set up above.
+            // numThreads stays put since the workers use it to find the outside queue
+            JoinWorkers(pool, i);
+            DestroyPool(pool);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void SubmitTask(ThreadPool* pool, TaskGroup* group, TaskFunction function, void* argument) {
+/**
+ * Purpose: Queues a task. Workers submit to their own queue and everybody
+ *          else shares the pool's outside queue. A full queue runs the task
+ *          right away instead
+ * @param pool : ThreadPool* - the pool. NULL runs the task right away
+ * @param group : TaskGroup* - the group the task counts towards
+ * @param function : TaskFunction - what to run
+ * @param argument : void* - passed to function
+ * @return : void
+ */
+
+    Task task;
+    WorkerQueue* queue;
+
+    task.function = function;
+    task.argument = argument;
+    task.group    = group;
+    AtomicAdd(&group->pending, 1);
+
+    if (!pool) {
+        RunTask(NULL, &task);
+        return;
+    }
+
+    queue = &pool->queues[currentPool == pool ? currentQueue : pool->numThreads];
+    AcquireLock(&queue->lock);
+    if (queue->bottom - queue->top == POOL_QUEUE_SIZE) {
+        ReleaseLock(&queue->lock);
+        RunTask(pool, &task);
+        return;
+    }
+    queue->tasks[queue->bottom++ & (POOL_QUEUE_SIZE - 1)] = task;
+    AtomicAdd(&pool->queued, 1);
+    ReleaseLock(&queue->lock);
+
+    AcquireLock(&pool->idleLock);
+    WakeOne(&pool->wake);
+    ReleaseLock(&pool->idleLock);
+}
+
+void WaitForGroup(ThreadPool* pool, TaskGroup* group) {
+/**
+ * Purpose: Waits until every task in group has finished, running queued
+ *          tasks in the meantime. Only tasks that workers queued are taken,
+ *          never new outside work, so a task that waits can't end up
+ *          nested under an unbounded pile of other waiting tasks. With
+ *          nothing to take it sleeps until the group's last task finishes,
+ *          looking again every POOL_WAIT_MS for work it could help with
+ * @param pool : ThreadPool* - the pool the tasks went to. May be NULL
+ * @param group : TaskGroup* - the group to wait on
+ * @return : void
+ */
+
+    Task task;
+    int self;
+
+    if (!pool) return;
+    self = currentPool == pool ? currentQueue : pool->numThreads;
+
+    while (AtomicAdd(&group->pending, 0)) {
+        if (TakeTask(pool, self, 0, &task)) {
+            RunTask(pool, &task);
+            continue;
+        }
+        AcquireLock(&pool->idleLock);
+        if (AtomicAdd(&group->pending, 0)) WaitConditionFor(&pool->finished, &pool->idleLock, POOL_WAIT_MS);
+        ReleaseLock(&pool->idleLock);
+    }
+}
+
+void StopThreadPool(ThreadPool* pool) {
+/**
+ * Purpose: Lets the workers finish what's queued, then stops them
+ * @param pool : ThreadPool* - the pool
+ * @return : void
+ */
+
+    JoinWorkers(pool, pool->numThreads);
+    DestroyPool(pool);
+}
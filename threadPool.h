@@ -0,0 +1,88 @@
+/**
+ * Purpose: A small work-stealing thread pool. Every worker has its own task
+ *          queue. A worker runs its newest task first and, when it runs out,
+ *          steals the oldest task from someone else's queue. Threads that wait
+ *          on a task group run queued tasks while they wait, so tasks can
+ *          submit and wait on more tasks without deadlocking the pool
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<pthread.h>
+#endif
+
+#define POOL_MAX_THREADS  64     // Most worker threads a pool can have
+#define POOL_QUEUE_SIZE   1024   // Tasks per queue. Must be a power of 2
+#define POOL_WAIT_MS      1      // How often a thread waiting on a group looks for tasks it could run
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION PoolLock;
+typedef CONDITION_VARIABLE PoolCondition;
+#else
+typedef pthread_mutex_t PoolLock;
+typedef pthread_cond_t PoolCondition;
+#endif
+
+typedef void (*TaskFunction)(void* argument);
+
+// Tasks that somebody wants to wait for together
+typedef struct taskGroup_s {
+    volatile long pending;  // Submitted but not finished yet
+} TaskGroup;
+
+typedef struct task_s {
+    TaskFunction function;
+    void* argument;
+    TaskGroup* group;
+} Task;
+
+typedef struct workerQueue_s {
+    struct threadPool_s* pool;  // The pool this queue belongs to
+    int index;                  // Its place in the pool's queues
+    PoolLock lock;
+    Task tasks[POOL_QUEUE_SIZE];
+    unsigned int top;      // Oldest task. Thieves take from here
+    unsigned int bottom;   // One past the newest task. The owner takes from here
+    unsigned long long executed;  // Tasks this queue's thread has run
+    unsigned long long steals;    // Of those, how many came from another queue
+} WorkerQueue;
+
+typedef struct threadPool_s {
+    int numThreads;                            // Worker threads
+    WorkerQueue queues[POOL_MAX_THREADS + 1];  // One per worker, the last for outside threads
+#ifdef _WIN32
+    HANDLE threads[POOL_MAX_THREADS];
+#else
+    pthread_t threads[POOL_MAX_THREADS];
+#endif
+    PoolCondition wake;
+    PoolCondition finished;  // A group's last task finished
+    PoolLock idleLock;       // Protects sleeping on wake and finished
+    volatile long queued;    // Tasks sitting in any queue
+    volatile int stopping;   // Set when the pool is shutting down
+} ThreadPool;
+
+void InitLock(PoolLock* lock);
+void AcquireLock(PoolLock* lock);
+void ReleaseLock(PoolLock* lock);
+void DestroyLock(PoolLock* lock);
+void InitCondition(PoolCondition* condition);
+void WaitCondition(PoolCondition* condition, PoolLock* lock);
+void WaitConditionFor(PoolCondition* condition, PoolLock* lock, unsigned int milliseconds);
+void WakeOne(PoolCondition* condition);
+void WakeAll(PoolCondition* condition);
+void DestroyCondition(PoolCondition* condition);
+void YieldThread(void);
+long AtomicAdd(volatile long* value, long amount);
+int CountCores(void);
+
+int StartThreadPool(ThreadPool* pool, int numThreads);
+void SubmitTask(ThreadPool* pool, TaskGroup* group, TaskFunction function, void* argument);
+void WaitForGroup(ThreadPool* pool, TaskGroup* group);
+void StopThreadPool(ThreadPool* pool);
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * Purpose: The tile decoder. See tileDecode.h
+ */
+
+#include<stdio.h>
+#include<string.h>
+#include"tileDecode.h"
+#include"board.h"
+#include"trace.h"
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include<tmmintrin.h>
+#define HAVE_SSSE3 1
+#endif
+
+// Sixteen consecutive table entries starting at byte value h
+#define TILE_KINDS_16(h) \
+    TILE_KIND_OF((h) + 0x0), TILE_KIND_OF((h) + 0x1), TILE_KIND_OF((h) + 0x2), TILE_KIND_OF((h) + 0x3), \
+    TILE_KIND_OF((h) + 0x4), TILE_KIND_OF((h) + 0x5), TILE_KIND_OF((h) + 0x6), TILE_KIND_OF((h) + 0x7), \
+    TILE_KIND_OF((h) + 0x8), TILE_KIND_OF((h) + 0x9), TILE_KIND_OF((h) + 0xA), TILE_KIND_OF((h) + 0xB), \
+    TILE_KIND_OF((h) + 0xC), TILE_KIND_OF((h) + 0xD), TILE_KIND_OF((h) + 0xE), TILE_KIND_OF((h) + 0xF)
+
+// The kind of every possible raw byte, worked out by the compiler
+const unsigned char tileKindTable[256] = {
+    TILE_KINDS_16(0x00), TILE_KINDS_16(0x10), TILE_KINDS_16(0x20), TILE_KINDS_16(0x30),
+    TILE_KINDS_16(0x40), TILE_KINDS_16(0x50), TILE_KINDS_16(0x60), TILE_KINDS_16(0x70),
+    TILE_KINDS_16(0x80), TILE_KINDS_16(0x90), TILE_KINDS_16(0xA0), TILE_KINDS_16(0xB0),
+    TILE_KINDS_16(0xC0), TILE_KINDS_16(0xD0), TILE_KINDS_16(0xE0), TILE_KINDS_16(0xF0)
+};
+
+// What each kind looks like when the minefield is printed
+const char tileGlyphs[TILE_KIND_COUNT][4] = {
+    " _ ", " 1 ", " 2 ", " 3 ", " 4 ", " 5 ", " 6 ", " 7 ", " 8 ",  // Revealed tiles
+    "   ", "  F", "  ?", " X ", " B ", " * ", "   ",                // No mine underneath
+    " B ", " B ", " B ", " B ", " B ", " B ", " B ", " B ", " B ",  // Mine under a number. Can't happen
+    " B ", " BF", " B?", " B ", " B ", " * ", " B "                 // Mine underneath
+};
+
+void DecodeFieldScalar(const unsigned char* field, DWORD height, unsigned char* kinds) {
+/**
+ * Purpose: Decodes the minefield one byte at a time through tileKindTable
+ * @param field : const unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param height : DWORD - the height of the minefield
+ * @param kinds : unsigned char* - receives the kind grid (KIND_GRID_SIZE bytes)
+ * @return : void
+ */
+
+    for (DWORD i = 0; i < (height + 2)*ROW_STRIDE; i++) {
+        kinds[i] = tileKindTable[field[i]];
+    }
+
+    return;
+}
+
+#ifdef HAVE_SSSE3
+static void DecodeFieldSsse3(const unsigned char* field, DWORD height, unsigned char* kinds) {
+/**
+ * Purpose: Decodes the minefield 16 bytes at a time. The low nibble picks the
+ *          kind with a PSHUFB lookup, then unrevealed "numbers" become
+ *          TILE_OTHER and the mine bit is copied over
+ * @param field : const unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param height : DWORD - the height of the minefield
+ * @param kinds : unsigned char* - receives the kind grid (KIND_GRID_SIZE bytes)
+ * @return : void
+ */
+
+    const __m128i lowKinds    = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, TILE_OTHER, \
+                                              TILE_REVEALED_MINE, TILE_WRONG_FLAG, TILE_EXPLODED, \
+                                              TILE_QUESTION, TILE_FLAG, TILE_UNCLICKED);
+    const __m128i lowMask     = _mm_set1_epi8(0x0F);
+    const __m128i nine        = _mm_set1_epi8(9);
+    const __m128i revealedBit = _mm_set1_epi8(REVEALED_TILE);
+    const __m128i other       = _mm_set1_epi8(TILE_OTHER);
+    const __m128i mineBit     = _mm_set1_epi8(TILE_MINE_BIT);
+    const __m128i zero        = _mm_setzero_si128();
+
+    for (DWORD i = 0; i < (height + 2)*ROW_STRIDE; i += 16) {
+        __m128i raw  = _mm_loadu_si128((const __m128i*)(field + i));
+        __m128i low  = _mm_and_si128(raw, lowMask);
+        __m128i kind = _mm_shuffle_epi8(lowKinds, low);
+
+        // A low nibble of 0-8 is only a number if the tile has been revealed
+        __m128i hidden = _mm_and_si128(_mm_cmplt_epi8(low, nine), \
+                                       _mm_cmpeq_epi8(_mm_and_si128(raw, revealedBit), zero));
+        kind = _mm_or_si128(_mm_andnot_si128(hidden, kind), _mm_and_si128(hidden, other));
+
+        // MINE is the sign bit
+        kind = _mm_or_si128(kind, _mm_and_si128(_mm_cmplt_epi8(raw, zero), mineBit));
+        _mm_storeu_si128((__m128i*)(kinds + i), kind);
+    }
+
+    return;
+}
+#endif
+
+void DecodeField(const unsigned char* field, DWORD height, unsigned char* kinds) {
+/**
+ * Purpose: Decodes rows 0 through height + 1 of the minefield into kinds
+ *          using the fastest decoder this build has
+ * @param field : const unsigned char* - the raw minefield (MINEFIELD_SIZE bytes)
+ * @param height : DWORD - the height of the minefield
+ * @param kinds : unsigned char* - receives the kind grid (KIND_GRID_SIZE bytes)
+ * @return : void
+ */
+
+    unsigned long long start = TRACE_START();
+
+    if (height > MAX_HEIGHT) height = MAX_HEIGHT;
+#ifdef HAVE_SSSE3
+    DecodeFieldSsse3(field, height, kinds);
+#else
+    DecodeFieldScalar(field, height, kinds);
+#endif
+    TRACE_END(TRACE_DECODE, start, (height + 2)*ROW_STRIDE);
+
+    return;
+}
+
+int CheckDecoder(void) {
+/**
+ * Purpose: Makes sure DecodeField and the scalar decoder agree byte for byte,
+ *          for every byte value in every lane and for random minefields
+ * @return : int - 0 if they agree, 1 if not
+ */
+
+    unsigned char field[MINEFIELD_SIZE];
+    unsigned char fast[KIND_GRID_SIZE];
+    unsigned char slow[KIND_GRID_SIZE];
+    unsigned int state = 1;
+
+    for (int round = 0; round < 1024; round++) {
+
+        // The first 16 rounds shift every byte value through every lane
+        for (int i = 0; i < MINEFIELD_SIZE; i++) {
+            field[i] = round < 16 ? (unsigned char)(i + round) : (unsigned char)NextRandom(&state);
+        }
+
+        DecodeField(field, MAX_HEIGHT, fast);
+        DecodeFieldScalar(field, MAX_HEIGHT, slow);
+        for (int i = 0; i < KIND_GRID_SIZE; i++) {
+            if (fast[i] != slow[i]) {
+                printf("Decoder mismatch for byte 0x%02x at %d: 0x%02x vs 0x%02x\n", \
+                       field[i], i, fast[i], slow[i]);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
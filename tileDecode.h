@@ -0,0 +1,48 @@
+/**
+ * Purpose: Turns raw winmine minefield bytes into a grid of tile kinds. Every
+ *          piece of the helper that needs to know what a tile is (printing,
+ *          finding mines, solving) reads the kind grid instead of testing
+ *          bitmasks against the raw bytes itself
+ */
+
+#ifndef TILE_DECODE_H
+#define TILE_DECODE_H
+
+#include"winmine.h"
+
+// A tile kind is what the player sees in the low 4 bits plus whether there's
+// a mine hiding under it. 0 through 8 are revealed tiles with that many
+// mines around them
+#define TILE_UNCLICKED      0x09  // Nothing clicked yet
+#define TILE_FLAG           0x0A  // Flagged
+#define TILE_QUESTION       0x0B  // Question mark
+#define TILE_WRONG_FLAG     0x0C  // Flag over something that wasn't a mine (game lost)
+#define TILE_REVEALED_MINE  0x0D  // Mine shown at the end of the game
+#define TILE_EXPLODED       0x0E  // The mine that lost the game
+#define TILE_OTHER          0x0F  // Border or anything else that isn't a tile
+#define TILE_VISIBLE_MASK   0x0F  // What the player can see
+#define TILE_MINE_BIT       0x10  // There's a mine under this tile
+#define TILE_KIND_COUNT     0x20  // Number of distinct kinds
+
+// The kind grid has the same 32 byte stride as the minefield so x + y*32
+// indexes both. Rows 0 through height + 1 (the borders) are decoded
+#define KIND_GRID_SIZE      (ROW_STRIDE*(MAX_HEIGHT + 2))
+
+// The kind of a single raw byte, as a constant expression. Only a byte's low
+// nibble, REVEALED_TILE and MINE bits matter
+#define TILE_LOW(b)         ((b) & 0x0F)
+#define TILE_HIGH_KIND(lo)  ((lo) == 0x0A ? TILE_REVEALED_MINE : (lo) == 0x0B ? TILE_WRONG_FLAG : \
+                             (lo) == 0x0C ? TILE_EXPLODED : (lo) == 0x0D ? TILE_QUESTION : \
+                             (lo) == 0x0E ? TILE_FLAG : (lo) == 0x0F ? TILE_UNCLICKED : TILE_OTHER)
+#define TILE_KIND_OF(b)     ((((b) & MINE) ? TILE_MINE_BIT : 0) | \
+                             (TILE_LOW(b) <= 8 ? (((b) & REVEALED_TILE) ? TILE_LOW(b) : TILE_OTHER) \
+                                               : TILE_HIGH_KIND(TILE_LOW(b))))
+
+extern const unsigned char tileKindTable[256];
+extern const char tileGlyphs[TILE_KIND_COUNT][4];
+
+void DecodeField(const unsigned char* field, DWORD height, unsigned char* kinds);
+void DecodeFieldScalar(const unsigned char* field, DWORD height, unsigned char* kinds);
+int CheckDecoder(void);
+
+#endif
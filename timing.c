@@ -0,0 +1,52 @@
+/**
+ * Purpose: Monotonic clock. See timing.h
+ */
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<time.h>
+#endif
+#include"timing.h"
+
+unsigned long long NowNs(void) {
+/**
+ * Purpose: Gets the current time from a monotonic clock
+ * @return : unsigned long long - nanoseconds since some arbitrary point
+ */
+
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;  // Ticks per second. Never changes after boot
+    LARGE_INTEGER now;
+
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (unsigned long long)(now.QuadPart / frequency.QuadPart) * 1000000000ULL + \
+           (unsigned long long)(now.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+#endif
+}
+
+void SleepMs(unsigned int milliseconds) {
+/**
+ * Purpose: Puts the calling thread to sleep
+ * @param milliseconds : unsigned int - how long to sleep for
+ * @return : void
+ */
+
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    struct timespec duration;
+
+    duration.tv_sec  = milliseconds / 1000;
+    duration.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+    nanosleep(&duration, NULL);
+#endif
+
+    return;
+}
@@ -0,0 +1,11 @@
+/**
+ * Purpose: A monotonic nanosecond clock for timing the helper's operations
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+unsigned long long NowNs(void);
+void SleepMs(unsigned int milliseconds);
+
+#endif
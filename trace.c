@@ -0,0 +1,318 @@
+/**
+ * Purpose: Per-thread trace buffers and the JSON and CSV dumps. See trace.h
+ */
+
+#include<stdlib.h>
+#include<string.h>
+#include"trace.h"
+
+#ifdef _WIN32
+#include<windows.h>
+#endif
+
+#if defined(__GNUC__)
+#define THREAD_LOCAL          __thread
+#define LOAD_RELAXED(p)       __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STORE_RELAXED(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define FENCE_ACQUIRE()       __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define FENCE_RELEASE()       __atomic_thread_fence(__ATOMIC_RELEASE)
+#define LOAD_POINTER(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define PUSH_BUFFER(head, buffer) \
+    __atomic_compare_exchange_n((head), &(buffer)->next, (buffer), 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+#define COUNT_BUFFER(counter) __atomic_fetch_add((counter), 1, __ATOMIC_RELAXED)
+#else
+// MSVC's volatile accesses already acquire and release. Events can tear on
+// 32 bit builds but the sequence numbers throw those away
+#define THREAD_LOCAL          __declspec(thread)
+#define LOAD_RELAXED(p)       (*(volatile unsigned long long*)(p))
+#define STORE_RELAXED(p, v)   (*(volatile unsigned long long*)(p) = (v))
+#define LOAD_ACQUIRE(p)       LOAD_RELAXED(p)
+#define STORE_RELEASE(p, v)   STORE_RELAXED(p, v)
+#define FENCE_ACQUIRE()       MemoryBarrier()
+#define FENCE_RELEASE()       MemoryBarrier()
+#define LOAD_POINTER(p)       (*(p))
+#define PUSH_BUFFER(head, buffer) \
+    (InterlockedCompareExchangePointer((PVOID volatile*)(head), (buffer), (buffer)->next) == (buffer)->next)
+#define COUNT_BUFFER(counter) (InterlockedIncrement(counter) - 1)
+#endif
+
+// One slot of a ring. seq is the event's index + 1 once it's complete and
+// 0 while the owner is writing it
+struct traceSlot_s {
+    unsigned long long seq;
+    TraceEvent event;
+};
+
+// Everything one thread records. Only the owning thread writes to it. Buffers
+// outlive their threads so a dump still sees what a finished thread did
+typedef struct traceBuffer_s {
+    struct traceBuffer_s* next;          // The buffer registered before this one
+    int thread;                          // Registration order
+    unsigned long long written;          // Events ever written
+    TraceCounter counters[TRACE_NUM_KINDS];
+    struct traceSlot_s slots[TRACE_RING_SIZE];
+} TraceBuffer;
+
+static const char* kindNames[TRACE_NUM_KINDS] = {
+    "find_process", "find_module", "attach", "read_memory", "write_memory", "virtual_alloc",
+    "virtual_free", "create_thread", "wait_thread", "flag_all", "decode", "render"
+};
+
+int traceLevel = TRACE_OFF;
+
+static TraceBuffer* volatile buffers = NULL;     // Every thread's buffer, newest first
+static THREAD_LOCAL TraceBuffer* localBuffer = NULL;
+static unsigned long long epochNs = 0;           // When tracing was first turned on
+static volatile long numBuffers = 0;
+
+void SetTraceLevel(int level) {
+/**
+ * Purpose: Turns tracing on or off. Event times count from the first time
+ *          it's turned on
+ * @param level : int - TRACE_OFF, TRACE_RECORD or TRACE_VERBOSE
+ * @return : void
+ */
+
+    if (level != TRACE_OFF && !epochNs) epochNs = NowNs();
+    traceLevel = level;
+
+    return;
+}
+
+const char* TraceKindName(int kind) {
+/**
+ * Purpose: The name dumps use for a kind of trace point
+ * @param kind : int - one of the TRACE_ kinds
+ * @return : const char* - its name
+ */
+
+    if (kind < 0 || kind >= TRACE_NUM_KINDS) return "unknown";
+    return kindNames[kind];
+}
+
+static TraceBuffer* RegisterBuffer(void) {
+/**
+ * Purpose: Gives the calling thread its buffer and links it into the list the
+ *          dumps walk. Only happens the first time a thread records
+ * @return : TraceBuffer* - the buffer, or NULL if it couldn't be allocated
+ */
+
+    TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+
+    if (!buffer) return NULL;
+    buffer->thread = (int)COUNT_BUFFER(&numBuffers);
+
+    // A failed push means another thread got in first. Link in front of it
+    do buffer->next = LOAD_POINTER(&buffers);
+    while (!PUSH_BUFFER(&buffers, buffer));
+
+    localBuffer = buffer;
+    return buffer;
+}
+
+void TraceRecord(int kind, unsigned long long startNs, unsigned long long durationNs, unsigned long long numBytes) {
+/**
+ * Purpose: Adds one trace point to the calling thread's counters and ring.
+ *          Use the TRACE_ macros rather than calling this directly
+ * @param kind : int - one of the TRACE_ kinds
+ * @param startNs : unsigned long long - NowNs() when it started
+ * @param durationNs : unsigned long long - how long it took
+ * @param numBytes : unsigned long long - bytes it moved, if any
+ * @return : void
+ */
+
+    TraceBuffer* buffer = localBuffer ? localBuffer : RegisterBuffer();
+    TraceCounter* counter;
+    struct traceSlot_s* slot;
+    unsigned long long index;
+    int bucket = 0;
+
+    if (!buffer || kind < 0 || kind >= TRACE_NUM_KINDS) return;
+
+    while (bucket < TRACE_BUCKETS - 1 && durationNs >> (bucket + 1)) bucket++;
+
+    // Only this thread writes its counters. The relaxed stores are just so a
+    // dump on another thread never sees half a number
+    counter = &buffer->counters[kind];
+    STORE_RELAXED(&counter->calls, counter->calls + 1);
+    STORE_RELAXED(&counter->bytes, counter->bytes + numBytes);
+    STORE_RELAXED(&counter->totalNs, counter->totalNs + durationNs);
+    if (durationNs > counter->maxNs) STORE_RELAXED(&counter->maxNs, durationNs);
+    STORE_RELAXED(&counter->histogram[bucket], counter->histogram[bucket] + 1);
+
+    // Seqlock the slot: 0 while it's being written, its index + 1 after
+    index = buffer->written;
+    slot  = &buffer->slots[index & (TRACE_RING_SIZE - 1)];
+    STORE_RELAXED(&slot->seq, 0ull);
+    FENCE_RELEASE();
+    STORE_RELAXED(&slot->event.startNs, startNs > epochNs ? startNs - epochNs : 0ull);
+    STORE_RELAXED(&slot->event.durationNs, durationNs);
+    STORE_RELAXED(&slot->event.bytes, numBytes);
+    STORE_RELAXED(&slot->event.kind, (unsigned long long)kind);
+    STORE_RELEASE(&slot->seq, index + 1);
+    STORE_RELEASE(&buffer->written, index + 1);
+
+    return;
+}
+
+static int ReadSlot(TraceBuffer* buffer, unsigned long long index, TraceEvent* event) {
+/**
+ * Purpose: Copies an event out of another thread's ring
+ * @param buffer : TraceBuffer* - the ring
+ * @param index : unsigned long long - the event's index
+ * @param event : TraceEvent* - receives the event
+ * @return : int - 0 on success, 1 if it was overwritten (or being written)
+ */
+
+    struct traceSlot_s* slot = &buffer->slots[index & (TRACE_RING_SIZE - 1)];
+    unsigned long long seq = LOAD_ACQUIRE(&slot->seq);
+
+    if (seq != index + 1) return 1;
+    event->startNs    = LOAD_RELAXED(&slot->event.startNs);
+    event->durationNs = LOAD_RELAXED(&slot->event.durationNs);
+    event->bytes      = LOAD_RELAXED(&slot->event.bytes);
+    event->kind       = LOAD_RELAXED(&slot->event.kind);
+    FENCE_ACQUIRE();
+
+    return LOAD_RELAXED(&slot->seq) != seq;
+}
+
+void CollectTraceCounters(TraceCounter* counters) {
+/**
+ * Purpose: Adds up every thread's counters
+ * @param counters : TraceCounter* - receives TRACE_NUM_KINDS totals
+ * @return : void
+ */
+
+    memset(counters, 0, sizeof(TraceCounter)*TRACE_NUM_KINDS);
+    for (TraceBuffer* buffer = LOAD_POINTER(&buffers); buffer; buffer = buffer->next) {
+        for (int k = 0; k < TRACE_NUM_KINDS; k++) {
+            TraceCounter* from = &buffer->counters[k];
+            unsigned long long maxNs = LOAD_RELAXED(&from->maxNs);
+
+            counters[k].calls   += LOAD_RELAXED(&from->calls);
+            counters[k].bytes   += LOAD_RELAXED(&from->bytes);
+            counters[k].totalNs += LOAD_RELAXED(&from->totalNs);
+            if (maxNs > counters[k].maxNs) counters[k].maxNs = maxNs;
+            for (int b = 0; b < TRACE_BUCKETS; b++) counters[k].histogram[b] += LOAD_RELAXED(&from->histogram[b]);
+        }
+    }
+
+    return;
+}
+
+unsigned long long TracePercentile(const TraceCounter* counter, double fraction) {
+/**
+ * Purpose: Estimates a latency percentile from the histogram. The answer is
+ *          the top of the bucket it lands in, so it's within a factor of 2
+ * @param counter : const TraceCounter* - the counter
+ * @param fraction : double - 0.5 for the median, 0.99 for p99 and so on
+ * @return : unsigned long long - nanoseconds. 0 if nothing was recorded
+ */
+
+    unsigned long long seen = 0;
+    unsigned long long wanted = (unsigned long long)(fraction*(double)counter->calls);
+
+    if (!counter->calls) return 0;
+    for (int b = 0; b < TRACE_BUCKETS; b++) {
+        seen += counter->histogram[b];
+        if (seen > wanted || seen == counter->calls) {
+            unsigned long long top = 2ull << b;
+            return top < counter->maxNs ? top : counter->maxNs;
+        }
+    }
+    return counter->maxNs;
+}
+
+int DumpTrace(FILE* out, int format) {
+/**
+ * Purpose: Writes the counters, histograms and every event still in the rings
+ * @param out : FILE* - where to write
+ * @param format : int - TRACE_JSON or TRACE_CSV
+ * @return : int - 0 on success, 1 on failure
+ */
+
+    TraceCounter counters[TRACE_NUM_KINDS];
+    TraceEvent event;
+    int first = 1;
+    int numThreads = 0;
+
+    CollectTraceCounters(counters);
+    for (TraceBuffer* buffer = LOAD_POINTER(&buffers); buffer; buffer = buffer->next) {
+        if (buffer->thread >= numThreads) numThreads = buffer->thread + 1;
+    }
+
+    if (format == TRACE_CSV) fprintf(out, "record,thread,kind,start_ns,duration_ns,bytes,calls,total_ns,p50_ns,p99_ns,max_ns\n");
+    else fprintf(out, "{\n  \"counters\": [");
+
+    for (int k = 0; k < TRACE_NUM_KINDS; k++) {
+        TraceCounter* counter = &counters[k];
+        int firstBucket = 1;
+
+        if (!counter->calls) continue;
+        if (format == TRACE_CSV) {
+            fprintf(out, "counter,,%s,,,%llu,%llu,%llu,%llu,%llu,%llu\n", kindNames[k], counter->bytes, counter->calls, \
+                    counter->totalNs, TracePercentile(counter, 0.5), TracePercentile(counter, 0.99), counter->maxNs);
+            continue;
+        }
+
+        fprintf(out, "%s\n    {\"kind\": \"%s\", \"calls\": %llu, \"bytes\": %llu, \"total_ns\": %llu, " \
+                "\"mean_ns\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu, \"histogram\": {", \
+                first ? "" : ",", kindNames[k], counter->calls, counter->bytes, counter->totalNs, \
+                counter->totalNs / counter->calls, TracePercentile(counter, 0.5), TracePercentile(counter, 0.99), \
+                counter->maxNs);
+        for (int b = 0; b < TRACE_BUCKETS; b++) {
+            if (!counter->histogram[b]) continue;
+            fprintf(out, "%s\"%llu\": %llu", firstBucket ? "" : ", ", b ? 1ull << b : 0ull, counter->histogram[b]);
+            firstBucket = 0;
+        }
+        fprintf(out, "}}");
+        first = 0;
+    }
+    if (format == TRACE_JSON) fprintf(out, "\n  ],\n  \"events\": [");
+
+    // Oldest thread first. Rings only hold the last TRACE_RING_SIZE events
+    first = 1;
+    for (int thread = 0; thread < numThreads; thread++) {
+        TraceBuffer* buffer = LOAD_POINTER(&buffers);
+        unsigned long long written;
+
+        while (buffer && buffer->thread != thread) buffer = buffer->next;
+        if (!buffer) continue;
+
+        written = LOAD_ACQUIRE(&buffer->written);
+        for (unsigned long long i = written > TRACE_RING_SIZE ? written - TRACE_RING_SIZE : 0; i < written; i++) {
+            if (ReadSlot(buffer, i, &event)) continue;
+            if (format == TRACE_CSV) {
+                fprintf(out, "event,%d,%s,%llu,%llu,%llu,,,,,\n", thread, TraceKindName((int)event.kind), \
+                        event.startNs, event.durationNs, event.bytes);
+                continue;
+            }
+            fprintf(out, "%s\n    {\"thread\": %d, \"kind\": \"%s\", \"start_ns\": %llu, \"duration_ns\": %llu, " \
+                    "\"bytes\": %llu}", first ? "" : ",", thread, TraceKindName((int)event.kind), event.startNs, \
+                    event.durationNs, event.bytes);
+            first = 0;
+        }
+    }
+    if (format == TRACE_JSON) fprintf(out, "\n  ]\n}\n");
+
+    return ferror(out) != 0;
+}
+
+void ResetTrace(void) {
+/**
+ * Purpose: Forgets everything recorded so far. Only safe while no other
+ *          thread is recording
+ * @return : void
+ */
+
+    for (TraceBuffer* buffer = LOAD_POINTER(&buffers); buffer; buffer = buffer->next) {
+        memset(buffer->counters, 0, sizeof(buffer->counters));
+        memset(buffer->slots, 0, sizeof(buffer->slots));
+        buffer->written = 0;
+    }
+
+    return;
+}
@@ -0,0 +1,84 @@
+/**
+ * Purpose: Counters, latency histograms and an event log for the slow parts
+ *          of the helper (finding the game, reading and writing its memory,
+ *          the remote thread that flags mines, decoding and rendering).
+ *          Every thread records into its own ring buffer, so recording never
+ *          takes a lock. When tracing is off each trace point costs one load
+ *          and one branch
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include<stdio.h>
+#include"timing.h"
+
+#define TRACE_OFF      0   // Nothing is recorded
+#define TRACE_RECORD   1   // Trace points are recorded
+#define TRACE_VERBOSE  2   // Recorded, and the old debug messages are printed too
+
+#define TRACE_RING_SIZE  4096  // Events kept per thread. Must be a power of 2
+#define TRACE_BUCKETS    40    // Latency histogram buckets. Bucket b holds [2^b, 2^(b+1)) ns
+
+#define TRACE_JSON  0
+#define TRACE_CSV   1
+
+// What a trace point measures
+enum traceKind_e {
+    TRACE_FIND_PROCESS,   // Walking the process list for winmine
+    TRACE_FIND_MODULE,    // Walking winmine's modules for its base address
+    TRACE_ATTACH,         // Attaching to a process: the module lookup plus opening it
+    TRACE_READ,           // ReadProcessMemory (or whatever the source reads with)
+    TRACE_WRITE,          // WriteProcessMemory (or whatever the source writes with)
+    TRACE_ALLOC,          // VirtualAllocEx
+    TRACE_FREE,           // VirtualFreeEx
+    TRACE_CREATE_THREAD,  // CreateRemoteThread
+    TRACE_WAIT_THREAD,    // Waiting for the remote thread to finish
+    TRACE_FLAG_ALL,       // A whole flag-all, start to finish
+    TRACE_DECODE,         // Decoding the minefield into tile kinds
+    TRACE_RENDER,         // Formatting a frame
+    TRACE_NUM_KINDS
+};
+
+// Totals for one kind of trace point. Bytes is whatever the point moved
+typedef struct traceCounter_s {
+    unsigned long long calls;
+    unsigned long long bytes;
+    unsigned long long totalNs;
+    unsigned long long maxNs;
+    unsigned long long histogram[TRACE_BUCKETS];
+} TraceCounter;
+
+typedef struct traceEvent_s {
+    unsigned long long startNs;     // Since tracing was first turned on
+    unsigned long long durationNs;
+    unsigned long long bytes;
+    unsigned long long kind;
+} TraceEvent;
+
+// Replaces the old debug flag. One of the TRACE_ levels above
+extern int traceLevel;
+
+// Starts a trace point. 0 when tracing is off
+#define TRACE_START() (traceLevel ? NowNs() : 0ull)
+
+// Ends a trace point started with TRACE_START
+#define TRACE_END(kind, start, numBytes) \
+    do { if (traceLevel && (start)) TraceRecord((kind), (start), NowNs() - (start), (numBytes)); } while (0)
+
+// Records something that was already timed
+#define TRACE_SPAN(kind, start, durationNs, numBytes) \
+    do { if (traceLevel) TraceRecord((kind), (start), (durationNs), (numBytes)); } while (0)
+
+// The old "if (debug) printf(...)"
+#define DEBUG_PRINT(...) do { if (traceLevel == TRACE_VERBOSE) printf(__VA_ARGS__); } while (0)
+
+void SetTraceLevel(int level);
+const char* TraceKindName(int kind);
+void TraceRecord(int kind, unsigned long long startNs, unsigned long long durationNs, unsigned long long numBytes);
+void CollectTraceCounters(TraceCounter* counters);
+unsigned long long TracePercentile(const TraceCounter* counter, double fraction);
+int DumpTrace(FILE* out, int format);
+void ResetTrace(void);
+
+#endif
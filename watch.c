@@ -0,0 +1,174 @@
+/**
+ * Purpose: Live watch mode. See watch.h
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"watch.h"
+#include"snapshot.h"
+#include"tileDecode.h"
+#include"render.h"
+#include"timing.h"
+
+void InitWatchConfig(WatchConfig* config) {
+/**
+ * Purpose: Fills in the default watch settings
+ * @param config : WatchConfig* - the config to initialize
+ * @return : void
+ */
+
+    config->intervalMs = WATCH_INTERVAL_MS;
+    config->maxPolls   = 0;
+    config->display    = WATCH_DRAW;
+    config->onPoll     = NULL;
+    config->context    = NULL;
+
+    return;
+}
+
+static int FieldChanged(const Snapshot* previous, const Snapshot* current) {
+/**
+ * Purpose: Cheap check for whether anything worth showing changed between
+ *          two snapshots: the header, then each 32 byte row of the field
+ * @param previous : const Snapshot* - the last snapshot
+ * @param current : const Snapshot* - the new snapshot
+ * @return : int - non-zero if something changed
+ */
+
+    const unsigned char* before = SNAPSHOT_FIELD(previous);
+    const unsigned char* after  = SNAPSHOT_FIELD(current);
+
+    if (previous->width != current->width || previous->height != current->height || \
+        previous->numMines != current->numMines) return 1;
+
+    for (DWORD y = 1; y <= current->height; y++) {
+        if (memcmp(before + y*ROW_STRIDE, after + y*ROW_STRIDE, ROW_STRIDE) != 0) return 1;
+    }
+
+    return 0;
+}
+
+static size_t ReportChanges(Frame* frame, const unsigned char* before, const unsigned char* after, \
+                            DWORD height, DWORD width) {
+/**
+ * Purpose: Formats one "x,y: glyph" line for every tile whose kind changed
+ * @param frame : Frame* - receives the text
+ * @param before : const unsigned char* - kinds from the last change
+ * @param after : const unsigned char* - kinds from this poll
+ * @param height : DWORD - the height of the minefield
+ * @param width : DWORD - the width of the minefield
+ * @return : size_t - number of tiles that changed
+ */
+
+    size_t changed = 0;
+
+    frame->length = 0;
+    for (DWORD y = 1; y <= height; y++) {
+        if (memcmp(before + y*ROW_STRIDE + 1, after + y*ROW_STRIDE + 1, width) == 0) continue;
+
+        for (DWORD x = 1; x <= width; x++) {
+            if (before[x + y*ROW_STRIDE] == after[x + y*ROW_STRIDE]) continue;
+            frame->length += (size_t)snprintf(frame->text + frame->length, FRAME_BUFFER_SIZE - frame->length, \
+                                              "%2u,%2u:%s\n", x, y, tileGlyphs[after[x + y*ROW_STRIDE]]);
+            changed++;
+        }
+    }
+
+    return changed;
+}
+
+int WatchMineField(MemorySource* source, WatchConfig* config, WatchStats* stats) {
+/**
+ * Purpose: Polls the minefield until onPoll says to stop or maxPolls is hit,
+ *          showing only what changed between polls
+ * @param source : MemorySource* - where to read winmine's memory from
+ * @param config : WatchConfig* - how to watch
+ * @param stats : WatchStats* - receives counters and latency samples
+ * @return : int - 0 on success, 1 if reading the minefield failed
+ */
+
+    // Local variables. These are large so they don't live on the stack
+    static Snapshot snapshots[2];                  // Previous and current poll
+    static unsigned char kinds[2][KIND_GRID_SIZE]; // Kinds at the last change and now
+    static Frame frame;                            // Output for changed tiles
+    int current = 0;                               // Which snapshot is the current one
+    int haveKinds = 0;                             // Have we decoded anything yet?
+    unsigned long long pollStart;
+
+    memset(stats, 0, sizeof(WatchStats));
+    InitFrame(&frame);
+
+    while (!config->maxPolls || stats->polls < config->maxPolls) {
+        if (config->onPoll && config->onPoll(config->context)) break;
+
+        pollStart = NowNs();
+        if (TakeSnapshot(source, &snapshots[current])) return 1;
+        stats->polls++;
+
+        if (haveKinds && !FieldChanged(&snapshots[!current], &snapshots[current])) {
+            stats->skipped++;
+        }
+        else {
+            DecodeField(SNAPSHOT_FIELD(&snapshots[current]), snapshots[current].height, kinds[1]);
+
+            if (config->display == WATCH_REPORT) {
+                if (!haveKinds) memset(kinds[0], TILE_OTHER, KIND_GRID_SIZE);
+                stats->tilesChanged += ReportChanges(&frame, kinds[0], kinds[1], \
+                                                     snapshots[current].height, snapshots[current].width);
+            }
+            else {
+                RenderFrameDiff(&frame, kinds[1], snapshots[current].height, snapshots[current].width);
+                stats->tilesChanged += frame.tilesChanged;
+            }
+
+            if (config->display != WATCH_QUIET) WriteFrame(&frame);
+            stats->bytesWritten += frame.length;
+            stats->latencyNs[stats->numSamples % WATCH_MAX_SAMPLES] = NowNs() - pollStart;
+            stats->numSamples++;
+
+            memcpy(kinds[0], kinds[1], KIND_GRID_SIZE);
+            haveKinds = 1;
+        }
+
+        current = !current;
+        if (config->intervalMs) SleepMs(config->intervalMs);
+    }
+
+    return 0;
+}
+
+static int CompareSamples(const void* a, const void* b) {
+/**
+ * Purpose: qsort comparison for latency samples
+ * @param a : const void* - pointer to the first sample
+ * @param b : const void* - pointer to the second sample
+ * @return : int - <0, 0 or >0 the same as strcmp
+ */
+
+    unsigned long long first  = *(const unsigned long long*)a;
+    unsigned long long second = *(const unsigned long long*)b;
+
+    return (first > second) - (first < second);
+}
+
+void PrintWatchStats(WatchStats* stats) {
+/**
+ * Purpose: Prints the poll counters and latency percentiles of a watch
+ * @param stats : WatchStats* - the stats from WatchMineField. The samples get sorted
+ * @return : void
+ */
+
+    size_t numSamples = stats->numSamples < WATCH_MAX_SAMPLES ? (size_t)stats->numSamples : WATCH_MAX_SAMPLES;
+
+    printf("Polls: %llu\t\tSkipped (no change): %llu\t\tTiles changed: %llu\t\tBytes written: %llu\n", \
+           stats->polls, stats->skipped, stats->tilesChanged, stats->bytesWritten);
+    if (!numSamples) return;
+
+    qsort(stats->latencyNs, numSamples, sizeof(unsigned long long), CompareSamples);
+    printf("Poll to display latency (us): p50 %.1f\t\tp90 %.1f\t\tp99 %.1f\t\tmax %.1f\n", \
+           stats->latencyNs[numSamples*50/100] / 1000.0, stats->latencyNs[numSamples*90/100] / 1000.0, \
+           stats->latencyNs[numSamples*99/100] / 1000.0, stats->latencyNs[numSamples - 1] / 1000.0);
+
+    return;
+}
@@ -0,0 +1,41 @@
+/**
+ * Purpose: Watches the minefield by polling it at a fixed rate. Polls where
+ *          nothing changed are detected with a memcmp of each 32 byte row and
+ *          skipped. Otherwise only the tiles that changed are redrawn or
+ *          reported. Poll to display latency is tracked for every change
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include"memorySource.h"
+
+#define WATCH_INTERVAL_MS  50    // Default time between polls
+#define WATCH_MAX_SAMPLES  4096  // Latency samples kept (the most recent ones win)
+
+#define WATCH_DRAW    0  // Redraw changed tiles in place with ANSI escapes
+#define WATCH_REPORT  1  // Print the coordinates and new glyph of each changed tile
+#define WATCH_QUIET   2  // Do all the work but don't write anything. For load testing
+
+typedef struct watchConfig_s {
+    unsigned int intervalMs;        // Time between polls. 0 polls as fast as possible
+    unsigned long long maxPolls;    // Stop after this many polls. 0 means no limit
+    int display;                    // WATCH_DRAW, WATCH_REPORT or WATCH_QUIET
+    int (*onPoll)(void* context);   // Called before each poll. Return non-zero to stop
+    void* context;                  // Passed to onPoll
+} WatchConfig;
+
+typedef struct watchStats_s {
+    unsigned long long polls;          // Number of snapshots taken
+    unsigned long long skipped;        // Polls where nothing changed
+    unsigned long long tilesChanged;   // Tiles redrawn or reported
+    unsigned long long bytesWritten;   // Output produced
+    unsigned long long numSamples;     // Latency samples taken (may exceed WATCH_MAX_SAMPLES)
+    unsigned long long latencyNs[WATCH_MAX_SAMPLES];  // Poll to display latency of each change
+} WatchStats;
+
+void InitWatchConfig(WatchConfig* config);
+int WatchMineField(MemorySource* source, WatchConfig* config, WatchStats* stats);
+void PrintWatchStats(WatchStats* stats);
+
+#endif
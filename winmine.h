@@ -0,0 +1,46 @@
+/**
+ * Purpose: Memory layout of winmine.exe (the Windows XP minesweeper) along with
+ *          the handful of types the rest of the helper needs so the portable
+ *          pieces can also be built on Linux
+ */
+
+#ifndef WINMINE_H
+#define WINMINE_H
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<stdint.h>
+typedef uint32_t      DWORD;
+typedef unsigned char BYTE;
+#endif
+
+#define FLAG_TILE_FUNCTION     0x374F  // Offset to the function that flags a given tile
+#define NUM_MINES_OFFSET       0x5330  // Offset to the position in memory with the number of mines
+#define MINEFIELD_OFFSET       0x5340  // Offset to the start of the minefield in memory
+#define WIDTH_OFFSET           0x5334  // Offset to the position in memory containing the width of the field
+#define HEIGHT_OFFSET          0x5338  // Offset to the position in memory containing the height of the field
+#define MINES_REMAINING_OFFSET 0x5194  // Offset to the number of mines left to be found
+#define MINEFIELD_SIZE         0x35F   // Size of the minefield in memory
+#define BUFF_SIZE              1024    // Size of buffers
+#define MINE                   0x80    // A mine in memory
+#define REVEALED_TILE          0x40    // A tile that's been clicked on that's not a bomb
+#define UNCLICKED_SPACE        0x0F    // An unclicked tile in memory
+#define FLAG                   0x0E    // A flag in memory
+#define QUESTION_MARK          0x0D    // A question mark in memory
+#define EXPLODED_MINE          0xCC    // The mine you clicked on to lose the game
+#define WRONG_MINE             0x0B    // You put a flag over something that wasn't a mine
+#define REVEALED_MINE          0x0A    // Value of the least significant byte in memory when all mines are revealed
+#define BORDER_TILE            0x10    // The border winmine puts around the playable tiles
+
+#define ROW_STRIDE             32      // Each row of the minefield is 32 bytes, border included
+#define MAX_WIDTH              30      // Widest field winmine allows
+#define MAX_HEIGHT             24      // Tallest field winmine allows
+
+// The mine count, dimensions and minefield all live in one contiguous window
+// (0x5330 - 0x569F) so a snapshot can grab everything with a single read
+#define SNAPSHOT_OFFSET        NUM_MINES_OFFSET
+#define SNAPSHOT_SIZE          (MINEFIELD_OFFSET + MINEFIELD_SIZE - SNAPSHOT_OFFSET)
+#define MODULE_IMAGE_SIZE      0x6000  // Enough of the module to cover every offset above
+
+#endif
@@ -1,4 +1,12 @@
 #include<stdlib.h>
+#if defined(__linux__) && defined(__i386__)
+#include<stdio.h>
+#include<string.h>
+#include<sys/mman.h>
+#include"board.h"
+#include"flagStub.h"
+#include"timing.h"
+#endif
 /**
  * Note that a CALL instruction is: E8 <offset> where <offset> is the number of
  * bytes from 5 + the CALL instruction (CALL is 5 bytes) to the location we're
@@ -15,6 +23,7 @@
  */
 
 
+#if !defined(__linux__) || !defined(__i386__)
 // To pass two or more arguments to CreateRemoteThread, we'll use a struct
 // to put two DWORDs on the stack
 struct parameters_s {
@@ -22,6 +31,13 @@ struct parameters_s {
     int y;
 };
 
+// The batched version hands the stub a count followed by every location
+struct flagBatch_s {
+    int count;
+    struct parameters_s locations[];
+};
+#endif
+
 void aSecondDeeperTestFunction_oooo_spooky(int x, int y) {
 /**
  * Purpose: This is meant to emulate the function I actually
@@ -47,6 +63,112 @@ void testFunction(struct parameters_s* param) {
     return;
 }
 
+void flagBatch(struct flagBatch_s* batch) {
+/**
+ * Purpose: The batched flagging stub in flagStub.c is based on the compiled
+ *          result of this function. One remote thread walks every location
+ *          instead of one thread per mine.
+ * @param batch : struct flagBatch_s* - a count followed by that many locations
+ * @return void
+ */
+    for (int i = 0; i < (int)batch->count; i++) {
+        aSecondDeeperTestFunction_oooo_spooky(batch->locations[i].x, batch->locations[i].y);
+    }
+    return;
+}
+
+#if defined(__linux__) && defined(__i386__)
+/**
+ * Built as a 32-bit Linux program this file also checks the real loop stub.
+ * The stub generated by BuildFlagBatch is mapped executable and pointed at
+ * StandInFlagTile, a stdcall function that does what winmine's flag function
+ * does to its memory. Build with:
+ *   gcc -m32 -O2 -o winmineShellcode winmineShellcode.c flagStub.c board.c timing.c
+ */
+
+#define TEST_BOARDS 10000  // Number of boards to flag when timing the stub
+
+static unsigned char image[MODULE_IMAGE_SIZE];  // Synthetic winmine module
+static int tilesFlagged;                        // Calls made to StandInFlagTile
+
+void __attribute__((stdcall)) StandInFlagTile(int x, int y) {
+/**
+ * Purpose: Stands in for the function at FLAG_TILE_FUNCTION. Flags a blank
+ *          tile and decrements the number of mines left
+ * @param x : int - the x coord
+ * @param y : int - the y coord
+ * @return void
+ */
+    unsigned char* tile = image + MINEFIELD_OFFSET + x + y*32;
+    DWORD minesRemaining;
+
+    if ((*tile & 0x0F) != UNCLICKED_SPACE) return;
+    *tile = (unsigned char)((*tile & MINE) | FLAG);
+
+    memcpy(&minesRemaining, image + MINES_REMAINING_OFFSET, sizeof(DWORD));
+    minesRemaining--;
+    memcpy(image + MINES_REMAINING_OFFSET, &minesRemaining, sizeof(DWORD));
+    tilesFlagged++;
+}
+
+int main(void) {
+
+    // Local variables
+    struct parameters_s locations[MAX_WIDTH*MAX_HEIGHT];  // Every mine on the board
+    DWORD numLocations = 0;
+    unsigned char* field = image + MINEFIELD_OFFSET;
+    unsigned char* stub;                                   // Executable copy of the batch
+    DWORD minesRemaining;
+    unsigned long long start;
+    double nsPerBoard;
+
+    if (BuildBoard(image, 30, 16, 99, 1)) return 1;
+    for (int y = 1; y <= 16; y++) {
+        for (int x = 1; x <= 30; x++) {
+            if (field[x + y*32] & MINE) {
+                locations[numLocations].x = x;
+                locations[numLocations].y = y;
+                numLocations++;
+            }
+        }
+    }
+
+    stub = mmap(NULL, FlagBatchSize(numLocations), PROT_READ | PROT_WRITE | PROT_EXEC, \
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stub == MAP_FAILED) {
+        perror("Error mapping the stub");
+        return 1;
+    }
+    BuildFlagBatch(stub, (uint32_t)stub, (uint32_t)StandInFlagTile, locations, numLocations);
+
+    // Run it once and make sure every mine got exactly one flag
+    ((void (__attribute__((stdcall)) *)(void*))stub)(stub + FLAG_BATCH_OFFSET);
+    memcpy(&minesRemaining, image + MINES_REMAINING_OFFSET, sizeof(DWORD));
+    for (DWORD i = 0; i < numLocations; i++) {
+        if (field[locations[i].x + locations[i].y*32] != (MINE | FLAG)) {
+            printf("FAIL: mine at %d,%d wasn't flagged\n", locations[i].x, locations[i].y);
+            return 1;
+        }
+    }
+    if (tilesFlagged != (int)numLocations || minesRemaining != 0) {
+        printf("FAIL: %d flags placed, %u mines remaining\n", tilesFlagged, minesRemaining);
+        return 1;
+    }
+    printf("PASS: the loop stub flagged all %u mines\n", numLocations);
+
+    // Then time it per board
+    start = NowNs();
+    for (int i = 0; i < TEST_BOARDS; i++) {
+        BuildBoard(image, 30, 16, 99, 1);
+        ((void (__attribute__((stdcall)) *)(void*))stub)(stub + FLAG_BATCH_OFFSET);
+    }
+    nsPerBoard = (double)(NowNs() - start) / TEST_BOARDS;
+    printf("%.0f ns per expert board (board reset included)\n", nsPerBoard);
+
+    munmap(stub, FlagBatchSize(numLocations));
+    return 0;
+}
+#else
     
 int main(void) {
     
@@ -57,4 +179,5 @@ int main(void) {
     testFunction(&param);
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
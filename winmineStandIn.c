@@ -0,0 +1,99 @@
+/**
+ * Purpose: A Linux stand-in for winmine.exe. It maps a fake winmine module
+ *          (same offsets, same minefield layout, and code with the signatures
+ *          the offsets are found by) at winmine's usual base address and then
+ *          sits there so the helper can attach to it with
+ *          process_vm_readv. It also plays: clicks left in its click mailbox
+ *          (see board.h) are opened with winmine's reveal cascade when
+ *          SIGUSR1 arrives. Nothing about it is meant to run on
+ *          Windows
+ */
+
+#define _GNU_SOURCE  // memfd_create
+
+#include<signal.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/prctl.h>
+#include"board.h"
+#include"signature.h"
+
+#define WINMINE_BASE 0x01000000  // winmine isn't ASLR'd so it always loads here
+
+int main(int argc, char** argv) {
+
+    // Local variables
+    DWORD width    = argc > 1 ? (DWORD)atoi(argv[1]) : 30;   // Default to expert
+    DWORD height   = argc > 2 ? (DWORD)atoi(argv[2]) : 16;
+    DWORD numMines = argc > 3 ? (DWORD)atoi(argv[3]) : 99;
+    unsigned int seed = argc > 4 ? (unsigned int)atoi(argv[4]) : (unsigned int)getpid();
+    unsigned char* image;  // The fake winmine module
+    ClickMailbox* mailbox; // Where the helper leaves clicks
+    static unsigned char fresh[MODULE_IMAGE_SIZE];  // New games are dealt here first
+    sigset_t wake;         // SIGUSR1 says there are clicks in the mailbox
+
+    // SIGUSR1 would kill us until we're waiting for it
+    sigemptyset(&wake);
+    sigaddset(&wake, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &wake, NULL);
+
+    // Name the module and the process after winmine so they can be found the
+    // same way the real thing is (/proc/<pid>/comm and /proc/<pid>/maps)
+    int fd = memfd_create("winmine.exe", 0);
+    if (fd < 0 || ftruncate(fd, MODULE_IMAGE_SIZE)) {
+        perror("Error creating the module image");
+        return 1;
+    }
+    image = mmap((void*)WINMINE_BASE, MODULE_IMAGE_SIZE, PROT_READ | PROT_WRITE, \
+                 MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+    if (image == MAP_FAILED) {
+        image = mmap(NULL, MODULE_IMAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (image == MAP_FAILED) {
+            perror("Error mapping the module image");
+            return 1;
+        }
+    }
+    prctl(PR_SET_NAME, "winmine.exe");
+
+    if (BuildBoard(image, width, height, numMines, seed)) return 1;
+
+    // The code is the same every run, like the real binary's, so the offset cache can find it again
+    if (PlantSignatures(image, SIGNATURE_CODE_SIZE, (uint32_t)(uintptr_t)image, &builtinOffsets, 1)) return 1;
+
+    printf("PID: %d\t\tBase: 0x%08lx\t\tHeight: %u\t\tWidth: %u\t\tMines: %u\n", \
+           getpid(), (unsigned long)image, height, width, numMines);
+    fflush(stdout);
+
+    // Click whatever shows up in the mailbox until somebody kills us
+    mailbox = (ClickMailbox*)(image + CLICK_MAILBOX_OFFSET);
+    while (1) {
+        int received;
+
+        if (sigwait(&wake, &received)) continue;
+        while (__atomic_load_n(&mailbox->posted, __ATOMIC_ACQUIRE) != mailbox->done) {
+            unsigned short tile = mailbox->tiles[mailbox->done % CLICK_MAILBOX_TILES];
+            DWORD sequence = mailbox->sequence;
+
+            // Odd before the field changes and even again after, like a seqlock
+            __atomic_store_n(&mailbox->sequence, sequence + 1, __ATOMIC_RELEASE);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+
+            // A new game only replaces the counters and minefield. The code has to stay put
+            if (tile == CLICK_NEW_GAME) {
+                if (!BuildBoard(fresh, width, height, numMines, mailbox->newGame)) {
+                    memcpy(image + SNAPSHOT_OFFSET, fresh + SNAPSHOT_OFFSET, SNAPSHOT_SIZE);
+                    memcpy(image + MINES_REMAINING_OFFSET, fresh + MINES_REMAINING_OFFSET, sizeof(DWORD));
+                }
+            }
+            else ClickTiles(image + MINEFIELD_OFFSET, width, height, &tile, 1);
+
+            mailbox->done++;
+            __atomic_store_n(&mailbox->sequence, sequence + 2, __ATOMIC_RELEASE);
+        }
+    }
+
+    return 0;
+}